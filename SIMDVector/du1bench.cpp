@@ -0,0 +1,726 @@
+// du1bench.cpp
+// Petr Kubt NPRG051 2013/2014
+
+#include "du1bench.hpp"
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_dispatch.hpp"
+#include "du1simd_reduce.hpp"
+#include "du1simd_algorithm.hpp"
+#include "du1simd_blas.hpp"
+#include "du1simd_filter.hpp"
+#include "du1simd_sort.hpp"
+#include "du1simd_scan.hpp"
+#include "du1simd_histogram.hpp"
+#include "du1simd_gather.hpp"
+#include "du1simd_packed.hpp"
+#include "du1simd_stream.hpp"
+#include "du1simd_math.hpp"
+#include "du1simd_parallel.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <cmath>
+
+namespace du1bench {
+
+	namespace {
+
+		// Larger than the last level cache of current desktop and most server parts
+		const std::size_t flush_bytes = std::size_t( 128) << 20;
+
+		// Largest vector sorted, the sorts of the larger ones take seconds per call
+		const std::size_t sort_bytes = std::size_t( 16) << 20;
+
+		struct config {
+			options opt;
+			std::string filter;
+			std::size_t min_size;
+			std::size_t max_size;
+			std::string json;
+
+			config() : min_size( std::size_t( 16) << 10), max_size( std::size_t( 256) << 20) { }
+		};
+
+		template< typename simd_carrier_type>
+		struct kernels
+		{
+			typedef simd_vector< float, simd_carrier_type> vector_type;
+
+			typedef typename vector_type::iterator iterator;
+
+			typedef du1simd::simd< float, simd_carrier_type> simd_op;
+
+			// Keys of the histograms, the kernels do not use the carrier of the keys
+			typedef simd_vector< std::uint16_t, std::uint64_t> key_vector_type;
+
+			typedef key_vector_type::iterator key_iterator;
+
+			typedef simd_vector< std::uint32_t, typename du1simd::index_carrier< simd_carrier_type>::type> index_vector_type;
+
+			typedef typename index_vector_type::iterator index_iterator;
+
+			static void run( const std::string & carrier, const config & c, std::vector< result> & results)
+			{
+				for ( std::size_t bytes = c.min_size; bytes <= c.max_size; bytes *= 4)
+				{
+					std::size_t n = bytes / sizeof(float);
+					std::string suffix = "/" + carrier + "/" + std::to_string( n);
+
+					vector_type x( n, du1simd::uninitialized), y( n, du1simd::uninitialized);
+					du1simd::fill( x.begin(), x.end(), 1.0F);
+					du1simd::fill( y.begin(), y.end(), 2.0F);
+
+					add( results, c, "sum" + suffix, n, sizeof(float), [ & x](){
+						float s = du1simd::reduce_sum( x.begin(), x.end());
+						do_not_optimize( s);
+					});
+					add( results, c, "sum_prefetch_256" + suffix, n, sizeof(float), [ & x](){
+						float s = du1simd::reduce_sum< du1simd::default_accumulators, du1simd::prefetch_traversal< 256>>( x.begin(), x.end());
+						do_not_optimize( s);
+					});
+					add( results, c, "sum_prefetch_1024" + suffix, n, sizeof(float), [ & x](){
+						float s = du1simd::reduce_sum< du1simd::default_accumulators, du1simd::prefetch_traversal< 1024>>( x.begin(), x.end());
+						do_not_optimize( s);
+					});
+					add( results, c, "sum_prefetch_4096" + suffix, n, sizeof(float), [ & x](){
+						float s = du1simd::reduce_sum< du1simd::default_accumulators, du1simd::prefetch_traversal< 4096>>( x.begin(), x.end());
+						do_not_optimize( s);
+					});
+					add( results, c, "sum_tiled_4096" + suffix, n, sizeof(float), [ & x](){
+						float s = du1simd::reduce_sum< du1simd::default_accumulators, du1simd::prefetch_traversal< 4096, 4096>>( x.begin(), x.end());
+						do_not_optimize( s);
+					});
+					add( results, c, "sum_compensated" + suffix, n, sizeof(float), [ & x](){
+						float s = du1simd::reduce_sum< du1simd::default_accumulators, du1simd::sequential_traversal, du1simd::compensated_summation>( x.begin(), x.end());
+						do_not_optimize( s);
+					});
+
+					// x read by a source in batches of 64K elements, into a new vector per batch or through the pipeline
+					const std::size_t batch = std::min< std::size_t>( n, 1 << 16);
+					auto copy_batch = [ & x]( std::size_t & position, float * p, std::size_t m){
+						m = std::min( m, x.size() - position);
+						std::copy( x.begin() + position, x.begin() + position + m, p);
+						position += m;
+						return m;
+					};
+					add( results, c, "batch_sum" + suffix, n, 2 * sizeof(float), [ & x, batch, & copy_batch](){
+						std::size_t position = 0;
+						float s = 0;
+						while ( position < x.size())
+						{
+							vector_type b( batch, du1simd::uninitialized);
+							b.resize( copy_batch( position, du1simd::to_address( b.begin()), batch), du1simd::uninitialized);
+							s += du1simd::reduce_sum( b.begin(), b.end());
+						}
+						do_not_optimize( s);
+					});
+					du1simd::stream_pipeline< float, simd_carrier_type> pipeline( batch);
+					add( results, c, "stream_sum" + suffix, n, 2 * sizeof(float), [ & pipeline, & copy_batch](){
+						std::size_t position = 0;
+						du1simd::running_sum< float, simd_carrier_type> s;
+						pipeline.run( [ & position, & copy_batch]( float * p, std::size_t m){ return copy_batch( position, p, m); },
+							[ & s]( iterator b, iterator e){ s.add( b, e); });
+						do_not_optimize( s.value());
+					});
+					add( results, c, "dot" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						float s = du1simd::dot( x.begin(), x.end(), y.begin());
+						do_not_optimize( s);
+					});
+					add( results, c, "axpy" + suffix, n, 3 * sizeof(float), [ & x, & y](){
+						du1simd::axpy( 0.5F, x.begin(), x.end(), y.begin());
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "scal" + suffix, n, 2 * sizeof(float), [ & y](){
+						du1simd::scal( -1.0F, y.begin(), y.end());
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "nrm2" + suffix, n, sizeof(float), [ & x](){
+						float s = du1simd::nrm2( x.begin(), x.end());
+						do_not_optimize( s);
+					});
+					add( results, c, "asum" + suffix, n, sizeof(float), [ & x](){
+						float s = du1simd::asum( x.begin(), x.end());
+						do_not_optimize( s);
+					});
+					add( results, c, "iamax" + suffix, n, sizeof(float), [ & x](){
+						auto m = du1simd::iamax( x.begin(), x.end());
+						do_not_optimize( m);
+					});
+					add( results, c, "transform" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						simd_carrier_type two = simd_op::broadcast( 2.0F);
+						du1simd::transform( x.begin(), x.end(), y.begin(), [ two]( simd_carrier_type a){
+							return simd_op::mul( a, two);
+						});
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "exp" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						y = du1simd::exp( x);
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "fill" + suffix, n, sizeof(float), [ & y](){
+						du1simd::fill( y.begin(), y.end(), 3.0F);
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "copy" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						du1simd::copy( x.begin(), x.end(), y.begin());
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "parallel_copy" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						du1simd::parallel_copy( x.begin(), x.end(), y.begin());
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "inclusive_scan" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						du1simd::inclusive_scan( x.begin(), x.end(), y.begin());
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "parallel_inclusive_scan" + suffix, n, 3 * sizeof(float), [ & x, & y](){
+						du1simd::parallel_inclusive_scan( x.begin(), x.end(), y.begin());
+						do_not_optimize( * y.begin());
+					});
+
+					// Half of the elements selected in an unpredictable order
+					vector_type z( n, du1simd::uninitialized), w;
+					std::size_t i = 0;
+					for ( iterator b = z.begin(); b != z.end(); ++ b, ++ i)
+					{
+						* b = static_cast< float>( ( i * 7919) % 100);
+					}
+					w.reserve( n);
+					add( results, c, "count_if" + suffix, n, sizeof(float), [ & z](){
+						std::size_t m = du1simd::count_if( z.begin(), z.end(), du1simd::less< simd_carrier_type>( 50.0F));
+						do_not_optimize( m);
+					});
+					add( results, c, "copy_if" + suffix, n, 2 * sizeof(float), [ & z, & w](){
+						w.clear();
+						std::size_t m = du1simd::copy_if( z.begin(), z.end(), w, du1simd::less< simd_carrier_type>( 50.0F));
+						do_not_optimize( m);
+					});
+
+					// Skewed keys, four of five are the same, the values are grouped by the carrier
+					key_vector_type k( n, du1simd::uninitialized);
+					i = 0;
+					for ( key_iterator b = k.begin(); b != k.end(); ++ b, ++ i)
+					{
+						* b = static_cast< std::uint16_t>( i % 5 != 0 ? 7 : ( i * 7919) % 65536);
+					}
+					add( results, c, "histogram" + suffix, n, sizeof(std::uint16_t), [ & k](){
+						std::vector< std::uint64_t> h = du1simd::histogram( k.begin(), k.end());
+						do_not_optimize( h[ 7]);
+					});
+					add( results, c, "parallel_histogram" + suffix, n, sizeof(std::uint16_t), [ & k](){
+						std::vector< std::uint64_t> h = du1simd::parallel_histogram( k.begin(), k.end());
+						do_not_optimize( h[ 7]);
+					});
+					add( results, c, "group_by_sum" + suffix, n, sizeof(std::uint16_t) + sizeof(float), [ & k, & z](){
+						du1simd::group_table< float, simd_carrier_type> t = du1simd::group_by< du1simd::aggregate::sum>( k.begin(), k.end(), z.begin());
+						do_not_optimize( t.counts[ 7]);
+					});
+
+					// Random indices into the whole of x, the table is as large as the vectors
+					index_vector_type r( n, du1simd::uninitialized);
+					i = 0;
+					for ( index_iterator b = r.begin(); b != r.end(); ++ b, ++ i)
+					{
+						* b = static_cast< std::uint32_t>( ( i * 2654435761u) % n);
+					}
+					add( results, c, "gather" + suffix, n, 3 * sizeof(float), [ & x, & y, & r](){
+						du1simd::gather( x.begin(), x.end(), r.begin(), r.end(), y.begin());
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "gather_prefetch" + suffix, n, 3 * sizeof(float), [ & x, & y, & r](){
+						du1simd::gather( x.begin(), x.end(), r.begin(), r.end(), y.begin(), du1simd::gather_prefetch_distance);
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "scatter" + suffix, n, 3 * sizeof(float), [ & x, & y, & r](){
+						du1simd::scatter( y.begin(), y.end(), r.begin(), x.begin(), x.end());
+						do_not_optimize( * x.begin());
+					});
+
+					// Sorting a copy of distinct elements in an unpredictable order
+					if ( bytes <= sort_bytes)
+					{
+						vector_type u( n, du1simd::uninitialized);
+						i = 0;
+						for ( iterator b = z.begin(); b != z.end(); ++ b, ++ i)
+						{
+							* b = static_cast< float>( ( i * 7919) % 1000003);
+						}
+						add( results, c, "sort" + suffix, n, 2 * sizeof(float), [ & z, & u](){
+							std::copy( z.begin(), z.end(), u.begin());
+							du1simd::sort( u.begin(), u.end());
+							do_not_optimize( * u.begin());
+						});
+					}
+				}
+			}
+
+			template< typename F>
+			static void add( std::vector< result> & results, const config & c, const std::string & name, std::size_t n, std::size_t bytes_per_element, F f)
+			{
+				if ( ! c.filter.empty() && name.find( c.filter) == std::string::npos)
+				{
+					return;
+				}
+				results.push_back( du1bench::run( name, n, bytes_per_element, f, c.opt));
+				if ( c.json != "-")
+				{
+					print( results.back());
+				}
+			}
+		};
+
+#if DU1SIMD_HAVE_SSE
+		// Kernels over a column of 10-bit integers, plain and packed
+		template< typename simd_carrier_type>
+		struct integer_kernels
+		{
+			typedef simd_vector< std::uint32_t, simd_carrier_type> vector_type;
+
+			typedef packed_simd_vector< std::uint32_t, simd_carrier_type> packed_type;
+
+			static void run( const std::string & carrier, const config & c, std::vector< result> & results)
+			{
+				for ( std::size_t bytes = c.min_size; bytes <= c.max_size; bytes *= 4)
+				{
+					std::size_t n = bytes / sizeof(std::uint32_t);
+					std::string suffix = "/" + carrier + "/" + std::to_string( n);
+
+					vector_type x( n, du1simd::uninitialized);
+					std::size_t i = 0;
+					for ( auto b = x.begin(); b != x.end(); ++ b, ++ i)
+					{
+						* b = static_cast< std::uint32_t>( ( i * 7919) % 1000);
+					}
+					packed_type p( x.begin(), x.end());
+
+					// The bytes per element are those of the plain column, the packed kernels read fewer
+					kernels< float>::add( results, c, "widening_sum" + suffix, n, sizeof(std::uint32_t), [ & x](){
+						std::uint64_t s = du1simd::widening_sum( x.begin(), x.end());
+						do_not_optimize( s);
+					});
+					kernels< float>::add( results, c, "packed_widening_sum" + suffix, n, sizeof(std::uint32_t), [ & p](){
+						std::uint64_t s = du1simd::widening_sum( p);
+						do_not_optimize( s);
+					});
+					kernels< float>::add( results, c, "count_if" + suffix, n, sizeof(std::uint32_t), [ & x](){
+						std::size_t m = du1simd::count_if( x.begin(), x.end(), du1simd::less< simd_carrier_type>( 500u));
+						do_not_optimize( m);
+					});
+					kernels< float>::add( results, c, "packed_count_if" + suffix, n, sizeof(std::uint32_t), [ & p](){
+						std::size_t m = du1simd::count_if( p, du1simd::less< simd_carrier_type>( 500u));
+						do_not_optimize( m);
+					});
+				}
+			}
+		};
+#endif
+
+		// Element loops in the style of tester::sum, the baselines of the kernels
+		struct baselines
+		{
+			typedef simd_vector< float, float> vector_type;
+
+			typedef vector_type::iterator iterator;
+
+			static void run( const config & c, std::vector< result> & results)
+			{
+				for ( std::size_t bytes = c.min_size; bytes <= c.max_size; bytes *= 4)
+				{
+					std::size_t n = bytes / sizeof(float);
+					std::string suffix = "/baseline/" + std::to_string( n);
+
+					vector_type x( n, du1simd::uninitialized), y( n, du1simd::uninitialized);
+					std::fill( x.begin(), x.end(), 1.0F);
+					std::fill( y.begin(), y.end(), 2.0F);
+
+					add( results, c, "sum" + suffix, n, sizeof(float), [ & x](){
+						float s = 0;
+						for ( iterator b = x.begin(); b != x.end(); ++ b)
+						{
+							s = s + * b;
+						}
+						do_not_optimize( s);
+					});
+					add( results, c, "dot" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						float s = 0;
+						for ( iterator b = x.begin(), d = y.begin(); b != x.end(); ++ b, ++ d)
+						{
+							s = s + * b * * d;
+						}
+						do_not_optimize( s);
+					});
+					add( results, c, "axpy" + suffix, n, 3 * sizeof(float), [ & x, & y](){
+						for ( iterator b = x.begin(), d = y.begin(); b != x.end(); ++ b, ++ d)
+						{
+							* d = * d + 0.5F * * b;
+						}
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "scal" + suffix, n, 2 * sizeof(float), [ & y](){
+						for ( iterator b = y.begin(); b != y.end(); ++ b)
+						{
+							* b = * b * -1.0F;
+						}
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "nrm2" + suffix, n, sizeof(float), [ & x](){
+						float s = 0;
+						for ( iterator b = x.begin(); b != x.end(); ++ b)
+						{
+							s = s + * b * * b;
+						}
+						s = std::sqrt( s);
+						do_not_optimize( s);
+					});
+					add( results, c, "asum" + suffix, n, sizeof(float), [ & x](){
+						float s = 0;
+						for ( iterator b = x.begin(); b != x.end(); ++ b)
+						{
+							s = s + std::abs( * b);
+						}
+						do_not_optimize( s);
+					});
+					add( results, c, "iamax" + suffix, n, sizeof(float), [ & x](){
+						iterator m = x.begin();
+						for ( iterator b = x.begin(); b != x.end(); ++ b)
+						{
+							if ( std::abs( * b) > std::abs( * m))
+							{
+								m = b;
+							}
+						}
+						do_not_optimize( m);
+					});
+					add( results, c, "exp" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						for ( iterator b = x.begin(), d = y.begin(); b != x.end(); ++ b, ++ d)
+						{
+							* d = std::exp( * b);
+						}
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "copy" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						for ( iterator b = x.begin(), d = y.begin(); b != x.end(); ++ b, ++ d)
+						{
+							* d = * b;
+						}
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "inclusive_scan" + suffix, n, 2 * sizeof(float), [ & x, & y](){
+						float s = 0;
+						for ( iterator b = x.begin(), d = y.begin(); b != x.end(); ++ b, ++ d)
+						{
+							s = s + * b;
+							* d = s;
+						}
+						do_not_optimize( * y.begin());
+					});
+
+					vector_type z( n, du1simd::uninitialized), w;
+					std::size_t i = 0;
+					for ( iterator b = z.begin(); b != z.end(); ++ b, ++ i)
+					{
+						* b = static_cast< float>( ( i * 7919) % 100);
+					}
+					w.reserve( n);
+					add( results, c, "count_if" + suffix, n, sizeof(float), [ & z](){
+						std::size_t m = 0;
+						for ( iterator b = z.begin(); b != z.end(); ++ b)
+						{
+							if ( * b < 50.0F)
+							{
+								++ m;
+							}
+						}
+						do_not_optimize( m);
+					});
+					add( results, c, "copy_if" + suffix, n, 2 * sizeof(float), [ & z, & w](){
+						w.clear();
+						for ( iterator b = z.begin(); b != z.end(); ++ b)
+						{
+							if ( * b < 50.0F)
+							{
+								w.push_back( * b);
+							}
+						}
+						do_not_optimize( * w.begin());
+					});
+
+					kernels< float>::key_vector_type k( n, du1simd::uninitialized);
+					i = 0;
+					for ( kernels< float>::key_iterator b = k.begin(); b != k.end(); ++ b, ++ i)
+					{
+						* b = static_cast< std::uint16_t>( i % 5 != 0 ? 7 : ( i * 7919) % 65536);
+					}
+					add( results, c, "histogram" + suffix, n, sizeof(std::uint16_t), [ & k](){
+						std::vector< std::uint64_t> h( 65536);
+						for ( kernels< float>::key_iterator b = k.begin(); b != k.end(); ++ b)
+						{
+							++ h[ * b];
+						}
+						do_not_optimize( h[ 7]);
+					});
+					add( results, c, "group_by_sum" + suffix, n, sizeof(std::uint16_t) + sizeof(float), [ & k, & z](){
+						std::vector< float> t( 65536);
+						std::vector< std::uint64_t> h( 65536);
+						iterator d = z.begin();
+						for ( kernels< float>::key_iterator b = k.begin(); b != k.end(); ++ b, ++ d)
+						{
+							t[ * b] = t[ * b] + * d;
+							++ h[ * b];
+						}
+						do_not_optimize( h[ 7]);
+					});
+
+					kernels< float>::index_vector_type r( n, du1simd::uninitialized);
+					i = 0;
+					for ( kernels< float>::index_iterator b = r.begin(); b != r.end(); ++ b, ++ i)
+					{
+						* b = static_cast< std::uint32_t>( ( i * 2654435761u) % n);
+					}
+					add( results, c, "gather" + suffix, n, 3 * sizeof(float), [ & x, & y, & r](){
+						iterator d = y.begin();
+						for ( kernels< float>::index_iterator b = r.begin(); b != r.end(); ++ b, ++ d)
+						{
+							* d = x.begin()[ * b];
+						}
+						do_not_optimize( * y.begin());
+					});
+					add( results, c, "scatter" + suffix, n, 3 * sizeof(float), [ & x, & y, & r](){
+						iterator d = y.begin();
+						for ( kernels< float>::index_iterator b = r.begin(); b != r.end(); ++ b, ++ d)
+						{
+							x.begin()[ * b] = * d;
+						}
+						do_not_optimize( * x.begin());
+					});
+
+					if ( bytes <= sort_bytes)
+					{
+						vector_type u( n, du1simd::uninitialized);
+						i = 0;
+						for ( iterator b = z.begin(); b != z.end(); ++ b, ++ i)
+						{
+							* b = static_cast< float>( ( i * 7919) % 1000003);
+						}
+						add( results, c, "sort" + suffix, n, 2 * sizeof(float), [ & z, & u](){
+							std::copy( z.begin(), z.end(), u.begin());
+							std::sort( u.begin(), u.end());
+							do_not_optimize( * u.begin());
+						});
+					}
+				}
+			}
+
+			template< typename F>
+			static void add( std::vector< result> & results, const config & c, const std::string & name, std::size_t n, std::size_t bytes_per_element, F f)
+			{
+				kernels< float>::add( results, c, name, n, bytes_per_element, f);
+			}
+		};
+
+		bool parse_size( const char * s, std::size_t & value)
+		{
+			char * end;
+			unsigned long long v = std::strtoull( s, & end, 10);
+			if ( end == s || * end != 0 || v == 0)
+			{
+				return false;
+			}
+			value = static_cast< std::size_t>( v);
+			return true;
+		}
+
+		void usage()
+		{
+			std::cerr << "usage: SIMDVector --benchmark [--filter substring] [--min-size bytes] [--max-size bytes]" << std::endl
+				<< "                   [--repetitions n] [--cold] [--json file|-]" << std::endl;
+		}
+	}
+
+	void flush_caches()
+	{
+		static std::vector< unsigned char> buffer( flush_bytes);
+		unsigned char x = 0;
+		for ( std::size_t i = 0; i < buffer.size(); i += 64)
+		{
+			buffer[ i] = static_cast< unsigned char>( buffer[ i] + 1);
+			x = static_cast< unsigned char>( x + buffer[ i]);
+		}
+		do_not_optimize( x);
+	}
+
+	statistics compute_statistics( std::vector< double> samples)
+	{
+		statistics s;
+		s.median = s.mean = s.stddev = s.min = 0;
+		if ( samples.empty())
+		{
+			return s;
+		}
+		std::sort( samples.begin(), samples.end());
+		std::size_t n = samples.size();
+		s.median = ( n % 2 == 1) ? samples[ n / 2] : ( samples[ n / 2 - 1] + samples[ n / 2]) / 2;
+		s.min = samples[ 0];
+		double sum = 0;
+		for ( std::size_t i = 0; i < n; ++ i)
+		{
+			sum += samples[ i];
+		}
+		s.mean = sum / n;
+		double var = 0;
+		for ( std::size_t i = 0; i < n; ++ i)
+		{
+			var += ( samples[ i] - s.mean) * ( samples[ i] - s.mean);
+		}
+		s.stddev = n > 1 ? std::sqrt( var / ( n - 1)) : 0;
+		return s;
+	}
+
+	void print( const result & r)
+	{
+		std::cout << std::left << std::setw( 32) << r.name << std::right
+			<< std::setw( 14) << std::fixed << std::setprecision( 1) << r.seconds.median * 1e9 << " ns"
+			<< " +-" << std::setw( 5) << std::setprecision( 1) << ( r.seconds.median > 0 ? 100.0 * r.seconds.stddev / r.seconds.median : 0) << "%"
+			<< std::setw( 10) << std::setprecision( 2) << r.bandwidth / 1e9 << " GB/s"
+			<< std::setw( 10) << std::setprecision( 3) << r.cycles_per_element << " cycles/element"
+			<< std::defaultfloat << std::endl;
+	}
+
+	std::string to_json( const std::vector< result> & results)
+	{
+		std::ostringstream os;
+		os << std::setprecision( 9);
+		os << "{" << std::endl;
+		os << "  \"context\": {" << std::endl;
+		os << "    \"isa\": \"" << du1simd::isa_name( du1simd::best_isa()) << "\"," << std::endl;
+		os << "    \"hardware_threads\": " << std::thread::hardware_concurrency() << std::endl;
+		os << "  }," << std::endl;
+		os << "  \"benchmarks\": [" << std::endl;
+		for ( std::size_t i = 0; i < results.size(); ++ i)
+		{
+			const result & r = results[ i];
+			os << "    {" << std::endl;
+			os << "      \"name\": \"" << r.name << "\"," << std::endl;
+			os << "      \"elements\": " << r.elements << "," << std::endl;
+			os << "      \"bytes_per_element\": " << r.bytes_per_element << "," << std::endl;
+			os << "      \"calls_per_repetition\": " << r.calls_per_repetition << "," << std::endl;
+			os << "      \"repetitions\": " << r.repetitions << "," << std::endl;
+			os << "      \"median_ns\": " << r.seconds.median * 1e9 << "," << std::endl;
+			os << "      \"mean_ns\": " << r.seconds.mean * 1e9 << "," << std::endl;
+			os << "      \"stddev_ns\": " << r.seconds.stddev * 1e9 << "," << std::endl;
+			os << "      \"min_ns\": " << r.seconds.min * 1e9 << "," << std::endl;
+			os << "      \"bytes_per_second\": " << r.bandwidth << "," << std::endl;
+			os << "      \"cycles_per_element\": " << r.cycles_per_element << std::endl;
+			os << "    }" << ( i + 1 < results.size() ? "," : "") << std::endl;
+		}
+		os << "  ]" << std::endl;
+		os << "}" << std::endl;
+		return os.str();
+	}
+
+	int main( int argc, char * * argv)
+	{
+		config c;
+		for ( int i = 0; i < argc; ++ i)
+		{
+			std::string a = argv[ i];
+			bool has_value = i + 1 < argc;
+			if ( a == "--filter" && has_value)
+			{
+				c.filter = argv[ ++ i];
+			}
+			else if ( a == "--min-size" && has_value && parse_size( argv[ i + 1], c.min_size))
+			{
+				++ i;
+			}
+			else if ( a == "--max-size" && has_value && parse_size( argv[ i + 1], c.max_size))
+			{
+				++ i;
+			}
+			else if ( a == "--repetitions" && has_value && parse_size( argv[ i + 1], c.opt.repetitions))
+			{
+				++ i;
+			}
+			else if ( a == "--cold")
+			{
+				c.opt.cache = cache_state::cold;
+			}
+			else if ( a == "--json" && has_value)
+			{
+				c.json = argv[ ++ i];
+			}
+			else
+			{
+				usage();
+				return 1;
+			}
+		}
+
+		std::vector< result> results;
+
+		baselines::run( c, results);
+		kernels< float>::run( "float", c, results);
+#if DU1SIMD_HAVE_SSE
+		kernels< __m128>::run( "__m128", c, results);
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
+		{
+			kernels< __m256>::run( "__m256", c, results);
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			kernels< __m512>::run( "__m512", c, results);
+		}
+#endif
+#if DU1SIMD_HAVE_NEON
+		kernels< float32x4_t>::run( "float32x4_t", c, results);
+#endif
+#if DU1SIMD_HAVE_SVE
+		if ( du1simd::supports( du1simd::isa::sve))
+		{
+			kernels< du1simd::sve_float32_t>::run( "sve_float32_t", c, results);
+		}
+#endif
+#if DU1SIMD_HAVE_SSE
+		integer_kernels< __m128i>::run( "__m128i", c, results);
+#endif
+#if DU1SIMD_HAVE_AVX2
+		if ( du1simd::supports( du1simd::isa::avx2))
+		{
+			integer_kernels< __m256i>::run( "__m256i", c, results);
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512BW
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			integer_kernels< __m512i>::run( "__m512i", c, results);
+		}
+#endif
+
+		if ( c.json == "-")
+		{
+			std::cout << to_json( results);
+		}
+		else if ( ! c.json.empty())
+		{
+			std::ofstream f( c.json);
+			f << to_json( results);
+			if ( ! f)
+			{
+				std::cerr << "cannot write " << c.json << std::endl;
+				return 1;
+			}
+		}
+		return 0;
+	}
+};
@@ -0,0 +1,203 @@
+// du1bench.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Micro-benchmark harness
+//
+// du1bench::run( name, elements, bytes_per_element, f, options) measures f (one pass over elements
+// elements) as follows:
+//
+//	1. warmup: f is called until options.warmup_seconds elapsed (at least once), which also brings
+//	   the data into the caches for hot runs,
+//	2. the number of calls per repetition is chosen so that a repetition takes options.min_seconds,
+//	3. options.repetitions repetitions are timed, each by the steady clock and by the time stamp counter.
+//
+// The result holds the median, mean, standard deviation and minimum of the time per call together with
+// the bandwidth (bytes_per_element * elements / median) and the time stamp counter cycles per element.
+// With cache_state::cold the caches are flushed before every call and each repetition is a single call.
+//
+// The benchmarks of the library kernels are in du1bench.cpp, run them by
+//
+//	SIMDVector --benchmark [--filter substring] [--min-size bytes] [--max-size bytes] [--repetitions n]
+//		[--cold] [--json file|-]
+//
+// The kernels are named kernel/carrier/elements, each of them also runs as a plain loop over the elements
+// in the style of tester::sum (kernel/baseline/elements) to compare against.
+//
+// The JSON output lists one record per benchmark and is meant to be compared between builds.
+//
+
+#ifndef DU1BENCH_HPP
+#define DU1BENCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+// Includes immintrin.h before du1simd_ops.hpp does, the same GCC 12 diagnostics are suppressed
+#if !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <x86intrin.h>
+#if !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+namespace du1bench {
+
+	enum class cache_state {
+		// Data left in the caches by the warmup and the previous calls
+		hot,
+		// Caches flushed before every call
+		cold
+	};
+
+	struct options {
+		std::size_t repetitions;
+		double min_seconds;
+		double warmup_seconds;
+		cache_state cache;
+
+		options() : repetitions( 9), min_seconds( 0.01), warmup_seconds( 0.05), cache( cache_state::hot) { }
+	};
+
+	struct statistics {
+		double median;
+		double mean;
+		double stddev;
+		double min;
+	};
+
+	struct result {
+		std::string name;
+		std::size_t elements;
+		std::size_t bytes_per_element;
+		std::size_t calls_per_repetition;
+		std::size_t repetitions;
+		// Seconds per call
+		statistics seconds;
+		// Bytes per second at the median time
+		double bandwidth;
+		// Median time stamp counter ticks per element, 0 if not available
+		double cycles_per_element;
+	};
+
+	// Time stamp counter (reference cycles), the generic timer on AArch64, 0 on platforms without them
+	inline std::uint64_t cycles()
+	{
+#if ( defined(_MSC_VER) && ( defined(_M_IX86) || defined(_M_X64))) || (defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)))
+		return __rdtsc();
+#elif defined(__GNUC__) && defined(__aarch64__)
+		std::uint64_t t;
+		__asm__ __volatile__ ( "mrs %0, cntvct_el0" : "=r" ( t));
+		return t;
+#else
+		return 0;
+#endif
+	}
+
+	inline double now()
+	{
+		return std::chrono::duration< double>( std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Keeps the compiler from removing the computation of x
+	template< typename T>
+	void do_not_optimize( const T & x)
+	{
+#if defined(__GNUC__)
+		__asm__ __volatile__ ( "" : : "g" ( & x) : "memory");
+#else
+		static volatile unsigned char sink;
+		sink = * reinterpret_cast< const volatile unsigned char *>( & x);
+#endif
+	}
+
+	// Evicts the caches by writing and reading a buffer larger than the last level cache (du1bench.cpp)
+	void flush_caches();
+
+	// Single timed call of f in seconds
+	template< typename F>
+	double time_once( F f)
+	{
+		double tb = now();
+		f();
+		return now() - tb;
+	}
+
+	statistics compute_statistics( std::vector< double> samples);
+
+	template< typename F>
+	result run( const std::string & name, std::size_t elements, std::size_t bytes_per_element, F f, const options & opt = options())
+	{
+		result r;
+		r.name = name;
+		r.elements = elements;
+		r.bytes_per_element = bytes_per_element;
+		r.repetitions = opt.repetitions == 0 ? 1 : opt.repetitions;
+
+		// Warmup, also gives an estimate of the time per call
+		std::size_t warmup_calls = 0;
+		double tb = now();
+		double elapsed = 0;
+		do
+		{
+			f();
+			++ warmup_calls;
+			elapsed = now() - tb;
+		} while ( elapsed < opt.warmup_seconds);
+
+		double per_call = elapsed / warmup_calls;
+		std::size_t calls = 1;
+		if ( opt.cache == cache_state::hot && per_call > 0)
+		{
+			calls = std::max< std::size_t>( 1, static_cast< std::size_t>( std::ceil( opt.min_seconds / per_call)));
+		}
+		r.calls_per_repetition = calls;
+
+		std::vector< double> times, ticks;
+		for ( std::size_t i = 0; i < r.repetitions; ++ i)
+		{
+			if ( opt.cache == cache_state::cold)
+			{
+				flush_caches();
+			}
+			double t0 = now();
+			std::uint64_t c0 = cycles();
+			for ( std::size_t j = 0; j < calls; ++ j)
+			{
+				f();
+			}
+			std::uint64_t c1 = cycles();
+			double t1 = now();
+			times.push_back( ( t1 - t0) / calls);
+			ticks.push_back( static_cast< double>( c1 - c0) / calls);
+		}
+
+		r.seconds = compute_statistics( times);
+		r.bandwidth = r.seconds.median > 0 ? static_cast< double>( elements * bytes_per_element) / r.seconds.median : 0;
+		r.cycles_per_element = elements > 0 ? compute_statistics( ticks).median / elements : 0;
+		return r;
+	}
+
+	// Prints a human readable table row
+	void print( const result & r);
+
+	// Writes the results as a JSON document
+	std::string to_json( const std::vector< result> & results);
+
+	// Runs the library benchmarks, argv as described above (without the --benchmark switch)
+	int main( int argc, char * * argv);
+};
+
+#endif // DU1BENCH_HPP
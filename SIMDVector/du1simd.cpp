@@ -1,4 +1,1128 @@
 // du1simd.cpp
 // Petr Kubt NPRG051 2013/2014
 
-#include "du1simd.hpp"
\ No newline at end of file
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_dispatch.hpp"
+#include "du1simd_parallel.hpp"
+#include "du1simd_expr.hpp"
+#include "du1simd_mmap.hpp"
+#include "du1simd_filter.hpp"
+
+#include <new>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <iomanip>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#endif
+
+#if DU1SIMD_HAVE_SVE && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <cerrno>
+#include <linux/perf_event.h>
+#endif
+#endif
+
+namespace du1simd {
+
+	// Mask tables of the operation traits
+
+#if DU1SIMD_HAVE_SSE
+	const simd< float, __m128>::mask_data simd< float, __m128>::mask_data_;
+#endif
+
+	// The tables of __m256 are defined by du1simd_avx2.cpp, which compiles the carrier with GCC and Clang
+
+	const unsigned char detail::byte_mask_table_[ 192] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+	};
+
+	// Positions of the set bits of the masks of up to 8 lanes in increasing order (du1simd_filter.hpp)
+	const unsigned char detail::compress_index_table_[ 256][ 8] = {
+		{ 0, 0, 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0, 0, 0 }, { 1, 0, 0, 0, 0, 0, 0, 0 }, { 0, 1, 0, 0, 0, 0, 0, 0 },
+		{ 2, 0, 0, 0, 0, 0, 0, 0 }, { 0, 2, 0, 0, 0, 0, 0, 0 }, { 1, 2, 0, 0, 0, 0, 0, 0 }, { 0, 1, 2, 0, 0, 0, 0, 0 },
+		{ 3, 0, 0, 0, 0, 0, 0, 0 }, { 0, 3, 0, 0, 0, 0, 0, 0 }, { 1, 3, 0, 0, 0, 0, 0, 0 }, { 0, 1, 3, 0, 0, 0, 0, 0 },
+		{ 2, 3, 0, 0, 0, 0, 0, 0 }, { 0, 2, 3, 0, 0, 0, 0, 0 }, { 1, 2, 3, 0, 0, 0, 0, 0 }, { 0, 1, 2, 3, 0, 0, 0, 0 },
+		{ 4, 0, 0, 0, 0, 0, 0, 0 }, { 0, 4, 0, 0, 0, 0, 0, 0 }, { 1, 4, 0, 0, 0, 0, 0, 0 }, { 0, 1, 4, 0, 0, 0, 0, 0 },
+		{ 2, 4, 0, 0, 0, 0, 0, 0 }, { 0, 2, 4, 0, 0, 0, 0, 0 }, { 1, 2, 4, 0, 0, 0, 0, 0 }, { 0, 1, 2, 4, 0, 0, 0, 0 },
+		{ 3, 4, 0, 0, 0, 0, 0, 0 }, { 0, 3, 4, 0, 0, 0, 0, 0 }, { 1, 3, 4, 0, 0, 0, 0, 0 }, { 0, 1, 3, 4, 0, 0, 0, 0 },
+		{ 2, 3, 4, 0, 0, 0, 0, 0 }, { 0, 2, 3, 4, 0, 0, 0, 0 }, { 1, 2, 3, 4, 0, 0, 0, 0 }, { 0, 1, 2, 3, 4, 0, 0, 0 },
+		{ 5, 0, 0, 0, 0, 0, 0, 0 }, { 0, 5, 0, 0, 0, 0, 0, 0 }, { 1, 5, 0, 0, 0, 0, 0, 0 }, { 0, 1, 5, 0, 0, 0, 0, 0 },
+		{ 2, 5, 0, 0, 0, 0, 0, 0 }, { 0, 2, 5, 0, 0, 0, 0, 0 }, { 1, 2, 5, 0, 0, 0, 0, 0 }, { 0, 1, 2, 5, 0, 0, 0, 0 },
+		{ 3, 5, 0, 0, 0, 0, 0, 0 }, { 0, 3, 5, 0, 0, 0, 0, 0 }, { 1, 3, 5, 0, 0, 0, 0, 0 }, { 0, 1, 3, 5, 0, 0, 0, 0 },
+		{ 2, 3, 5, 0, 0, 0, 0, 0 }, { 0, 2, 3, 5, 0, 0, 0, 0 }, { 1, 2, 3, 5, 0, 0, 0, 0 }, { 0, 1, 2, 3, 5, 0, 0, 0 },
+		{ 4, 5, 0, 0, 0, 0, 0, 0 }, { 0, 4, 5, 0, 0, 0, 0, 0 }, { 1, 4, 5, 0, 0, 0, 0, 0 }, { 0, 1, 4, 5, 0, 0, 0, 0 },
+		{ 2, 4, 5, 0, 0, 0, 0, 0 }, { 0, 2, 4, 5, 0, 0, 0, 0 }, { 1, 2, 4, 5, 0, 0, 0, 0 }, { 0, 1, 2, 4, 5, 0, 0, 0 },
+		{ 3, 4, 5, 0, 0, 0, 0, 0 }, { 0, 3, 4, 5, 0, 0, 0, 0 }, { 1, 3, 4, 5, 0, 0, 0, 0 }, { 0, 1, 3, 4, 5, 0, 0, 0 },
+		{ 2, 3, 4, 5, 0, 0, 0, 0 }, { 0, 2, 3, 4, 5, 0, 0, 0 }, { 1, 2, 3, 4, 5, 0, 0, 0 }, { 0, 1, 2, 3, 4, 5, 0, 0 },
+		{ 6, 0, 0, 0, 0, 0, 0, 0 }, { 0, 6, 0, 0, 0, 0, 0, 0 }, { 1, 6, 0, 0, 0, 0, 0, 0 }, { 0, 1, 6, 0, 0, 0, 0, 0 },
+		{ 2, 6, 0, 0, 0, 0, 0, 0 }, { 0, 2, 6, 0, 0, 0, 0, 0 }, { 1, 2, 6, 0, 0, 0, 0, 0 }, { 0, 1, 2, 6, 0, 0, 0, 0 },
+		{ 3, 6, 0, 0, 0, 0, 0, 0 }, { 0, 3, 6, 0, 0, 0, 0, 0 }, { 1, 3, 6, 0, 0, 0, 0, 0 }, { 0, 1, 3, 6, 0, 0, 0, 0 },
+		{ 2, 3, 6, 0, 0, 0, 0, 0 }, { 0, 2, 3, 6, 0, 0, 0, 0 }, { 1, 2, 3, 6, 0, 0, 0, 0 }, { 0, 1, 2, 3, 6, 0, 0, 0 },
+		{ 4, 6, 0, 0, 0, 0, 0, 0 }, { 0, 4, 6, 0, 0, 0, 0, 0 }, { 1, 4, 6, 0, 0, 0, 0, 0 }, { 0, 1, 4, 6, 0, 0, 0, 0 },
+		{ 2, 4, 6, 0, 0, 0, 0, 0 }, { 0, 2, 4, 6, 0, 0, 0, 0 }, { 1, 2, 4, 6, 0, 0, 0, 0 }, { 0, 1, 2, 4, 6, 0, 0, 0 },
+		{ 3, 4, 6, 0, 0, 0, 0, 0 }, { 0, 3, 4, 6, 0, 0, 0, 0 }, { 1, 3, 4, 6, 0, 0, 0, 0 }, { 0, 1, 3, 4, 6, 0, 0, 0 },
+		{ 2, 3, 4, 6, 0, 0, 0, 0 }, { 0, 2, 3, 4, 6, 0, 0, 0 }, { 1, 2, 3, 4, 6, 0, 0, 0 }, { 0, 1, 2, 3, 4, 6, 0, 0 },
+		{ 5, 6, 0, 0, 0, 0, 0, 0 }, { 0, 5, 6, 0, 0, 0, 0, 0 }, { 1, 5, 6, 0, 0, 0, 0, 0 }, { 0, 1, 5, 6, 0, 0, 0, 0 },
+		{ 2, 5, 6, 0, 0, 0, 0, 0 }, { 0, 2, 5, 6, 0, 0, 0, 0 }, { 1, 2, 5, 6, 0, 0, 0, 0 }, { 0, 1, 2, 5, 6, 0, 0, 0 },
+		{ 3, 5, 6, 0, 0, 0, 0, 0 }, { 0, 3, 5, 6, 0, 0, 0, 0 }, { 1, 3, 5, 6, 0, 0, 0, 0 }, { 0, 1, 3, 5, 6, 0, 0, 0 },
+		{ 2, 3, 5, 6, 0, 0, 0, 0 }, { 0, 2, 3, 5, 6, 0, 0, 0 }, { 1, 2, 3, 5, 6, 0, 0, 0 }, { 0, 1, 2, 3, 5, 6, 0, 0 },
+		{ 4, 5, 6, 0, 0, 0, 0, 0 }, { 0, 4, 5, 6, 0, 0, 0, 0 }, { 1, 4, 5, 6, 0, 0, 0, 0 }, { 0, 1, 4, 5, 6, 0, 0, 0 },
+		{ 2, 4, 5, 6, 0, 0, 0, 0 }, { 0, 2, 4, 5, 6, 0, 0, 0 }, { 1, 2, 4, 5, 6, 0, 0, 0 }, { 0, 1, 2, 4, 5, 6, 0, 0 },
+		{ 3, 4, 5, 6, 0, 0, 0, 0 }, { 0, 3, 4, 5, 6, 0, 0, 0 }, { 1, 3, 4, 5, 6, 0, 0, 0 }, { 0, 1, 3, 4, 5, 6, 0, 0 },
+		{ 2, 3, 4, 5, 6, 0, 0, 0 }, { 0, 2, 3, 4, 5, 6, 0, 0 }, { 1, 2, 3, 4, 5, 6, 0, 0 }, { 0, 1, 2, 3, 4, 5, 6, 0 },
+		{ 7, 0, 0, 0, 0, 0, 0, 0 }, { 0, 7, 0, 0, 0, 0, 0, 0 }, { 1, 7, 0, 0, 0, 0, 0, 0 }, { 0, 1, 7, 0, 0, 0, 0, 0 },
+		{ 2, 7, 0, 0, 0, 0, 0, 0 }, { 0, 2, 7, 0, 0, 0, 0, 0 }, { 1, 2, 7, 0, 0, 0, 0, 0 }, { 0, 1, 2, 7, 0, 0, 0, 0 },
+		{ 3, 7, 0, 0, 0, 0, 0, 0 }, { 0, 3, 7, 0, 0, 0, 0, 0 }, { 1, 3, 7, 0, 0, 0, 0, 0 }, { 0, 1, 3, 7, 0, 0, 0, 0 },
+		{ 2, 3, 7, 0, 0, 0, 0, 0 }, { 0, 2, 3, 7, 0, 0, 0, 0 }, { 1, 2, 3, 7, 0, 0, 0, 0 }, { 0, 1, 2, 3, 7, 0, 0, 0 },
+		{ 4, 7, 0, 0, 0, 0, 0, 0 }, { 0, 4, 7, 0, 0, 0, 0, 0 }, { 1, 4, 7, 0, 0, 0, 0, 0 }, { 0, 1, 4, 7, 0, 0, 0, 0 },
+		{ 2, 4, 7, 0, 0, 0, 0, 0 }, { 0, 2, 4, 7, 0, 0, 0, 0 }, { 1, 2, 4, 7, 0, 0, 0, 0 }, { 0, 1, 2, 4, 7, 0, 0, 0 },
+		{ 3, 4, 7, 0, 0, 0, 0, 0 }, { 0, 3, 4, 7, 0, 0, 0, 0 }, { 1, 3, 4, 7, 0, 0, 0, 0 }, { 0, 1, 3, 4, 7, 0, 0, 0 },
+		{ 2, 3, 4, 7, 0, 0, 0, 0 }, { 0, 2, 3, 4, 7, 0, 0, 0 }, { 1, 2, 3, 4, 7, 0, 0, 0 }, { 0, 1, 2, 3, 4, 7, 0, 0 },
+		{ 5, 7, 0, 0, 0, 0, 0, 0 }, { 0, 5, 7, 0, 0, 0, 0, 0 }, { 1, 5, 7, 0, 0, 0, 0, 0 }, { 0, 1, 5, 7, 0, 0, 0, 0 },
+		{ 2, 5, 7, 0, 0, 0, 0, 0 }, { 0, 2, 5, 7, 0, 0, 0, 0 }, { 1, 2, 5, 7, 0, 0, 0, 0 }, { 0, 1, 2, 5, 7, 0, 0, 0 },
+		{ 3, 5, 7, 0, 0, 0, 0, 0 }, { 0, 3, 5, 7, 0, 0, 0, 0 }, { 1, 3, 5, 7, 0, 0, 0, 0 }, { 0, 1, 3, 5, 7, 0, 0, 0 },
+		{ 2, 3, 5, 7, 0, 0, 0, 0 }, { 0, 2, 3, 5, 7, 0, 0, 0 }, { 1, 2, 3, 5, 7, 0, 0, 0 }, { 0, 1, 2, 3, 5, 7, 0, 0 },
+		{ 4, 5, 7, 0, 0, 0, 0, 0 }, { 0, 4, 5, 7, 0, 0, 0, 0 }, { 1, 4, 5, 7, 0, 0, 0, 0 }, { 0, 1, 4, 5, 7, 0, 0, 0 },
+		{ 2, 4, 5, 7, 0, 0, 0, 0 }, { 0, 2, 4, 5, 7, 0, 0, 0 }, { 1, 2, 4, 5, 7, 0, 0, 0 }, { 0, 1, 2, 4, 5, 7, 0, 0 },
+		{ 3, 4, 5, 7, 0, 0, 0, 0 }, { 0, 3, 4, 5, 7, 0, 0, 0 }, { 1, 3, 4, 5, 7, 0, 0, 0 }, { 0, 1, 3, 4, 5, 7, 0, 0 },
+		{ 2, 3, 4, 5, 7, 0, 0, 0 }, { 0, 2, 3, 4, 5, 7, 0, 0 }, { 1, 2, 3, 4, 5, 7, 0, 0 }, { 0, 1, 2, 3, 4, 5, 7, 0 },
+		{ 6, 7, 0, 0, 0, 0, 0, 0 }, { 0, 6, 7, 0, 0, 0, 0, 0 }, { 1, 6, 7, 0, 0, 0, 0, 0 }, { 0, 1, 6, 7, 0, 0, 0, 0 },
+		{ 2, 6, 7, 0, 0, 0, 0, 0 }, { 0, 2, 6, 7, 0, 0, 0, 0 }, { 1, 2, 6, 7, 0, 0, 0, 0 }, { 0, 1, 2, 6, 7, 0, 0, 0 },
+		{ 3, 6, 7, 0, 0, 0, 0, 0 }, { 0, 3, 6, 7, 0, 0, 0, 0 }, { 1, 3, 6, 7, 0, 0, 0, 0 }, { 0, 1, 3, 6, 7, 0, 0, 0 },
+		{ 2, 3, 6, 7, 0, 0, 0, 0 }, { 0, 2, 3, 6, 7, 0, 0, 0 }, { 1, 2, 3, 6, 7, 0, 0, 0 }, { 0, 1, 2, 3, 6, 7, 0, 0 },
+		{ 4, 6, 7, 0, 0, 0, 0, 0 }, { 0, 4, 6, 7, 0, 0, 0, 0 }, { 1, 4, 6, 7, 0, 0, 0, 0 }, { 0, 1, 4, 6, 7, 0, 0, 0 },
+		{ 2, 4, 6, 7, 0, 0, 0, 0 }, { 0, 2, 4, 6, 7, 0, 0, 0 }, { 1, 2, 4, 6, 7, 0, 0, 0 }, { 0, 1, 2, 4, 6, 7, 0, 0 },
+		{ 3, 4, 6, 7, 0, 0, 0, 0 }, { 0, 3, 4, 6, 7, 0, 0, 0 }, { 1, 3, 4, 6, 7, 0, 0, 0 }, { 0, 1, 3, 4, 6, 7, 0, 0 },
+		{ 2, 3, 4, 6, 7, 0, 0, 0 }, { 0, 2, 3, 4, 6, 7, 0, 0 }, { 1, 2, 3, 4, 6, 7, 0, 0 }, { 0, 1, 2, 3, 4, 6, 7, 0 },
+		{ 5, 6, 7, 0, 0, 0, 0, 0 }, { 0, 5, 6, 7, 0, 0, 0, 0 }, { 1, 5, 6, 7, 0, 0, 0, 0 }, { 0, 1, 5, 6, 7, 0, 0, 0 },
+		{ 2, 5, 6, 7, 0, 0, 0, 0 }, { 0, 2, 5, 6, 7, 0, 0, 0 }, { 1, 2, 5, 6, 7, 0, 0, 0 }, { 0, 1, 2, 5, 6, 7, 0, 0 },
+		{ 3, 5, 6, 7, 0, 0, 0, 0 }, { 0, 3, 5, 6, 7, 0, 0, 0 }, { 1, 3, 5, 6, 7, 0, 0, 0 }, { 0, 1, 3, 5, 6, 7, 0, 0 },
+		{ 2, 3, 5, 6, 7, 0, 0, 0 }, { 0, 2, 3, 5, 6, 7, 0, 0 }, { 1, 2, 3, 5, 6, 7, 0, 0 }, { 0, 1, 2, 3, 5, 6, 7, 0 },
+		{ 4, 5, 6, 7, 0, 0, 0, 0 }, { 0, 4, 5, 6, 7, 0, 0, 0 }, { 1, 4, 5, 6, 7, 0, 0, 0 }, { 0, 1, 4, 5, 6, 7, 0, 0 },
+		{ 2, 4, 5, 6, 7, 0, 0, 0 }, { 0, 2, 4, 5, 6, 7, 0, 0 }, { 1, 2, 4, 5, 6, 7, 0, 0 }, { 0, 1, 2, 4, 5, 6, 7, 0 },
+		{ 3, 4, 5, 6, 7, 0, 0, 0 }, { 0, 3, 4, 5, 6, 7, 0, 0 }, { 1, 3, 4, 5, 6, 7, 0, 0 }, { 0, 1, 3, 4, 5, 6, 7, 0 },
+		{ 2, 3, 4, 5, 6, 7, 0, 0 }, { 0, 2, 3, 4, 5, 6, 7, 0 }, { 1, 2, 3, 4, 5, 6, 7, 0 }, { 0, 1, 2, 3, 4, 5, 6, 7 }
+	};
+
+	// CPU detection
+
+	namespace {
+
+#if DU1SIMD_HAVE_SSE
+		void cpuid( unsigned leaf, unsigned subleaf, unsigned regs[ 4])
+		{
+#if defined(_MSC_VER)
+			int r[ 4];
+			__cpuidex( r, static_cast< int>( leaf), static_cast< int>( subleaf));
+			for ( int i = 0; i < 4; ++ i)
+			{
+				regs[ i] = static_cast< unsigned>( r[ i]);
+			}
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+			if ( ! __get_cpuid_count( leaf, subleaf, & regs[ 0], & regs[ 1], & regs[ 2], & regs[ 3]))
+			{
+				regs[ 0] = regs[ 1] = regs[ 2] = regs[ 3] = 0;
+			}
+#else
+			(void)leaf;
+			(void)subleaf;
+			regs[ 0] = regs[ 1] = regs[ 2] = regs[ 3] = 0;
+#endif
+		}
+
+		// Register state enabled by the operating system (XCR0)
+		unsigned long long xgetbv0()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv( 0);
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+			unsigned lo, hi;
+			__asm__ __volatile__ ( "xgetbv" : "=a" ( lo), "=d" ( hi) : "c" ( 0));
+			return ( static_cast< unsigned long long>( hi) << 32) | lo;
+#else
+			return 0;
+#endif
+		}
+#endif
+
+#if DU1SIMD_HAVE_SVE
+		// SVE enabled by the operating system (HWCAP_SVE), the vector length is read by svcntb() only then
+		bool sve_enabled()
+		{
+#if defined(__linux__)
+			return ( getauxval( AT_HWCAP) & ( 1UL << 22)) != 0;
+#else
+			return false;
+#endif
+		}
+#endif
+
+	}
+
+	isa compiled_isa()
+	{
+#if DU1SIMD_HAVE_SVE
+		return isa::sve;
+#elif DU1SIMD_HAVE_NEON
+		return isa::neon;
+#elif DU1SIMD_HAVE_AVX512
+		return isa::avx512;
+#elif DU1SIMD_HAVE_AVX2
+		return isa::avx2;
+#elif DU1SIMD_HAVE_AVX
+		return isa::avx;
+#elif DU1SIMD_HAVE_SSE
+		return isa::sse3;
+#else
+		return isa::scalar;
+#endif
+	}
+
+	isa detect_isa()
+	{
+#if !DU1SIMD_HAVE_SSE
+#if DU1SIMD_HAVE_SVE
+		// The carrier is compiled for a single vector length
+		if ( sve_enabled() && svcntb() * 8 == __ARM_FEATURE_SVE_BITS)
+		{
+			return isa::sve;
+		}
+#endif
+#if DU1SIMD_HAVE_NEON
+		return isa::neon;
+#else
+		return isa::scalar;
+#endif
+#else
+		unsigned r1[ 4], r7[ 4];
+		cpuid( 0, 0, r1);
+		unsigned max_leaf = r1[ 0];
+
+		cpuid( 1, 0, r1);
+		if ( ! ( r1[ 2] & ( 1u << 0)))
+		{
+			return isa::scalar;
+		}
+
+		// AVX requires both the CPU flag and the OS saving the YMM state (OSXSAVE, XCR0 bits 1 and 2)
+		bool osxsave = ( r1[ 2] & ( 1u << 27)) != 0;
+		bool cpu_avx = ( r1[ 2] & ( 1u << 28)) != 0;
+		if ( ! osxsave || ! cpu_avx)
+		{
+			return isa::sse3;
+		}
+		unsigned long long xcr0 = xgetbv0();
+		if ( ( xcr0 & 0x06) != 0x06)
+		{
+			return isa::sse3;
+		}
+		if ( max_leaf < 7)
+		{
+			return isa::avx;
+		}
+
+		cpuid( 7, 0, r7);
+		bool cpu_avx2 = ( r7[ 1] & ( 1u << 5)) != 0;
+		bool cpu_avx512f = ( r7[ 1] & ( 1u << 16)) != 0;
+		bool cpu_avx512bw = ( r7[ 1] & ( 1u << 30)) != 0;
+
+		// AVX-512 additionally requires the opmask and ZMM state (XCR0 bits 5, 6 and 7)
+		// BW is required too, the integer carriers use its byte and word instructions
+		if ( cpu_avx512f && cpu_avx512bw && cpu_avx2 && ( xcr0 & 0xE6) == 0xE6)
+		{
+			return isa::avx512;
+		}
+		return cpu_avx2 ? isa::avx2 : isa::avx;
+#endif
+	}
+
+	namespace {
+
+		// The widest supported level the build contains code of, registers the kernels of the units
+		isa select_isa()
+		{
+			bool units[ isa_levels] = {};
+			units[ static_cast< std::size_t>( isa::avx2)] = detail::register_avx2_kernels();
+			units[ static_cast< std::size_t>( isa::avx512)] = detail::register_avx512_kernels();
+
+			isa level = detect_isa();
+			while ( level > compiled_isa() && ! units[ static_cast< std::size_t>( level)])
+			{
+				level = static_cast< isa>( static_cast< int>( level) - 1);
+			}
+			return level;
+		}
+	}
+
+	isa best_isa()
+	{
+		static const isa level = select_isa();
+		return level;
+	}
+
+	const char * isa_name( isa level)
+	{
+		switch ( level)
+		{
+		case isa::sse3:
+			return "sse3";
+		case isa::avx:
+			return "avx";
+		case isa::avx2:
+			return "avx2";
+		case isa::avx512:
+			return "avx512";
+		case isa::neon:
+			return "neon";
+		case isa::sve:
+			return "sve";
+		default:
+			return "scalar";
+		}
+	}
+
+	// Thread pool
+
+	thread_pool::thread_pool( std::size_t threads) : queued_( 0), stop_( false)
+	{
+		if ( threads == 0)
+		{
+			threads = std::thread::hardware_concurrency();
+		}
+		if ( threads == 0)
+		{
+			threads = 1;
+		}
+
+		for ( std::size_t i = 0; i < threads; ++ i)
+		{
+			queues_.push_back( std::unique_ptr< task_queue>( new task_queue));
+		}
+		for ( std::size_t i = 0; i + 1 < threads; ++ i)
+		{
+			workers_.push_back( std::thread( [ this, i](){ worker_loop( i); }));
+		}
+	}
+
+	thread_pool::~thread_pool()
+	{
+		{
+			std::lock_guard< std::mutex> lock( sleep_lock_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for ( auto & w : workers_)
+		{
+			w.join();
+		}
+	}
+
+	void thread_pool::submit( std::vector< task> & tasks)
+	{
+		std::size_t n = tasks.size();
+		std::size_t w = workers_.size();
+
+		for ( std::size_t q = 0; q < w; ++ q)
+		{
+			std::size_t from = q * n / w;
+			std::size_t to = ( q + 1) * n / w;
+			std::lock_guard< std::mutex> lock( queues_[ q]->lock);
+			for ( std::size_t i = from; i < to; ++ i)
+			{
+				queues_[ q]->tasks.push_back( std::move( tasks[ i]));
+			}
+		}
+		queued_ += n;
+
+		// Taking the lock orders the update of queued_ before any worker going to sleep
+		{
+			std::lock_guard< std::mutex> lock( sleep_lock_);
+		}
+		wake_.notify_all();
+	}
+
+	bool thread_pool::try_run_one( std::size_t home)
+	{
+		task t;
+		std::size_t n = queues_.size();
+
+		for ( std::size_t i = 0; i < n && ! t; ++ i)
+		{
+			task_queue & q = * queues_[ ( home + i) % n];
+			std::lock_guard< std::mutex> lock( q.lock);
+			if ( q.tasks.empty())
+			{
+				continue;
+			}
+			if ( i == 0)
+			{
+				t = std::move( q.tasks.back());
+				q.tasks.pop_back();
+			}
+			else
+			{
+				t = std::move( q.tasks.front());
+				q.tasks.pop_front();
+			}
+		}
+
+		if ( ! t)
+		{
+			return false;
+		}
+		-- queued_;
+		t();
+		return true;
+	}
+
+	void thread_pool::wait_for( const std::atomic< std::size_t> & pending)
+	{
+		// The calling thread owns the last queue, which is only ever stolen from
+		std::size_t home = queues_.size() - 1;
+		while ( pending != 0)
+		{
+			if ( ! try_run_one( home))
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void thread_pool::worker_loop( std::size_t index)
+	{
+		for ( ;;)
+		{
+			if ( try_run_one( index))
+			{
+				continue;
+			}
+			std::unique_lock< std::mutex> lock( sleep_lock_);
+			wake_.wait( lock, [ this](){ return stop_ || queued_ != 0; });
+			if ( stop_ && queued_ == 0)
+			{
+				return;
+			}
+		}
+	}
+
+	thread_pool & default_pool()
+	{
+		static thread_pool pool;
+		return pool;
+	}
+
+	// Page allocation
+
+	namespace {
+
+		thread_local int numa_error = 0;
+
+		const std::size_t huge_2mb_bytes = std::size_t( 1) << 21;
+		const std::size_t huge_1gb_bytes = std::size_t( 1) << 30;
+
+		// Granularity of the mapping requested by the options, the same for allocation and release
+		std::size_t page_granularity( const page_options & options)
+		{
+			switch ( options.pages)
+			{
+			case page_size::transparent_huge:
+			case page_size::huge_2mb:
+				return huge_2mb_bytes;
+			case page_size::huge_1gb:
+				return huge_1gb_bytes;
+			default:
+				return 4096;
+			}
+		}
+
+		std::size_t round_bytes( std::size_t bytes, std::size_t granularity)
+		{
+			return ( ( bytes + granularity - 1) / granularity) * granularity;
+		}
+
+#if defined(__linux__)
+		const int mpol_bind = 2;
+		const int mpol_interleave = 3;
+
+		// Nodes listed in /sys/devices/system/node/online ("0-3,5"), node 0 if it cannot be read
+		unsigned long online_nodes()
+		{
+			unsigned long mask = 0;
+			std::FILE * f = std::fopen( "/sys/devices/system/node/online", "r");
+			if ( f != NULL)
+			{
+				int from, to;
+				char sep;
+				while ( std::fscanf( f, "%d", & from) == 1)
+				{
+					to = from;
+					sep = '\n';
+					if ( std::fscanf( f, "%c", & sep) == 1 && sep == '-')
+					{
+						if ( std::fscanf( f, "%d", & to) != 1)
+						{
+							break;
+						}
+						sep = '\n';
+						if ( std::fscanf( f, "%c", & sep) != 1)
+						{
+							sep = '\n';
+						}
+					}
+					for ( int n = from; n <= to && n < static_cast< int>( 8 * sizeof( unsigned long)); ++ n)
+					{
+						mask |= 1UL << n;
+					}
+					if ( sep != ',')
+					{
+						break;
+					}
+				}
+				std::fclose( f);
+			}
+			return mask != 0 ? mask : 1UL;
+		}
+
+		// The node of a bind was checked by check_numa_node
+		void apply_numa_policy( void * p, std::size_t bytes, const page_options & options)
+		{
+			if ( options.numa == numa_policy::none)
+			{
+				return;
+			}
+			unsigned long mask;
+			int mode;
+			if ( options.numa == numa_policy::bind)
+			{
+				mask = 1UL << options.node;
+				mode = mpol_bind;
+			}
+			else
+			{
+				mask = online_nodes();
+				mode = mpol_interleave;
+			}
+			// Best effort, a refused policy leaves the default placement and is reported by last_numa_error()
+			if ( syscall( SYS_mbind, p, bytes, mode, & mask, 8 * sizeof( unsigned long), 0) != 0)
+			{
+				numa_error = errno;
+			}
+		}
+#endif
+
+		// Rejects a bind to a node out of the mask range or not online
+		void check_numa_node( const page_options & options)
+		{
+			if ( options.numa != numa_policy::bind)
+			{
+				return;
+			}
+			bool valid = options.node >= 0 && options.node < max_numa_nodes;
+#if defined(_WIN32)
+			ULONG highest = 0;
+			valid = valid && GetNumaHighestNodeNumber( & highest) && static_cast< ULONG>( options.node) <= highest;
+#elif defined(__linux__)
+			valid = valid && ( online_nodes() >> options.node & 1UL) != 0;
+#else
+			valid = valid && options.node == 0;
+#endif
+			if ( ! valid)
+			{
+				throw std::invalid_argument( "NUMA node does not exist!");
+			}
+		}
+	}
+
+	int last_numa_error()
+	{
+		return numa_error;
+	}
+
+	void * page_allocate( std::size_t bytes, const page_options & options)
+	{
+		if ( bytes == 0)
+		{
+			return nullptr;
+		}
+		check_numa_node( options);
+		numa_error = 0;
+
+		std::size_t granularity = page_granularity( options);
+		std::size_t size = round_bytes( bytes, granularity);
+
+#if defined(_WIN32)
+		void * p = nullptr;
+		if ( options.pages == page_size::huge_2mb || options.pages == page_size::huge_1gb)
+		{
+			// Large pages require SeLockMemoryPrivilege, fall back to regular pages without it
+			SIZE_T large = GetLargePageMinimum();
+			if ( large != 0 && size % large == 0)
+			{
+				p = VirtualAlloc( nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			}
+		}
+		if ( p == nullptr && options.numa == numa_policy::bind)
+		{
+			p = VirtualAllocExNuma( GetCurrentProcess(), nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, static_cast< DWORD>( options.node));
+			if ( p == nullptr)
+			{
+				numa_error = static_cast< int>( GetLastError());
+			}
+		}
+		if ( p == nullptr)
+		{
+			p = VirtualAlloc( nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		}
+		if ( p == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return p;
+#elif defined(__unix__) || defined(__APPLE__)
+		void * p = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+		if ( options.pages == page_size::huge_2mb || options.pages == page_size::huge_1gb)
+		{
+			// log2 of the page size in the MAP_HUGE_SHIFT bits
+			int shift = options.pages == page_size::huge_1gb ? 30 : 21;
+			p = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | ( shift << 26), -1, 0);
+		}
+#endif
+		if ( p == MAP_FAILED)
+		{
+			// Over-map by the granularity and trim to get an aligned region
+			std::size_t extra = granularity > 4096 ? granularity : 0;
+			char * q = static_cast< char *>( mmap( nullptr, size + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+			if ( q == MAP_FAILED)
+			{
+				throw std::bad_alloc();
+			}
+			std::size_t head = ( granularity - reinterpret_cast< std::uintptr_t>( q) % granularity) % granularity;
+			if ( extra != 0)
+			{
+				if ( head != 0)
+				{
+					munmap( q, head);
+				}
+				if ( extra - head != 0)
+				{
+					munmap( q + head + size, extra - head);
+				}
+			}
+			p = q + ( extra != 0 ? head : 0);
+#if defined(MADV_HUGEPAGE)
+			if ( options.pages != page_size::normal)
+			{
+				madvise( p, size, MADV_HUGEPAGE);
+			}
+#endif
+		}
+#if defined(__linux__)
+		apply_numa_policy( p, size, options);
+#endif
+		return p;
+#else
+		void * p = aligned_alloc( granularity, size);
+		if ( p == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return p;
+#endif
+	}
+
+	void page_deallocate( void * p, std::size_t bytes, const page_options & options)
+	{
+		if ( p == nullptr)
+		{
+			return;
+		}
+#if defined(_WIN32)
+		(void)bytes;
+		(void)options;
+		VirtualFree( p, 0, MEM_RELEASE);
+#elif defined(__unix__) || defined(__APPLE__)
+		munmap( p, round_bytes( bytes, page_granularity( options)));
+#else
+		(void)bytes;
+		(void)options;
+		free( p);
+#endif
+	}
+	// File mapping
+
+#if defined(_WIN32)
+	file_mapping::file_mapping() : data_( nullptr), size_( 0), mode_( map_mode::read_only), file_( INVALID_HANDLE_VALUE), section_( nullptr) { }
+#else
+	file_mapping::file_mapping() : data_( nullptr), size_( 0), mode_( map_mode::read_only), fd_( -1) { }
+#endif
+
+	file_mapping::file_mapping( const std::string & path, map_mode mode) : file_mapping()
+	{
+		open( path, mode, 0);
+	}
+
+	file_mapping::file_mapping( const std::string & path, std::size_t size) : file_mapping()
+	{
+		if ( size == 0)
+		{
+			throw mapping_exception( "Cannot create an empty mapping");
+		}
+		open( path, map_mode::read_write, size);
+	}
+
+	file_mapping::file_mapping( file_mapping && m) : file_mapping()
+	{
+		* this = std::move( m);
+	}
+
+	file_mapping & file_mapping::operator=( file_mapping && m)
+	{
+		std::swap( data_, m.data_);
+		std::swap( size_, m.size_);
+		std::swap( mode_, m.mode_);
+#if defined(_WIN32)
+		std::swap( file_, m.file_);
+		std::swap( section_, m.section_);
+#else
+		std::swap( fd_, m.fd_);
+#endif
+		return * this;
+	}
+
+	file_mapping::~file_mapping()
+	{
+		close();
+	}
+
+#if defined(_WIN32)
+	void file_mapping::open( const std::string & path, map_mode mode, std::size_t create_size)
+	{
+		bool writable = mode == map_mode::read_write;
+		mode_ = mode;
+		file_ = CreateFileA( path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr,
+			create_size != 0 ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if ( file_ == INVALID_HANDLE_VALUE)
+		{
+			throw mapping_exception( "Cannot open the file");
+		}
+		LARGE_INTEGER size;
+		if ( create_size != 0)
+		{
+			size.QuadPart = static_cast< LONGLONG>( create_size);
+		}
+		else if ( ! GetFileSizeEx( file_, & size) || size.QuadPart == 0)
+		{
+			close();
+			throw mapping_exception( "Cannot map an empty file");
+		}
+		// CreateFileMapping extends the file to the requested size, the new bytes are zero
+		section_ = CreateFileMappingA( file_, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+			static_cast< DWORD>( size.QuadPart >> 32), static_cast< DWORD>( size.QuadPart & 0xFFFFFFFF), nullptr);
+		if ( section_ == nullptr)
+		{
+			close();
+			throw mapping_exception( "Cannot create the file mapping");
+		}
+		data_ = MapViewOfFile( section_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+		if ( data_ == nullptr)
+		{
+			close();
+			throw mapping_exception( "Cannot map the file");
+		}
+		size_ = static_cast< std::size_t>( size.QuadPart);
+	}
+
+	void file_mapping::close()
+	{
+		if ( data_ != nullptr)
+		{
+			UnmapViewOfFile( data_);
+		}
+		if ( section_ != nullptr)
+		{
+			CloseHandle( section_);
+		}
+		if ( file_ != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle( file_);
+		}
+		data_ = nullptr;
+		size_ = 0;
+		section_ = nullptr;
+		file_ = INVALID_HANDLE_VALUE;
+	}
+
+	void file_mapping::advise( access_advice advice, std::size_t offset, std::size_t length) const
+	{
+		// Windows has no access pattern hints for views, only the prefetch of will_need (Windows 8)
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+		if ( advice == access_advice::will_need && data_ != nullptr && offset < size_)
+		{
+			WIN32_MEMORY_RANGE_ENTRY range;
+			range.VirtualAddress = static_cast< char *>( data_) + offset;
+			range.NumberOfBytes = ( length < size_ - offset) ? length : size_ - offset;
+			PrefetchVirtualMemory( GetCurrentProcess(), 1, & range, 0);
+		}
+#else
+		(void)advice;
+		(void)offset;
+		(void)length;
+#endif
+	}
+
+	void file_mapping::flush() const
+	{
+		if ( data_ != nullptr && mode_ == map_mode::read_write)
+		{
+			FlushViewOfFile( data_, 0);
+			FlushFileBuffers( file_);
+		}
+	}
+#else
+	void file_mapping::open( const std::string & path, map_mode mode, std::size_t create_size)
+	{
+		bool writable = mode == map_mode::read_write;
+		mode_ = mode;
+		fd_ = ::open( path.c_str(), writable ? ( create_size != 0 ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR) : O_RDONLY, 0644);
+		if ( fd_ < 0)
+		{
+			throw mapping_exception( "Cannot open the file");
+		}
+		std::size_t size = create_size;
+		if ( create_size != 0)
+		{
+			// The extended file reads as zeros
+			if ( ftruncate( fd_, static_cast< off_t>( create_size)) != 0)
+			{
+				close();
+				throw mapping_exception( "Cannot resize the file");
+			}
+		}
+		else
+		{
+			struct stat st;
+			if ( fstat( fd_, & st) != 0 || st.st_size == 0)
+			{
+				close();
+				throw mapping_exception( "Cannot map an empty file");
+			}
+			size = static_cast< std::size_t>( st.st_size);
+		}
+		void * p = mmap( nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd_, 0);
+		if ( p == MAP_FAILED)
+		{
+			close();
+			throw mapping_exception( "Cannot map the file");
+		}
+		data_ = p;
+		size_ = size;
+	}
+
+	void file_mapping::close()
+	{
+		if ( data_ != nullptr)
+		{
+			munmap( data_, size_);
+		}
+		if ( fd_ >= 0)
+		{
+			::close( fd_);
+		}
+		data_ = nullptr;
+		size_ = 0;
+		fd_ = -1;
+	}
+
+	void file_mapping::advise( access_advice advice, std::size_t offset, std::size_t length) const
+	{
+		if ( data_ == nullptr || offset >= size_)
+		{
+			return;
+		}
+		// madvise requires a page-aligned start, widen the range down to the page boundary
+		std::size_t page = static_cast< std::size_t>( sysconf( _SC_PAGESIZE));
+		std::size_t start = ( offset / page) * page;
+		std::size_t end = ( length < size_ - offset) ? offset + length : size_;
+		int a;
+		switch ( advice)
+		{
+		case access_advice::sequential:
+			a = POSIX_MADV_SEQUENTIAL;
+			break;
+		case access_advice::random:
+			a = POSIX_MADV_RANDOM;
+			break;
+		case access_advice::will_need:
+			a = POSIX_MADV_WILLNEED;
+			break;
+		case access_advice::dont_need:
+			a = POSIX_MADV_DONTNEED;
+			break;
+		default:
+			a = POSIX_MADV_NORMAL;
+			break;
+		}
+		// Only a hint, failures are ignored
+		posix_madvise( static_cast< char *>( data_) + start, end - start, a);
+	}
+
+	void file_mapping::flush() const
+	{
+		if ( data_ != nullptr && mode_ == map_mode::read_write)
+		{
+			msync( data_, size_, MS_SYNC);
+		}
+	}
+#endif
+
+	// Instrumentation
+
+	namespace {
+
+		struct registered_kernel {
+			std::string name;
+			instrument::counters c;
+
+			explicit registered_kernel( const char * n) : name( n) { }
+		};
+
+		// The deque never moves its elements, the references returned by kernel() stay valid
+		struct kernel_registry {
+			std::mutex lock;
+			std::deque< registered_kernel> kernels;
+		};
+
+		kernel_registry & registry()
+		{
+			static kernel_registry r;
+			return r;
+		}
+
+		std::atomic< bool> hardware_enabled( false);
+
+#if defined(__linux__)
+		// User space counter of the calling thread, a member of group or the leader of a new group if group is -1
+		int open_counter( std::uint64_t config, int group)
+		{
+			perf_event_attr a;
+			std::memset( & a, 0, sizeof(a));
+			a.type = PERF_TYPE_HARDWARE;
+			a.size = sizeof(a);
+			a.config = config;
+			a.disabled = ( group < 0) ? 1 : 0;
+			a.exclude_kernel = 1;
+			a.exclude_hv = 1;
+			a.read_format = PERF_FORMAT_GROUP;
+			return static_cast< int>( syscall( SYS_perf_event_open, & a, 0, -1, group, 0));
+		}
+
+		// Cycle and LLC miss counters of one thread, read together by one read() of the group leader
+		struct perf_group {
+			int leader;
+			int member;
+			bool opened;
+
+			perf_group() : leader( -1), member( -1), opened( false) { }
+
+			~perf_group()
+			{
+				if ( member >= 0)
+				{
+					::close( member);
+				}
+				if ( leader >= 0)
+				{
+					::close( leader);
+				}
+			}
+
+			// Opens the counters once, false if they are not available
+			bool open()
+			{
+				if ( ! opened)
+				{
+					opened = true;
+					leader = open_counter( PERF_COUNT_HW_CPU_CYCLES, -1);
+					if ( leader >= 0)
+					{
+						member = open_counter( PERF_COUNT_HW_CACHE_MISSES, leader);
+						if ( member < 0)
+						{
+							::close( leader);
+							leader = -1;
+						}
+						else
+						{
+							ioctl( leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+						}
+					}
+				}
+				return leader >= 0;
+			}
+
+			bool read( instrument::hardware_sample & s)
+			{
+				// nr followed by the values in the order of opening
+				std::uint64_t values[ 3];
+				if ( ! open() || ::read( leader, values, sizeof(values)) != static_cast< ssize_t>( sizeof(values)) || values[ 0] != 2)
+				{
+					return false;
+				}
+				s.cycles = values[ 1];
+				s.llc_misses = values[ 2];
+				return true;
+			}
+		};
+
+		perf_group & thread_counters()
+		{
+			thread_local perf_group g;
+			return g;
+		}
+#endif
+	}
+
+	namespace instrument {
+
+		counters & kernel( const char * name)
+		{
+			kernel_registry & r = registry();
+			std::lock_guard< std::mutex> guard( r.lock);
+			for ( auto & k : r.kernels)
+			{
+				if ( k.name == name)
+				{
+					return k.c;
+				}
+			}
+			r.kernels.emplace_back( name);
+			return r.kernels.back().c;
+		}
+
+		std::vector< kernel_stats> snapshot()
+		{
+			kernel_registry & r = registry();
+			std::lock_guard< std::mutex> guard( r.lock);
+			std::vector< kernel_stats> v;
+			v.reserve( r.kernels.size());
+			for ( auto & k : r.kernels)
+			{
+				kernel_stats s;
+				s.name = k.name;
+				s.calls = k.c.calls.load( std::memory_order_relaxed);
+				s.bytes = k.c.bytes.load( std::memory_order_relaxed);
+				s.blocks = k.c.blocks.load( std::memory_order_relaxed);
+				s.edge_blocks = k.c.edge_blocks.load( std::memory_order_relaxed);
+				s.nanoseconds = k.c.nanoseconds.load( std::memory_order_relaxed);
+				s.cycles = k.c.cycles.load( std::memory_order_relaxed);
+				s.llc_misses = k.c.llc_misses.load( std::memory_order_relaxed);
+				v.push_back( s);
+			}
+			return v;
+		}
+
+		void reset()
+		{
+			kernel_registry & r = registry();
+			std::lock_guard< std::mutex> guard( r.lock);
+			for ( auto & k : r.kernels)
+			{
+				k.c.calls.store( 0, std::memory_order_relaxed);
+				k.c.bytes.store( 0, std::memory_order_relaxed);
+				k.c.blocks.store( 0, std::memory_order_relaxed);
+				k.c.edge_blocks.store( 0, std::memory_order_relaxed);
+				k.c.nanoseconds.store( 0, std::memory_order_relaxed);
+				k.c.cycles.store( 0, std::memory_order_relaxed);
+				k.c.llc_misses.store( 0, std::memory_order_relaxed);
+			}
+		}
+
+		void report( std::ostream & os)
+		{
+			os << std::left << std::setw( 32) << "kernel" << std::right
+				<< std::setw( 10) << "calls" << std::setw( 16) << "bytes" << std::setw( 14) << "blocks" << std::setw( 8) << "edges"
+				<< std::setw( 12) << "ms" << std::setw( 10) << "GB/s" << std::setw( 16) << "cycles" << std::setw( 14) << "llc_misses" << std::endl;
+			for ( const kernel_stats & s : snapshot())
+			{
+				if ( s.calls == 0)
+				{
+					continue;
+				}
+				double gbs = ( s.nanoseconds != 0) ? static_cast< double>( s.bytes) / s.nanoseconds : 0.0;
+				os << std::left << std::setw( 32) << s.name << std::right
+					<< std::setw( 10) << s.calls << std::setw( 16) << s.bytes << std::setw( 14) << s.blocks << std::setw( 8) << s.edge_blocks
+					<< std::setw( 12) << std::fixed << std::setprecision( 3) << s.nanoseconds / 1e6 << std::setw( 10) << std::setprecision( 2) << gbs
+					<< std::setw( 16) << s.cycles << std::setw( 14) << s.llc_misses << std::endl;
+			}
+		}
+
+		bool enable_hardware_counters( bool on)
+		{
+			if ( on)
+			{
+#if defined(__linux__)
+				// The counters of the calling thread tell whether the kernel lets this process open them
+				on = thread_counters().open();
+#else
+				on = false;
+#endif
+			}
+			hardware_enabled.store( on, std::memory_order_relaxed);
+			return on;
+		}
+
+		bool hardware_counters_enabled()
+		{
+			return hardware_enabled.load( std::memory_order_relaxed);
+		}
+
+		bool read_hardware_counters( hardware_sample & s)
+		{
+			if ( ! hardware_enabled.load( std::memory_order_relaxed))
+			{
+				return false;
+			}
+#if defined(__linux__)
+			return thread_counters().read( s);
+#else
+			( void) s;
+			return false;
+#endif
+		}
+	}
+};
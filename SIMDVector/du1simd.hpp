@@ -18,18 +18,60 @@
 #include <memory>
 #include <exception>
 #include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <type_traits>
 
 #ifndef DU1SIMD_HPP
 #define DU1SIMD_HPP
 
-// Exception to be thrown if memory alignment fails in simd_vector constructor
-class alignment_exception : std::exception
-{
+#include "du1simd_alloc.hpp"
+#include "du1simd_instrument.hpp"
+
+// constexpr where the compiler supports it (Visual C++ 2013 does not), a plain const otherwise
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define DU1SIMD_CONSTEXPR
+#else
+#define DU1SIMD_CONSTEXPR constexpr
+#endif
+
+// C++20 contiguous iterators, std::to_address and the ranges algorithms see the iterators as pointers
+#if defined(__cpp_lib_to_address)
+#define DU1SIMD_HAVE_CONTIGUOUS_ITERATOR 1
+#else
+#define DU1SIMD_HAVE_CONTIGUOUS_ITERATOR 0
+#endif
+
+namespace du1simd {
 
+	// Number of elements of T in a block of S (the lane count), a power of two for all carriers
+	template< typename T, typename S>
+	struct lanes_of : std::integral_constant< std::size_t, sizeof(S) / sizeof(T)> { };
+
+	// n rounded up to a multiple of k, with k known at compile time the division is a shift
+	template< std::size_t k>
+	DU1SIMD_CONSTEXPR std::size_t round_up( std::size_t n)
+	{
+		return ( n % k == 0) ? n : ( n / k + 1) * k;
+	}
+
+	// Number of blocks of k elements covering n elements
+	template< std::size_t k>
+	DU1SIMD_CONSTEXPR std::size_t blocks_for( std::size_t n)
+	{
+		return n / k + ( n % k != 0 ? 1 : 0);
+	}
 };
 
 // simd_iterator
 
+// The iterator is a plain pointer to the block, so a loop over the blocks keeps a single register
+// T may be const, the blocks are const then (const_simd_iterator of simd_vector)
 template< typename T, typename S>
 class simd_vector_simd_iterator {
 	// Static check of type parameters
@@ -38,84 +80,102 @@ class simd_vector_simd_iterator {
 public:
 	typedef simd_vector_simd_iterator<T, S> self;
 
+	// S or const S
+	typedef typename std::conditional<std::is_const<T>::value, const S, S>::type block_type;
+
 	// Random access iterator category
 	typedef std::random_access_iterator_tag iterator_category;
+#if DU1SIMD_HAVE_CONTIGUOUS_ITERATOR
+	typedef std::contiguous_iterator_tag iterator_concept;
+#endif
 
 	// Iterator types
 	typedef S value_type;
+	typedef block_type element_type;
 	typedef std::ptrdiff_t difference_type;
-	typedef S* pointer;
-	typedef S& reference;
+	typedef block_type* pointer;
+	typedef block_type& reference;
 
 private:
-	// Pointer to beginning of correspondent simd_vector
-	S* base;
+	// Pointer to the current block
+	block_type* ptr;
 
-	// Iterator offset
-	difference_type offset;
-
-	simd_vector_simd_iterator(S* origin, difference_type off) : base(origin), offset(off) { }
+	explicit simd_vector_simd_iterator(block_type* p) : ptr(p) { }
 
 	template<typename U, typename K> friend class simd_vector_iterator;
+	template<typename U, typename K> friend class simd_vector_simd_iterator;
 
 public:
 	// Operator overloads
-	S& operator*() const { return base[offset]; }
-	S& operator[](const difference_type& n) const { return base[offset + n]; }
-	bool operator==(const self& v) const { return ((base == v.base) && (offset == v.offset)); }
-	bool operator!=(const self& v) const { return ((base != v.base) || (offset != v.offset)); }
-	bool operator<(const self& v) const { return ((base + offset) < (v.base + v.offset)); }
-	bool operator>(const self& v) const { return ((base + offset) > (v.base + v.offset)); }
-	bool operator<=(const self& v) const { return ((base + offset) <= (v.base + v.offset)); }
-	bool operator>=(const self& v) const { return ((base + offset) >= (v.base + v.offset)); }
+	block_type& operator*() const { return *ptr; }
+	block_type* operator->() const { return ptr; }
+	block_type& operator[](const difference_type& n) const { return ptr[n]; }
+
+	// Comparisons, also of a block iterator with a const block iterator
+	template< typename U>
+	bool operator==(const simd_vector_simd_iterator<U, S>& v) const { return ptr == v.ptr; }
+	template< typename U>
+	bool operator!=(const simd_vector_simd_iterator<U, S>& v) const { return ptr != v.ptr; }
+	template< typename U>
+	bool operator<(const simd_vector_simd_iterator<U, S>& v) const { return ptr < v.ptr; }
+	template< typename U>
+	bool operator>(const simd_vector_simd_iterator<U, S>& v) const { return ptr > v.ptr; }
+	template< typename U>
+	bool operator<=(const simd_vector_simd_iterator<U, S>& v) const { return ptr <= v.ptr; }
+	template< typename U>
+	bool operator>=(const simd_vector_simd_iterator<U, S>& v) const { return ptr >= v.ptr; }
 	self& operator++()
 	{
-		++offset;
+		++ptr;
 		return (*this);
 	}
 	self operator++(int)
 	{
 		self tmp = (*this);
-		++offset;
+		++ptr;
 		return tmp;
 	}
 	self& operator--()
 	{
-		--offset;
+		--ptr;
 		return (*this);
 	}
 	self operator--(int)
 	{
 		self tmp = (*this);
-		--offset;
+		--ptr;
 		return tmp;
 	}
 	self& operator+=(const difference_type& n)
 	{
-		offset += n;
+		ptr += n;
 		return (*this);
 	}
 	self& operator-=(const difference_type& n)
 	{
-		offset -= n;
+		ptr -= n;
 		return (*this);
 	}
-	difference_type operator-(const self& a) const
+	template< typename U>
+	difference_type operator-(const simd_vector_simd_iterator<U, S>& a) const
 	{
-		return (offset - a.offset);
+		return (ptr - a.ptr);
 	}
 
 	// Default constructor
-	simd_vector_simd_iterator() : base(nullptr), offset(0) { }
+	simd_vector_simd_iterator() : ptr(nullptr) { }
 
 	// Copy constructor
-	simd_vector_simd_iterator(const simd_vector_simd_iterator<T, S>& v) : base(v.base), offset(v.offset) { }
+	simd_vector_simd_iterator(const simd_vector_simd_iterator<T, S>& v) : ptr(v.ptr) { }
+
+	// Conversion of a block iterator to a const block iterator
+	template< typename U, typename = typename std::enable_if<std::is_same<const U, T>::value && !std::is_const<U>::value>::type>
+	simd_vector_simd_iterator(const simd_vector_simd_iterator<U, S>& v) : ptr(v.ptr) { }
 
 	// Copy assignment operator
 	simd_vector_simd_iterator<T, S>& operator=(const simd_vector_simd_iterator<T, S>& v)
 	{
-		base = v.base;
-		offset = v.offset;
+		ptr = v.ptr;
 		return (*this);
 	}
 };
@@ -142,6 +202,10 @@ simd_vector_simd_iterator< T, S> operator-(simd_vector_simd_iterator< T, S> a, s
 
 // iterator
 
+// The iterator is a plain pointer to the element, the block and the position within it are computed
+// from the address, the data of simd_vector and mapped_simd_vector are aligned to sizeof(S)
+// T may be const, the iterator is the const_iterator of simd_vector then
+// The kernels take both, they use value_type (T without const) as the element type of the operations
 template< typename T, typename S>
 class simd_vector_iterator {
 	// Static check of type parameters
@@ -153,112 +217,140 @@ public:
 
 	// Random access iterator category
 	typedef std::random_access_iterator_tag iterator_category;
+#if DU1SIMD_HAVE_CONTIGUOUS_ITERATOR
+	typedef std::contiguous_iterator_tag iterator_concept;
+#endif
 
 	// Iterator types
-	typedef T value_type;
+	typedef typename std::remove_const<T>::type value_type;
+	typedef T element_type;
 	typedef std::ptrdiff_t difference_type;
 	typedef T* pointer;
 	typedef T& reference;
 
 private:
-	// Pointer to beginning of correspondent simd_vector
-	T* base;
+	// Elements per block
+	static DU1SIMD_CONSTEXPR const difference_type k = du1simd::lanes_of<T, S>::value;
 
-	// Iterator offset
-	difference_type offset;
+	// Pointer to the current element
+	T* ptr;
 
 	// Constructor, should be called only from begin() and end() methods
-	simd_vector_iterator(T* origin, difference_type off) : base(origin), offset(off) {  }
+	explicit simd_vector_iterator(T* p) : ptr(p) {  }
+
+	// Position of the element within its block
+	difference_type position() const
+	{
+		return static_cast<difference_type>((reinterpret_cast<std::uintptr_t>(ptr) % sizeof(S)) / sizeof(T));
+	}
 
-	template<typename U, typename K> friend class simd_vector;
+	template<typename U, typename K, typename B> friend class simd_vector;
+	template<typename U, typename K> friend class mapped_simd_vector;
+	template<typename U, typename K> friend class simd_vector_iterator;
 
 public:
 	// simd_iterator related methods
 	simd_it lower_block() const
 	{
-		int k = sizeof(S) / sizeof(T);
-		return simd_it(reinterpret_cast<S*>(base), offset / k);
+		return simd_it(reinterpret_cast<typename simd_it::block_type*>(ptr - position()));
 	}
 
+	// The iterator is treated as the end of a range: upper_block() is one past the block containing
+	// the element preceding it and upper_offset() masks the elements of that block not in the range
 	simd_it upper_block() const
 	{
-		int k = sizeof(S) / sizeof(T);
-		return simd_it(reinterpret_cast<S*>(base), (offset / k) + 1);
+		difference_type p = position();
+		return simd_it(reinterpret_cast<typename simd_it::block_type*>(ptr - p + (p != 0 ? k : 0)));
 	}
 
 	difference_type lower_offset() const
 	{
-		int k = sizeof(S) / sizeof(T);
-		return (offset % k);
+		return position();
 	}
 
 	difference_type upper_offset() const
 	{
-		int k = sizeof(S) / sizeof(T);
-		return ((offset % k) - (k - 1));
+		difference_type p = position();
+		return (p != 0) ? p - k : 0;
 	}
 
 	// Operator overloads
-	T& operator*() const { return base[offset]; }
-	T& operator[](const difference_type& n) const { return base[offset + n]; }
-	bool operator==(const self& v) const { return ((base == v.base) && (offset == v.offset)); }
-	bool operator!=(const self& v) const { return ((base != v.base) || (offset != v.offset)); }
-	bool operator<(const self& v) const { return ((base + offset) < (v.base + v.offset)); }
-	bool operator>(const self& v) const { return ((base + offset) > (v.base + v.offset)); }
-	bool operator<=(const self& v) const { return ((base + offset) <= (v.base + v.offset)); }
-	bool operator>=(const self& v) const { return ((base + offset) >= (v.base + v.offset)); }
+	T& operator*() const { return *ptr; }
+	T* operator->() const { return ptr; }
+	T& operator[](const difference_type& n) const { return ptr[n]; }
+
+	// Comparisons, also of an iterator with a const_iterator
+	template< typename U>
+	bool operator==(const simd_vector_iterator<U, S>& v) const { return ptr == v.ptr; }
+	template< typename U>
+	bool operator!=(const simd_vector_iterator<U, S>& v) const { return ptr != v.ptr; }
+	template< typename U>
+	bool operator<(const simd_vector_iterator<U, S>& v) const { return ptr < v.ptr; }
+	template< typename U>
+	bool operator>(const simd_vector_iterator<U, S>& v) const { return ptr > v.ptr; }
+	template< typename U>
+	bool operator<=(const simd_vector_iterator<U, S>& v) const { return ptr <= v.ptr; }
+	template< typename U>
+	bool operator>=(const simd_vector_iterator<U, S>& v) const { return ptr >= v.ptr; }
 	self& operator++()
 	{
-		++offset;
+		++ptr;
 		return (*this);
 	}
 	self operator++(int)
 	{
 		self tmp = (*this);
-		++offset;
+		++ptr;
 		return tmp;
 	}
 	self& operator--()
 	{
-		--offset;
+		--ptr;
 		return (*this);
 	}
 	self operator--(int)
 	{
 		self tmp = (*this);
-		--offset;
+		--ptr;
 		return tmp;
 	}
 	self& operator+=(const difference_type& n)
 	{
-		offset += n;
+		ptr += n;
 		return (*this);
 	}
 	self& operator-=(const difference_type& n)
 	{
-		offset -= n;
+		ptr -= n;
 		return (*this);
 	}
-	difference_type operator-(const self& a) const
+	template< typename U>
+	difference_type operator-(const simd_vector_iterator<U, S>& a) const
 	{
-		return (offset - a.offset);
+		return (ptr - a.ptr);
 	}
 
 	// Default constructor
-	simd_vector_iterator() : base(nullptr), offset(0) {	}
+	simd_vector_iterator() : ptr(nullptr) {	}
 
 	// Copy constructor
-	simd_vector_iterator(const simd_vector_iterator<T, S>& v) : base(v.base), offset(v.offset) { }
+	simd_vector_iterator(const simd_vector_iterator<T, S>& v) : ptr(v.ptr) { }
+
+	// Conversion of an iterator to a const_iterator
+	template< typename U, typename = typename std::enable_if<std::is_same<const U, T>::value && !std::is_const<U>::value>::type>
+	simd_vector_iterator(const simd_vector_iterator<U, S>& v) : ptr(v.ptr) { }
 
 	// Copy assignment operator
 	simd_vector_iterator<T, S>& operator=(const simd_vector_iterator<T, S>& v)
 	{
-		base = v.base;
-		offset = v.offset;
+		ptr = v.ptr;
 		return (*this);
 	}
 };
 
+template< typename T, typename S>
+DU1SIMD_CONSTEXPR const typename simd_vector_iterator<T, S>::difference_type simd_vector_iterator<T, S>::k;
+
 // Addition and subtraction operators
 template< typename T, typename S>
 simd_vector_iterator< T, S> operator+( simd_vector_iterator< T, S> a, std::ptrdiff_t b)
@@ -278,20 +370,56 @@ simd_vector_iterator< T, S> operator-(simd_vector_iterator< T, S> a, std::ptrdif
 	return a -= b;
 }
 
+namespace du1simd {
+
+	// Address of the element an iterator refers to, also of the end of a range (std::to_address in C++20)
+	template< typename T, typename S>
+	T * to_address( const simd_vector_iterator< T, S> & it)
+	{
+		return it.operator->();
+	}
+
+	template< typename T, typename S>
+	typename simd_vector_simd_iterator< T, S>::pointer to_address( const simd_vector_simd_iterator< T, S> & it)
+	{
+		return it.operator->();
+	}
+};
+
+
+// Element-wise expression, see du1simd_expr.hpp
+namespace du1simd {
+	template< typename E, typename T, typename S>
+	struct expression;
+
+	// Size of an expression without vector operands (a broadcast scalar), it fits vectors of any size
+	const std::size_t any_size = SIZE_MAX;
+};
 
 // Vector class
 
-template< typename T, typename S>
+template< typename T, typename S, typename A = du1simd::simd_allocator<T, S> >
 class simd_vector {
 	// Static check of type parameters
 	static_assert(sizeof(S) % sizeof(T) == 0, "Incompatible type parameters!");
+	static_assert(std::is_same<typename A::value_type, T>::value, "Allocator value type must be T!");
 
 public:
-	typedef simd_vector<T, S> self;
+	typedef simd_vector<T, S, A> self;
+
+	typedef A allocator_type;
+
+	// Elements per block (k), the capacity is always a multiple of it
+	static DU1SIMD_CONSTEXPR const std::size_t lanes = du1simd::lanes_of<T, S>::value;
 
 private:
-	// k = sizeof(S) / sizeof(T)
-	int k;
+	typedef std::allocator_traits<A> alloc_traits;
+
+	// Number of elements allocated over the capacity, one block unless the allocator guarantees the alignment
+	static const std::size_t slack = (du1simd::allocator_alignment<A>::value % sizeof(S) == 0) ? 0 : lanes;
+
+	// Allocator of the data block
+	A alloc;
 	// Raw pointer to block of allocated data
 	T* raw_block;
 	// Pointer to beginning of the aligned data block
@@ -300,114 +428,546 @@ private:
 	T* aligned_end;
 	// Size of the container
 	std::size_t content_size;
+	// Number of elements the aligned data block can hold (always a multiple of lanes)
+	std::size_t content_capacity;
 
 	void swap(self& other)
 	{
-		std::swap(k, other.k);
+		std::swap(alloc, other.alloc);
 		std::swap(raw_block, other.raw_block);
 		std::swap(aligned_begin, other.aligned_begin);
 		std::swap(aligned_end, other.aligned_end);
 		std::swap(content_size, other.content_size);
+		std::swap(content_capacity, other.content_capacity);
 	}
 
-public:
-	typedef simd_vector_iterator< T, S> iterator;
-
-	typedef simd_vector_simd_iterator<T, S> simd_iterator;
+	// Round size to be divisible by lanes (we need all bigger blocks to be allocated and accesible)
+	static DU1SIMD_CONSTEXPR std::size_t round_count(std::size_t s)
+	{
+		return du1simd::round_up<lanes>(s);
+	}
 
-public:
-	explicit simd_vector( std::size_t s)
+	// Allocates an aligned block for rounded_count elements, the elements are not constructed
+	// Returns the aligned pointer; raw is set to the pointer which has to be passed to release_block
+	T* allocate_block(std::size_t rounded_count, T*& raw)
 	{
-		content_size = s;
+		if (rounded_count == 0)
+		{
+			raw = nullptr;
+			return nullptr;
+		}
 
-		k = sizeof(S) / sizeof(T);
+		// Required size must be higher because of alignment overhead (if the allocator does not align)
+		auto required_count = rounded_count + slack;
 
-		// Round size to be divisible by k (we need all bigger blocks to be allocated and accesible)
-		auto rounded_count = (s % k == 0) ? s : ((s / k) + 1) * k;
+		DU1SIMD_INSTRUMENT_BYTES("simd_vector::allocate", required_count * sizeof(T));
 
-#ifdef __GNUC__
-		// GCC ONLY CODE
+		// Allocating space for data block
+		raw = alloc_traits::allocate(alloc, required_count);
 
-		// Directly attempting to allocate aligned memory block
-		void* raw_pointer = aligned_alloc(sizeof(S), rounded_count * sizeof(T));
-		if (raw_pointer == NULL)
+		// Getting aligned pointer for the data block
+		void* tmp_begin = reinterpret_cast<void*>(raw);
+		std::size_t buffer_size = required_count * sizeof(T);
+
+		if (!std::align(sizeof(S), rounded_count * sizeof(T), tmp_begin, buffer_size))
 		{
+			alloc_traits::deallocate(alloc, raw, required_count);
 			throw alignment_exception();
 		}
-		aligned_begin = reinterpret_cast<T*>(raw_pointer);
-		raw_block = reinterpret_cast<T*>(raw_pointer);
 
-#else
-		// MSVC AND OTHER COMPILERS CODE
+		return reinterpret_cast<T*>(tmp_begin);
+	}
+
+	void release_block(T* raw, std::size_t rounded_count)
+	{
+		if (raw != nullptr)
+		{
+			alloc_traits::deallocate(alloc, raw, rounded_count + slack);
+		}
+	}
 
-		// First allocating bigger block and then performing aligning in it
+	void destroy(T* b, T* e)
+	{
+		for (; b != e; ++b)
+		{
+			alloc_traits::destroy(alloc, b);
+		}
+	}
 
-		// Required size must be higher because of alignment overhead
-		auto required_count = rounded_count + k;
+	// Uses the reallocate method of the allocator, only for trivially copyable elements and aligning allocators
+	bool try_reallocate(std::size_t new_capacity, std::true_type)
+	{
+		if (slack != 0 || raw_block == nullptr || new_capacity == 0)
+		{
+			return false;
+		}
+		raw_block = aligned_begin = alloc.reallocate(raw_block, content_capacity, new_capacity);
+		return true;
+	}
 
-		// Allocating space for data block
-		raw_block = new T[required_count];
+	bool try_reallocate(std::size_t, std::false_type)
+	{
+		return false;
+	}
 
-		// Getting aligned pointer for the data block
-		void* tmp_begin = reinterpret_cast<void*>(raw_block);
-		std::size_t buffer_size = required_count * sizeof(T);
+	// Moves the content into a new block of new_capacity (a multiple of k, at least content_size) elements
+	void reallocate(std::size_t new_capacity)
+	{
+		typedef std::integral_constant<bool, du1simd::allocator_reallocates<A>::value && std::is_trivially_copyable<T>::value> use_reallocate;
 
+		if (!try_reallocate(new_capacity, use_reallocate()))
+		{
+			T* new_raw;
+			T* new_begin = allocate_block(new_capacity, new_raw);
+			try
+			{
+				relocate(aligned_begin, aligned_begin + content_size, new_begin);
+			}
+			catch (...)
+			{
+				release_block(new_raw, new_capacity);
+				throw;
+			}
+			release_block(raw_block, content_capacity);
+
+			raw_block = new_raw;
+			aligned_begin = new_begin;
+		}
+		aligned_end = aligned_begin + content_size;
+		content_capacity = new_capacity;
+	}
 
-		if (!std::align(sizeof(S), rounded_count * sizeof(T), tmp_begin, buffer_size))
+	// Moves [b, e) to uninitialized storage starting at d and destroys the source elements
+	// Elements with a throwing move constructor are copied, if a constructor throws the elements built at d
+	// are destroyed and [b, e) is left intact
+	void relocate(T* b, T* e, T* d)
+	{
+		if (std::is_trivially_copyable<T>::value)
 		{
-			throw alignment_exception();
+			if (b != e)
+			{
+				std::memcpy(static_cast<void*>(d), static_cast<const void*>(b), (e - b) * sizeof(T));
+			}
+			return;
 		}
+		T* q = d;
+		try
+		{
+			for (T* p = b; p != e; ++p, ++q)
+			{
+				alloc_traits::construct(alloc, q, std::move_if_noexcept(*p));
+			}
+		}
+		catch (...)
+		{
+			destroy(d, q);
+			throw;
+		}
+		destroy(b, e);
+	}
 
-		aligned_begin = reinterpret_cast<T*>(tmp_begin);
+	// Capacity for at least n elements growing geometrically
+	std::size_t grown_capacity(std::size_t n) const
+	{
+		std::size_t doubled = 2 * content_capacity;
+		return round_count(n > doubled ? n : doubled);
+	}
+
+	// Allocates the block for s elements without constructing them
+	void initialize(std::size_t s)
+	{
+		content_size = s;
+
+		content_capacity = round_count(s);
+
+		aligned_begin = allocate_block(content_capacity, raw_block);
 
-#endif
 		aligned_end = aligned_begin + content_size;
+	}
+
+	// Copies the s elements at p to the start of the block, whose elements in [0, s) are not constructed
+	// Trivially copyable elements are copied by a single memcpy, both blocks start at a block boundary,
+	// so the library copies whole aligned vectors. Otherwise the elements are copy-constructed one by one, the block is released if a
+	// constructor throws.
+	void copy_construct(const T* p, std::size_t s)
+	{
+		if (std::is_trivially_copyable<T>::value)
+		{
+			if (s != 0)
+			{
+				std::memcpy(static_cast<void*>(aligned_begin), static_cast<const void*>(p), s * sizeof(T));
+			}
+			return;
+		}
+		T* d = aligned_begin;
+		try
+		{
+			for (; d != aligned_begin + s; ++d, ++p)
+			{
+				alloc_traits::construct(alloc, d, *p);
+			}
+		}
+		catch (...)
+		{
+			destroy(aligned_begin, d);
+			release_block(raw_block, content_capacity);
+			throw;
+		}
+	}
+
+	// Constructs the elements in [b, e) from args, the elements constructed so far are destroyed if a
+	// constructor throws
+	template< typename ... Args>
+	void construct_range(T* b, T* e, const Args& ... args)
+	{
+		T* p = b;
+		try
+		{
+			for (; p != e; ++p)
+			{
+				alloc_traits::construct(alloc, p, args...);
+			}
+		}
+		catch (...)
+		{
+			destroy(b, p);
+			throw;
+		}
+	}
+
+public:
+	typedef simd_vector_iterator< T, S> iterator;
+
+	typedef simd_vector_iterator< const T, S> const_iterator;
+
+	typedef simd_vector_simd_iterator<T, S> simd_iterator;
+
+	typedef simd_vector_simd_iterator<const T, S> const_simd_iterator;
+
+public:
+	// Empty vector, no memory is allocated
+	simd_vector() : alloc(), raw_block(nullptr), aligned_begin(nullptr), aligned_end(nullptr), content_size(0), content_capacity(0)
+	{
+	}
+
+	explicit simd_vector(const A& a) : alloc(a), raw_block(nullptr), aligned_begin(nullptr), aligned_end(nullptr), content_size(0), content_capacity(0)
+	{
+	}
+
+	// Vector of s value-initialized elements
+	explicit simd_vector( std::size_t s, const A& a = A()) : alloc(a)
+	{
+		initialize(s);
+
+		try
+		{
+			construct_range(aligned_begin, aligned_end);
+		}
+		catch (...)
+		{
+			release_block(raw_block, content_capacity);
+			throw;
+		}
+	}
+
+	// Vector of s uninitialized elements, skips the initialization pass for data about to be overwritten
+	simd_vector( std::size_t s, du1simd::uninitialized_t, const A& a = A()) : alloc(a)
+	{
+		static_assert(std::is_trivially_default_constructible<T>::value, "Uninitialized elements must be trivially constructible!");
 
+		initialize(s);
+	}
+
+	// Copy constructor, the copy has the capacity of the size rounded up to a multiple of k
+	simd_vector(const self& v) : alloc(alloc_traits::select_on_container_copy_construction(v.alloc))
+	{
+		initialize(v.content_size);
+		copy_construct(v.aligned_begin, v.content_size);
+	}
+
+	simd_vector(const self& v, const A& a) : alloc(a)
+	{
+		initialize(v.content_size);
+		copy_construct(v.aligned_begin, v.content_size);
 	}
 
 	// Move constructor
-	simd_vector(self&& v) : k(v.k), raw_block(v.raw_block), aligned_begin(v.aligned_begin), aligned_end(v.aligned_end), content_size(v.content_size)
+	simd_vector(self&& v) : alloc(std::move(v.alloc)), raw_block(v.raw_block), aligned_begin(v.aligned_begin), aligned_end(v.aligned_end), content_size(v.content_size), content_capacity(v.content_capacity)
 	{
 		v.raw_block = nullptr;
 		v.aligned_begin = nullptr;
 		v.aligned_end = nullptr;
+		v.content_size = 0;
+		v.content_capacity = 0;
+	}
+
+	// Copy assignment operator
+	// Trivially copyable elements are copied into the current block if it is large enough, otherwise a
+	// copy is built and swapped in, so the vector is left unchanged if the copy throws
+	simd_vector<T, S, A>& operator=(const self& v)
+	{
+		if (this == &v)
+		{
+			return (*this);
+		}
+
+		bool propagate = alloc_traits::propagate_on_container_copy_assignment::value && !(alloc == v.alloc);
+		if (!propagate && std::is_trivially_copyable<T>::value && v.content_size <= content_capacity)
+		{
+			if (v.content_size != 0)
+			{
+				std::memcpy(static_cast<void*>(aligned_begin), static_cast<const void*>(v.aligned_begin), v.content_size * sizeof(T));
+			}
+			content_size = v.content_size;
+			aligned_end = aligned_begin + content_size;
+		}
+		else
+		{
+			self tmp(v, alloc_traits::propagate_on_container_copy_assignment::value ? v.alloc : alloc);
+			swap(tmp);
+		}
+		return (*this);
 	}
 
 	// Move assignment operator
-	simd_vector<T, S>& operator=(self&& v)
+	simd_vector<T, S, A>& operator=(self&& v)
 	{
 		swap(v);
 		return (*this);
 	}
 
+	allocator_type get_allocator() const
+	{
+		return alloc;
+	}
+
+	// Expression assignment operator, evaluates the expression in a single pass over the blocks
+	// Throws std::length_error if the operand vectors are not of the size of this vector
+	template< typename E>
+	simd_vector<T, S, A>& operator=(const du1simd::expression<E, T, S>& e)
+	{
+		if (e.self().size() != du1simd::any_size && e.self().size() != content_size)
+		{
+			throw std::length_error("Expression operands of a different size!");
+		}
+
+		simd_iterator blocks = begin().lower_block();
+		std::size_t count = du1simd::blocks_for<lanes>(content_size);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			blocks[i] = e.self().block(i);
+		}
+		return (*this);
+	}
+
 	~simd_vector()
 	{
-#ifdef __GNUC__
-		// GCC code
-		// The memory was malloc-ed
-		free(raw_block);
-#else
-		// MSVC and other compilers code
-		// The memory was new-ed
-		delete raw_block;
-#endif
+		destroy(aligned_begin, aligned_end);
+		release_block(raw_block, content_capacity);
 	}
 
 	iterator begin()
 	{
-		return iterator(aligned_begin, 0);
+		return iterator(aligned_begin);
 	}
 
 	iterator end()
 	{
-		return iterator(aligned_begin, content_size);
+		return iterator(aligned_begin + content_size);
 	}
 
-	std::size_t size()
+	// Read-only access, a const vector may be scanned by several threads at once
+	const_iterator begin() const
+	{
+		return const_iterator(aligned_begin);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(aligned_begin + content_size);
+	}
+
+	const_iterator cbegin() const
+	{
+		return begin();
+	}
+
+	const_iterator cend() const
+	{
+		return end();
+	}
+
+	std::size_t size() const
 	{
 		return content_size;
 	}
+
+	// Number of elements which fit into the allocated block, a multiple of k
+	std::size_t capacity() const
+	{
+		return content_capacity;
+	}
+
+	bool empty() const
+	{
+		return content_size == 0;
+	}
+
+	// Makes room for at least n elements, invalidates the iterators if the block is reallocated
+	void reserve(std::size_t n)
+	{
+		if (n > content_capacity)
+		{
+			reallocate(round_count(n));
+		}
+	}
+
+	// Changes the size to n, the new elements are value-initialized
+	// The size is unchanged if a constructor throws
+	void resize(std::size_t n)
+	{
+		if (n > content_capacity)
+		{
+			reallocate(grown_capacity(n));
+		}
+		if (n > content_size)
+		{
+			construct_range(aligned_end, aligned_begin + n);
+		}
+		resize_down(n);
+	}
+
+	// Changes the size to n, the new elements are left uninitialized
+	void resize(std::size_t n, du1simd::uninitialized_t)
+	{
+		static_assert(std::is_trivially_default_constructible<T>::value, "Uninitialized elements must be trivially constructible!");
+
+		if (n > content_capacity)
+		{
+			reallocate(grown_capacity(n));
+		}
+		// A smaller size destroys the elements past it
+		resize_down(n);
+	}
+
+	// Changes the size to n, the new elements are copies of value
+	// The size is unchanged if a constructor throws
+	void resize(std::size_t n, const T& value)
+	{
+		if (n > content_size)
+		{
+			// value may refer to an element of the vector
+			T tmp(value);
+			if (n > content_capacity)
+			{
+				reallocate(grown_capacity(n));
+			}
+			construct_range(aligned_end, aligned_begin + n, tmp);
+		}
+		resize_down(n);
+	}
+
+	void push_back(const T& value)
+	{
+		emplace_back(value);
+	}
+
+	void push_back(T&& value)
+	{
+		emplace_back(std::move(value));
+	}
+
+	// Constructs a new element at the end, the capacity grows geometrically
+	template< typename ... Args>
+	T& emplace_back(Args&& ... args)
+	{
+		if (content_size == content_capacity)
+		{
+			// The new element is constructed before the old ones are moved, the arguments may refer to them
+			std::size_t new_capacity = grown_capacity(content_size + 1);
+			T* new_raw;
+			T* new_begin = allocate_block(new_capacity, new_raw);
+			try
+			{
+				alloc_traits::construct(alloc, new_begin + content_size, std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				release_block(new_raw, new_capacity);
+				throw;
+			}
+			try
+			{
+				relocate(aligned_begin, aligned_end, new_begin);
+			}
+			catch (...)
+			{
+				destroy(new_begin + content_size, new_begin + content_size + 1);
+				release_block(new_raw, new_capacity);
+				throw;
+			}
+			release_block(raw_block, content_capacity);
+
+			raw_block = new_raw;
+			aligned_begin = new_begin;
+			content_capacity = new_capacity;
+		}
+		else
+		{
+			alloc_traits::construct(alloc, aligned_begin + content_size, std::forward<Args>(args)...);
+		}
+		++content_size;
+		aligned_end = aligned_begin + content_size;
+		return aligned_begin[content_size - 1];
+	}
+
+	void pop_back()
+	{
+		assert(content_size > 0);
+		resize_down(content_size - 1);
+	}
+
+	void clear()
+	{
+		resize_down(0);
+	}
+
+	// Reduces the capacity to the size rounded up to a multiple of k
+	void shrink_to_fit()
+	{
+		std::size_t rounded = round_count(content_size);
+		if (rounded < content_capacity)
+		{
+			reallocate(rounded);
+		}
+	}
+
+private:
+	// Sets the size to n, destroying the elements past n if it shrinks
+	// The elements in [content_size, n) must have been constructed already
+	void resize_down(std::size_t n)
+	{
+		if (n < content_size)
+		{
+			destroy(aligned_begin + n, aligned_end);
+		}
+		content_size = n;
+		aligned_end = aligned_begin + content_size;
+	}
 };
 
+template< typename T, typename S, typename A>
+DU1SIMD_CONSTEXPR const std::size_t simd_vector<T, S, A>::lanes;
+
+
+#if DU1SIMD_HAVE_PMR
+namespace du1simd {
+	namespace pmr {
+		// simd_vector allocating from a std::pmr::memory_resource
+		template< typename T, typename S>
+		using simd_vector = ::simd_vector< T, S, std::pmr::polymorphic_allocator< T>>;
+	};
+};
+#endif
 
 #endif // DU1SIMD_HPP
@@ -0,0 +1,202 @@
+// du1simd_algorithm.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Block-wise writing algorithms over simd_vector ranges
+//
+// du1simd::fill( b, e, value), du1simd::generate_blocks( b, e, g), du1simd::transform( b, e, d, f) and
+// du1simd::copy( b, e, d) write whole simd blocks instead of single elements. Only the partial first and
+// last blocks of a range are written lane by lane, so the elements just outside of the range are never
+// touched.
+//
+// When the full blocks of the destination take at least threshold bytes, they are written by
+// non-temporal stores (du1simd::simd::stream) followed by a fence. Such stores bypass the caches and
+// do not read the destination lines first, which roughly halves the memory traffic of a large output
+// and does not evict the working set. Below the threshold the output is likely to be read again soon
+// and regular stores are used. default_streaming_threshold is a fraction of a typical last level cache,
+// pass 0 to always stream or SIZE_MAX to never stream.
+//
+
+#ifndef DU1SIMD_ALGORITHM_HPP
+#define DU1SIMD_ALGORITHM_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_split.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+namespace du1simd {
+
+	// Size of the output in bytes above which the block algorithms use non-temporal stores
+	const std::size_t default_streaming_threshold = std::size_t( 1) << 23;
+
+	namespace detail {
+
+		// Copies the lanes [lo, hi) of the block a to the block at p, the other lanes of p are kept
+		template< typename T, typename S>
+		void store_lanes( S * p, const S & a, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			std::memcpy( reinterpret_cast< char *>( p) + lo * sizeof(T), reinterpret_cast< const char *>( & a) + lo * sizeof(T), ( hi - lo) * sizeof(T));
+		}
+
+		// Writes make( i) to the i-th block covering [b, e), the blocks are produced in order
+		template< typename T, typename S, typename M>
+		void write_blocks( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, M & make, std::size_t threshold)
+		{
+			typedef simd< T, S> simd_op;
+			const std::ptrdiff_t k = lanes_of< T, S>::value;
+
+			if ( ! ( b < e))
+			{
+				return;
+			}
+
+			auto bb = b.lower_block();
+			auto ee = e.upper_block();
+			-- ee;
+
+			std::ptrdiff_t lgap = b.lower_offset();
+			std::ptrdiff_t ugap = e.upper_offset();
+
+			S * p = du1simd::to_address( bb);
+			S * last = du1simd::to_address( ee);
+			std::size_t i = 0;
+
+			if ( p == last)
+			{
+				store_lanes< T>( p, make( i), lgap, k + ugap);
+				return;
+			}
+
+			if ( lgap != 0)
+			{
+				store_lanes< T>( p, make( i), lgap, k);
+				++ p;
+				++ i;
+			}
+
+			S * body_end = ( ugap != 0) ? last : last + 1;
+
+			if ( static_cast< std::size_t>( body_end - p) * sizeof(S) >= threshold)
+			{
+				for ( ; p != body_end; ++ p, ++ i)
+				{
+					simd_op::stream( p, make( i));
+				}
+				simd_op::fence();
+			}
+			else
+			{
+				for ( ; p != body_end; ++ p, ++ i)
+				{
+					simd_op::store( p, make( i));
+				}
+			}
+
+			if ( ugap != 0)
+			{
+				store_lanes< T>( last, make( i), 0, k + ugap);
+			}
+		}
+	}
+
+	// Assigns value to the elements in [b, e)
+	template< typename T, typename S>
+	void fill( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, const T & value,
+		std::size_t threshold = default_streaming_threshold)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "fill", S, b, e, 1);
+
+		S block = simd< T, S>::broadcast( value);
+		auto make = [ & block]( std::size_t){ return block; };
+		detail::write_blocks( b, e, make, threshold);
+	}
+
+	// Assigns g() to the blocks covering [b, e), g is called once per block in order
+	// Only the lanes inside of the range are stored, lane j of a block receives the element at the
+	// position j within that block
+	template< typename T, typename S, typename G>
+	void generate_blocks( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, G g,
+		std::size_t threshold = default_streaming_threshold)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "generate_blocks", S, b, e, 1);
+
+		auto make = [ & g]( std::size_t){ return g(); };
+		detail::write_blocks( b, e, make, threshold);
+	}
+
+	// Writes f( block) of the blocks of [b, e) to the range starting at d and returns the end of the output
+	// f maps a carrier to a carrier, the lanes of its argument outside of the range are zero. If d has the
+	// same position within its block as b, the whole source blocks are passed directly, otherwise the
+	// blocks are assembled from the elements of the range. The source may be a const_iterator range.
+	template< typename U, typename T, typename S, typename F>
+	simd_vector_iterator< T, S> transform( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e, simd_vector_iterator< T, S> d, F f,
+		std::size_t threshold = default_streaming_threshold)
+	{
+		static_assert( std::is_same< typename std::remove_const< U>::type, T>::value, "Incompatible source and destination!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "transform", S, b, e, 2);
+
+		const std::ptrdiff_t k = lanes_of< T, S>::value;
+
+		std::ptrdiff_t n = e - b;
+		if ( n <= 0)
+		{
+			return d;
+		}
+
+		if ( b.lower_offset() == d.lower_offset())
+		{
+			// The whole blocks are passed directly, the partial ones are read by load_partial
+			block_split< U, S> s = split( b, e);
+			auto make = [ & s, & f]( std::size_t i) -> S {
+				if ( s.has_head())
+				{
+					if ( i == 0)
+					{
+						return f( load_head( s));
+					}
+					-- i;
+				}
+				return static_cast< std::ptrdiff_t>( i) < s.blocks() ? f( s.body_begin[ i]) : f( load_tail( s));
+			};
+			detail::write_blocks( d, d + n, make, threshold);
+		}
+		else
+		{
+			const T * src = du1simd::to_address( b);
+			std::ptrdiff_t lgap = d.lower_offset();
+			auto make = [ src, n, lgap, k, & f]( std::size_t i) -> S {
+				// Index of the source element of lane 0 of the i-th destination block
+				std::ptrdiff_t first = static_cast< std::ptrdiff_t>( i) * k - lgap;
+				std::ptrdiff_t lo = std::max< std::ptrdiff_t>( 0, - first);
+				std::ptrdiff_t hi = std::min< std::ptrdiff_t>( k, n - first);
+				S block = simd< T, S>::zero();
+				std::memcpy( reinterpret_cast< char *>( & block) + lo * sizeof(T), src + first + lo, ( hi - lo) * sizeof(T));
+				return f( block);
+			};
+			detail::write_blocks( d, d + n, make, threshold);
+		}
+
+		return d + n;
+	}
+
+	// Copies [b, e) to the range starting at d block by block and returns the end of the output
+	// If d has the same position within its block as b, the whole blocks are copied by aligned loads and
+	// stores, an output of at least threshold bytes is written by non-temporal stores
+	template< typename U, typename T, typename S>
+	simd_vector_iterator< T, S> copy( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e, simd_vector_iterator< T, S> d,
+		std::size_t threshold = default_streaming_threshold)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "copy", S, b, e, 2);
+
+		return du1simd::transform( b, e, d, []( S a){ return a; }, threshold);
+	}
+};
+
+#endif // DU1SIMD_ALGORITHM_HPP
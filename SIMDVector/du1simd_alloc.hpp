@@ -0,0 +1,288 @@
+// du1simd_alloc.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Allocators for simd_vector
+//
+// simd_vector< T, S, A> obtains its memory from the allocator A through std::allocator_traits, so any
+// standard allocator (including std::pmr::polymorphic_allocator) can be used. The allocator is
+// not required to return memory aligned to sizeof(S): simd_vector over-allocates by one block and
+// aligns the pointer itself, exactly as for plain operator new. An allocator which guarantees the
+// alignment declares it, which removes the overhead:
+//
+//	static const std::size_t alignment = 64;
+//
+// An allocator may also provide reallocate( p, old_count, new_count), returning a block of new_count
+// elements with the bitwise copy of the first min( old_count, new_count) elements of p (which is
+// released). simd_vector uses it for trivially copyable elements instead of allocate + memcpy.
+//
+// du1simd::page_allocator< T> maps memory directly from the operating system and can request huge
+// pages and NUMA placement, see page_options.
+//
+// With C++17, du1simd::pmr::simd_vector< T, S> is simd_vector with std::pmr::polymorphic_allocator.
+//
+// du1simd::simd_allocator< T, S> is the default allocator: with GCC it calls aligned_alloc and
+// reallocates by realloc where the malloc alignment is sufficient for S, elsewhere it uses operator
+// new and leaves the alignment to the vector.
+//
+
+#ifndef DU1SIMD_ALLOC_HPP
+#define DU1SIMD_ALLOC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <exception>
+#include <type_traits>
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#define DU1SIMD_HAVE_PMR 1
+#endif
+#endif
+#ifndef DU1SIMD_HAVE_PMR
+#define DU1SIMD_HAVE_PMR 0
+#endif
+
+#if DU1SIMD_HAVE_PMR
+#include <memory_resource>
+#endif
+
+// Exception to be thrown if memory alignment fails in simd_vector constructor
+class alignment_exception : std::exception
+{
+
+};
+
+namespace du1simd {
+
+	template< typename T, typename S>
+	class simd_allocator {
+	public:
+		typedef T value_type;
+		typedef T * pointer;
+		typedef const T * const_pointer;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+
+		template< typename U>
+		struct rebind {
+			typedef simd_allocator< U, S> other;
+		};
+
+#ifdef __GNUC__
+		static const std::size_t alignment = sizeof(S);
+#else
+		static const std::size_t alignment = alignof(T);
+#endif
+
+		simd_allocator() { }
+
+		template< typename U>
+		simd_allocator( const simd_allocator< U, S> &) { }
+
+		T * allocate( std::size_t n)
+		{
+#ifdef __GNUC__
+			// aligned_alloc requires the size to be a multiple of the alignment
+			std::size_t bytes = ( ( n * sizeof(T) + alignment - 1) / alignment) * alignment;
+			void * p = aligned_alloc( alignment, bytes);
+			if ( p == NULL)
+			{
+				throw alignment_exception();
+			}
+			return static_cast< T *>( p);
+#else
+			return static_cast< T *>( ::operator new( n * sizeof(T)));
+#endif
+		}
+
+		void deallocate( T * p, std::size_t)
+		{
+#ifdef __GNUC__
+			free( p);
+#else
+			::operator delete( p);
+#endif
+		}
+
+#ifdef __GNUC__
+		T * reallocate( T * p, std::size_t old_count, std::size_t new_count)
+		{
+			// realloc keeps only the malloc alignment
+			if ( alignment <= alignof(std::max_align_t))
+			{
+				void * q = realloc( static_cast< void *>( p), new_count * sizeof(T));
+				if ( q == NULL)
+				{
+					throw std::bad_alloc();
+				}
+				if ( reinterpret_cast< std::uintptr_t>( q) % alignment == 0)
+				{
+					return static_cast< T *>( q);
+				}
+				p = static_cast< T *>( q);
+				old_count = new_count;
+			}
+			T * r = allocate( new_count);
+			std::memcpy( static_cast< void *>( r), static_cast< const void *>( p), ( old_count < new_count ? old_count : new_count) * sizeof(T));
+			deallocate( p, old_count);
+			return r;
+		}
+#endif
+	};
+
+	template< typename T, typename U, typename S>
+	bool operator==( const simd_allocator< T, S> &, const simd_allocator< U, S> &)
+	{
+		return true;
+	}
+
+	template< typename T, typename U, typename S>
+	bool operator!=( const simd_allocator< T, S> &, const simd_allocator< U, S> &)
+	{
+		return false;
+	}
+
+	// Alignment guaranteed by the allocator A, alignof of its value type unless declared
+	template< typename A>
+	struct allocator_alignment {
+	private:
+		template< typename U>
+		static std::integral_constant< std::size_t, U::alignment> test( int);
+		template< typename U>
+		static std::integral_constant< std::size_t, alignof(typename U::value_type)> test( ...);
+	public:
+		static const std::size_t value = decltype( test< A>( 0))::value;
+	};
+
+	// Whether the allocator A provides reallocate( p, old_count, new_count)
+	template< typename A>
+	struct allocator_reallocates {
+	private:
+		template< typename U>
+		static std::true_type test( decltype( & U::reallocate));
+		template< typename U>
+		static std::false_type test( ...);
+	public:
+		static const bool value = decltype( test< A>( 0))::value;
+	};
+
+	// Page-level allocation
+
+	enum class page_size {
+		// Regular pages of the operating system
+		normal,
+		// Regular mapping aligned to 2MB and advised to be backed by transparent huge pages
+		transparent_huge,
+		// Explicit 2MB / 1GB huge pages (MAP_HUGETLB, MEM_LARGE_PAGES), transparent_huge if not available
+		huge_2mb,
+		huge_1gb
+	};
+
+	enum class numa_policy {
+		// First-touch placement of the operating system
+		none,
+		// All pages on options.node
+		bind,
+		// Pages interleaved round-robin over all nodes
+		interleave
+	};
+
+	// Nodes addressable by numa_policy::bind, the node masks of mbind are one unsigned long
+	const int max_numa_nodes = 8 * sizeof( unsigned long);
+
+	// The node of numa_policy::bind must be an online node below max_numa_nodes, page_allocate throws
+	// std::invalid_argument otherwise. The placement itself is best effort, a policy the system refuses
+	// (e.g. mbind blocked in a container) leaves the first-touch placement, see last_numa_error()
+	struct page_options {
+		page_size pages;
+		numa_policy numa;
+		int node;
+
+		page_options( page_size p = page_size::normal, numa_policy n = numa_policy::none, int nd = 0) : pages( p), numa( n), node( nd) { }
+	};
+
+	inline bool operator==( const page_options & a, const page_options & b)
+	{
+		return a.pages == b.pages && a.numa == b.numa && a.node == b.node;
+	}
+
+	// Maps bytes of memory directly from the operating system according to the options (du1simd.cpp)
+	// The page and NUMA requests are hints, a request the system cannot satisfy falls back to normal pages
+	// Throws std::invalid_argument for a bind to a node which does not exist
+	void * page_allocate( std::size_t bytes, const page_options & options);
+
+	// Error of the NUMA policy of the last page_allocate of the calling thread, 0 if the policy was applied
+	// or none was requested, errno of mbind on Linux, GetLastError() of VirtualAllocExNuma on Windows
+	int last_numa_error();
+
+	// Unmaps memory returned by page_allocate with the same bytes and options
+	void page_deallocate( void * p, std::size_t bytes, const page_options & options);
+
+	// Allocator mapping whole pages, intended for large vectors:
+	//
+	//	typedef simd_vector< float, __m256, du1simd::page_allocator< float>> big_vector;
+	//	big_vector v( n, du1simd::uninitialized, du1simd::page_allocator< float>(
+	//		du1simd::page_options( du1simd::page_size::transparent_huge, du1simd::numa_policy::interleave)));
+	//	du1simd::parallel_fill( v.begin(), v.end(), 0.0F);	// parallel first touch, du1simd_parallel.hpp
+	//
+	// The pages are only placed when they are first written to, so the vector should be created
+	// uninitialized and touched by the threads which will process each chunk.
+	template< typename T>
+	class page_allocator {
+	public:
+		typedef T value_type;
+
+		template< typename U>
+		struct rebind {
+			typedef page_allocator< U> other;
+		};
+
+		static const std::size_t alignment = 4096;
+
+		explicit page_allocator( const page_options & options = page_options()) : options_( options) { }
+
+		template< typename U>
+		page_allocator( const page_allocator< U> & a) : options_( a.options()) { }
+
+		T * allocate( std::size_t n)
+		{
+			return static_cast< T *>( page_allocate( n * sizeof(T), options_));
+		}
+
+		void deallocate( T * p, std::size_t n)
+		{
+			page_deallocate( p, n * sizeof(T), options_);
+		}
+
+		const page_options & options() const
+		{
+			return options_;
+		}
+	private:
+		page_options options_;
+	};
+
+	template< typename T, typename U>
+	bool operator==( const page_allocator< T> & a, const page_allocator< U> & b)
+	{
+		return a.options() == b.options();
+	}
+
+	template< typename T, typename U>
+	bool operator!=( const page_allocator< T> & a, const page_allocator< U> & b)
+	{
+		return ! ( a.options() == b.options());
+	}
+
+	// Tag of the constructors and methods which leave trivially constructible elements uninitialized
+	struct uninitialized_t {
+	};
+
+	const uninitialized_t uninitialized = uninitialized_t();
+};
+
+#endif // DU1SIMD_ALLOC_HPP
@@ -0,0 +1,36 @@
+// du1simd_avx2.cpp
+// Petr Kubt NPRG051 2013/2014
+
+// Kernels of isa::avx2, compiled by GCC and Clang with -mavx2 -mfma (see du1simd_dispatch.hpp)
+// Defines the mask tables of __m256 as well, the unit is a part of every build
+
+#include "du1simd_dispatch.hpp"
+#include "du1simd_reduce.hpp"
+
+namespace du1simd {
+
+	// Mask tables of the operation traits, defined whenever __m256 is compiled in
+#if DU1SIMD_HAVE_AVX
+	const std::int32_t simd< float, __m256>::lmask_table_[ 16] = {
+		0, 0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -1, -1, -1, -1, -1
+	};
+	const std::int32_t simd< float, __m256>::umask_table_[ 16] = {
+		-1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0
+	};
+#endif
+
+	namespace detail {
+
+		bool register_avx2_kernels()
+		{
+#if DU1SIMD_HAVE_AVX2
+			const std::size_t level = static_cast< std::size_t>( isa::avx2);
+			isa_entries< carrier_size_kernel>::entry[ level] = & carrier_size_kernel< __m256>::run;
+			isa_entries< reduce_sum_kernel>::entry[ level] = & reduce_sum_kernel< __m256>::run;
+			return true;
+#else
+			return false;
+#endif
+		}
+	}
+};
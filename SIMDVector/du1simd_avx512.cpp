@@ -0,0 +1,25 @@
+// du1simd_avx512.cpp
+// Petr Kubt NPRG051 2013/2014
+
+// Kernels of isa::avx512, compiled by GCC and Clang with -mavx512f -mavx512bw -mfma (see du1simd_dispatch.hpp)
+
+#include "du1simd_dispatch.hpp"
+#include "du1simd_reduce.hpp"
+
+namespace du1simd {
+
+	namespace detail {
+
+		bool register_avx512_kernels()
+		{
+#if DU1SIMD_HAVE_AVX512 && DU1SIMD_HAVE_AVX512BW
+			const std::size_t level = static_cast< std::size_t>( isa::avx512);
+			isa_entries< carrier_size_kernel>::entry[ level] = & carrier_size_kernel< __m512>::run;
+			isa_entries< reduce_sum_kernel>::entry[ level] = & reduce_sum_kernel< __m512>::run;
+			return true;
+#else
+			return false;
+#endif
+		}
+	}
+};
@@ -0,0 +1,372 @@
+// du1simd_blas.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// BLAS level 1 kernels over simd_vector ranges
+//
+//	dot< N>( xb, xe, yb)	sum of x[i] * y[i]
+//	axpy( a, xb, xe, yb)	y[i] += a * x[i]
+//	scal( a, xb, xe)	x[i] *= a
+//	nrm2< N>( xb, xe)	Euclidean norm, the sum of squares neither overflows nor underflows
+//	asum< N>( xb, xe)	sum of |x[i]|
+//	iamax( xb, xe)		first element of the largest |x[i]|, xe for an empty range
+//
+// x is the range [xb, xe), y the range of the same length starting at yb. The kernels work with float
+// and double elements and use du1simd::simd::fmadd (fused where DU1SIMD_HAVE_FMA), N independent
+// accumulators as in du1simd_reduce.hpp and du1simd::split for the ragged edges. The reductions may be
+// called without N, default_accumulators is used then.
+//
+// dot and axpy process whole blocks only if x and y have the same position within their blocks (e.g.
+// both start at begin() of their vectors), otherwise they fall back to a loop over the elements.
+//
+// The ranges which are only read (x of all the kernels except scal, y of dot) may be const_iterator ranges.
+//
+// nrm2 sums the squares directly and only if that sum overflows or underflows, it repeats the sum with
+// the elements divided by the largest magnitude. iamax does not handle NaN elements, the result is
+// unspecified then.
+//
+
+#ifndef DU1SIMD_BLAS_HPP
+#define DU1SIMD_BLAS_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_split.hpp"
+#include "du1simd_reduce.hpp"
+#include "du1simd_algorithm.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+namespace du1simd {
+
+	namespace detail {
+
+		// Number of blocks whose maximum is taken before it is compared with the best one so far (iamax)
+		const std::ptrdiff_t iamax_chunk = 64;
+
+		template< typename T, typename U, typename S>
+		typename std::remove_const< T>::type scalar_dot( simd_vector_iterator< T, S> xb, simd_vector_iterator< T, S> xe, simd_vector_iterator< U, S> yb)
+		{
+			typename std::remove_const< T>::type acc = 0;
+			for ( ; xb != xe; ++ xb, ++ yb)
+			{
+				acc = acc + * xb * * yb;
+			}
+			return acc;
+		}
+
+		template< typename T, typename U, typename S>
+		void scalar_axpy( T a, simd_vector_iterator< U, S> xb, simd_vector_iterator< U, S> xe, simd_vector_iterator< T, S> yb)
+		{
+			for ( ; xb != xe; ++ xb, ++ yb)
+			{
+				* yb = * yb + a * * xb;
+			}
+		}
+
+		// Block transformations of asum and nrm2
+		template< typename T, typename S>
+		struct abs_block {
+			S operator()( S a) const
+			{
+				return simd< T, S>::abs( a);
+			}
+		};
+
+		template< typename T, typename S>
+		struct square_block {
+			S operator()( S a) const
+			{
+				return simd< T, S>::mul( a, a);
+			}
+		};
+
+		// Square of a / d
+		template< typename T, typename S>
+		struct scaled_square_block {
+			S d;
+
+			explicit scaled_square_block( S divisor) : d( divisor) { }
+
+			S operator()( S a) const
+			{
+				S b = simd< T, S>::div( a, d);
+				return simd< T, S>::mul( b, b);
+			}
+		};
+	}
+
+	// Sum of x[i] * y[i] computed with N independent accumulators
+	template< std::size_t N, typename T, typename U, typename S>
+	typename std::remove_const< T>::type dot( simd_vector_iterator< T, S> xb, simd_vector_iterator< T, S> xe, simd_vector_iterator< U, S> yb)
+	{
+		typedef typename std::remove_const< T>::type value_type;
+
+		static_assert( N > 0, "At least one accumulator is required!");
+		static_assert( std::is_floating_point< value_type>::value, "Floating point element type required!");
+		static_assert( std::is_same< typename std::remove_const< U>::type, value_type>::value, "Incompatible element types!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "dot", S, xb, xe, 2);
+
+		typedef simd< value_type, S> simd_op;
+
+		std::ptrdiff_t n = xe - xb;
+		if ( n <= 0)
+		{
+			return 0;
+		}
+		if ( xb.lower_offset() != yb.lower_offset())
+		{
+			return detail::scalar_dot( xb, xe, yb);
+		}
+
+		block_split< T, S> sx = split( xb, xe);
+		block_split< U, S> sy = split( yb, yb + n);
+
+		S acc[ N];
+		detail::accumulators< value_type, S, N>::zero( acc);
+
+		// The lanes outside of the range are zero in both operands, so their products are zero
+		if ( sx.has_head())
+		{
+			acc[ 0] = simd_op::fmadd( load_head( sx), load_head( sy), acc[ 0]);
+		}
+
+		const S * p = sx.body_begin;
+		const S * q = sy.body_begin;
+		std::ptrdiff_t m = sx.blocks();
+
+		std::ptrdiff_t i = 0;
+		for ( ; i + static_cast< std::ptrdiff_t>( N) <= m; i += N)
+		{
+			for ( std::size_t j = 0; j < N; ++ j)
+			{
+				acc[ j] = simd_op::fmadd( p[ i + j], q[ i + j], acc[ j]);
+			}
+		}
+		for ( std::size_t j = 0; i < m; ++ i, ++ j)
+		{
+			acc[ j] = simd_op::fmadd( p[ i], q[ i], acc[ j]);
+		}
+
+		if ( sx.has_tail())
+		{
+			acc[ N - 1] = simd_op::fmadd( load_tail( sx), load_tail( sy), acc[ N - 1]);
+		}
+
+		return simd_op::sum( detail::accumulators< value_type, S, N>::combine( acc));
+	}
+
+	template< typename T, typename U, typename S>
+	typename std::remove_const< T>::type dot( simd_vector_iterator< T, S> xb, simd_vector_iterator< T, S> xe, simd_vector_iterator< U, S> yb)
+	{
+		return dot< default_accumulators>( xb, xe, yb);
+	}
+
+	// y[i] += a * x[i]
+	template< typename T, typename U, typename S>
+	void axpy( T a, simd_vector_iterator< U, S> xb, simd_vector_iterator< U, S> xe, simd_vector_iterator< T, S> yb)
+	{
+		static_assert( std::is_floating_point< T>::value, "Floating point element type required!");
+		static_assert( std::is_same< typename std::remove_const< U>::type, T>::value, "Incompatible element types!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "axpy", S, xb, xe, 3);
+
+		typedef simd< T, S> simd_op;
+
+		std::ptrdiff_t n = xe - xb;
+		if ( n <= 0)
+		{
+			return;
+		}
+		if ( xb.lower_offset() != yb.lower_offset())
+		{
+			detail::scalar_axpy( a, xb, xe, yb);
+			return;
+		}
+
+		block_split< U, S> sx = split( xb, xe);
+		block_split< T, S> sy = split( yb, yb + n);
+
+		S av = simd_op::broadcast( a);
+
+		if ( sx.has_head())
+		{
+			detail::store_lanes< T>( sy.head, simd_op::fmadd( av, load_head( sx), load_head( sy)), sy.head_lo, sy.head_hi);
+		}
+
+		const S * p = sx.body_begin;
+		S * q = sy.body_begin;
+		std::ptrdiff_t m = sx.blocks();
+		for ( std::ptrdiff_t i = 0; i < m; ++ i)
+		{
+			simd_op::store( q + i, simd_op::fmadd( av, p[ i], q[ i]));
+		}
+
+		if ( sx.has_tail())
+		{
+			detail::store_lanes< T>( sy.tail, simd_op::fmadd( av, load_tail( sx), load_tail( sy)), 0, sy.tail_hi);
+		}
+	}
+
+	// x[i] *= a
+	// The blocks are read before they are written, so non-temporal stores would save no memory traffic
+	// and regular stores are used regardless of the size
+	template< typename T, typename S>
+	void scal( T a, simd_vector_iterator< T, S> xb, simd_vector_iterator< T, S> xe)
+	{
+		static_assert( std::is_floating_point< T>::value, "Floating point element type required!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "scal", S, xb, xe, 2);
+
+		S av = simd< T, S>::broadcast( a);
+		transform( xb, xe, xb, [ av]( S x){ return simd< T, S>::mul( x, av); }, std::numeric_limits< std::size_t>::max());
+	}
+
+	// Sum of |x[i]| computed with N independent accumulators
+	template< std::size_t N, typename T, typename S>
+	typename std::remove_const< T>::type asum( simd_vector_iterator< T, S> xb, simd_vector_iterator< T, S> xe)
+	{
+		typedef typename std::remove_const< T>::type value_type;
+
+		static_assert( std::is_floating_point< value_type>::value, "Floating point element type required!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "asum", S, xb, xe, 1);
+
+		return transform_reduce_sum< N>( xb, xe, detail::abs_block< value_type, S>());
+	}
+
+	template< typename T, typename S>
+	typename std::remove_const< T>::type asum( simd_vector_iterator< T, S> xb, simd_vector_iterator< T, S> xe)
+	{
+		return asum< default_accumulators>( xb, xe);
+	}
+
+	// Iterator to the first element of the largest magnitude in [xb, xe), xe if the range is empty
+	// The maxima of chunks of blocks are compared with the best one so far, at the end only the chunk
+	// holding the first largest magnitude is searched for its position
+	template< typename T, typename S>
+	simd_vector_iterator< T, S> iamax( simd_vector_iterator< T, S> xb, simd_vector_iterator< T, S> xe)
+	{
+		typedef typename std::remove_const< T>::type value_type;
+
+		static_assert( std::is_floating_point< value_type>::value, "Floating point element type required!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "iamax", S, xb, xe, 1);
+
+		typedef simd< value_type, S> simd_op;
+
+		if ( ! ( xb < xe))
+		{
+			return xe;
+		}
+
+		block_split< T, S> s = split( xb, xe);
+		const T * x = du1simd::to_address( xb);
+
+		// [first, last) holds the first element of the magnitude best
+		value_type best = -1;
+		const T * first = x;
+		const T * last = x;
+
+		// The lanes outside of the range are zero and cannot exceed a magnitude inside of it
+		if ( s.has_head())
+		{
+			best = simd_op::max_lane( simd_op::abs( load_head( s)));
+			last = x + ( s.head_hi - s.head_lo);
+		}
+
+		const S * p = s.body_begin;
+		std::ptrdiff_t m = s.blocks();
+		for ( std::ptrdiff_t c = 0; c < m; c += detail::iamax_chunk)
+		{
+			std::ptrdiff_t ce = std::min( m, c + detail::iamax_chunk);
+			S m0 = simd_op::zero(), m1 = simd_op::zero(), m2 = simd_op::zero(), m3 = simd_op::zero();
+			std::ptrdiff_t i = c;
+			for ( ; i + 4 <= ce; i += 4)
+			{
+				m0 = simd_op::max( m0, simd_op::abs( p[ i]));
+				m1 = simd_op::max( m1, simd_op::abs( p[ i + 1]));
+				m2 = simd_op::max( m2, simd_op::abs( p[ i + 2]));
+				m3 = simd_op::max( m3, simd_op::abs( p[ i + 3]));
+			}
+			for ( ; i < ce; ++ i)
+			{
+				m0 = simd_op::max( m0, simd_op::abs( p[ i]));
+			}
+			value_type cm = simd_op::max_lane( simd_op::max( simd_op::max( m0, m1), simd_op::max( m2, m3)));
+			if ( cm > best)
+			{
+				best = cm;
+				first = reinterpret_cast< const T *>( p + c);
+				last = reinterpret_cast< const T *>( p + ce);
+			}
+		}
+
+		if ( s.has_tail())
+		{
+			value_type tm = simd_op::max_lane( simd_op::abs( load_tail( s)));
+			if ( tm > best)
+			{
+				best = tm;
+				first = reinterpret_cast< const T *>( s.tail);
+				last = first + s.tail_hi;
+			}
+		}
+
+		for ( const T * q = first; q != last; ++ q)
+		{
+			if ( simd< value_type, value_type>::abs( * q) == best)
+			{
+				return xb + ( q - x);
+			}
+		}
+		return xb + ( first - x);
+	}
+
+	// Euclidean norm of x computed with N independent accumulators
+	template< std::size_t N, typename T, typename S>
+	typename std::remove_const< T>::type nrm2( simd_vector_iterator< T, S> xb, simd_vector_iterator< T, S> xe)
+	{
+		typedef typename std::remove_const< T>::type value_type;
+
+		static_assert( std::is_floating_point< value_type>::value, "Floating point element type required!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "nrm2", S, xb, xe, 1);
+
+		value_type ss = transform_reduce_sum< N>( xb, xe, detail::square_block< value_type, S>());
+		if ( ss >= std::numeric_limits< value_type>::min() && ss <= std::numeric_limits< value_type>::max())
+		{
+			return std::sqrt( ss);
+		}
+
+		// Zero, or the sum of squares overflowed, underflowed or is NaN: scale by the largest magnitude
+		simd_vector_iterator< T, S> im = iamax( xb, xe);
+		if ( im == xe)
+		{
+			return 0;
+		}
+		value_type big = simd< value_type, value_type>::abs( * im);
+		if ( ! ( big > 0) || big > std::numeric_limits< value_type>::max())
+		{
+			return ( ss != ss) ? ss : big;
+		}
+
+		value_type scaled = transform_reduce_sum< N>( xb, xe, detail::scaled_square_block< value_type, S>( simd< value_type, S>::broadcast( big)));
+		return big * std::sqrt( scaled);
+	}
+
+	template< typename T, typename S>
+	typename std::remove_const< T>::type nrm2( simd_vector_iterator< T, S> xb, simd_vector_iterator< T, S> xe)
+	{
+		return nrm2< default_accumulators>( xb, xe);
+	}
+};
+
+#endif // DU1SIMD_BLAS_HPP
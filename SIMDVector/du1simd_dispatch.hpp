@@ -0,0 +1,165 @@
+// du1simd_dispatch.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Runtime selection of the widest simd carrier supported by the CPU
+//
+// du1simd::detect_isa() queries CPUID (and XGETBV for the OS support of the wider register state),
+// du1simd::best_isa() additionally limits the result to the levels this binary contains code of. On AArch64
+// NEON is always present and SVE is read from the hardware capabilities of the operating system, the
+// fixed-length SVE carrier is used only if the vector length of the CPU is the one of the build.
+//
+// du1simd::dispatch< kernel>( args...) calls kernel< carrier>::run( args...) with the carrier
+// corresponding to best_isa(). The kernel is a class template parametrized by the carrier type only,
+// the type of run must not depend on the carrier:
+//
+//	template< typename simd_carrier_type>
+//	struct my_kernel {
+//		static float run( std::size_t n) { ... simd_vector< float, simd_carrier_type> ... }
+//	};
+//
+//	float x = du1simd::dispatch< my_kernel>( n);
+//
+// The carriers compiled into the calling translation unit (compiled_isa(), MSVC compiles all of them in
+// without /arch options) are called directly. GCC and Clang accept the AVX intrinsics only in code compiled
+// with the corresponding -m option, a baseline build (-msse3) compiles __m128 in only. The wider levels
+// are therefore compiled by translation units of their own:
+//
+//	du1simd_avx2.cpp	-mavx2 -mfma				__m256 for isa::avx2
+//	du1simd_avx512.cpp	-mavx512f -mavx512bw -mfma		__m512 for isa::avx512
+//
+// A unit stores kernel< carrier>::run of its carrier into isa_entries< kernel>::entry[ level] when best_isa()
+// is first called, dispatch calls the entry of the widest supported level which has one and the compiled-in
+// carriers otherwise. The library registers reduce_sum_kernel (du1simd_reduce.hpp) and carrier_size_kernel,
+// a kernel of the application is registered the same way by a unit of the application before it is
+// dispatched. A unit compiled without its options registers nothing.
+//
+// The linker keeps a single copy of an inline function instantiated by several translation units, so a
+// unit must instantiate only code parametrized by its carrier, and the other translation units must be
+// compiled without the options of the units (otherwise the linker may keep the copy of a unit and run it on
+// a CPU without the level). Per-function target attributes do not help here, the carrier code is inlined
+// into generic templates compiled for the baseline.
+//
+
+#ifndef DU1SIMD_DISPATCH_HPP
+#define DU1SIMD_DISPATCH_HPP
+
+#include "du1simd_ops.hpp"
+
+#include <cstddef>
+#include <utility>
+
+namespace du1simd {
+
+	// Instruction set levels, ordered from the narrowest, the x86 levels followed by the ARM ones
+	enum class isa {
+		scalar,
+		sse3,
+		avx,
+		avx2,
+		avx512,
+		neon,
+		sve
+	};
+
+	// Number of the levels
+	const std::size_t isa_levels = 7;
+
+	// Widest level supported by the CPU and the operating system
+	isa detect_isa();
+
+	// Widest level the carriers of the translation units of the library are compiled for (by the -m options)
+	isa compiled_isa();
+
+	// Widest level supported both by the CPU and by this build, either compiled in or by the unit of the
+	// level (computed once, registers the kernels of the units)
+	isa best_isa();
+
+	// Printable name of the level
+	const char * isa_name( isa level);
+
+	// The levels of the other architecture are never supported
+	inline bool supports( isa level)
+	{
+		isa best = best_isa();
+		return level == isa::scalar || ( level <= best && ( level >= isa::neon) == ( best >= isa::neon));
+	}
+
+	// Entry points of kernel< carrier>::run compiled by the units of the wider levels, indexed by the level,
+	// null where the unit does not provide the kernel
+	template< template< typename> class kernel>
+	struct isa_entries {
+		typedef decltype( & kernel< float>::run) entry_type;
+
+		static entry_type entry[ isa_levels];
+	};
+
+	template< template< typename> class kernel>
+	typename isa_entries< kernel>::entry_type isa_entries< kernel>::entry[ isa_levels];
+
+	// Size of the carrier in bytes, reports the carrier dispatch selects
+	template< typename simd_carrier_type>
+	struct carrier_size_kernel {
+		static std::size_t run()
+		{
+			return sizeof( simd_carrier_type);
+		}
+	};
+
+	namespace detail {
+
+		// Register the kernels of the units (du1simd_avx2.cpp, du1simd_avx512.cpp), false if the unit was
+		// compiled without the options of its level
+		bool register_avx2_kernels();
+		bool register_avx512_kernels();
+	}
+
+	template< template< typename> class kernel, typename ... args_type>
+	auto dispatch( args_type && ... args) -> decltype( kernel< float>::run( std::forward< args_type>( args) ...))
+	{
+		isa level = best_isa();
+		isa compiled = compiled_isa();
+
+		for ( isa l = level; l > compiled; l = static_cast< isa>( static_cast< int>( l) - 1))
+		{
+			typename isa_entries< kernel>::entry_type entry = isa_entries< kernel>::entry[ static_cast< std::size_t>( l)];
+			if ( entry)
+			{
+				return entry( std::forward< args_type>( args) ...);
+			}
+		}
+		if ( level > compiled)
+		{
+			level = compiled;
+		}
+
+		switch ( level)
+		{
+#if DU1SIMD_HAVE_SVE
+		case isa::sve:
+			return kernel< sve_float32_t>::run( std::forward< args_type>( args) ...);
+#endif
+#if DU1SIMD_HAVE_NEON
+		case isa::neon:
+			return kernel< float32x4_t>::run( std::forward< args_type>( args) ...);
+#endif
+#if DU1SIMD_HAVE_AVX512
+		case isa::avx512:
+			return kernel< __m512>::run( std::forward< args_type>( args) ...);
+#endif
+#if DU1SIMD_HAVE_AVX
+		case isa::avx2:
+		case isa::avx:
+			return kernel< __m256>::run( std::forward< args_type>( args) ...);
+#endif
+#if DU1SIMD_HAVE_SSE
+		case isa::sse3:
+			return kernel< __m128>::run( std::forward< args_type>( args) ...);
+#endif
+		default:
+			return kernel< float>::run( std::forward< args_type>( args) ...);
+		}
+	}
+};
+
+#endif // DU1SIMD_DISPATCH_HPP
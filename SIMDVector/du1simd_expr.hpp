@@ -0,0 +1,422 @@
+// du1simd_expr.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Lazy element-wise arithmetic on simd_vector
+//
+// The operators + - * / applied to simd_vectors, expressions and scalars do not compute anything, they
+// build an expression object referring to the operand vectors. The expression is evaluated when it is
+// assigned to a simd_vector of the same size, in a single pass over the simd blocks (operands of different
+// sizes throw std::length_error, when the expression is built or assigned):
+//
+//	simd_vector< float, __m128> x( n), y( n), z( n);
+//	z = 2.0F * x + y;		// one loop, z.block[ i] = add( mul( broadcast( 2), x.block[ i]), y.block[ i])
+//
+// du1simd::min, max, abs, sqrt and rsqrt (and exp, log, tanh, sigmoid of du1simd_math.hpp) are lazy as
+// well, z = du1simd::sqrt( x * x + y * y) is one loop too.
+//
+// No temporary vectors are allocated. Evaluation is block-wise, so the destination may be one of the
+// operands (y = a * x + y). The padding lanes of the last block are computed as well, which is harmless
+// because simd_vector allocates whole blocks. The operand vectors must outlive the expression.
+//
+
+#ifndef DU1SIMD_EXPR_HPP
+#define DU1SIMD_EXPR_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+
+namespace du1simd {
+
+	// Base of all expression nodes, E is the derived node type
+	template< typename E, typename T, typename S>
+	struct expression {
+		const E & self() const
+		{
+			return static_cast< const E &>( * this);
+		}
+	};
+
+	// Reference to the blocks of a simd_vector, the operands are only read, so they may be const vectors
+	template< typename T, typename S>
+	struct vector_operand : expression< vector_operand< T, S>, T, S> {
+		template< typename A>
+		explicit vector_operand( const simd_vector< T, S, A> & v) : blocks_( v.begin().lower_block()), size_( v.size()) { }
+
+		S block( std::size_t i) const
+		{
+			return blocks_[ i];
+		}
+		// Number of elements
+		std::size_t size() const
+		{
+			return size_;
+		}
+	private:
+		simd_vector_simd_iterator< const T, S> blocks_;
+		std::size_t size_;
+	};
+
+	// Scalar broadcast to all lanes
+	template< typename T, typename S>
+	struct scalar_operand : expression< scalar_operand< T, S>, T, S> {
+		explicit scalar_operand( T x) : value_( simd< T, S>::broadcast( x)) { }
+
+		S block( std::size_t) const
+		{
+			return value_;
+		}
+		std::size_t size() const
+		{
+			return any_size;
+		}
+	private:
+		S value_;
+	};
+
+	template< typename O, typename L, typename R, typename T, typename S>
+	struct binary_expression : expression< binary_expression< O, L, R, T, S>, T, S> {
+		binary_expression( const L & l, const R & r) : l_( l), r_( r)
+		{
+			if ( l_.size() != any_size && r_.size() != any_size && l_.size() != r_.size())
+			{
+				throw std::length_error( "Expression operands of a different size!");
+			}
+		}
+
+		S block( std::size_t i) const
+		{
+			return O::template apply< T, S>( l_.block( i), r_.block( i));
+		}
+		std::size_t size() const
+		{
+			return l_.size() != any_size ? l_.size() : r_.size();
+		}
+	private:
+		L l_;
+		R r_;
+	};
+
+	template< typename O, typename E, typename T, typename S>
+	struct unary_expression : expression< unary_expression< O, E, T, S>, T, S> {
+		explicit unary_expression( const E & e) : e_( e) { }
+
+		S block( std::size_t i) const
+		{
+			return O::template apply< T, S>( e_.block( i));
+		}
+		std::size_t size() const
+		{
+			return e_.size();
+		}
+	private:
+		E e_;
+	};
+
+	// Element-wise operations of the nodes
+
+	struct add_operation {
+		template< typename T, typename S>
+		static S apply( S a, S b)
+		{
+			return simd< T, S>::add( a, b);
+		}
+	};
+
+	struct sub_operation {
+		template< typename T, typename S>
+		static S apply( S a, S b)
+		{
+			return simd< T, S>::sub( a, b);
+		}
+	};
+
+	struct mul_operation {
+		template< typename T, typename S>
+		static S apply( S a, S b)
+		{
+			return simd< T, S>::mul( a, b);
+		}
+	};
+
+	struct div_operation {
+		template< typename T, typename S>
+		static S apply( S a, S b)
+		{
+			return simd< T, S>::div( a, b);
+		}
+	};
+
+	struct min_operation {
+		template< typename T, typename S>
+		static S apply( S a, S b)
+		{
+			return simd< T, S>::min( a, b);
+		}
+	};
+
+	struct max_operation {
+		template< typename T, typename S>
+		static S apply( S a, S b)
+		{
+			return simd< T, S>::max( a, b);
+		}
+	};
+
+	struct abs_operation {
+		template< typename T, typename S>
+		static S apply( S a)
+		{
+			return simd< T, S>::abs( a);
+		}
+	};
+
+	struct sqrt_operation {
+		template< typename T, typename S>
+		static S apply( S a)
+		{
+			return simd< T, S>::sqrt( a);
+		}
+	};
+
+	struct rsqrt_operation {
+		template< typename T, typename S>
+		static S apply( S a)
+		{
+			return simd< T, S>::rsqrt( a);
+		}
+	};
+
+	namespace detail {
+
+		// Maps an operand type to its node type, scalars are resolved once the other operand is known
+		template< typename U>
+		struct operand {
+			static const bool is_node = false;
+		};
+
+		template< typename T, typename S, typename A>
+		struct operand< simd_vector< T, S, A>> {
+			static const bool is_node = true;
+			typedef T value_type;
+			typedef S carrier_type;
+			typedef vector_operand< T, S> type;
+			static type make( const simd_vector< T, S, A> & v)
+			{
+				return type( v);
+			}
+		};
+
+		template< typename O, typename L, typename R, typename T, typename S>
+		struct operand< binary_expression< O, L, R, T, S>> {
+			static const bool is_node = true;
+			typedef T value_type;
+			typedef S carrier_type;
+			typedef binary_expression< O, L, R, T, S> type;
+			static const type & make( const type & e)
+			{
+				return e;
+			}
+		};
+
+		template< typename O, typename E, typename T, typename S>
+		struct operand< unary_expression< O, E, T, S>> {
+			static const bool is_node = true;
+			typedef T value_type;
+			typedef S carrier_type;
+			typedef unary_expression< O, E, T, S> type;
+			static const type & make( const type & e)
+			{
+				return e;
+			}
+		};
+
+		template< typename T, typename S>
+		struct operand< vector_operand< T, S>> {
+			static const bool is_node = true;
+			typedef T value_type;
+			typedef S carrier_type;
+			typedef vector_operand< T, S> type;
+			static const type & make( const type & e)
+			{
+				return e;
+			}
+		};
+
+		template< typename T, typename S>
+		struct operand< scalar_operand< T, S>> {
+			static const bool is_node = true;
+			typedef T value_type;
+			typedef S carrier_type;
+			typedef scalar_operand< T, S> type;
+			static const type & make( const type & e)
+			{
+				return e;
+			}
+		};
+
+		template< typename U, typename N>
+		struct scalar_of {
+			typedef scalar_operand< typename N::value_type, typename N::carrier_type> type;
+			template< typename V>
+			static type make( V x)
+			{
+				return type( static_cast< typename N::value_type>( x));
+			}
+		};
+
+		template< typename O, typename L, typename R,
+			bool LN = operand< L>::is_node, bool RN = operand< R>::is_node, bool LA = std::is_arithmetic< L>::value, bool RA = std::is_arithmetic< R>::value>
+		struct binary_result {
+		};
+
+		// node op node
+		template< typename O, typename L, typename R, bool LA, bool RA>
+		struct binary_result< O, L, R, true, true, LA, RA> {
+			typedef operand< L> lo;
+			typedef operand< R> ro;
+			static_assert( std::is_same< typename lo::value_type, typename ro::value_type>::value
+				&& std::is_same< typename lo::carrier_type, typename ro::carrier_type>::value, "Incompatible operands!");
+			typedef binary_expression< O, typename lo::type, typename ro::type, typename lo::value_type, typename lo::carrier_type> type;
+			template< typename A, typename B>
+			static type make( A & l, B & r)
+			{
+				return type( lo::make( l), ro::make( r));
+			}
+		};
+
+		// node op scalar
+		template< typename O, typename L, typename R>
+		struct binary_result< O, L, R, true, false, false, true> {
+			typedef operand< L> lo;
+			typedef scalar_of< R, lo> ro;
+			typedef binary_expression< O, typename lo::type, typename ro::type, typename lo::value_type, typename lo::carrier_type> type;
+			template< typename A, typename B>
+			static type make( A & l, B & r)
+			{
+				return type( lo::make( l), ro::make( r));
+			}
+		};
+
+		// scalar op node
+		template< typename O, typename L, typename R>
+		struct binary_result< O, L, R, false, true, true, false> {
+			typedef scalar_of< L, operand< R>> lo;
+			typedef operand< R> ro;
+			typedef binary_expression< O, typename lo::type, typename ro::type, typename ro::value_type, typename ro::carrier_type> type;
+			template< typename A, typename B>
+			static type make( A & l, B & r)
+			{
+				return type( lo::make( l), ro::make( r));
+			}
+		};
+
+		template< typename U>
+		struct bare {
+			typedef typename std::remove_cv< typename std::remove_reference< U>::type>::type type;
+		};
+
+		template< typename U>
+		struct is_vector : std::false_type { };
+
+		template< typename T, typename S, typename A>
+		struct is_vector< simd_vector< T, S, A>> : std::true_type { };
+
+		// Vector operands must be lvalues, an expression referring to a temporary vector would dangle
+		template< typename U>
+		struct valid_operand {
+			static const bool value = ! is_vector< typename bare< U>::type>::value || std::is_lvalue_reference< U>::value;
+		};
+
+		template< typename O, typename L, typename R, bool valid = valid_operand< L>::value && valid_operand< R>::value>
+		struct result : binary_result< O, typename bare< L>::type, typename bare< R>::type> {
+		};
+
+		template< typename O, typename L, typename R>
+		struct result< O, L, R, false> {
+		};
+
+		// f( node), the function takes part in overload resolution for node operands only
+		template< typename O, typename U, bool valid = valid_operand< U>::value && operand< typename bare< U>::type>::is_node>
+		struct unary_result {
+			typedef operand< typename bare< U>::type> uo;
+			typedef unary_expression< O, typename uo::type, typename uo::value_type, typename uo::carrier_type> type;
+			template< typename A>
+			static type make( A & u)
+			{
+				return type( uo::make( u));
+			}
+		};
+
+		template< typename O, typename U>
+		struct unary_result< O, U, false> {
+		};
+	}
+
+	// Element-wise functions of simd_vectors and expressions, e.g. z = du1simd::sqrt( x * x + y * y)
+	// du1simd_math.hpp adds exp, log, tanh and sigmoid
+
+	template< typename U>
+	typename detail::unary_result< abs_operation, U>::type abs( U && u)
+	{
+		return detail::unary_result< abs_operation, U>::make( u);
+	}
+
+	template< typename U>
+	typename detail::unary_result< sqrt_operation, U>::type sqrt( U && u)
+	{
+		return detail::unary_result< sqrt_operation, U>::make( u);
+	}
+
+	template< typename U>
+	typename detail::unary_result< rsqrt_operation, U>::type rsqrt( U && u)
+	{
+		return detail::unary_result< rsqrt_operation, U>::make( u);
+	}
+
+	template< typename L, typename R>
+	typename detail::result< min_operation, L, R>::type min( L && l, R && r)
+	{
+		return detail::result< min_operation, L, R>::make( l, r);
+	}
+
+	template< typename L, typename R>
+	typename detail::result< max_operation, L, R>::type max( L && l, R && r)
+	{
+		return detail::result< max_operation, L, R>::make( l, r);
+	}
+};
+
+// The operators live in the global namespace next to simd_vector so that argument dependent lookup
+// finds them for plain vector operands, they take part in overload resolution only for simd_vectors,
+// du1simd expressions and scalars combined with one of them
+
+template< typename L, typename R>
+typename du1simd::detail::result< du1simd::add_operation, L, R>::type operator+( L && l, R && r)
+{
+	return du1simd::detail::result< du1simd::add_operation, L, R>::make( l, r);
+}
+
+template< typename L, typename R>
+typename du1simd::detail::result< du1simd::sub_operation, L, R>::type operator-( L && l, R && r)
+{
+	return du1simd::detail::result< du1simd::sub_operation, L, R>::make( l, r);
+}
+
+template< typename L, typename R>
+typename du1simd::detail::result< du1simd::mul_operation, L, R>::type operator*( L && l, R && r)
+{
+	return du1simd::detail::result< du1simd::mul_operation, L, R>::make( l, r);
+}
+
+template< typename L, typename R>
+typename du1simd::detail::result< du1simd::div_operation, L, R>::type operator/( L && l, R && r)
+{
+	return du1simd::detail::result< du1simd::div_operation, L, R>::make( l, r);
+}
+
+#endif // DU1SIMD_EXPR_HPP
@@ -0,0 +1,451 @@
+// du1simd_filter.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Filtering (stream compaction) kernels over simd_vector ranges
+//
+// The predicate of a kernel is evaluated a block at a time: pred( block) returns the lane_mask of the
+// lanes to keep, computed by du1simd::simd::cmp_lt / cmp_le / cmp_eq. The predicates less< S>( x),
+// less_equal, greater, greater_equal, equal_to and between< S>( lo, hi) (lo <= x <= hi) compare the
+// lanes with broadcast values, any other functor of the same signature may be used as well.
+//
+//	count_if( b, e, pred)					number of the elements kept, nothing is written,
+//								e.g. to estimate the selectivity before allocating
+//	copy_if( b, e, out, pred)				appends the elements kept to the simd_vector out
+//	partition_copy( b, e, out_true, out_false, pred)	appends the elements kept to out_true and the
+//								other ones to out_false
+//
+// The kept lanes of a block are packed by detail::compress, by vcompressps / vcompresspd on AVX-512
+// and compact on SVE, by a permutation looked up by the mask on AVX2 (__m256, __m256d), AVX (__m128)
+// and NEON (a byte table lookup), and by a branchless loop over the lanes otherwise. The lanes of 32 and 64-bit integers are moved as floats and
+// doubles. A packed block is always stored whole at the end of the output, the lanes past the kept ones
+// are overwritten by the next block, so the output keeps room for a block beyond its size and grows
+// geometrically.
+//
+// The order of the elements is preserved. The output vectors must not be the source vector and their
+// element type must be trivially copyable, they are resized with du1simd::uninitialized.
+//
+
+#ifndef DU1SIMD_FILTER_HPP
+#define DU1SIMD_FILTER_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_split.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace du1simd {
+
+	namespace detail {
+
+		// Positions of the set bits of the masks of up to 8 lanes (du1simd.cpp)
+		extern const unsigned char compress_index_table_[ 256][ 8];
+
+		inline std::size_t popcount( lane_mask m)
+		{
+#if defined(__GNUC__)
+			return static_cast< std::size_t>( __builtin_popcount( m));
+#elif defined(_MSC_VER) && defined(__AVX__)
+			return __popcnt( m);
+#else
+			m = m - ( ( m >> 1) & 0x55555555u);
+			m = ( m & 0x33333333u) + ( ( m >> 2) & 0x33333333u);
+			return static_cast< std::size_t>( ( ( ( m + ( m >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+		}
+
+		// Mask of the lanes [lo, hi)
+		inline lane_mask lane_range( std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			return static_cast< lane_mask>( ( ( std::uint64_t( 1) << hi) - 1) & ~( ( std::uint64_t( 1) << lo) - 1));
+		}
+
+		// Writes the lanes of a selected by m to consecutive elements at p and returns their number
+		// All the k elements at p may be overwritten
+		template< typename T, typename S>
+		std::size_t compress( T * p, const S & a, lane_mask m)
+		{
+			const std::size_t k = lanes_of< T, S>::value;
+			T lanes[ k];
+			std::memcpy( lanes, & a, sizeof(S));
+			std::size_t n = 0;
+			for ( std::size_t j = 0; j < k; ++ j)
+			{
+				p[ n] = lanes[ j];
+				n += ( m >> j) & 1;
+			}
+			return n;
+		}
+
+#if defined(__AVX__)
+		// The lanes of a selected by m moved to the lowest lanes
+		inline __m128 compressed( __m128 a, lane_mask m)
+		{
+			std::int32_t packed;
+			std::memcpy( & packed, compress_index_table_[ m], sizeof(packed));
+			return _mm_permutevar_ps( a, _mm_cvtepu8_epi32( _mm_cvtsi32_si128( packed)));
+		}
+
+		inline std::size_t compress( float * p, __m128 a, lane_mask m)
+		{
+			_mm_storeu_ps( p, compressed( a, m));
+			return popcount( m);
+		}
+#endif
+
+#if defined(__AVX2__)
+		inline __m256 compressed( __m256 a, lane_mask m)
+		{
+			__m256i idx = _mm256_cvtepu8_epi32( _mm_loadl_epi64( reinterpret_cast< const __m128i *>( compress_index_table_[ m])));
+			return _mm256_permutevar8x32_ps( a, idx);
+		}
+
+		// Double lane i is moved as the pair of float lanes 2i, 2i + 1
+		inline __m256d compressed( __m256d a, lane_mask m)
+		{
+			std::int32_t packed;
+			std::memcpy( & packed, compress_index_table_[ m], sizeof(packed));
+			__m256i d = _mm256_cvtepu8_epi64( _mm_cvtsi32_si128( packed));
+			__m256i even = _mm256_add_epi64( d, d);
+			__m256i idx = _mm256_or_si256( even, _mm256_slli_epi64( _mm256_add_epi64( even, _mm256_set1_epi64x( 1)), 32));
+			return _mm256_castps_pd( _mm256_permutevar8x32_ps( _mm256_castpd_ps( a), idx));
+		}
+
+		inline std::size_t compress( float * p, __m256 a, lane_mask m)
+		{
+			_mm256_storeu_ps( p, compressed( a, m));
+			return popcount( m);
+		}
+
+		inline std::size_t compress( double * p, __m256d a, lane_mask m)
+		{
+			_mm256_storeu_pd( p, compressed( a, m));
+			return popcount( m);
+		}
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+		// vcompress into a register and a full store, faster than the compressing store on some cores
+		inline std::size_t compress( float * p, __m512 a, lane_mask m)
+		{
+			_mm512_storeu_ps( p, _mm512_maskz_compress_ps( static_cast< __mmask16>( m), a));
+			return popcount( m);
+		}
+
+		inline std::size_t compress( double * p, __m512d a, lane_mask m)
+		{
+			_mm512_storeu_pd( p, _mm512_maskz_compress_pd( static_cast< __mmask8>( m), a));
+			return popcount( m);
+		}
+#endif
+
+#if DU1SIMD_HAVE_NEON
+		// The lane indices of the table expanded to the byte indices of a table lookup
+		inline float32x4_t compressed( float32x4_t a, lane_mask m)
+		{
+			static const std::uint8_t spread[ 16] = { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3 };
+			static const std::uint8_t offset[ 16] = { 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3 };
+			uint8x16_t lanes = vqtbl1q_u8( vcombine_u8( vld1_u8( compress_index_table_[ m]), vdup_n_u8( 0)), vld1q_u8( spread));
+			uint8x16_t bytes = vaddq_u8( vshlq_n_u8( lanes, 2), vld1q_u8( offset));
+			return vreinterpretq_f32_u8( vqtbl1q_u8( vreinterpretq_u8_f32( a), bytes));
+		}
+
+		inline std::size_t compress( float * p, float32x4_t a, lane_mask m)
+		{
+			vst1q_f32( p, compressed( a, m));
+			return popcount( m);
+		}
+#endif
+
+#if DU1SIMD_HAVE_SVE
+		// The store is predicated, only the lanes kept are written
+		inline std::size_t compress( float * p, sve_float32_t a, lane_mask m)
+		{
+			typedef simd< float, sve_float32_t> simd_op;
+
+			std::size_t n = popcount( m);
+			svst1_f32( simd_op::lanes( 0, static_cast< std::ptrdiff_t>( n)), p, svcompact_f32( simd_op::from_mask( m), a));
+			return n;
+		}
+#endif
+
+		// Lanes of 32 and 64-bit integers are moved as the lanes of float and double
+		template< typename T, std::size_t n>
+		struct is_integer_of_size : std::integral_constant< bool, std::is_integral< T>::value && sizeof(T) == n> { };
+
+#if defined(__AVX__)
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 4>::value, std::size_t>::type compress( T * p, __m128i a, lane_mask m)
+		{
+			return compress( reinterpret_cast< float *>( p), _mm_castsi128_ps( a), m);
+		}
+#endif
+
+#if defined(__AVX2__)
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 4>::value, std::size_t>::type compress( T * p, __m256i a, lane_mask m)
+		{
+			return compress( reinterpret_cast< float *>( p), _mm256_castsi256_ps( a), m);
+		}
+
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 8>::value, std::size_t>::type compress( T * p, __m256i a, lane_mask m)
+		{
+			return compress( reinterpret_cast< double *>( p), _mm256_castsi256_pd( a), m);
+		}
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 4>::value, std::size_t>::type compress( T * p, __m512i a, lane_mask m)
+		{
+			return compress( reinterpret_cast< float *>( p), _mm512_castsi512_ps( a), m);
+		}
+
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 8>::value, std::size_t>::type compress( T * p, __m512i a, lane_mask m)
+		{
+			return compress( reinterpret_cast< double *>( p), _mm512_castsi512_pd( a), m);
+		}
+#endif
+
+		// Appends to a vector through a pointer to its end, room for n elements is made before writing them
+		template< typename V>
+		class append_buffer {
+		public:
+			typedef typename V::iterator::value_type value_type;
+
+			explicit append_buffer( V & out) : out_( out), size_( out.size()), data_( to_address( out.begin())) { }
+
+			void reserve( std::size_t n)
+			{
+				if ( size_ + n > out_.capacity())
+				{
+					grow( n);
+				}
+			}
+			value_type * end() const
+			{
+				return data_ + size_;
+			}
+			void advance( std::size_t n)
+			{
+				size_ += n;
+			}
+			std::size_t size() const
+			{
+				return size_;
+			}
+			// Sets the size of the vector to the elements appended
+			void commit()
+			{
+				out_.resize( size_, uninitialized);
+			}
+		private:
+			V & out_;
+			std::size_t size_;
+			value_type * data_;
+
+			void grow( std::size_t n)
+			{
+				commit();
+				out_.reserve( std::max( 2 * out_.capacity(), size_ + n));
+				data_ = to_address( out_.begin());
+			}
+
+			append_buffer & operator=( const append_buffer &);
+		};
+
+		// Calls f( block, selected, range) for the blocks covering [b, e), range is the mask of the lanes
+		// inside of [b, e) and selected the lanes of range the predicate holds for
+		template< typename T, typename S, typename P, typename F>
+		void for_each_selected( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, P & pred, F f)
+		{
+			static_assert( lanes_of< T, S>::value <= 32, "Too many lanes for a lane_mask!");
+
+			const lane_mask all = lane_range( 0, lanes_of< T, S>::value);
+
+			block_split< T, S> s = split( b, e);
+
+			if ( s.has_head())
+			{
+				S a = load_head( s);
+				lane_mask range = lane_range( s.head_lo, s.head_hi);
+				f( a, pred( a) & range, range);
+			}
+
+			const S * p = s.body_begin;
+			std::ptrdiff_t m = s.blocks();
+			for ( std::ptrdiff_t i = 0; i < m; ++ i)
+			{
+				f( p[ i], pred( p[ i]) & all, all);
+			}
+
+			if ( s.has_tail())
+			{
+				S a = load_tail( s);
+				lane_mask range = lane_range( 0, s.tail_hi);
+				f( a, pred( a) & range, range);
+			}
+		}
+
+		enum class compare_op {
+			less,
+			less_equal,
+			greater,
+			greater_equal,
+			equal
+		};
+
+		// Comparison of the lanes with a broadcast value
+		template< typename T, typename S, compare_op op>
+		struct compare_predicate {
+			S x;
+
+			explicit compare_predicate( T value) : x( simd< T, S>::broadcast( value)) { }
+
+			lane_mask operator()( S a) const
+			{
+				typedef simd< T, S> simd_op;
+
+				switch ( op)
+				{
+				case compare_op::less:
+					return simd_op::cmp_lt( a, x);
+				case compare_op::less_equal:
+					return simd_op::cmp_le( a, x);
+				case compare_op::greater:
+					return simd_op::cmp_lt( x, a);
+				case compare_op::greater_equal:
+					return simd_op::cmp_le( x, a);
+				default:
+					return simd_op::cmp_eq( a, x);
+				}
+			}
+		};
+
+		template< typename T, typename S>
+		struct between_predicate {
+			S lo;
+			S hi;
+
+			between_predicate( T low, T high) : lo( simd< T, S>::broadcast( low)), hi( simd< T, S>::broadcast( high)) { }
+
+			lane_mask operator()( S a) const
+			{
+				return simd< T, S>::cmp_le( lo, a) & simd< T, S>::cmp_le( a, hi);
+			}
+		};
+	}
+
+	// Predicates for the blocks of S, e.g. du1simd::less< __m128>( 0.5F)
+	template< typename S, typename T>
+	detail::compare_predicate< T, S, detail::compare_op::less> less( T x)
+	{
+		return detail::compare_predicate< T, S, detail::compare_op::less>( x);
+	}
+
+	template< typename S, typename T>
+	detail::compare_predicate< T, S, detail::compare_op::less_equal> less_equal( T x)
+	{
+		return detail::compare_predicate< T, S, detail::compare_op::less_equal>( x);
+	}
+
+	template< typename S, typename T>
+	detail::compare_predicate< T, S, detail::compare_op::greater> greater( T x)
+	{
+		return detail::compare_predicate< T, S, detail::compare_op::greater>( x);
+	}
+
+	template< typename S, typename T>
+	detail::compare_predicate< T, S, detail::compare_op::greater_equal> greater_equal( T x)
+	{
+		return detail::compare_predicate< T, S, detail::compare_op::greater_equal>( x);
+	}
+
+	template< typename S, typename T>
+	detail::compare_predicate< T, S, detail::compare_op::equal> equal_to( T x)
+	{
+		return detail::compare_predicate< T, S, detail::compare_op::equal>( x);
+	}
+
+	// lo <= x <= hi
+	template< typename S, typename T>
+	detail::between_predicate< T, S> between( T lo, T hi)
+	{
+		return detail::between_predicate< T, S>( lo, hi);
+	}
+
+	// Number of the elements in [b, e) the block predicate pred holds for
+	template< typename T, typename S, typename P>
+	std::size_t count_if( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, P pred)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "count_if", S, b, e, 1);
+
+		std::size_t n = 0;
+		detail::for_each_selected( b, e, pred, [ & n]( const S &, lane_mask selected, lane_mask){
+			n += detail::popcount( selected);
+		});
+		return n;
+	}
+
+	// Appends the elements in [b, e) the block predicate pred holds for to out, returns their number
+	template< typename T, typename S, typename P, typename V, typename K, typename A>
+	std::size_t copy_if( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, simd_vector< V, K, A> & out, P pred)
+	{
+		static_assert( std::is_same< typename std::remove_const< T>::type, V>::value, "Incompatible output vector!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "copy_if", S, b, e, 2);
+
+		const std::size_t k = lanes_of< T, S>::value;
+
+		detail::append_buffer< simd_vector< V, K, A>> buffer( out);
+		std::size_t first = buffer.size();
+		detail::for_each_selected( b, e, pred, [ & buffer, k]( const S & a, lane_mask selected, lane_mask){
+			buffer.reserve( k);
+			buffer.advance( detail::compress( buffer.end(), a, selected));
+		});
+		buffer.commit();
+		return buffer.size() - first;
+	}
+
+	// Appends the elements in [b, e) the block predicate pred holds for to out_true and the other ones to
+	// out_false, returns the numbers of the elements appended to out_true and out_false
+	template< typename T, typename S, typename P, typename V, typename K1, typename A1, typename K2, typename A2>
+	std::pair< std::size_t, std::size_t> partition_copy( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e,
+		simd_vector< V, K1, A1> & out_true, simd_vector< V, K2, A2> & out_false, P pred)
+	{
+		static_assert( std::is_same< typename std::remove_const< T>::type, V>::value, "Incompatible output vector!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "partition_copy", S, b, e, 2);
+
+		const std::size_t k = lanes_of< T, S>::value;
+
+		detail::append_buffer< simd_vector< V, K1, A1>> buffer_true( out_true);
+		detail::append_buffer< simd_vector< V, K2, A2>> buffer_false( out_false);
+		std::size_t first_true = buffer_true.size();
+		std::size_t first_false = buffer_false.size();
+		detail::for_each_selected( b, e, pred, [ & buffer_true, & buffer_false, k]( const S & a, lane_mask selected, lane_mask range){
+			buffer_true.reserve( k);
+			buffer_false.reserve( k);
+			buffer_true.advance( detail::compress( buffer_true.end(), a, selected));
+			buffer_false.advance( detail::compress( buffer_false.end(), a, range & ~ selected));
+		});
+		buffer_true.commit();
+		buffer_false.commit();
+		return std::make_pair( buffer_true.size() - first_true, buffer_false.size() - first_false);
+	}
+};
+
+#endif // DU1SIMD_FILTER_HPP
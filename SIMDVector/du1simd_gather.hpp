@@ -0,0 +1,404 @@
+// du1simd_gather.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Index-driven access to simd_vector ranges
+//
+//	gather( tb, te, ib, ie, d)		d[ i] = tb[ ib[ i]] for the indices [ib, ie), returns the end of the output
+//	scatter( vb, ve, ib, tb, te)		tb[ ib[ i]] = vb[ i] for the values [vb, ve), in order, so the last
+//						of the equal indices wins
+//	gather( table, indices)			the same on whole vectors, returns a new vector
+//	scatter( values, indices, table)
+//
+// index_carrier< S>::type is the integer carrier of the width of S (__m256i for __m256 and __m256d),
+// a natural carrier of the indices into a vector of S.
+//
+// The indices are uint32_t elements of a simd_vector of any carrier IS and are processed a whole block of
+// IS at a time, only the partial first and last blocks are processed lane by lane. The carrier of the
+// indices selects the instructions:
+//
+//	__m256i		AVX2 vpgatherdd / vpgatherdq of 8 lanes, the scatter is scalar (AVX2 has none)
+//	__m512i		AVX-512 gathers and scatters of 16 lanes, the overlapping lanes of a scatter are
+//			written from the lowest one, as the scalar loop does
+//	others		a scalar loop which loads all the indices of the block first, then the elements, then
+//			stores them, so the loads of a block are independent and overlap
+//
+// The instructions handle 4 and 8-byte elements, others use the scalar loop. The gathers take signed
+// 32-bit indices, a table of more than INT32_MAX elements uses the scalar loop as well.
+//
+// A random access to a table larger than the last level cache is a DRAM latency per element, which the
+// hardware prefetchers cannot predict. With prefetch_distance > 0 the kernels prefetch the elements of the
+// indices that many positions ahead (rounded up to whole blocks), so the misses of the later blocks are in
+// flight while a block is processed. The loads of a plain gather are independent, so the out-of-order core
+// overlaps them by itself as far as its miss buffers allow, and the prefetches pay off only when the
+// gather runs interleaved with other work (e.g. a gather per block of a larger loop) that limits how far
+// ahead the core gets. Measure before enabling it: the default distance 0 issues no prefetches.
+//
+
+#ifndef DU1SIMD_GATHER_HPP
+#define DU1SIMD_GATHER_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_split.hpp"
+#include "du1simd_traversal.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace du1simd {
+
+	// Distance in indices of the prefetches for tables in DRAM
+	const std::size_t gather_prefetch_distance = 64;
+
+	// Carrier of the indices of the width of the carrier S of the elements
+	template< typename S>
+	struct index_carrier {
+		typedef S type;
+	};
+
+#if DU1SIMD_HAVE_SSE
+	template<>
+	struct index_carrier< __m128> {
+		typedef __m128i type;
+	};
+
+	template<>
+	struct index_carrier< __m128d> {
+		typedef __m128i type;
+	};
+#endif
+
+#if DU1SIMD_HAVE_AVX
+	template<>
+	struct index_carrier< __m256> {
+		typedef __m256i type;
+	};
+
+	template<>
+	struct index_carrier< __m256d> {
+		typedef __m256i type;
+	};
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+	template<>
+	struct index_carrier< __m512> {
+		typedef __m512i type;
+	};
+
+	template<>
+	struct index_carrier< __m512d> {
+		typedef __m512i type;
+	};
+#endif
+
+	namespace detail {
+
+		// Largest table addressed by the gather instructions
+		const std::size_t gather_table_limit = 0x7FFFFFFF;
+
+		// Gather and scatter of the lanes [lo, hi) of an index block at p, the scalar loop
+		template< typename T>
+		struct gather_lanes {
+			static void gather( const T * table, const std::uint32_t * p, std::ptrdiff_t lo, std::ptrdiff_t hi, T * out)
+			{
+				for ( std::ptrdiff_t j = lo; j < hi; ++ j)
+				{
+					out[ j - lo] = table[ p[ j]];
+				}
+			}
+
+			static void scatter( const T * in, const std::uint32_t * p, std::ptrdiff_t lo, std::ptrdiff_t hi, T * table)
+			{
+				for ( std::ptrdiff_t j = lo; j < hi; ++ j)
+				{
+					table[ p[ j]] = in[ j - lo];
+				}
+			}
+		};
+
+		// Gather and scatter of a whole index block of IS, the software-pipelined scalar loop
+		template< typename T, typename IS>
+		struct gather_scalar {
+			static void gather( const T * table, const IS & block, T * out)
+			{
+				const std::size_t k = lanes_of< std::uint32_t, IS>::value;
+				const std::uint32_t * p = reinterpret_cast< const std::uint32_t *>( & block);
+
+				std::uint32_t index[ k];
+				for ( std::size_t j = 0; j < k; ++ j)
+				{
+					index[ j] = p[ j];
+				}
+				T value[ k];
+				for ( std::size_t j = 0; j < k; ++ j)
+				{
+					value[ j] = table[ index[ j]];
+				}
+				std::memcpy( out, value, sizeof( value));
+			}
+
+			static void scatter( const T * in, const IS & block, T * table)
+			{
+				gather_lanes< T>::scatter( in, reinterpret_cast< const std::uint32_t *>( & block), 0, lanes_of< std::uint32_t, IS>::value, table);
+			}
+		};
+
+		// The kernel of the index blocks of IS, hardware is true for the gather instructions
+		template< typename T, typename IS, typename E = void>
+		struct gather_block : gather_scalar< T, IS> {
+			static const bool hardware = false;
+		};
+
+#if DU1SIMD_HAVE_AVX2
+		template< typename T>
+		struct gather_block< T, __m256i, typename std::enable_if< sizeof(T) == 4>::type> {
+			static const bool hardware = true;
+
+			static void gather( const T * table, const __m256i & block, T * out)
+			{
+				__m256i a = _mm256_i32gather_epi32( reinterpret_cast< const int *>( table), block, 4);
+				_mm256_storeu_si256( reinterpret_cast< __m256i *>( out), a);
+			}
+
+			static void scatter( const T * in, const __m256i & block, T * table)
+			{
+				gather_lanes< T>::scatter( in, reinterpret_cast< const std::uint32_t *>( & block), 0, 8, table);
+			}
+		};
+
+		template< typename T>
+		struct gather_block< T, __m256i, typename std::enable_if< sizeof(T) == 8>::type> {
+			static const bool hardware = true;
+
+			static void gather( const T * table, const __m256i & block, T * out)
+			{
+				const long long * base = reinterpret_cast< const long long *>( table);
+				__m256i a = _mm256_i32gather_epi64( base, _mm256_castsi256_si128( block), 8);
+				__m256i b = _mm256_i32gather_epi64( base, _mm256_extracti128_si256( block, 1), 8);
+				_mm256_storeu_si256( reinterpret_cast< __m256i *>( out), a);
+				_mm256_storeu_si256( reinterpret_cast< __m256i *>( out) + 1, b);
+			}
+
+			static void scatter( const T * in, const __m256i & block, T * table)
+			{
+				gather_lanes< T>::scatter( in, reinterpret_cast< const std::uint32_t *>( & block), 0, 8, table);
+			}
+		};
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+		template< typename T>
+		struct gather_block< T, __m512i, typename std::enable_if< sizeof(T) == 4>::type> {
+			static const bool hardware = true;
+
+			static void gather( const T * table, const __m512i & block, T * out)
+			{
+				__m512i a = _mm512_i32gather_epi32( block, table, 4);
+				_mm512_storeu_si512( out, a);
+			}
+
+			static void scatter( const T * in, const __m512i & block, T * table)
+			{
+				_mm512_i32scatter_epi32( table, block, _mm512_loadu_si512( in), 4);
+			}
+		};
+
+		template< typename T>
+		struct gather_block< T, __m512i, typename std::enable_if< sizeof(T) == 8>::type> {
+			static const bool hardware = true;
+
+			static void gather( const T * table, const __m512i & block, T * out)
+			{
+				__m512i a = _mm512_i32gather_epi64( _mm512_castsi512_si256( block), table, 8);
+				__m512i b = _mm512_i32gather_epi64( _mm512_extracti64x4_epi64( block, 1), table, 8);
+				_mm512_storeu_si512( out, a);
+				_mm512_storeu_si512( out + 8, b);
+			}
+
+			static void scatter( const T * in, const __m512i & block, T * table)
+			{
+				_mm512_i32scatter_epi64( table, _mm512_castsi512_si256( block), _mm512_loadu_si512( in), 8);
+				_mm512_i32scatter_epi64( table, _mm512_extracti64x4_epi64( block, 1), _mm512_loadu_si512( in + 8), 8);
+			}
+		};
+#endif
+
+		// Prefetches the elements of the indices of the block at p, if it is before the end
+		template< typename T, typename IS>
+		void prefetch_block( const T * table, const IS * p, const IS * end)
+		{
+			if ( p < end)
+			{
+				const std::uint32_t * q = reinterpret_cast< const std::uint32_t *>( p);
+				for ( std::size_t j = 0; j < lanes_of< std::uint32_t, IS>::value; ++ j)
+				{
+					du1simd::prefetch( table + q[ j]);
+				}
+			}
+		}
+
+		// Head, body and tail of the indices
+		template< typename T, typename I, typename IS>
+		block_split< I, IS> split_indices( simd_vector_iterator< I, IS> ib, simd_vector_iterator< I, IS> ie)
+		{
+			static_assert( std::is_same< typename std::remove_const< I>::type, std::uint32_t>::value, "uint32_t indices required!");
+
+			return split( ib, ie);
+		}
+
+		// Distance of the prefetches in whole blocks of k indices
+		inline std::ptrdiff_t prefetch_blocks( std::size_t prefetch_distance, std::size_t k)
+		{
+			return static_cast< std::ptrdiff_t>( ( prefetch_distance + k - 1) / k);
+		}
+
+		// The blocks of the indices by the kernel B
+		template< typename B, typename T, typename I, typename IS>
+		void gather_body( const T * table, const block_split< I, IS> & s, T * out, std::ptrdiff_t ahead)
+		{
+			const std::size_t k = lanes_of< std::uint32_t, IS>::value;
+
+			for ( auto p = s.body_begin; p != s.body_end; ++ p, out += k)
+			{
+				if ( ahead != 0)
+				{
+					prefetch_block( table, p + ahead, s.body_end);
+				}
+				B::gather( table, * p, out);
+			}
+		}
+
+		// The blocks of the indices by the kernel B, in order
+		template< typename B, typename T, typename I, typename IS>
+		void scatter_body( const T * in, const block_split< I, IS> & s, T * table, std::ptrdiff_t ahead)
+		{
+			const std::size_t k = lanes_of< std::uint32_t, IS>::value;
+
+			for ( auto p = s.body_begin; p != s.body_end; ++ p, in += k)
+			{
+				if ( ahead != 0)
+				{
+					prefetch_block( static_cast< const T *>( table), p + ahead, s.body_end);
+				}
+				B::scatter( in, * p, table);
+			}
+		}
+	}
+
+	// Writes the elements of [tb, te) at the indices [ib, ie) to the range starting at d, returns the end
+	// of the output, every index must be less than te - tb
+	template< typename U, typename T, typename S, typename I, typename IS>
+	simd_vector_iterator< T, S> gather( simd_vector_iterator< U, S> tb, simd_vector_iterator< U, S> te,
+		simd_vector_iterator< I, IS> ib, simd_vector_iterator< I, IS> ie, simd_vector_iterator< T, S> d,
+		std::size_t prefetch_distance = 0)
+	{
+		static_assert( std::is_same< typename std::remove_const< U>::type, T>::value, "Incompatible table and destination!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "gather", IS, ib, ie, 3);
+
+		typedef detail::gather_block< T, IS> block_kernel;
+		typedef detail::gather_scalar< T, IS> scalar_kernel;
+
+		std::ptrdiff_t n = ie - ib;
+		if ( n <= 0)
+		{
+			return d;
+		}
+
+		const T * table = du1simd::to_address( tb);
+		T * out = du1simd::to_address( d);
+		block_split< I, IS> s = detail::split_indices< T>( ib, ie);
+		std::ptrdiff_t ahead = detail::prefetch_blocks( prefetch_distance, lanes_of< std::uint32_t, IS>::value);
+
+		if ( s.has_head())
+		{
+			detail::gather_lanes< T>::gather( table, reinterpret_cast< const std::uint32_t *>( s.head), s.head_lo, s.head_hi, out);
+			out += s.head_hi - s.head_lo;
+		}
+		if ( block_kernel::hardware && static_cast< std::size_t>( te - tb) <= detail::gather_table_limit)
+		{
+			detail::gather_body< block_kernel>( table, s, out, ahead);
+		}
+		else
+		{
+			detail::gather_body< scalar_kernel>( table, s, out, ahead);
+		}
+		out += s.blocks() * lanes_of< std::uint32_t, IS>::value;
+		if ( s.has_tail())
+		{
+			detail::gather_lanes< T>::gather( table, reinterpret_cast< const std::uint32_t *>( s.tail), 0, s.tail_hi, out);
+		}
+
+		return d + n;
+	}
+
+	// Writes the values [vb, ve) to the elements of [tb, te) at the indices starting at ib in order, every
+	// index must be less than te - tb
+	template< typename U, typename T, typename S, typename I, typename IS>
+	void scatter( simd_vector_iterator< U, S> vb, simd_vector_iterator< U, S> ve, simd_vector_iterator< I, IS> ib,
+		simd_vector_iterator< T, S> tb, simd_vector_iterator< T, S> te,
+		std::size_t prefetch_distance = 0)
+	{
+		static_assert( std::is_same< typename std::remove_const< U>::type, T>::value, "Incompatible values and table!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "scatter", S, vb, ve, 3);
+
+		typedef detail::gather_block< T, IS> block_kernel;
+		typedef detail::gather_scalar< T, IS> scalar_kernel;
+
+		std::ptrdiff_t n = ve - vb;
+		if ( n <= 0)
+		{
+			return;
+		}
+
+		const T * in = du1simd::to_address( vb);
+		T * table = du1simd::to_address( tb);
+		block_split< I, IS> s = detail::split_indices< T>( ib, ib + n);
+		std::ptrdiff_t ahead = detail::prefetch_blocks( prefetch_distance, lanes_of< std::uint32_t, IS>::value);
+
+		if ( s.has_head())
+		{
+			detail::gather_lanes< T>::scatter( in, reinterpret_cast< const std::uint32_t *>( s.head), s.head_lo, s.head_hi, table);
+			in += s.head_hi - s.head_lo;
+		}
+		if ( block_kernel::hardware && static_cast< std::size_t>( te - tb) <= detail::gather_table_limit)
+		{
+			detail::scatter_body< block_kernel>( in, s, table, ahead);
+		}
+		else
+		{
+			detail::scatter_body< scalar_kernel>( in, s, table, ahead);
+		}
+		in += s.blocks() * lanes_of< std::uint32_t, IS>::value;
+		if ( s.has_tail())
+		{
+			detail::gather_lanes< T>::scatter( in, reinterpret_cast< const std::uint32_t *>( s.tail), 0, s.tail_hi, table);
+		}
+	}
+
+	// Elements of table at the indices
+	template< typename T, typename S, typename IS>
+	simd_vector< T, S> gather( const simd_vector< T, S> & table, const simd_vector< std::uint32_t, IS> & indices,
+		std::size_t prefetch_distance = 0)
+	{
+		simd_vector< T, S> r( indices.size(), du1simd::uninitialized);
+		du1simd::gather( table.begin(), table.end(), indices.begin(), indices.end(), r.begin(), prefetch_distance);
+		return r;
+	}
+
+	// Writes values to the elements of table at the indices, indices has at least values.size() elements
+	template< typename T, typename S, typename IS>
+	void scatter( const simd_vector< T, S> & values, const simd_vector< std::uint32_t, IS> & indices, simd_vector< T, S> & table,
+		std::size_t prefetch_distance = 0)
+	{
+		du1simd::scatter( values.begin(), values.end(), indices.begin(), table.begin(), table.end(), prefetch_distance);
+	}
+};
+
+#endif // DU1SIMD_GATHER_HPP
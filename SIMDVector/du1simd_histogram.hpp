@@ -0,0 +1,477 @@
+// du1simd_histogram.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Histogram and group-by kernels over simd_vector ranges of 8 and 16-bit keys
+//
+// The keys index dense tables of key_range< K>::value entries (256 or 65536) directly:
+//
+//	histogram( b, e, counts)		adds the number of occurrences of every key in [b, e) to counts[ key]
+//	group_by< A>( kb, ke, vb)		aggregates the values [vb, vb + ( ke - kb)) by the keys [kb, ke),
+//						A is aggregate::sum, min, max or count, returns a group_table
+//	parallel_histogram, parallel_group_by	the same on a thread pool
+//
+// Incrementing a table entry is a load, an add and a store. When the next element has the same key, its
+// load has to wait until the store is forwarded, so a scalar loop over a range of equal or few distinct
+// keys is bound by the store-to-load forwarding latency instead of the throughput. The kernels avoid the
+// chains in two ways:
+//
+//	- On AVX-512 (isa::avx512 at runtime) 16 keys are widened to 32-bit lanes, vpconflictd finds the
+//	  lanes with equal keys and each lane adds the number of the equal lanes up to it to the gathered
+//	  count, the scatter stores the lanes in order, so the last lane of a key leaves its total.
+//	- Otherwise consecutive elements update alternating sub-histograms, which are summed at the end.
+//
+// The counts are accumulated in 32-bit tables, flushed to the 64-bit counts before they can overflow.
+// The group-by updates two interleaved sub-tables of values the same way. The tables are merged block by
+// block by the carrier S of the value column (simd::add, simd::min, simd::max). The value range need not
+// have the same position within its blocks as the key range.
+//
+// The parallel kernels split the key range into chunks as parallel_reduce does, at most max_partials
+// of them, each builds its own table and the tables are merged pairwise in chunk order, the merges of a
+// level of the tree running in parallel. The result depends on the range and the chunk size only.
+//
+
+#ifndef DU1SIMD_HISTOGRAM_HPP
+#define DU1SIMD_HISTOGRAM_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_ops_int.hpp"
+#include "du1simd_dispatch.hpp"
+#include "du1simd_parallel.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <utility>
+#include <type_traits>
+
+#if DU1SIMD_HAVE_AVX512BW && ( defined(__AVX512CD__) || defined(_MSC_VER))
+#define DU1SIMD_HAVE_AVX512CD 1
+#else
+#define DU1SIMD_HAVE_AVX512CD 0
+#endif
+
+namespace du1simd {
+
+	// Number of the distinct keys of type K
+	template< typename K>
+	struct key_range {
+		static_assert( std::is_integral< K>::value && std::is_unsigned< K>::value && sizeof(K) <= 2, "8 or 16-bit unsigned keys required!");
+
+		static DU1SIMD_CONSTEXPR const std::size_t value = std::size_t( 1) << ( 8 * sizeof(K));
+	};
+
+	template< typename K>
+	DU1SIMD_CONSTEXPR const std::size_t key_range< K>::value;
+
+	enum class aggregate {
+		sum,
+		min,
+		max,
+		count
+	};
+
+	// Aggregates of all keys, values[ key] is the identity of the aggregate (0, the largest or the smallest
+	// value) for a key without elements, values is empty for aggregate::count
+	template< typename V, typename S>
+	struct group_table {
+		simd_vector< V, S> values;
+		std::vector< std::uint64_t> counts;
+	};
+
+	// Largest number of chunk tables of the parallel kernels
+	const std::size_t max_partials = 64;
+
+	namespace detail {
+
+		// Interleaved sub-histograms of the scalar loop, more ways were slower on the measured cores
+		const std::size_t histogram_ways = 2;
+
+		// Elements counted by a 32-bit table before it is flushed
+		const std::size_t histogram_flush = std::size_t( 1) << 31;
+
+		// counts[ key] += sub[ key] + sub[ m + key] + ..., sub is cleared
+		template< std::size_t ways>
+		void flush_counts( std::uint32_t * sub, std::size_t m, std::uint64_t * counts)
+		{
+			for ( std::size_t key = 0; key < m; ++ key)
+			{
+				std::uint64_t c = 0;
+				for ( std::size_t j = 0; j < ways; ++ j)
+				{
+					c += sub[ j * m + key];
+					sub[ j * m + key] = 0;
+				}
+				counts[ key] += c;
+			}
+		}
+
+		// Adds the counts of [p, p + n) to the table of histogram_ways sub-histograms
+		template< typename K>
+		void count_scalar( const K * p, std::size_t n, std::uint32_t * sub)
+		{
+			const std::size_t m = key_range< K>::value;
+
+			std::uint32_t * sub0 = sub;
+			std::uint32_t * sub1 = sub + m;
+			std::size_t i = 0;
+			for ( ; i + 2 <= n; i += 2)
+			{
+				++ sub0[ p[ i]];
+				++ sub1[ p[ i + 1]];
+			}
+			if ( i < n)
+			{
+				++ sub0[ p[ i]];
+			}
+		}
+
+#if DU1SIMD_HAVE_AVX512CD
+		// The masked intrinsics with all lanes set are used where the unmasked ones of GCC pass an undefined
+		// source and trip -Wmaybe-uninitialized
+
+		// 16 keys widened to 32-bit lanes
+		inline __m512i load_keys( const std::uint8_t * p)
+		{
+			return _mm512_maskz_cvtepu8_epi32( 0xFFFF, _mm_loadu_si128( reinterpret_cast< const __m128i *>( p)));
+		}
+
+		inline __m512i load_keys( const std::uint16_t * p)
+		{
+			return _mm512_maskz_cvtepu16_epi32( 0xFFFF, _mm256_loadu_si256( reinterpret_cast< const __m256i *>( p)));
+		}
+
+		// Number of the bits set in every 32-bit lane, a nibble lookup (AVX512_VPOPCNTDQ is not required)
+		inline __m512i popcount_epi32( __m512i x)
+		{
+			const __m512i table = _mm512_set4_epi32( 0x04030302, 0x03020201, 0x03020201, 0x02010100);
+			const __m512i nibble = _mm512_set1_epi8( 0x0F);
+			__m512i lo = _mm512_shuffle_epi8( table, _mm512_and_si512( x, nibble));
+			__m512i hi = _mm512_shuffle_epi8( table, _mm512_and_si512( _mm512_srli_epi16( x, 4), nibble));
+			__m512i bytes = _mm512_add_epi8( lo, hi);
+			return _mm512_madd_epi16( _mm512_maddubs_epi16( bytes, _mm512_set1_epi8( 1)), _mm512_set1_epi16( 1));
+		}
+
+		// Adds the counts of [p, p + n) to the table, vpconflictd resolves the equal keys of 16 lanes
+		template< typename K>
+		void count_conflict( const K * p, std::size_t n, std::uint32_t * table)
+		{
+			const __m512i one = _mm512_set1_epi32( 1);
+
+			std::size_t i = 0;
+			for ( ; i + 16 <= n; i += 16)
+			{
+				__m512i keys = load_keys( p + i);
+				__m512i equal_before = popcount_epi32( _mm512_conflict_epi32( keys));
+				__m512i c = _mm512_mask_i32gather_epi32( one, 0xFFFF, keys, table, 4);
+				_mm512_i32scatter_epi32( table, keys, _mm512_add_epi32( c, _mm512_add_epi32( equal_before, one)), 4);
+			}
+			for ( ; i < n; ++ i)
+			{
+				++ table[ p[ i]];
+			}
+		}
+#endif
+
+		// Adds the counts of [p, p + n) to counts
+		template< typename K>
+		void count_keys( const K * p, std::size_t n, std::uint64_t * counts)
+		{
+			const std::size_t m = key_range< K>::value;
+
+#if DU1SIMD_HAVE_AVX512CD
+			if ( supports( isa::avx512))
+			{
+				std::vector< std::uint32_t> table( m);
+				for ( ; n != 0; )
+				{
+					std::size_t piece = std::min( n, histogram_flush);
+					count_conflict( p, piece, table.data());
+					flush_counts< 1>( table.data(), m, counts);
+					p += piece;
+					n -= piece;
+				}
+				return;
+			}
+#endif
+			std::vector< std::uint32_t> sub( histogram_ways * m);
+			for ( ; n != 0; )
+			{
+				std::size_t piece = std::min( n, histogram_flush);
+				count_scalar( p, piece, sub.data());
+				flush_counts< histogram_ways>( sub.data(), m, counts);
+				p += piece;
+				n -= piece;
+			}
+		}
+
+		// Scalar update and block-wise merge of an aggregate
+		template< aggregate A, typename V, typename S>
+		struct aggregate_op;
+
+		template< typename V, typename S>
+		struct aggregate_op< aggregate::sum, V, S> {
+			static V identity()
+			{
+				return V( 0);
+			}
+			static V apply( V a, V x)
+			{
+				return a + x;
+			}
+			static S merge( S a, S b)
+			{
+				return simd< V, S>::add( a, b);
+			}
+		};
+
+		template< typename V, typename S>
+		struct aggregate_op< aggregate::min, V, S> {
+			static V identity()
+			{
+				return std::numeric_limits< V>::has_infinity ? std::numeric_limits< V>::infinity() : std::numeric_limits< V>::max();
+			}
+			static V apply( V a, V x)
+			{
+				return ( x < a) ? x : a;
+			}
+			static S merge( S a, S b)
+			{
+				return simd< V, S>::min( a, b);
+			}
+		};
+
+		template< typename V, typename S>
+		struct aggregate_op< aggregate::max, V, S> {
+			static V identity()
+			{
+				return std::numeric_limits< V>::has_infinity ? - std::numeric_limits< V>::infinity() : std::numeric_limits< V>::lowest();
+			}
+			static V apply( V a, V x)
+			{
+				return ( a < x) ? x : a;
+			}
+			static S merge( S a, S b)
+			{
+				return simd< V, S>::max( a, b);
+			}
+		};
+
+		// The table of aggregate::count has no values
+		template< typename V, typename S>
+		struct aggregate_op< aggregate::count, V, S> {
+		};
+
+		// Interleaved sub-tables of the group-by
+		const std::size_t group_ways = 2;
+
+		// Table of m groups with the values set to the identity of the aggregate
+		template< aggregate A, typename V, typename S>
+		group_table< V, S> make_table( std::size_t m, std::true_type)
+		{
+			group_table< V, S> t;
+			t.values.resize( m, aggregate_op< A, V, S>::identity());
+			t.counts.assign( m, 0);
+			return t;
+		}
+
+		template< aggregate A, typename V, typename S>
+		group_table< V, S> make_table( std::size_t m, std::false_type)
+		{
+			group_table< V, S> t;
+			t.counts.assign( m, 0);
+			return t;
+		}
+
+		template< aggregate A, typename V, typename S>
+		group_table< V, S> make_table( std::size_t m)
+		{
+			return make_table< A, V, S>( m, std::integral_constant< bool, A != aggregate::count>());
+		}
+
+		// a.values = merge( a.values, b.values) block by block, the tables have the same size
+		template< aggregate A, typename V, typename S>
+		void merge_values( simd_vector< V, S> & a, const simd_vector< V, S> & b, std::true_type)
+		{
+			auto p = a.begin().lower_block();
+			auto q = b.begin().lower_block();
+			std::size_t count = a.size() / lanes_of< V, S>::value;
+			for ( std::size_t i = 0; i < count; ++ i)
+			{
+				p[ i] = aggregate_op< A, V, S>::merge( p[ i], q[ i]);
+			}
+		}
+
+		template< aggregate A, typename V, typename S>
+		void merge_values( simd_vector< V, S> &, const simd_vector< V, S> &, std::false_type)
+		{
+		}
+
+		// Adds the groups of b to a
+		template< aggregate A, typename V, typename S>
+		void merge_tables( group_table< V, S> & a, const group_table< V, S> & b)
+		{
+			merge_values< A>( a.values, b.values, std::integral_constant< bool, A != aggregate::count>());
+			for ( std::size_t key = 0; key < a.counts.size(); ++ key)
+			{
+				a.counts[ key] += b.counts[ key];
+			}
+		}
+
+		// Aggregates [x, x + n) by the keys [p, p + n) into t
+		template< aggregate A, typename K, typename V, typename S>
+		void group_values( const K * p, const V * x, std::size_t n, group_table< V, S> & t, std::true_type)
+		{
+			typedef aggregate_op< A, V, S> op;
+
+			const std::size_t m = key_range< K>::value;
+
+			// The second sub-table is merged block-wise into the first one (t.values)
+			group_table< V, S> second = make_table< A, V, S>( m);
+			V * v0 = du1simd::to_address( t.values.begin());
+			V * v1 = du1simd::to_address( second.values.begin());
+			std::uint64_t * c0 = t.counts.data();
+			std::uint64_t * c1 = second.counts.data();
+
+			std::size_t i = 0;
+			for ( ; i + group_ways <= n; i += group_ways)
+			{
+				K k0 = p[ i];
+				K k1 = p[ i + 1];
+				v0[ k0] = op::apply( v0[ k0], x[ i]);
+				v1[ k1] = op::apply( v1[ k1], x[ i + 1]);
+				++ c0[ k0];
+				++ c1[ k1];
+			}
+			if ( i < n)
+			{
+				v0[ p[ i]] = op::apply( v0[ p[ i]], x[ i]);
+				++ c0[ p[ i]];
+			}
+
+			merge_tables< A>( t, second);
+		}
+
+		// aggregate::count is a histogram
+		template< aggregate A, typename K, typename V, typename S>
+		void group_values( const K * p, const V *, std::size_t n, group_table< V, S> & t, std::false_type)
+		{
+			count_keys( p, n, t.counts.data());
+		}
+
+		template< aggregate A, typename K, typename KS, typename V, typename S>
+		group_table< typename std::remove_const< V>::type, S> group_range( simd_vector_iterator< K, KS> kb, simd_vector_iterator< K, KS> ke, simd_vector_iterator< V, S> vb)
+		{
+			typedef typename std::remove_const< K>::type key_type;
+			typedef typename std::remove_const< V>::type value_type;
+
+			group_table< value_type, S> t = make_table< A, value_type, S>( key_range< key_type>::value);
+			if ( kb < ke)
+			{
+				group_values< A>( du1simd::to_address( kb), du1simd::to_address( vb), static_cast< std::size_t>( ke - kb), t,
+					std::integral_constant< bool, A != aggregate::count>());
+			}
+			return t;
+		}
+
+		// Chunks of [b, e) of at least chunk_size elements, at most max_partials of them
+		inline std::size_t partial_chunk_size( std::ptrdiff_t n, std::size_t chunk_size)
+		{
+			std::size_t least = ( static_cast< std::size_t>( n) + max_partials - 1) / max_partials;
+			return std::max( chunk_size, least);
+		}
+
+		// Builds the table of every chunk on the pool, merges them pairwise in chunk order
+		template< typename R, typename T, typename S, typename B, typename M>
+		R parallel_tables( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, B build, M merge, thread_pool & pool, std::size_t chunk_size)
+		{
+			chunking< T, S> chunks( b, e, partial_chunk_size( e - b, chunk_size));
+			std::size_t n = chunks.count();
+			if ( n == 0)
+			{
+				return build( b, b);
+			}
+
+			std::vector< R> partials( n);
+			pool.parallel_for( n, [ & partials, & build, & chunks]( std::size_t i){
+				partials[ i] = build( chunks.begin( i), chunks.end( i));
+			});
+			for ( std::size_t w = 1; w < n; w *= 2)
+			{
+				pool.parallel_for( ( n - w + 2 * w - 1) / ( 2 * w), [ & partials, & merge, w]( std::size_t j){
+					merge( partials[ 2 * w * j], partials[ 2 * w * j + w]);
+				});
+			}
+			return std::move( partials[ 0]);
+		}
+	}
+
+	// Adds the number of occurrences of every key in [b, e) to counts[ key], counts has key_range< K> entries
+	template< typename K, typename S>
+	void histogram( simd_vector_iterator< K, S> b, simd_vector_iterator< K, S> e, std::uint64_t * counts)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "histogram", S, b, e, 1);
+
+		if ( b < e)
+		{
+			detail::count_keys( du1simd::to_address( b), static_cast< std::size_t>( e - b), counts);
+		}
+	}
+
+	// Numbers of occurrences of all keys in [b, e)
+	template< typename K, typename S>
+	std::vector< std::uint64_t> histogram( simd_vector_iterator< K, S> b, simd_vector_iterator< K, S> e)
+	{
+		std::vector< std::uint64_t> counts( key_range< typename std::remove_const< K>::type>::value);
+		histogram( b, e, counts.data());
+		return counts;
+	}
+
+	// Aggregates of the values [vb, vb + ( ke - kb)) grouped by the keys [kb, ke)
+	template< aggregate A, typename K, typename KS, typename V, typename S>
+	group_table< typename std::remove_const< V>::type, S> group_by( simd_vector_iterator< K, KS> kb, simd_vector_iterator< K, KS> ke, simd_vector_iterator< V, S> vb)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "group_by", KS, kb, ke, 1);
+
+		return detail::group_range< A>( kb, ke, vb);
+	}
+
+	// Histogram of [b, e) built on the pool
+	template< typename K, typename S>
+	std::vector< std::uint64_t> parallel_histogram( simd_vector_iterator< K, S> b, simd_vector_iterator< K, S> e,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "parallel_histogram", S, b, e, 1);
+
+		typedef std::vector< std::uint64_t> table_type;
+		return detail::parallel_tables< table_type>( b, e,
+			[]( simd_vector_iterator< K, S> cb, simd_vector_iterator< K, S> ce){ return histogram( cb, ce); },
+			[]( table_type & x, const table_type & y){
+				for ( std::size_t key = 0; key < x.size(); ++ key)
+				{
+					x[ key] += y[ key];
+				}
+			},
+			pool, chunk_size);
+	}
+
+	// group_by of [kb, ke) built on the pool
+	template< aggregate A, typename K, typename KS, typename V, typename S>
+	group_table< typename std::remove_const< V>::type, S> parallel_group_by( simd_vector_iterator< K, KS> kb, simd_vector_iterator< K, KS> ke, simd_vector_iterator< V, S> vb,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "parallel_group_by", KS, kb, ke, 1);
+
+		typedef group_table< typename std::remove_const< V>::type, S> table_type;
+		return detail::parallel_tables< table_type>( kb, ke,
+			[ kb, vb]( simd_vector_iterator< K, KS> cb, simd_vector_iterator< K, KS> ce){ return detail::group_range< A>( cb, ce, vb + ( cb - kb)); },
+			[]( table_type & x, const table_type & y){ detail::merge_tables< A>( x, y); },
+			pool, chunk_size);
+	}
+};
+
+#endif // DU1SIMD_HISTOGRAM_HPP
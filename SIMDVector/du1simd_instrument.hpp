@@ -0,0 +1,200 @@
+// du1simd_instrument.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Opt-in counters of the kernels
+//
+// With DU1SIMD_INSTRUMENT defined to 1 every call of an instrumented kernel adds to the counters
+// registered under the name of the kernel:
+//
+//	calls		number of calls
+//	bytes		bytes read and written by the calls (the range size times the number of streams)
+//	blocks		whole blocks of the ranges, processed by the unmasked loops
+//	edge_blocks	partial first and last blocks, processed by masked loads and stores
+//	nanoseconds	wall time of the calls
+//	cycles		core cycles of the calling thread (hardware counters only)
+//	llc_misses	last level cache misses of the calling thread (hardware counters only)
+//
+// simd_vector counts its allocations under "simd_vector::allocate", bytes are the sizes requested from
+// the allocator. The counters are updated by relaxed atomic additions when the call returns, so kernels
+// running on several threads at once are counted correctly. A kernel calling another instrumented kernel
+// (e.g. parallel_reduce_sum calling reduce_sum per chunk) is counted by both.
+//
+// du1simd::instrument::snapshot() copies the counters of all kernels registered so far, reset() clears
+// them and report( os) prints them as a table. The bytes per nanosecond and the LLC misses per byte tell
+// a memory-bound call from a compute-bound one.
+//
+// enable_hardware_counters( true) additionally reads the cycles and the LLC misses of the calling thread
+// by perf_event_open (Linux) around each call. It returns false if the counters cannot be opened (other
+// platforms, perf_event_paranoid, virtual machines without a PMU), the hardware columns stay zero then.
+// Only the calling thread is measured, the workers of a parallel kernel are not.
+//
+// Without DU1SIMD_INSTRUMENT the macros expand to nothing and the kernels are not changed at all. The flag
+// changes the inline kernels, so it must be the same in all translation units of a program.
+//
+
+#ifndef DU1SIMD_INSTRUMENT_HPP
+#define DU1SIMD_INSTRUMENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#ifndef DU1SIMD_INSTRUMENT
+#define DU1SIMD_INSTRUMENT 0
+#endif
+
+namespace du1simd {
+
+	namespace instrument {
+
+		// Counters of one kernel
+		struct counters {
+			std::atomic< std::uint64_t> calls;
+			std::atomic< std::uint64_t> bytes;
+			std::atomic< std::uint64_t> blocks;
+			std::atomic< std::uint64_t> edge_blocks;
+			std::atomic< std::uint64_t> nanoseconds;
+			std::atomic< std::uint64_t> cycles;
+			std::atomic< std::uint64_t> llc_misses;
+
+			counters() : calls( 0), bytes( 0), blocks( 0), edge_blocks( 0), nanoseconds( 0), cycles( 0), llc_misses( 0) { }
+		};
+
+		// Copy of the counters of one kernel
+		struct kernel_stats {
+			std::string name;
+			std::uint64_t calls;
+			std::uint64_t bytes;
+			std::uint64_t blocks;
+			std::uint64_t edge_blocks;
+			std::uint64_t nanoseconds;
+			std::uint64_t cycles;
+			std::uint64_t llc_misses;
+		};
+
+		// Counters of the kernel name, registered by the first call, the reference stays valid forever
+		counters & kernel( const char * name);
+
+		// Counters of all registered kernels in the order of registration
+		std::vector< kernel_stats> snapshot();
+
+		// Clears the counters of all registered kernels
+		void reset();
+
+		// Prints the snapshot, one kernel per line
+		void report( std::ostream & os);
+
+		// Turns the reading of the hardware counters on or off, returns whether they are read
+		bool enable_hardware_counters( bool on);
+
+		bool hardware_counters_enabled();
+
+		// Hardware counters of the calling thread
+		struct hardware_sample {
+			std::uint64_t cycles;
+			std::uint64_t llc_misses;
+		};
+
+		// Reads the hardware counters of the calling thread, false if they are not enabled or not available
+		bool read_hardware_counters( hardware_sample & s);
+
+		// Measures one call of a kernel, the counters are updated by the destructor
+		class scope {
+		public:
+			// A range of count elements of element_size bytes starting at first, split into blocks of
+			// block_size bytes, streams ranges of that size are read or written
+			scope( counters & c, const void * first, std::size_t count, std::size_t element_size, std::size_t block_size, std::size_t streams)
+				: c_( c), hardware_( false)
+			{
+				std::size_t k = block_size / element_size;
+				std::size_t lo = static_cast< std::size_t>( reinterpret_cast< std::uintptr_t>( first) % block_size) / element_size;
+				std::size_t n = count;
+				std::uint64_t edge = 0;
+				if ( n != 0 && ( lo != 0 || n < k))
+				{
+					std::size_t head = ( k - lo < n) ? k - lo : n;
+					n -= head;
+					++ edge;
+				}
+				if ( n % k != 0)
+				{
+					++ edge;
+				}
+
+				c_.calls.fetch_add( 1, std::memory_order_relaxed);
+				c_.bytes.fetch_add( static_cast< std::uint64_t>( count) * element_size * streams, std::memory_order_relaxed);
+				c_.blocks.fetch_add( n / k, std::memory_order_relaxed);
+				c_.edge_blocks.fetch_add( edge, std::memory_order_relaxed);
+
+				start();
+			}
+
+			// A call processing bytes bytes without a block structure (e.g. an allocation)
+			scope( counters & c, std::size_t bytes)
+				: c_( c), hardware_( false)
+			{
+				c_.calls.fetch_add( 1, std::memory_order_relaxed);
+				c_.bytes.fetch_add( bytes, std::memory_order_relaxed);
+
+				start();
+			}
+
+			~scope()
+			{
+				hardware_sample end;
+				if ( hardware_ && read_hardware_counters( end))
+				{
+					c_.cycles.fetch_add( end.cycles - sample_.cycles, std::memory_order_relaxed);
+					c_.llc_misses.fetch_add( end.llc_misses - sample_.llc_misses, std::memory_order_relaxed);
+				}
+				auto t = std::chrono::steady_clock::now() - start_;
+				c_.nanoseconds.fetch_add( static_cast< std::uint64_t>( std::chrono::duration_cast< std::chrono::nanoseconds>( t).count()), std::memory_order_relaxed);
+			}
+
+		private:
+			scope( const scope &);
+			scope & operator=( const scope &);
+
+			void start()
+			{
+				hardware_ = read_hardware_counters( sample_);
+				start_ = std::chrono::steady_clock::now();
+			}
+
+			counters & c_;
+			bool hardware_;
+			hardware_sample sample_;
+			std::chrono::steady_clock::time_point start_;
+		};
+	}
+};
+
+#if DU1SIMD_INSTRUMENT
+
+#define DU1SIMD_INSTRUMENT_CAT2( a, b) a ## b
+#define DU1SIMD_INSTRUMENT_CAT( a, b) DU1SIMD_INSTRUMENT_CAT2( a, b)
+
+// Counts the call of the kernel name over the simd_vector range [b, e) with blocks of S
+#define DU1SIMD_INSTRUMENT_RANGE( name, S, b, e, streams) \
+	static du1simd::instrument::counters & DU1SIMD_INSTRUMENT_CAT( du1simd_counters_, __LINE__) = du1simd::instrument::kernel( name); \
+	du1simd::instrument::scope DU1SIMD_INSTRUMENT_CAT( du1simd_scope_, __LINE__)( DU1SIMD_INSTRUMENT_CAT( du1simd_counters_, __LINE__), \
+		du1simd::to_address( b), static_cast< std::size_t>( ( e) - ( b) > 0 ? ( e) - ( b) : 0), sizeof( * du1simd::to_address( b)), sizeof(S), streams)
+
+// Counts the call of name processing bytes bytes
+#define DU1SIMD_INSTRUMENT_BYTES( name, bytes) \
+	static du1simd::instrument::counters & DU1SIMD_INSTRUMENT_CAT( du1simd_counters_, __LINE__) = du1simd::instrument::kernel( name); \
+	du1simd::instrument::scope DU1SIMD_INSTRUMENT_CAT( du1simd_scope_, __LINE__)( DU1SIMD_INSTRUMENT_CAT( du1simd_counters_, __LINE__), bytes)
+
+#else
+
+#define DU1SIMD_INSTRUMENT_RANGE( name, S, b, e, streams)
+#define DU1SIMD_INSTRUMENT_BYTES( name, bytes)
+
+#endif
+
+#endif // DU1SIMD_INSTRUMENT_HPP
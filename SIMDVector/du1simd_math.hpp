@@ -0,0 +1,641 @@
+// du1simd_math.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Transcendental functions of the float and double carriers
+//
+// du1simd::math< T, S> provides exp, log, tanh and sigmoid (1 / (1 + exp( -x))) of all the lanes of a
+// carrier of du1simd_ops.hpp, computed in the registers by polynomial approximations:
+//
+//	exp		x = n ln 2 + r, |r| <= ln 2 / 2, exp( r) by a polynomial, scaled by 2^n
+//	log		x = m 2^e, sqrt( 1/2) <= m < sqrt( 2), log( m) = 2 atanh( s) by a polynomial of
+//			s = (m - 1) / (m + 1)
+//	tanh		(exp( 2 |x|) - 1) / (exp( 2 |x|) + 1) with exp( 2 |x|) - 1 computed without cancellation
+//	sigmoid		1 / (1 + exp( -x))
+//
+// All the carriers of a type compute the same polynomials, so the results differ only where the
+// carrier fuses the multiply-adds (simd::fmadd). The maximum errors measured against the long double
+// functions of the C library over points spread over the ranges (du1test.cpp, math_test) are:
+//
+//			float		double
+//	exp		1 ulp		1 ulp		x in [-87, 88] resp. [-708, 709], subnormal results
+//							below that are within 1 ulp of the subnormal spacing
+//	log		2 ulp		2 ulp		x > 0, subnormals included
+//	tanh		3 ulp		3 ulp
+//	sigmoid		3 ulp		3 ulp		x in [-87, 87] resp. [-708, 708]
+//
+// The special values follow the C library: exp( -inf) = 0, exp( +inf) = exp( x) of an overflowing x =
+// +inf, log( 0) = -inf, log( x < 0) = NaN, log( +inf) = +inf, a NaN stays NaN. tanh( -0) is +0.
+//
+// The functions can also be applied lazily to simd_vectors and expressions (du1simd_expr.hpp):
+//
+//	z = du1simd::exp( -0.5F * x * x) / 2.5066283F;
+//
+
+#ifndef DU1SIMD_MATH_HPP
+#define DU1SIMD_MATH_HPP
+
+#include "du1simd_ops.hpp"
+#include "du1simd_expr.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace du1simd {
+
+	namespace detail {
+
+		// Binary format of the element type
+		template< typename T>
+		struct float_format;
+
+		template<>
+		struct float_format< float> {
+			typedef std::uint32_t bits_type;
+			static const int mantissa_bits = 23;
+			static const int exponent_bias = 127;
+		};
+
+		template<>
+		struct float_format< double> {
+			typedef std::uint64_t bits_type;
+			static const int mantissa_bits = 52;
+			static const int exponent_bias = 1023;
+		};
+
+		template< typename T>
+		T from_bits( typename float_format< T>::bits_type u)
+		{
+			T x;
+			std::memcpy( & x, & u, sizeof(T));
+			return x;
+		}
+
+		template< typename T>
+		typename float_format< T>::bits_type to_bits( T x)
+		{
+			typename float_format< T>::bits_type u;
+			std::memcpy( & u, & x, sizeof(T));
+			return u;
+		}
+
+		// Bit operations on the lanes of a carrier seen as unsigned integers of the size of T, and the
+		// selection of lanes by a comparison
+		//	shift_left( a)		lanes of a shifted left by the mantissa bits, e.g. an integer to the exponent
+		//	shift_right( a)		lanes of a shifted right by the mantissa bits, the biased exponent
+		//	bit_and, bit_or
+		//	select_lt( a, b, x, y)	x where a < b, y otherwise (also where a or b is NaN)
+		//	select_eq( a, b, x, y)	x where a == b, y otherwise
+		template< typename T, typename S>
+		struct float_bits;
+
+		template< typename T>
+		struct scalar_float_bits {
+			typedef typename float_format< T>::bits_type bits_type;
+
+			static T shift_left( T a)
+			{
+				return from_bits< T>( to_bits( a) << float_format< T>::mantissa_bits);
+			}
+			static T shift_right( T a)
+			{
+				return from_bits< T>( to_bits( a) >> float_format< T>::mantissa_bits);
+			}
+			static T bit_and( T a, T b)
+			{
+				return from_bits< T>( to_bits( a) & to_bits( b));
+			}
+			static T bit_or( T a, T b)
+			{
+				return from_bits< T>( to_bits( a) | to_bits( b));
+			}
+			static T select_lt( T a, T b, T x, T y)
+			{
+				return a < b ? x : y;
+			}
+			static T select_eq( T a, T b, T x, T y)
+			{
+				return a == b ? x : y;
+			}
+		};
+
+		template<>
+		struct float_bits< float, float> : scalar_float_bits< float> {
+		};
+
+		template<>
+		struct float_bits< double, double> : scalar_float_bits< double> {
+		};
+
+#if DU1SIMD_HAVE_SSE
+		template<>
+		struct float_bits< float, __m128> {
+			static __m128 shift_left( __m128 a)
+			{
+				return _mm_castsi128_ps( _mm_slli_epi32( _mm_castps_si128( a), 23));
+			}
+			static __m128 shift_right( __m128 a)
+			{
+				return _mm_castsi128_ps( _mm_srli_epi32( _mm_castps_si128( a), 23));
+			}
+			static __m128 bit_and( __m128 a, __m128 b)
+			{
+				return _mm_and_ps( a, b);
+			}
+			static __m128 bit_or( __m128 a, __m128 b)
+			{
+				return _mm_or_ps( a, b);
+			}
+			static __m128 select_lt( __m128 a, __m128 b, __m128 x, __m128 y)
+			{
+				__m128 m = _mm_cmplt_ps( a, b);
+				return _mm_or_ps( _mm_and_ps( m, x), _mm_andnot_ps( m, y));
+			}
+			static __m128 select_eq( __m128 a, __m128 b, __m128 x, __m128 y)
+			{
+				__m128 m = _mm_cmpeq_ps( a, b);
+				return _mm_or_ps( _mm_and_ps( m, x), _mm_andnot_ps( m, y));
+			}
+		};
+
+		template<>
+		struct float_bits< double, __m128d> {
+			static __m128d shift_left( __m128d a)
+			{
+				return _mm_castsi128_pd( _mm_slli_epi64( _mm_castpd_si128( a), 52));
+			}
+			static __m128d shift_right( __m128d a)
+			{
+				return _mm_castsi128_pd( _mm_srli_epi64( _mm_castpd_si128( a), 52));
+			}
+			static __m128d bit_and( __m128d a, __m128d b)
+			{
+				return _mm_and_pd( a, b);
+			}
+			static __m128d bit_or( __m128d a, __m128d b)
+			{
+				return _mm_or_pd( a, b);
+			}
+			static __m128d select_lt( __m128d a, __m128d b, __m128d x, __m128d y)
+			{
+				__m128d m = _mm_cmplt_pd( a, b);
+				return _mm_or_pd( _mm_and_pd( m, x), _mm_andnot_pd( m, y));
+			}
+			static __m128d select_eq( __m128d a, __m128d b, __m128d x, __m128d y)
+			{
+				__m128d m = _mm_cmpeq_pd( a, b);
+				return _mm_or_pd( _mm_and_pd( m, x), _mm_andnot_pd( m, y));
+			}
+		};
+#endif
+
+#if DU1SIMD_HAVE_AVX
+		// The integer shifts of 256-bit vectors are AVX2, the carriers of AVX shift the halves by SSE2
+		template<>
+		struct float_bits< float, __m256> {
+			static __m256 shift_left( __m256 a)
+			{
+#if defined(__AVX2__)
+				return _mm256_castsi256_ps( _mm256_slli_epi32( _mm256_castps_si256( a), 23));
+#else
+				__m256i i = _mm256_castps_si256( a);
+				__m128i lo = _mm_slli_epi32( _mm256_castsi256_si128( i), 23);
+				__m128i hi = _mm_slli_epi32( _mm256_extractf128_si256( i, 1), 23);
+				return _mm256_castsi256_ps( _mm256_insertf128_si256( _mm256_castsi128_si256( lo), hi, 1));
+#endif
+			}
+			static __m256 shift_right( __m256 a)
+			{
+#if defined(__AVX2__)
+				return _mm256_castsi256_ps( _mm256_srli_epi32( _mm256_castps_si256( a), 23));
+#else
+				__m256i i = _mm256_castps_si256( a);
+				__m128i lo = _mm_srli_epi32( _mm256_castsi256_si128( i), 23);
+				__m128i hi = _mm_srli_epi32( _mm256_extractf128_si256( i, 1), 23);
+				return _mm256_castsi256_ps( _mm256_insertf128_si256( _mm256_castsi128_si256( lo), hi, 1));
+#endif
+			}
+			static __m256 bit_and( __m256 a, __m256 b)
+			{
+				return _mm256_and_ps( a, b);
+			}
+			static __m256 bit_or( __m256 a, __m256 b)
+			{
+				return _mm256_or_ps( a, b);
+			}
+			static __m256 select_lt( __m256 a, __m256 b, __m256 x, __m256 y)
+			{
+				return _mm256_blendv_ps( y, x, _mm256_cmp_ps( a, b, _CMP_LT_OQ));
+			}
+			static __m256 select_eq( __m256 a, __m256 b, __m256 x, __m256 y)
+			{
+				return _mm256_blendv_ps( y, x, _mm256_cmp_ps( a, b, _CMP_EQ_OQ));
+			}
+		};
+
+		template<>
+		struct float_bits< double, __m256d> {
+			static __m256d shift_left( __m256d a)
+			{
+#if defined(__AVX2__)
+				return _mm256_castsi256_pd( _mm256_slli_epi64( _mm256_castpd_si256( a), 52));
+#else
+				__m256i i = _mm256_castpd_si256( a);
+				__m128i lo = _mm_slli_epi64( _mm256_castsi256_si128( i), 52);
+				__m128i hi = _mm_slli_epi64( _mm256_extractf128_si256( i, 1), 52);
+				return _mm256_castsi256_pd( _mm256_insertf128_si256( _mm256_castsi128_si256( lo), hi, 1));
+#endif
+			}
+			static __m256d shift_right( __m256d a)
+			{
+#if defined(__AVX2__)
+				return _mm256_castsi256_pd( _mm256_srli_epi64( _mm256_castpd_si256( a), 52));
+#else
+				__m256i i = _mm256_castpd_si256( a);
+				__m128i lo = _mm_srli_epi64( _mm256_castsi256_si128( i), 52);
+				__m128i hi = _mm_srli_epi64( _mm256_extractf128_si256( i, 1), 52);
+				return _mm256_castsi256_pd( _mm256_insertf128_si256( _mm256_castsi128_si256( lo), hi, 1));
+#endif
+			}
+			static __m256d bit_and( __m256d a, __m256d b)
+			{
+				return _mm256_and_pd( a, b);
+			}
+			static __m256d bit_or( __m256d a, __m256d b)
+			{
+				return _mm256_or_pd( a, b);
+			}
+			static __m256d select_lt( __m256d a, __m256d b, __m256d x, __m256d y)
+			{
+				return _mm256_blendv_pd( y, x, _mm256_cmp_pd( a, b, _CMP_LT_OQ));
+			}
+			static __m256d select_eq( __m256d a, __m256d b, __m256d x, __m256d y)
+			{
+				return _mm256_blendv_pd( y, x, _mm256_cmp_pd( a, b, _CMP_EQ_OQ));
+			}
+		};
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+		// The floating-point bit operations of 512-bit vectors are AVX512DQ, the integer ones are AVX512F
+		template<>
+		struct float_bits< float, __m512> {
+			static __m512 shift_left( __m512 a)
+			{
+				return _mm512_castsi512_ps( _mm512_slli_epi32( _mm512_castps_si512( a), 23));
+			}
+			static __m512 shift_right( __m512 a)
+			{
+				return _mm512_castsi512_ps( _mm512_srli_epi32( _mm512_castps_si512( a), 23));
+			}
+			static __m512 bit_and( __m512 a, __m512 b)
+			{
+				return _mm512_castsi512_ps( _mm512_and_si512( _mm512_castps_si512( a), _mm512_castps_si512( b)));
+			}
+			static __m512 bit_or( __m512 a, __m512 b)
+			{
+				return _mm512_castsi512_ps( _mm512_or_si512( _mm512_castps_si512( a), _mm512_castps_si512( b)));
+			}
+			static __m512 select_lt( __m512 a, __m512 b, __m512 x, __m512 y)
+			{
+				return _mm512_mask_blend_ps( _mm512_cmp_ps_mask( a, b, _CMP_LT_OQ), y, x);
+			}
+			static __m512 select_eq( __m512 a, __m512 b, __m512 x, __m512 y)
+			{
+				return _mm512_mask_blend_ps( _mm512_cmp_ps_mask( a, b, _CMP_EQ_OQ), y, x);
+			}
+		};
+
+		template<>
+		struct float_bits< double, __m512d> {
+			static __m512d shift_left( __m512d a)
+			{
+				return _mm512_castsi512_pd( _mm512_slli_epi64( _mm512_castpd_si512( a), 52));
+			}
+			static __m512d shift_right( __m512d a)
+			{
+				return _mm512_castsi512_pd( _mm512_srli_epi64( _mm512_castpd_si512( a), 52));
+			}
+			static __m512d bit_and( __m512d a, __m512d b)
+			{
+				return _mm512_castsi512_pd( _mm512_and_si512( _mm512_castpd_si512( a), _mm512_castpd_si512( b)));
+			}
+			static __m512d bit_or( __m512d a, __m512d b)
+			{
+				return _mm512_castsi512_pd( _mm512_or_si512( _mm512_castpd_si512( a), _mm512_castpd_si512( b)));
+			}
+			static __m512d select_lt( __m512d a, __m512d b, __m512d x, __m512d y)
+			{
+				return _mm512_mask_blend_pd( _mm512_cmp_pd_mask( a, b, _CMP_LT_OQ), y, x);
+			}
+			static __m512d select_eq( __m512d a, __m512d b, __m512d x, __m512d y)
+			{
+				return _mm512_mask_blend_pd( _mm512_cmp_pd_mask( a, b, _CMP_EQ_OQ), y, x);
+			}
+		};
+#endif
+
+#if DU1SIMD_HAVE_NEON
+		template<>
+		struct float_bits< float, float32x4_t> {
+			static float32x4_t shift_left( float32x4_t a)
+			{
+				return vreinterpretq_f32_u32( vshlq_n_u32( vreinterpretq_u32_f32( a), 23));
+			}
+			static float32x4_t shift_right( float32x4_t a)
+			{
+				return vreinterpretq_f32_u32( vshrq_n_u32( vreinterpretq_u32_f32( a), 23));
+			}
+			static float32x4_t bit_and( float32x4_t a, float32x4_t b)
+			{
+				return vreinterpretq_f32_u32( vandq_u32( vreinterpretq_u32_f32( a), vreinterpretq_u32_f32( b)));
+			}
+			static float32x4_t bit_or( float32x4_t a, float32x4_t b)
+			{
+				return vreinterpretq_f32_u32( vorrq_u32( vreinterpretq_u32_f32( a), vreinterpretq_u32_f32( b)));
+			}
+			static float32x4_t select_lt( float32x4_t a, float32x4_t b, float32x4_t x, float32x4_t y)
+			{
+				return vbslq_f32( vcltq_f32( a, b), x, y);
+			}
+			static float32x4_t select_eq( float32x4_t a, float32x4_t b, float32x4_t x, float32x4_t y)
+			{
+				return vbslq_f32( vceqq_f32( a, b), x, y);
+			}
+		};
+#endif
+
+#if DU1SIMD_HAVE_SVE
+		template<>
+		struct float_bits< float, sve_float32_t> {
+			static sve_float32_t shift_left( sve_float32_t a)
+			{
+				return svreinterpret_f32_u32( svlsl_n_u32_x( svptrue_b32(), svreinterpret_u32_f32( a), 23));
+			}
+			static sve_float32_t shift_right( sve_float32_t a)
+			{
+				return svreinterpret_f32_u32( svlsr_n_u32_x( svptrue_b32(), svreinterpret_u32_f32( a), 23));
+			}
+			static sve_float32_t bit_and( sve_float32_t a, sve_float32_t b)
+			{
+				return svreinterpret_f32_u32( svand_u32_x( svptrue_b32(), svreinterpret_u32_f32( a), svreinterpret_u32_f32( b)));
+			}
+			static sve_float32_t bit_or( sve_float32_t a, sve_float32_t b)
+			{
+				return svreinterpret_f32_u32( svorr_u32_x( svptrue_b32(), svreinterpret_u32_f32( a), svreinterpret_u32_f32( b)));
+			}
+			static sve_float32_t select_lt( sve_float32_t a, sve_float32_t b, sve_float32_t x, sve_float32_t y)
+			{
+				return svsel_f32( svcmplt_f32( svptrue_b32(), a, b), x, y);
+			}
+			static sve_float32_t select_eq( sve_float32_t a, sve_float32_t b, sve_float32_t x, sve_float32_t y)
+			{
+				return svsel_f32( svcmpeq_f32( svptrue_b32(), a, b), x, y);
+			}
+		};
+#endif
+
+		// Constants of the approximations, the polynomials start with the highest coefficient
+		template< typename T>
+		struct math_constants;
+
+		template<>
+		struct math_constants< float> {
+			// ln 2 = ln2_hi + ln2_lo, n ln2_hi is exact for the exponents n of float
+			static float ln2_hi() { return 0.693359375F; }
+			static float ln2_lo() { return -2.12194440e-4F; }
+			static float log2e() { return 1.44269504088896341F; }
+			// Below exp_lo exp( x) rounds to 0, above exp_hi to +inf
+			static float exp_lo() { return -103.972084F; }
+			static float exp_hi() { return 88.7228394F; }
+			// tanh( x) rounds to 1 above tanh_hi
+			static float tanh_hi() { return 9.0F; }
+			// exp( r) - 1 - r = r^2 p( r) on |r| <= ln 2 / 2, the minimax polynomial of Cephes
+			static const std::size_t exp_degree = 6;
+			static const float * exp_poly()
+			{
+				static const float p[ exp_degree] = {
+					1.9875691500E-4F, 1.3981999507E-3F, 8.3334519073E-3F, 4.1665795894E-2F, 1.6666665459E-1F, 5.0000001201E-1F };
+				return p;
+			}
+			// atanh( s) / s - 1 = s^2 q( s^2) on |s| <= 3 - 2 sqrt( 2), the Taylor series
+			static const std::size_t log_degree = 5;
+			static const float * log_poly()
+			{
+				static const float q[ log_degree] = {
+					1.0F / 11, 1.0F / 9, 1.0F / 7, 1.0F / 5, 1.0F / 3 };
+				return q;
+			}
+		};
+
+		template<>
+		struct math_constants< double> {
+			static double ln2_hi() { return 6.93145751953125E-1; }
+			static double ln2_lo() { return 1.42860682030941723212E-6; }
+			static double log2e() { return 1.44269504088896341; }
+			static double exp_lo() { return -745.13321910194122; }
+			static double exp_hi() { return 709.782712893383973; }
+			static double tanh_hi() { return 22.0; }
+			// The Taylor series up to r^13 / 13!
+			static const std::size_t exp_degree = 12;
+			static const double * exp_poly()
+			{
+				static const double p[ exp_degree] = {
+					1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0,
+					1.0 / 5040.0, 1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 1.0 / 2.0 };
+				return p;
+			}
+			static const std::size_t log_degree = 10;
+			static const double * log_poly()
+			{
+				static const double q[ log_degree] = {
+					1.0 / 21, 1.0 / 19, 1.0 / 17, 1.0 / 15, 1.0 / 13, 1.0 / 11, 1.0 / 9, 1.0 / 7, 1.0 / 5, 1.0 / 3 };
+				return q;
+			}
+		};
+	}
+
+	// exp, log, tanh and sigmoid of the lanes of a float or double carrier
+	template< typename T, typename S>
+	struct math {
+	private:
+		typedef simd< T, S> simd_op;
+		typedef detail::float_bits< T, S> bits_op;
+		typedef detail::float_format< T> format;
+		typedef detail::math_constants< T> constants;
+
+		static S constant( T x)
+		{
+			return simd_op::broadcast( x);
+		}
+
+		// p( x) by the Horner scheme
+		static S horner( S x, const T * p, std::size_t n)
+		{
+			S y = constant( p[ 0]);
+			for ( std::size_t i = 1; i < n; ++ i)
+			{
+				y = simd_op::fmadd( y, x, constant( p[ i]));
+			}
+			return y;
+		}
+
+		// Rounds the lanes to the nearest integer, |x| < 2^(mantissa_bits - 1)
+		static S round( S x)
+		{
+			const S magic = constant( static_cast< T>( 1.5) * static_cast< T>( typename format::bits_type( 1) << format::mantissa_bits));
+			return simd_op::sub( simd_op::add( x, magic), magic);
+		}
+
+		// 2^n of the integer lanes of n, the result must be a normal number
+		static S pow2( S n)
+		{
+			const S magic = constant( static_cast< T>( typename format::bits_type( 1) << format::mantissa_bits) + format::exponent_bias);
+			return bits_op::shift_left( simd_op::add( n, magic));
+		}
+
+		// exp( x) - 1 = 2^n (e + 1) - 1, with x in [exp_lo, exp_hi]
+		static S expm1_reduced( S x, S & n)
+		{
+			n = round( simd_op::mul( x, constant( constants::log2e())));
+			S r = simd_op::fmadd( n, constant( - constants::ln2_hi()), x);
+			r = simd_op::fmadd( n, constant( - constants::ln2_lo()), r);
+			S p = horner( r, constants::exp_poly(), constants::exp_degree);
+			return simd_op::fmadd( simd_op::mul( r, r), p, r);
+		}
+
+	public:
+		static S exp( S x)
+		{
+			const S lo = constant( constants::exp_lo());
+			const S hi = constant( constants::exp_hi());
+
+			S n;
+			S e = expm1_reduced( simd_op::min( simd_op::max( x, lo), hi), n);
+			// 2^n in two factors, so that neither overflows at the ends of the range
+			S h = round( simd_op::mul( n, constant( static_cast< T>( 0.5))));
+			S y = simd_op::mul( simd_op::mul( simd_op::add( e, constant( 1)), pow2( h)), pow2( simd_op::sub( n, h)));
+
+			y = bits_op::select_lt( hi, x, constant( std::numeric_limits< T>::infinity()), y);
+			y = bits_op::select_lt( x, lo, simd_op::zero(), y);
+			return bits_op::select_eq( x, x, y, x);
+		}
+
+		static S log( S x)
+		{
+			const T min_normal = std::numeric_limits< T>::min();
+			const S scale = constant( static_cast< T>( typename format::bits_type( 1) << format::mantissa_bits));
+			const S one = constant( 1);
+
+			// Subnormals are scaled to normal numbers
+			S subnormal = bits_op::select_lt( x, constant( min_normal), one, simd_op::zero());
+			S a = bits_op::select_lt( x, constant( min_normal), simd_op::mul( x, scale), x);
+
+			// a = m 2^e with m in [1/2, 1), the biased exponent is added to the mantissa of 2^mantissa_bits
+			S e = bits_op::bit_or( bits_op::shift_right( a), scale);
+			e = simd_op::sub( e, simd_op::add( scale, constant( format::exponent_bias - 1)));
+			e = simd_op::sub( e, simd_op::mul( subnormal, constant( format::mantissa_bits)));
+			const S mantissa = constant( detail::from_bits< T>( ( typename format::bits_type( 1) << format::mantissa_bits) - 1));
+			S m = bits_op::bit_or( bits_op::bit_and( a, mantissa), constant( static_cast< T>( 0.5)));
+
+			// m in [sqrt( 1/2), sqrt( 2))
+			S small = bits_op::select_lt( m, constant( static_cast< T>( 0.707106781186547524)), one, simd_op::zero());
+			m = simd_op::add( m, simd_op::mul( small, m));
+			e = simd_op::sub( e, small);
+
+			S s = simd_op::div( simd_op::sub( m, one), simd_op::add( m, one));
+			S s2 = simd_op::add( s, s);
+			S z = simd_op::mul( s, s);
+			S q = horner( z, constants::log_poly(), constants::log_degree);
+			S t = simd_op::fmadd( e, constant( constants::ln2_lo()), simd_op::mul( simd_op::mul( s2, z), q));
+			S y = simd_op::fmadd( e, constant( constants::ln2_hi()), simd_op::add( s2, t));
+
+			y = bits_op::select_lt( x, constant( std::numeric_limits< T>::infinity()), y, x);
+			y = bits_op::select_lt( simd_op::zero(), x, y, constant( std::numeric_limits< T>::quiet_NaN()));
+			y = bits_op::select_eq( x, simd_op::zero(), constant( - std::numeric_limits< T>::infinity()), y);
+			return bits_op::select_eq( x, x, y, x);
+		}
+
+		static S tanh( S x)
+		{
+			S a = simd_op::min( simd_op::abs( x), constant( constants::tanh_hi()));
+			S n;
+			S e = expm1_reduced( simd_op::add( a, a), n);
+			S p = pow2( n);
+			// exp( 2 |x|) - 1 = 2^n e + (2^n - 1), both terms are exact
+			e = simd_op::fmadd( p, e, simd_op::sub( p, constant( 1)));
+			S t = simd_op::div( e, simd_op::add( e, constant( 2)));
+
+			t = bits_op::select_lt( x, simd_op::zero(), simd_op::sub( simd_op::zero(), t), t);
+			return bits_op::select_eq( x, x, t, x);
+		}
+
+		static S sigmoid( S x)
+		{
+			const S one = constant( 1);
+			return simd_op::div( one, simd_op::add( one, exp( simd_op::sub( simd_op::zero(), x))));
+		}
+	};
+
+	// Lazy element-wise functions of simd_vectors and expressions (du1simd_expr.hpp)
+
+	struct exp_operation {
+		template< typename T, typename S>
+		static S apply( S a)
+		{
+			return math< T, S>::exp( a);
+		}
+	};
+
+	struct log_operation {
+		template< typename T, typename S>
+		static S apply( S a)
+		{
+			return math< T, S>::log( a);
+		}
+	};
+
+	struct tanh_operation {
+		template< typename T, typename S>
+		static S apply( S a)
+		{
+			return math< T, S>::tanh( a);
+		}
+	};
+
+	struct sigmoid_operation {
+		template< typename T, typename S>
+		static S apply( S a)
+		{
+			return math< T, S>::sigmoid( a);
+		}
+	};
+
+	template< typename U>
+	typename detail::unary_result< exp_operation, U>::type exp( U && u)
+	{
+		return detail::unary_result< exp_operation, U>::make( u);
+	}
+
+	template< typename U>
+	typename detail::unary_result< log_operation, U>::type log( U && u)
+	{
+		return detail::unary_result< log_operation, U>::make( u);
+	}
+
+	template< typename U>
+	typename detail::unary_result< tanh_operation, U>::type tanh( U && u)
+	{
+		return detail::unary_result< tanh_operation, U>::make( u);
+	}
+
+	template< typename U>
+	typename detail::unary_result< sigmoid_operation, U>::type sigmoid( U && u)
+	{
+		return detail::unary_result< sigmoid_operation, U>::make( u);
+	}
+};
+
+#endif // DU1SIMD_MATH_HPP
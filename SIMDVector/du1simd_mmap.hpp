@@ -0,0 +1,309 @@
+// du1simd_mmap.hpp
+// Petr Kub�t NPRG051 2013/2014
+
+//
+// simd_vector backed by a memory-mapped file
+//
+// mapped_simd_vector< T, S> maps a file into memory and exposes its payload through the same iterators
+// as simd_vector, so begin()/end(), lower_block()/upper_block() and all the kernels work directly on
+// the mapping without copying the data into the process heap.
+//
+// File layout:
+//
+//	[header][padding][payload: size elements of T][padding to a multiple of k elements]
+//
+// The header records the element and block sizes, the element count and the payload offset. The
+// payload offset is a multiple of sizeof(S) (the mapping itself is page aligned), so the payload has
+// the same sizeof(S) alignment as a simd_vector, and the file is padded to whole blocks, so the last
+// block may be read as a whole.
+//
+// A read-only mapping must not be written through the iterators (the pages are mapped read-only), map it
+// into a const mapped_simd_vector (or use cbegin()/cend()) and the compiler rejects such writes.
+//
+
+#ifndef DU1SIMD_MMAP_HPP
+#define DU1SIMD_MMAP_HPP
+
+#include "du1simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <exception>
+#include <type_traits>
+
+// Exception to be thrown if a file cannot be mapped or has an incompatible header
+class mapping_exception : public std::exception
+{
+public:
+	explicit mapping_exception( const char * message) : message_( message) { }
+
+	const char * what() const throw()
+	{
+		return message_;
+	}
+private:
+	const char * message_;
+};
+
+namespace du1simd {
+
+	enum class map_mode {
+		read_only,
+		read_write
+	};
+
+	// Expected access pattern of a mapped range (madvise / PrefetchVirtualMemory)
+	enum class access_advice {
+		normal,
+		sequential,
+		random,
+		will_need,
+		dont_need
+	};
+
+	// Mapping of a whole file, implemented in du1simd.cpp
+	class file_mapping {
+	public:
+		file_mapping();
+
+		// Maps an existing file
+		file_mapping( const std::string & path, map_mode mode);
+
+		// Creates (or truncates) the file to size bytes and maps it for reading and writing
+		file_mapping( const std::string & path, std::size_t size);
+
+		file_mapping( file_mapping && m);
+		file_mapping & operator=( file_mapping && m);
+
+		~file_mapping();
+
+		void * data() const
+		{
+			return data_;
+		}
+		std::size_t size() const
+		{
+			return size_;
+		}
+		map_mode mode() const
+		{
+			return mode_;
+		}
+
+		// Hint for the byte range [offset, offset + length) of the mapping
+		void advise( access_advice advice, std::size_t offset, std::size_t length) const;
+
+		// Writes the modified pages back to the file
+		void flush() const;
+
+	private:
+		void open( const std::string & path, map_mode mode, std::size_t create_size);
+		void close();
+
+		void * data_;
+		std::size_t size_;
+		map_mode mode_;
+#if defined(_WIN32)
+		void * file_;
+		void * section_;
+#else
+		int fd_;
+#endif
+
+		file_mapping( const file_mapping &);
+		file_mapping & operator=( const file_mapping &);
+	};
+
+	// Header at the beginning of a mapped vector file
+	struct mapped_header {
+		char magic[ 8];
+		std::uint32_t version;
+		std::uint32_t element_size;
+		std::uint32_t block_size;
+		std::uint32_t reserved;
+		std::uint64_t size;
+		std::uint64_t payload_offset;
+	};
+
+	const char mapped_magic[ 8] = { 'D', 'U', '1', 'S', 'I', 'M', 'D', 0 };
+	const std::uint32_t mapped_version = 1;
+};
+
+template< typename T, typename S>
+class mapped_simd_vector {
+	// Static check of type parameters
+	static_assert(sizeof(S) % sizeof(T) == 0, "Incompatible type parameters!");
+	static_assert(std::is_trivially_copyable<T>::value, "Mapped elements must be trivially copyable!");
+
+public:
+	typedef mapped_simd_vector<T, S> self;
+
+	// Elements per block (k), the payload is padded to a multiple of it
+	static DU1SIMD_CONSTEXPR const std::size_t lanes = du1simd::lanes_of<T, S>::value;
+
+	typedef simd_vector_iterator< T, S> iterator;
+
+	typedef simd_vector_iterator< const T, S> const_iterator;
+
+	typedef simd_vector_simd_iterator<T, S> simd_iterator;
+
+	typedef simd_vector_simd_iterator<const T, S> const_simd_iterator;
+
+private:
+	// Mapping of the whole file
+	du1simd::file_mapping mapping;
+	// Pointer to the payload inside of the mapping
+	T* aligned_begin;
+	// Size of the container
+	std::size_t content_size;
+
+	static std::size_t payload_offset()
+	{
+		std::size_t h = sizeof(du1simd::mapped_header);
+		return ((h + sizeof(S) - 1) / sizeof(S)) * sizeof(S);
+	}
+
+	// Bytes of the payload of s elements padded to whole blocks
+	static std::size_t payload_size(std::size_t s)
+	{
+		return du1simd::round_up<lanes>(s) * sizeof(T);
+	}
+
+	du1simd::mapped_header& header() const
+	{
+		return *static_cast<du1simd::mapped_header*>(mapping.data());
+	}
+
+public:
+	// Maps an existing vector file
+	explicit mapped_simd_vector(const std::string& path, du1simd::map_mode mode = du1simd::map_mode::read_only) : mapping(path, mode)
+	{
+		if (mapping.size() < sizeof(du1simd::mapped_header))
+		{
+			throw mapping_exception("File too small for a vector header");
+		}
+		const du1simd::mapped_header& h = header();
+		if (std::memcmp(h.magic, du1simd::mapped_magic, sizeof(h.magic)) != 0 || h.version != du1simd::mapped_version)
+		{
+			throw mapping_exception("Not a vector file");
+		}
+		if (h.element_size != sizeof(T) || h.block_size != sizeof(S) || h.payload_offset % sizeof(S) != 0)
+		{
+			throw mapping_exception("Incompatible element or block type");
+		}
+		// The payload must not overlap the header and its whole blocks must lie inside of the mapping,
+		// the sizes are compared without forming any sum or product of the untrusted fields
+		if (h.payload_offset < payload_offset() || h.payload_offset > mapping.size())
+		{
+			throw mapping_exception("Invalid payload offset");
+		}
+		const std::uint64_t blocks = (mapping.size() - static_cast<std::size_t>(h.payload_offset)) / sizeof(S);
+		if (h.size / lanes + (h.size % lanes != 0 ? 1 : 0) > blocks)
+		{
+			throw mapping_exception("Truncated vector file");
+		}
+		content_size = static_cast<std::size_t>(h.size);
+		aligned_begin = reinterpret_cast<T*>(static_cast<char*>(mapping.data()) + h.payload_offset);
+	}
+
+	// Creates a vector file of s zero elements and maps it for reading and writing
+	mapped_simd_vector(const std::string& path, std::size_t s) : mapping(path, payload_offset() + payload_size(s)), content_size(s)
+	{
+		du1simd::mapped_header& h = header();
+		std::memcpy(h.magic, du1simd::mapped_magic, sizeof(h.magic));
+		h.version = du1simd::mapped_version;
+		h.element_size = sizeof(T);
+		h.block_size = sizeof(S);
+		h.reserved = 0;
+		h.size = s;
+		h.payload_offset = payload_offset();
+		aligned_begin = reinterpret_cast<T*>(static_cast<char*>(mapping.data()) + payload_offset());
+	}
+
+	// Move constructor
+	mapped_simd_vector(self&& v) : mapping(std::move(v.mapping)), aligned_begin(v.aligned_begin), content_size(v.content_size)
+	{
+		v.aligned_begin = nullptr;
+		v.content_size = 0;
+	}
+
+	// Move assignment operator
+	self& operator=(self&& v)
+	{
+		mapping = std::move(v.mapping);
+		std::swap(aligned_begin, v.aligned_begin);
+		std::swap(content_size, v.content_size);
+		return (*this);
+	}
+
+	iterator begin()
+	{
+		return iterator(aligned_begin);
+	}
+
+	iterator end()
+	{
+		return iterator(aligned_begin + content_size);
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(aligned_begin);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(aligned_begin + content_size);
+	}
+
+	const_iterator cbegin() const
+	{
+		return begin();
+	}
+
+	const_iterator cend() const
+	{
+		return end();
+	}
+
+	std::size_t size() const
+	{
+		return content_size;
+	}
+
+	du1simd::map_mode mode() const
+	{
+		return mapping.mode();
+	}
+
+	// Access pattern hint for the whole payload (e.g. sequential before a full scan)
+	void advise(du1simd::access_advice advice) const
+	{
+		advise(advice, begin(), end());
+	}
+
+	// Access pattern hint for the elements in [b, e)
+	void advise(du1simd::access_advice advice, const_iterator b, const_iterator e) const
+	{
+		if (!(b < e))
+		{
+			return;
+		}
+		std::size_t offset = reinterpret_cast<const char*>(du1simd::to_address(b)) - static_cast<const char*>(mapping.data());
+		mapping.advise(advice, offset, (e - b) * sizeof(T));
+	}
+
+	// Writes the modified elements back to the file
+	void flush()
+	{
+		mapping.flush();
+	}
+};
+
+template< typename T, typename S>
+DU1SIMD_CONSTEXPR const std::size_t mapped_simd_vector<T, S>::lanes;
+
+
+#endif // DU1SIMD_MMAP_HPP
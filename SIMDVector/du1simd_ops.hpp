@@ -0,0 +1,1446 @@
+// du1simd_ops.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Operation traits for the simd carriers
+//
+// du1simd::simd< value_type, simd_carrier_type> provides the element-wise operations used by the
+// kernels: broadcast, zero, add, sub, mul, div, min, max, abs, sqrt, rsqrt (1 / sqrt), fmadd (a * b + c),
+// horizontal sum and maximum (max_lane), lane-wise comparisons giving a bit mask of the lanes (cmp_lt,
+// cmp_le, cmp_eq, see du1simd_filter.hpp), masking of the ragged ends of a range, partial loads
+// (load_partial reads only the given lanes of a block, see du1simd_split.hpp) and aligned stores, either
+// regular (store) or non-temporal (stream, bypassing the caches, to be completed by fence before the data
+// is read by another thread).
+//
+// sqrt is correctly rounded. rsqrt of the float vectors refines the hardware estimate by Newton steps, it
+// is within 4 ulp for positive normal a and NaN for 0, subnormals and infinity; on the scalar and double
+// carriers it is the division 1 / sqrt( a). The transcendental functions are in du1simd_math.hpp.
+//
+// fmadd is fused (a single rounding) where the translation unit enables FMA, see DU1SIMD_HAVE_FMA.
+//
+// The carriers of float are float, __m128, __m256 and __m512, the carriers of double are double, __m128d,
+// __m256d and __m512d; the integer carriers are in du1simd_ops_int.hpp. On ARM the carriers of float are
+// float32x4_t (NEON) and sve_float32_t (SVE), the scalar carriers are the only ones of double.
+//
+// The SSE carriers are always available on x86 (DU1SIMD_HAVE_SSE). The AVX (__m256) and AVX-512 (__m512)
+// carriers are compiled in when the compiler accepts the intrinsics (MSVC always, GCC/Clang with -mavx /
+// -mavx512f), see DU1SIMD_HAVE_AVX and DU1SIMD_HAVE_AVX512. Whether the running CPU supports the
+// compiled-in carriers is decided at runtime by du1simd::best_isa() (du1simd_dispatch.hpp), with GCC
+// and Clang the wider carriers of a baseline build are compiled by the units of their levels
+// (du1simd_avx2.cpp, du1simd_avx512.cpp) and run through du1simd::dispatch.
+//
+// The NEON carrier is always available on AArch64 (DU1SIMD_HAVE_NEON). The lanes of an SVE vector are
+// known only at runtime and the sizeless svfloat32_t cannot be the carrier of simd_vector, whose blocks
+// are sizeof(S) bytes. sve_float32_t is the SVE vector of the length fixed by -msve-vector-bits=N, it is
+// compiled in with that option (DU1SIMD_HAVE_SVE) and the binary runs only on CPUs of that length.
+//
+// The AVX carriers must not execute any instruction before the runtime check has been done,
+// therefore their mask tables are plain integer arrays instead of statically constructed vectors.
+//
+
+#ifndef DU1SIMD_OPS_HPP
+#define DU1SIMD_OPS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <cmath>
+
+// The x86 carriers (SSE and wider) are compiled for x86 targets only
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define DU1SIMD_HAVE_SSE 1
+#else
+#define DU1SIMD_HAVE_SSE 0
+#endif
+
+// NEON of AArch64, the across-lanes reductions (vaddvq, vmaxvq) do not exist on 32-bit ARM
+#if defined(_M_ARM64) || (defined(__ARM_NEON) && defined(__aarch64__))
+#define DU1SIMD_HAVE_NEON 1
+#else
+#define DU1SIMD_HAVE_NEON 0
+#endif
+
+// SVE with the vector length fixed at compile time (-msve-vector-bits=N), a carrier must have a size
+#if defined(__ARM_FEATURE_SVE) && defined(__ARM_FEATURE_SVE_BITS) && __ARM_FEATURE_SVE_BITS > 0
+#define DU1SIMD_HAVE_SVE 1
+#else
+#define DU1SIMD_HAVE_SVE 0
+#endif
+
+#if DU1SIMD_HAVE_SSE
+#include <xmmintrin.h>
+#include <pmmintrin.h>
+#endif
+
+#if DU1SIMD_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+#if DU1SIMD_HAVE_SVE
+#include <arm_sve.h>
+#include <atomic>
+#endif
+
+#if DU1SIMD_HAVE_SSE && (defined(_MSC_VER) || defined(__AVX__))
+#define DU1SIMD_HAVE_AVX 1
+#else
+#define DU1SIMD_HAVE_AVX 0
+#endif
+
+#if DU1SIMD_HAVE_SSE && ((defined(_MSC_VER) && _MSC_VER >= 1910) || defined(__AVX512F__))
+#define DU1SIMD_HAVE_AVX512 1
+#else
+#define DU1SIMD_HAVE_AVX512 0
+#endif
+
+#if DU1SIMD_HAVE_SSE && (defined(_MSC_VER) || defined(__AVX2__))
+#define DU1SIMD_HAVE_AVX2 1
+#else
+#define DU1SIMD_HAVE_AVX2 0
+#endif
+
+#if DU1SIMD_HAVE_SSE && ((defined(_MSC_VER) && _MSC_VER >= 1910) || defined(__AVX512BW__))
+#define DU1SIMD_HAVE_AVX512BW 1
+#else
+#define DU1SIMD_HAVE_AVX512BW 0
+#endif
+
+// FMA is a separate extension, MSVC has no flag for it and enables it together with AVX2
+#if DU1SIMD_HAVE_SSE && (defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__)))
+#define DU1SIMD_HAVE_FMA 1
+#else
+#define DU1SIMD_HAVE_FMA 0
+#endif
+
+// Also serves the integer carriers of du1simd_ops_int.hpp, only the first include of the header counts:
+// GCC 12 reports the _mm512_undefined_* pass-through registers of the unmasked AVX-512 intrinsics as
+// uninitialized wherever they are inlined, the diagnostics are located in the header itself
+#if DU1SIMD_HAVE_AVX || DU1SIMD_HAVE_AVX512 || DU1SIMD_HAVE_AVX2 || DU1SIMD_HAVE_AVX512BW
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+namespace du1simd {
+
+	template< typename value_type, typename simd_carrier_type>
+	struct simd;
+
+	// Bit mask of the lanes of a block, bit j stands for lane j (cmp_lt, cmp_le, cmp_eq)
+	typedef std::uint32_t lane_mask;
+
+	namespace detail {
+
+		// 64 zero bytes, 64 0xFF bytes and 64 zero bytes (du1simd.cpp)
+		// The lane masks of the double and integer carriers are windows of width bytes of this table
+		extern const unsigned char byte_mask_table_[ 192];
+
+		// Mask clearing the first gap bytes of a carrier of width bytes
+		inline const unsigned char * lower_byte_mask( std::size_t width, std::size_t gap)
+		{
+			(void)width;
+			return byte_mask_table_ + 64 - gap;
+		}
+
+		// Mask clearing the last gap bytes of a carrier of width bytes
+		inline const unsigned char * upper_byte_mask( std::size_t width, std::size_t gap)
+		{
+			return byte_mask_table_ + 128 - width + gap;
+		}
+
+		// Copies the lanes [lo, hi) of the block at p over the block a, no other memory is read
+		template< typename T, typename S>
+		S load_lanes( const S * p, std::ptrdiff_t lo, std::ptrdiff_t hi, S a)
+		{
+			std::memcpy( reinterpret_cast< char *>( & a) + lo * sizeof(T), reinterpret_cast< const char *>( p) + lo * sizeof(T), ( hi - lo) * sizeof(T));
+			return a;
+		}
+	}
+
+	template<>
+	struct simd< float, float> {
+		static float broadcast( float x)
+		{
+			return x;
+		}
+		static float zero()
+		{
+			return 0.0F;
+		}
+		static float add( float a, float b)
+		{
+			return a + b;
+		}
+		static float sub( float a, float b)
+		{
+			return a - b;
+		}
+		static float mul( float a, float b)
+		{
+			return a * b;
+		}
+		static float div( float a, float b)
+		{
+			return a / b;
+		}
+		static float min( float a, float b)
+		{
+			return a < b ? a : b;
+		}
+		static float max( float a, float b)
+		{
+			return a < b ? b : a;
+		}
+		static float abs( float a)
+		{
+			return a < 0 ? - a : a;
+		}
+		static float sqrt( float a)
+		{
+			return std::sqrt( a);
+		}
+		static float rsqrt( float a)
+		{
+			return 1.0F / std::sqrt( a);
+		}
+		// a * b + c
+		static float fmadd( float a, float b, float c)
+		{
+			return a * b + c;
+		}
+		static float sum( float a)
+		{
+			return a;
+		}
+		static float max_lane( float a)
+		{
+			return a;
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( float a, float b)
+		{
+			return ( a < b) ? 1u : 0u;
+		}
+		static lane_mask cmp_le( float a, float b)
+		{
+			return ( a <= b) ? 1u : 0u;
+		}
+		static lane_mask cmp_eq( float a, float b)
+		{
+			return ( a == b) ? 1u : 0u;
+		}
+		static void store( float * p, float a)
+		{
+			* p = a;
+		}
+		// No non-temporal store of a single float, stream is a regular store
+		static void stream( float * p, float a)
+		{
+			* p = a;
+		}
+		static void fence()
+		{
+		}
+
+		static float load_partial( const float * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo == 0);
+			assert( hi == 1);
+			return * p;
+		}
+
+		static float mask_lower( float a, std::ptrdiff_t lgap)
+		{
+			assert( lgap == 0);
+			return a;
+		}
+		static float mask_upper( float a, std::ptrdiff_t ugap)
+		{
+			assert( ugap == 0);
+			return a;
+		}
+		static float mask_both( float a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			assert( lgap == 0);
+			assert( ugap == 0);
+			return a;
+		}
+	};
+
+#if DU1SIMD_HAVE_SSE
+	template<>
+	struct simd< float, __m128> {
+		static __m128 broadcast( float x)
+		{
+			__m128 a = _mm_load_ss( & x);
+			return _mm_shuffle_ps( a, a, 0x00);
+		}
+		static __m128 zero()
+		{
+			return _mm_setzero_ps();
+		}
+		static __m128 add( __m128 a, __m128 b)
+		{
+			return _mm_add_ps( a, b);
+		}
+		static __m128 sub( __m128 a, __m128 b)
+		{
+			return _mm_sub_ps( a, b);
+		}
+		static __m128 mul( __m128 a, __m128 b)
+		{
+			return _mm_mul_ps( a, b);
+		}
+		static __m128 div( __m128 a, __m128 b)
+		{
+			return _mm_div_ps( a, b);
+		}
+		static __m128 min( __m128 a, __m128 b)
+		{
+			return _mm_min_ps( a, b);
+		}
+		static __m128 max( __m128 a, __m128 b)
+		{
+			return _mm_max_ps( a, b);
+		}
+		static __m128 abs( __m128 a)
+		{
+			return _mm_andnot_ps( _mm_set1_ps( -0.0F), a);
+		}
+		static __m128 sqrt( __m128 a)
+		{
+			return _mm_sqrt_ps( a);
+		}
+		// 1 / sqrt( a), the 12-bit estimate refined by a Newton step
+		static __m128 rsqrt( __m128 a)
+		{
+			__m128 y = _mm_rsqrt_ps( a);
+			__m128 h = _mm_mul_ps( _mm_mul_ps( _mm_set1_ps( 0.5F), a), _mm_mul_ps( y, y));
+			return _mm_mul_ps( y, _mm_sub_ps( _mm_set1_ps( 1.5F), h));
+		}
+		// a * b + c, fused if the translation unit enables FMA
+		static __m128 fmadd( __m128 a, __m128 b, __m128 c)
+		{
+#if DU1SIMD_HAVE_FMA
+			return _mm_fmadd_ps( a, b, c);
+#else
+			return _mm_add_ps( _mm_mul_ps( a, b), c);
+#endif
+		}
+		static float sum( __m128 a)
+		{
+			float x;
+			__m128 b = _mm_hadd_ps( a, a);
+			__m128 c = _mm_hadd_ps( b, b);
+			_mm_store_ss( & x, c);
+			return x;
+		}
+		static float max_lane( __m128 a)
+		{
+			__m128 b = _mm_max_ps( a, _mm_shuffle_ps( a, a, 0x4E));
+			__m128 c = _mm_max_ps( b, _mm_shuffle_ps( b, b, 0xB1));
+			return _mm_cvtss_f32( c);
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( __m128 a, __m128 b)
+		{
+			return static_cast< lane_mask>( _mm_movemask_ps( _mm_cmplt_ps( a, b)));
+		}
+		static lane_mask cmp_le( __m128 a, __m128 b)
+		{
+			return static_cast< lane_mask>( _mm_movemask_ps( _mm_cmple_ps( a, b)));
+		}
+		static lane_mask cmp_eq( __m128 a, __m128 b)
+		{
+			return static_cast< lane_mask>( _mm_movemask_ps( _mm_cmpeq_ps( a, b)));
+		}
+
+		static void store( __m128 * p, __m128 a)
+		{
+			_mm_store_ps( reinterpret_cast< float *>( p), a);
+		}
+		static void stream( __m128 * p, __m128 a)
+		{
+			_mm_stream_ps( reinterpret_cast< float *>( p), a);
+		}
+		static void fence()
+		{
+			_mm_sfence();
+		}
+
+		static __m128 load_partial( const __m128 * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= 4);
+#if defined(__AVX__)
+			__m128 m = _mm_and_ps( mask_data_.lmask_[ lo], mask_data_.umask_[ hi - 1]);
+			return _mm_maskload_ps( reinterpret_cast< const float *>( p), _mm_castps_si128( m));
+#else
+			return detail::load_lanes< float>( p, lo, hi, zero());
+#endif
+		}
+
+		static __m128 mask_lower( __m128 a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < 4);
+			return _mm_and_ps( a, mask_data_.lmask_[ lgap]);
+		}
+		static __m128 mask_upper( __m128 a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > -4);
+			assert( ugap <= 0);
+			return _mm_and_ps( a, mask_data_.umask_[ ugap + 3]);
+		}
+		static __m128 mask_both( __m128 a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return mask_upper( mask_lower( a, lgap), ugap);
+		}
+	private:
+		struct mask_data {
+			__m128 lmask_[ 4];
+			__m128 umask_[ 4];
+			mask_data()
+			{
+				lmask_[ 0] = _mm_castsi128_ps( _mm_set_epi32( -1, -1, -1, -1));
+				lmask_[ 1] = _mm_castsi128_ps( _mm_set_epi32( -1, -1, -1,  0));
+				lmask_[ 2] = _mm_castsi128_ps( _mm_set_epi32( -1, -1,  0,  0));
+				lmask_[ 3] = _mm_castsi128_ps( _mm_set_epi32( -1,  0,  0,  0));
+				umask_[ 0] = _mm_castsi128_ps( _mm_set_epi32(  0,  0,  0, -1));
+				umask_[ 1] = _mm_castsi128_ps( _mm_set_epi32(  0,  0, -1, -1));
+				umask_[ 2] = _mm_castsi128_ps( _mm_set_epi32(  0, -1, -1, -1));
+				umask_[ 3] = _mm_castsi128_ps( _mm_set_epi32( -1, -1, -1, -1));
+			}
+		};
+		static const mask_data mask_data_;
+	};
+
+#if DU1SIMD_HAVE_AVX
+	template<>
+	struct simd< float, __m256> {
+		static __m256 broadcast( float x)
+		{
+			return _mm256_set1_ps( x);
+		}
+		static __m256 zero()
+		{
+			return _mm256_setzero_ps();
+		}
+		static __m256 add( __m256 a, __m256 b)
+		{
+			return _mm256_add_ps( a, b);
+		}
+		static __m256 sub( __m256 a, __m256 b)
+		{
+			return _mm256_sub_ps( a, b);
+		}
+		static __m256 mul( __m256 a, __m256 b)
+		{
+			return _mm256_mul_ps( a, b);
+		}
+		static __m256 div( __m256 a, __m256 b)
+		{
+			return _mm256_div_ps( a, b);
+		}
+		static __m256 min( __m256 a, __m256 b)
+		{
+			return _mm256_min_ps( a, b);
+		}
+		static __m256 max( __m256 a, __m256 b)
+		{
+			return _mm256_max_ps( a, b);
+		}
+		static __m256 abs( __m256 a)
+		{
+			return _mm256_andnot_ps( _mm256_set1_ps( -0.0F), a);
+		}
+		static __m256 sqrt( __m256 a)
+		{
+			return _mm256_sqrt_ps( a);
+		}
+		// 1 / sqrt( a), the 12-bit estimate refined by a Newton step
+		static __m256 rsqrt( __m256 a)
+		{
+			__m256 y = _mm256_rsqrt_ps( a);
+			__m256 h = _mm256_mul_ps( _mm256_mul_ps( _mm256_set1_ps( 0.5F), a), _mm256_mul_ps( y, y));
+			return _mm256_mul_ps( y, _mm256_sub_ps( _mm256_set1_ps( 1.5F), h));
+		}
+		// a * b + c, fused if the translation unit enables FMA
+		static __m256 fmadd( __m256 a, __m256 b, __m256 c)
+		{
+#if DU1SIMD_HAVE_FMA
+			return _mm256_fmadd_ps( a, b, c);
+#else
+			return _mm256_add_ps( _mm256_mul_ps( a, b), c);
+#endif
+		}
+		static float sum( __m256 a)
+		{
+			__m128 b = _mm_add_ps( _mm256_castps256_ps128( a), _mm256_extractf128_ps( a, 1));
+			return simd< float, __m128>::sum( b);
+		}
+		static float max_lane( __m256 a)
+		{
+			return simd< float, __m128>::max_lane( _mm_max_ps( _mm256_castps256_ps128( a), _mm256_extractf128_ps( a, 1)));
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( __m256 a, __m256 b)
+		{
+			return static_cast< lane_mask>( _mm256_movemask_ps( _mm256_cmp_ps( a, b, _CMP_LT_OQ)));
+		}
+		static lane_mask cmp_le( __m256 a, __m256 b)
+		{
+			return static_cast< lane_mask>( _mm256_movemask_ps( _mm256_cmp_ps( a, b, _CMP_LE_OQ)));
+		}
+		static lane_mask cmp_eq( __m256 a, __m256 b)
+		{
+			return static_cast< lane_mask>( _mm256_movemask_ps( _mm256_cmp_ps( a, b, _CMP_EQ_OQ)));
+		}
+
+		static void store( __m256 * p, __m256 a)
+		{
+			_mm256_store_ps( reinterpret_cast< float *>( p), a);
+		}
+		static void stream( __m256 * p, __m256 a)
+		{
+			_mm256_stream_ps( reinterpret_cast< float *>( p), a);
+		}
+		static void fence()
+		{
+			_mm_sfence();
+		}
+
+		static __m256 load_partial( const __m256 * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= 8);
+			__m256 m = _mm256_and_ps( _mm256_loadu_ps( reinterpret_cast< const float *>( lmask_table_ + 8 - lo)),
+				_mm256_loadu_ps( reinterpret_cast< const float *>( umask_table_ + 8 - hi)));
+			return _mm256_maskload_ps( reinterpret_cast< const float *>( p), _mm256_castps_si256( m));
+		}
+
+		// The masks are read from a window sliding over a table of 8 zeros followed by 8 ones (lower)
+		// or 8 ones followed by 8 zeros (upper)
+		static __m256 mask_lower( __m256 a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < 8);
+			return _mm256_and_ps( a, _mm256_loadu_ps( reinterpret_cast< const float *>( lmask_table_ + 8 - lgap)));
+		}
+		static __m256 mask_upper( __m256 a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > -8);
+			assert( ugap <= 0);
+			return _mm256_and_ps( a, _mm256_loadu_ps( reinterpret_cast< const float *>( umask_table_ - ugap)));
+		}
+		static __m256 mask_both( __m256 a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return mask_upper( mask_lower( a, lgap), ugap);
+		}
+	private:
+		static const std::int32_t lmask_table_[ 16];
+		static const std::int32_t umask_table_[ 16];
+	};
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+	template<>
+	struct simd< float, __m512> {
+		static __m512 broadcast( float x)
+		{
+			return _mm512_set1_ps( x);
+		}
+		static __m512 zero()
+		{
+			return _mm512_setzero_ps();
+		}
+		static __m512 add( __m512 a, __m512 b)
+		{
+			return _mm512_add_ps( a, b);
+		}
+		static __m512 sub( __m512 a, __m512 b)
+		{
+			return _mm512_sub_ps( a, b);
+		}
+		static __m512 mul( __m512 a, __m512 b)
+		{
+			return _mm512_mul_ps( a, b);
+		}
+		static __m512 div( __m512 a, __m512 b)
+		{
+			return _mm512_div_ps( a, b);
+		}
+		static __m512 min( __m512 a, __m512 b)
+		{
+			return _mm512_min_ps( a, b);
+		}
+		static __m512 max( __m512 a, __m512 b)
+		{
+			return _mm512_max_ps( a, b);
+		}
+		static __m512 abs( __m512 a)
+		{
+			return _mm512_abs_ps( a);
+		}
+		static __m512 sqrt( __m512 a)
+		{
+			return _mm512_sqrt_ps( a);
+		}
+		// 1 / sqrt( a), the 14-bit estimate refined by a Newton step
+		static __m512 rsqrt( __m512 a)
+		{
+			__m512 y = _mm512_rsqrt14_ps( a);
+			__m512 h = _mm512_mul_ps( _mm512_mul_ps( _mm512_set1_ps( 0.5F), a), _mm512_mul_ps( y, y));
+			return _mm512_mul_ps( y, _mm512_sub_ps( _mm512_set1_ps( 1.5F), h));
+		}
+		// a * b + c, always fused (FMA is a part of AVX-512F)
+		static __m512 fmadd( __m512 a, __m512 b, __m512 c)
+		{
+			return _mm512_fmadd_ps( a, b, c);
+		}
+		static float sum( __m512 a)
+		{
+			__m256 b = _mm256_add_ps( _mm512_castps512_ps256( a),
+				_mm256_castpd_ps( _mm512_extractf64x4_pd( _mm512_castps_pd( a), 1)));
+			return simd< float, __m256>::sum( b);
+		}
+		static float max_lane( __m512 a)
+		{
+			return _mm512_reduce_max_ps( a);
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( __m512 a, __m512 b)
+		{
+			return static_cast< lane_mask>( _mm512_cmp_ps_mask( a, b, _CMP_LT_OQ));
+		}
+		static lane_mask cmp_le( __m512 a, __m512 b)
+		{
+			return static_cast< lane_mask>( _mm512_cmp_ps_mask( a, b, _CMP_LE_OQ));
+		}
+		static lane_mask cmp_eq( __m512 a, __m512 b)
+		{
+			return static_cast< lane_mask>( _mm512_cmp_ps_mask( a, b, _CMP_EQ_OQ));
+		}
+
+		static void store( __m512 * p, __m512 a)
+		{
+			_mm512_store_ps( reinterpret_cast< float *>( p), a);
+		}
+		static void stream( __m512 * p, __m512 a)
+		{
+			_mm512_stream_ps( reinterpret_cast< float *>( p), a);
+		}
+		static void fence()
+		{
+			_mm_sfence();
+		}
+
+		static __m512 load_partial( const __m512 * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= 16);
+			__mmask16 m = static_cast< __mmask16>( ( 0xFFFFu << lo) & ( 0xFFFFu >> ( 16 - hi)));
+			return _mm512_maskz_loadu_ps( m, p);
+		}
+
+		// Lane masks of the elements kept by mask_lower / mask_upper
+		static __mmask16 lmask( std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < 16);
+			return static_cast< __mmask16>( 0xFFFFu << lgap);
+		}
+		static __mmask16 umask( std::ptrdiff_t ugap)
+		{
+			assert( ugap > -16);
+			assert( ugap <= 0);
+			return static_cast< __mmask16>( 0xFFFFu >> -ugap);
+		}
+
+		static __m512 mask_lower( __m512 a, std::ptrdiff_t lgap)
+		{
+			return _mm512_maskz_mov_ps( lmask( lgap), a);
+		}
+		static __m512 mask_upper( __m512 a, std::ptrdiff_t ugap)
+		{
+			return _mm512_maskz_mov_ps( umask( ugap), a);
+		}
+		static __m512 mask_both( __m512 a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return _mm512_maskz_mov_ps( static_cast< __mmask16>( lmask( lgap) & umask( ugap)), a);
+		}
+	};
+#endif
+#endif // DU1SIMD_HAVE_SSE
+
+#if DU1SIMD_HAVE_NEON
+	// NEON of AArch64, min and max return NaN if a lane of either operand is NaN (SSE returns the second
+	// operand then), fmadd is always fused
+	template<>
+	struct simd< float, float32x4_t> {
+		static float32x4_t broadcast( float x)
+		{
+			return vdupq_n_f32( x);
+		}
+		static float32x4_t zero()
+		{
+			return vdupq_n_f32( 0.0F);
+		}
+		static float32x4_t add( float32x4_t a, float32x4_t b)
+		{
+			return vaddq_f32( a, b);
+		}
+		static float32x4_t sub( float32x4_t a, float32x4_t b)
+		{
+			return vsubq_f32( a, b);
+		}
+		static float32x4_t mul( float32x4_t a, float32x4_t b)
+		{
+			return vmulq_f32( a, b);
+		}
+		static float32x4_t div( float32x4_t a, float32x4_t b)
+		{
+			return vdivq_f32( a, b);
+		}
+		static float32x4_t min( float32x4_t a, float32x4_t b)
+		{
+			return vminq_f32( a, b);
+		}
+		static float32x4_t max( float32x4_t a, float32x4_t b)
+		{
+			return vmaxq_f32( a, b);
+		}
+		static float32x4_t abs( float32x4_t a)
+		{
+			return vabsq_f32( a);
+		}
+		static float32x4_t sqrt( float32x4_t a)
+		{
+			return vsqrtq_f32( a);
+		}
+		// 1 / sqrt( a), the 8-bit estimate refined by two Newton steps
+		static float32x4_t rsqrt( float32x4_t a)
+		{
+			float32x4_t y = vrsqrteq_f32( a);
+			y = vmulq_f32( y, vrsqrtsq_f32( vmulq_f32( a, y), y));
+			return vmulq_f32( y, vrsqrtsq_f32( vmulq_f32( a, y), y));
+		}
+		// a * b + c
+		static float32x4_t fmadd( float32x4_t a, float32x4_t b, float32x4_t c)
+		{
+			return vfmaq_f32( c, a, b);
+		}
+		static float sum( float32x4_t a)
+		{
+			return vaddvq_f32( a);
+		}
+		static float max_lane( float32x4_t a)
+		{
+			return vmaxvq_f32( a);
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( float32x4_t a, float32x4_t b)
+		{
+			return movemask( vcltq_f32( a, b));
+		}
+		static lane_mask cmp_le( float32x4_t a, float32x4_t b)
+		{
+			return movemask( vcleq_f32( a, b));
+		}
+		static lane_mask cmp_eq( float32x4_t a, float32x4_t b)
+		{
+			return movemask( vceqq_f32( a, b));
+		}
+
+		static void store( float32x4_t * p, float32x4_t a)
+		{
+			vst1q_f32( reinterpret_cast< float *>( p), a);
+		}
+		// NEON has no non-temporal store of a vector (STNP takes a pair of registers), stream is a regular store
+		static void stream( float32x4_t * p, float32x4_t a)
+		{
+			vst1q_f32( reinterpret_cast< float *>( p), a);
+		}
+		static void fence()
+		{
+		}
+
+		static float32x4_t load_partial( const float32x4_t * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= 4);
+			return detail::load_lanes< float>( p, lo, hi, zero());
+		}
+
+		static float32x4_t mask_lower( float32x4_t a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < 4);
+			return keep( a, vcgeq_u32( lane_index(), vdupq_n_u32( static_cast< std::uint32_t>( lgap))));
+		}
+		static float32x4_t mask_upper( float32x4_t a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > -4);
+			assert( ugap <= 0);
+			return keep( a, vcltq_u32( lane_index(), vdupq_n_u32( static_cast< std::uint32_t>( 4 + ugap))));
+		}
+		static float32x4_t mask_both( float32x4_t a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return mask_upper( mask_lower( a, lgap), ugap);
+		}
+	private:
+		// The masks are computed from the lane indices, there is no table to be initialized
+		static uint32x4_t lane_index()
+		{
+			static const std::uint32_t index[ 4] = { 0, 1, 2, 3 };
+			return vld1q_u32( index);
+		}
+		static float32x4_t keep( float32x4_t a, uint32x4_t m)
+		{
+			return vreinterpretq_f32_u32( vandq_u32( vreinterpretq_u32_f32( a), m));
+		}
+		// NEON has no movemask, the lanes of a comparison are weighted by their bits and summed
+		static lane_mask movemask( uint32x4_t m)
+		{
+			static const std::uint32_t bits[ 4] = { 1, 2, 4, 8 };
+			return static_cast< lane_mask>( vaddvq_u32( vandq_u32( m, vld1q_u32( bits))));
+		}
+	};
+#endif
+
+#if DU1SIMD_HAVE_SVE
+	// Vector of float of the SVE length fixed at compile time, unlike svfloat32_t it has a size
+	typedef svfloat32_t sve_float32_t __attribute__(( arm_sve_vector_bits( __ARM_FEATURE_SVE_BITS)));
+
+	// The ragged ends and the partial loads are predicated, the inactive lanes of a predicated load are
+	// neither read nor fault, so load_partial touches only the lanes inside of the range
+	template<>
+	struct simd< float, sve_float32_t> {
+		static const std::size_t k = __ARM_FEATURE_SVE_BITS / 32;
+
+		static_assert( k <= 32, "A lane_mask holds at most 32 lanes!");
+
+		static sve_float32_t broadcast( float x)
+		{
+			return svdup_n_f32( x);
+		}
+		static sve_float32_t zero()
+		{
+			return svdup_n_f32( 0.0F);
+		}
+		static sve_float32_t add( sve_float32_t a, sve_float32_t b)
+		{
+			return svadd_f32_x( all(), a, b);
+		}
+		static sve_float32_t sub( sve_float32_t a, sve_float32_t b)
+		{
+			return svsub_f32_x( all(), a, b);
+		}
+		static sve_float32_t mul( sve_float32_t a, sve_float32_t b)
+		{
+			return svmul_f32_x( all(), a, b);
+		}
+		static sve_float32_t div( sve_float32_t a, sve_float32_t b)
+		{
+			return svdiv_f32_x( all(), a, b);
+		}
+		static sve_float32_t min( sve_float32_t a, sve_float32_t b)
+		{
+			return svmin_f32_x( all(), a, b);
+		}
+		static sve_float32_t max( sve_float32_t a, sve_float32_t b)
+		{
+			return svmax_f32_x( all(), a, b);
+		}
+		static sve_float32_t abs( sve_float32_t a)
+		{
+			return svabs_f32_x( all(), a);
+		}
+		static sve_float32_t sqrt( sve_float32_t a)
+		{
+			return svsqrt_f32_x( all(), a);
+		}
+		// 1 / sqrt( a), the 8-bit estimate refined by two Newton steps
+		static sve_float32_t rsqrt( sve_float32_t a)
+		{
+			svfloat32_t y = svrsqrte_f32( a);
+			y = svmul_f32_x( all(), y, svrsqrts_f32( svmul_f32_x( all(), a, y), y));
+			return svmul_f32_x( all(), y, svrsqrts_f32( svmul_f32_x( all(), a, y), y));
+		}
+		// a * b + c, always fused
+		static sve_float32_t fmadd( sve_float32_t a, sve_float32_t b, sve_float32_t c)
+		{
+			return svmad_f32_x( all(), a, b, c);
+		}
+		static float sum( sve_float32_t a)
+		{
+			return svaddv_f32( all(), a);
+		}
+		static float max_lane( sve_float32_t a)
+		{
+			return svmaxv_f32( all(), a);
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( sve_float32_t a, sve_float32_t b)
+		{
+			return to_mask( svcmplt_f32( all(), a, b));
+		}
+		static lane_mask cmp_le( sve_float32_t a, sve_float32_t b)
+		{
+			return to_mask( svcmple_f32( all(), a, b));
+		}
+		static lane_mask cmp_eq( sve_float32_t a, sve_float32_t b)
+		{
+			return to_mask( svcmpeq_f32( all(), a, b));
+		}
+
+		static void store( sve_float32_t * p, sve_float32_t a)
+		{
+			svst1_f32( all(), reinterpret_cast< float *>( p), a);
+		}
+		static void stream( sve_float32_t * p, sve_float32_t a)
+		{
+			svstnt1_f32( all(), reinterpret_cast< float *>( p), a);
+		}
+		// The non-temporal stores are weakly ordered, the barrier orders them before the following stores
+		static void fence()
+		{
+			std::atomic_thread_fence( std::memory_order_release);
+		}
+
+		static sve_float32_t load_partial( const sve_float32_t * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= static_cast< std::ptrdiff_t>( k));
+			return svld1_f32( lanes( lo, hi), reinterpret_cast< const float *>( p));
+		}
+
+		static sve_float32_t mask_lower( sve_float32_t a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < static_cast< std::ptrdiff_t>( k));
+			return svsel_f32( lanes( lgap, static_cast< std::ptrdiff_t>( k)), a, zero());
+		}
+		static sve_float32_t mask_upper( sve_float32_t a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > - static_cast< std::ptrdiff_t>( k));
+			assert( ugap <= 0);
+			return svsel_f32( lanes( 0, static_cast< std::ptrdiff_t>( k) + ugap), a, zero());
+		}
+		static sve_float32_t mask_both( sve_float32_t a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return svsel_f32( lanes( lgap, static_cast< std::ptrdiff_t>( k) + ugap), a, zero());
+		}
+
+		// Predicate of all the lanes
+		static svbool_t all()
+		{
+			return svptrue_b32();
+		}
+		// Predicate of the lanes [lo, hi)
+		static svbool_t lanes( std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			return svbic_b_z( all(), svwhilelt_b32_s64( 0, hi), svwhilelt_b32_s64( 0, lo));
+		}
+		// Conversions between a predicate and the bit mask of its lanes
+		static lane_mask to_mask( svbool_t p)
+		{
+			return static_cast< lane_mask>( svorv_u32( p, lane_bits()));
+		}
+		static svbool_t from_mask( lane_mask m)
+		{
+			return svcmpne_n_u32( all(), svand_u32_x( all(), svdup_n_u32( m), lane_bits()), 0);
+		}
+	private:
+		// 1 << j in lane j
+		static svuint32_t lane_bits()
+		{
+			return svlsl_u32_x( all(), svdup_n_u32( 1), svindex_u32( 0, 1));
+		}
+	};
+#endif
+
+	template<>
+	struct simd< double, double> {
+		static double broadcast( double x)
+		{
+			return x;
+		}
+		static double zero()
+		{
+			return 0.0;
+		}
+		static double add( double a, double b)
+		{
+			return a + b;
+		}
+		static double sub( double a, double b)
+		{
+			return a - b;
+		}
+		static double mul( double a, double b)
+		{
+			return a * b;
+		}
+		static double div( double a, double b)
+		{
+			return a / b;
+		}
+		static double min( double a, double b)
+		{
+			return a < b ? a : b;
+		}
+		static double max( double a, double b)
+		{
+			return a < b ? b : a;
+		}
+		static double abs( double a)
+		{
+			return a < 0 ? - a : a;
+		}
+		static double sqrt( double a)
+		{
+			return std::sqrt( a);
+		}
+		static double rsqrt( double a)
+		{
+			return 1.0 / std::sqrt( a);
+		}
+		// a * b + c
+		static double fmadd( double a, double b, double c)
+		{
+			return a * b + c;
+		}
+		static double sum( double a)
+		{
+			return a;
+		}
+		static double max_lane( double a)
+		{
+			return a;
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( double a, double b)
+		{
+			return ( a < b) ? 1u : 0u;
+		}
+		static lane_mask cmp_le( double a, double b)
+		{
+			return ( a <= b) ? 1u : 0u;
+		}
+		static lane_mask cmp_eq( double a, double b)
+		{
+			return ( a == b) ? 1u : 0u;
+		}
+		static void store( double * p, double a)
+		{
+			* p = a;
+		}
+		static void stream( double * p, double a)
+		{
+			* p = a;
+		}
+		static void fence()
+		{
+		}
+
+		static double load_partial( const double * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo == 0);
+			assert( hi == 1);
+			return * p;
+		}
+
+		static double mask_lower( double a, std::ptrdiff_t lgap)
+		{
+			assert( lgap == 0);
+			return a;
+		}
+		static double mask_upper( double a, std::ptrdiff_t ugap)
+		{
+			assert( ugap == 0);
+			return a;
+		}
+		static double mask_both( double a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			assert( lgap == 0);
+			assert( ugap == 0);
+			return a;
+		}
+	};
+
+#if DU1SIMD_HAVE_SSE
+	template<>
+	struct simd< double, __m128d> {
+		static __m128d broadcast( double x)
+		{
+			return _mm_set1_pd( x);
+		}
+		static __m128d zero()
+		{
+			return _mm_setzero_pd();
+		}
+		static __m128d add( __m128d a, __m128d b)
+		{
+			return _mm_add_pd( a, b);
+		}
+		static __m128d sub( __m128d a, __m128d b)
+		{
+			return _mm_sub_pd( a, b);
+		}
+		static __m128d mul( __m128d a, __m128d b)
+		{
+			return _mm_mul_pd( a, b);
+		}
+		static __m128d div( __m128d a, __m128d b)
+		{
+			return _mm_div_pd( a, b);
+		}
+		static __m128d min( __m128d a, __m128d b)
+		{
+			return _mm_min_pd( a, b);
+		}
+		static __m128d max( __m128d a, __m128d b)
+		{
+			return _mm_max_pd( a, b);
+		}
+		static __m128d abs( __m128d a)
+		{
+			return _mm_andnot_pd( _mm_set1_pd( -0.0), a);
+		}
+		static __m128d sqrt( __m128d a)
+		{
+			return _mm_sqrt_pd( a);
+		}
+		// 1 / sqrt( a), there is no estimate of double precision below AVX-512
+		static __m128d rsqrt( __m128d a)
+		{
+			return _mm_div_pd( _mm_set1_pd( 1.0), _mm_sqrt_pd( a));
+		}
+		// a * b + c, fused if the translation unit enables FMA
+		static __m128d fmadd( __m128d a, __m128d b, __m128d c)
+		{
+#if DU1SIMD_HAVE_FMA
+			return _mm_fmadd_pd( a, b, c);
+#else
+			return _mm_add_pd( _mm_mul_pd( a, b), c);
+#endif
+		}
+		static double sum( __m128d a)
+		{
+			return _mm_cvtsd_f64( _mm_hadd_pd( a, a));
+		}
+		static double max_lane( __m128d a)
+		{
+			return _mm_cvtsd_f64( _mm_max_pd( a, _mm_unpackhi_pd( a, a)));
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( __m128d a, __m128d b)
+		{
+			return static_cast< lane_mask>( _mm_movemask_pd( _mm_cmplt_pd( a, b)));
+		}
+		static lane_mask cmp_le( __m128d a, __m128d b)
+		{
+			return static_cast< lane_mask>( _mm_movemask_pd( _mm_cmple_pd( a, b)));
+		}
+		static lane_mask cmp_eq( __m128d a, __m128d b)
+		{
+			return static_cast< lane_mask>( _mm_movemask_pd( _mm_cmpeq_pd( a, b)));
+		}
+		static void store( __m128d * p, __m128d a)
+		{
+			_mm_store_pd( reinterpret_cast< double *>( p), a);
+		}
+		static void stream( __m128d * p, __m128d a)
+		{
+			_mm_stream_pd( reinterpret_cast< double *>( p), a);
+		}
+		static void fence()
+		{
+			_mm_sfence();
+		}
+
+		static __m128d load_partial( const __m128d * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= 2);
+#if defined(__AVX__)
+			__m128d m = _mm_and_pd( _mm_loadu_pd( reinterpret_cast< const double *>( detail::lower_byte_mask( 16, lo * 8))),
+				_mm_loadu_pd( reinterpret_cast< const double *>( detail::upper_byte_mask( 16, ( 2 - hi) * 8))));
+			return _mm_maskload_pd( reinterpret_cast< const double *>( p), _mm_castpd_si128( m));
+#else
+			return detail::load_lanes< double>( p, lo, hi, zero());
+#endif
+		}
+
+		static __m128d mask_lower( __m128d a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < 2);
+			return _mm_and_pd( a, _mm_loadu_pd( reinterpret_cast< const double *>( detail::lower_byte_mask( 16, lgap * 8))));
+		}
+		static __m128d mask_upper( __m128d a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > -2);
+			assert( ugap <= 0);
+			return _mm_and_pd( a, _mm_loadu_pd( reinterpret_cast< const double *>( detail::upper_byte_mask( 16, - ugap * 8))));
+		}
+		static __m128d mask_both( __m128d a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return mask_upper( mask_lower( a, lgap), ugap);
+		}
+	};
+
+#if DU1SIMD_HAVE_AVX
+	template<>
+	struct simd< double, __m256d> {
+		static __m256d broadcast( double x)
+		{
+			return _mm256_set1_pd( x);
+		}
+		static __m256d zero()
+		{
+			return _mm256_setzero_pd();
+		}
+		static __m256d add( __m256d a, __m256d b)
+		{
+			return _mm256_add_pd( a, b);
+		}
+		static __m256d sub( __m256d a, __m256d b)
+		{
+			return _mm256_sub_pd( a, b);
+		}
+		static __m256d mul( __m256d a, __m256d b)
+		{
+			return _mm256_mul_pd( a, b);
+		}
+		static __m256d div( __m256d a, __m256d b)
+		{
+			return _mm256_div_pd( a, b);
+		}
+		static __m256d min( __m256d a, __m256d b)
+		{
+			return _mm256_min_pd( a, b);
+		}
+		static __m256d max( __m256d a, __m256d b)
+		{
+			return _mm256_max_pd( a, b);
+		}
+		static __m256d abs( __m256d a)
+		{
+			return _mm256_andnot_pd( _mm256_set1_pd( -0.0), a);
+		}
+		static __m256d sqrt( __m256d a)
+		{
+			return _mm256_sqrt_pd( a);
+		}
+		// 1 / sqrt( a), there is no estimate of double precision below AVX-512
+		static __m256d rsqrt( __m256d a)
+		{
+			return _mm256_div_pd( _mm256_set1_pd( 1.0), _mm256_sqrt_pd( a));
+		}
+		// a * b + c, fused if the translation unit enables FMA
+		static __m256d fmadd( __m256d a, __m256d b, __m256d c)
+		{
+#if DU1SIMD_HAVE_FMA
+			return _mm256_fmadd_pd( a, b, c);
+#else
+			return _mm256_add_pd( _mm256_mul_pd( a, b), c);
+#endif
+		}
+		static double sum( __m256d a)
+		{
+			__m128d b = _mm_add_pd( _mm256_castpd256_pd128( a), _mm256_extractf128_pd( a, 1));
+			return simd< double, __m128d>::sum( b);
+		}
+		static double max_lane( __m256d a)
+		{
+			return simd< double, __m128d>::max_lane( _mm_max_pd( _mm256_castpd256_pd128( a), _mm256_extractf128_pd( a, 1)));
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( __m256d a, __m256d b)
+		{
+			return static_cast< lane_mask>( _mm256_movemask_pd( _mm256_cmp_pd( a, b, _CMP_LT_OQ)));
+		}
+		static lane_mask cmp_le( __m256d a, __m256d b)
+		{
+			return static_cast< lane_mask>( _mm256_movemask_pd( _mm256_cmp_pd( a, b, _CMP_LE_OQ)));
+		}
+		static lane_mask cmp_eq( __m256d a, __m256d b)
+		{
+			return static_cast< lane_mask>( _mm256_movemask_pd( _mm256_cmp_pd( a, b, _CMP_EQ_OQ)));
+		}
+		static void store( __m256d * p, __m256d a)
+		{
+			_mm256_store_pd( reinterpret_cast< double *>( p), a);
+		}
+		static void stream( __m256d * p, __m256d a)
+		{
+			_mm256_stream_pd( reinterpret_cast< double *>( p), a);
+		}
+		static void fence()
+		{
+			_mm_sfence();
+		}
+
+		static __m256d load_partial( const __m256d * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= 4);
+			__m256d m = _mm256_and_pd( _mm256_loadu_pd( reinterpret_cast< const double *>( detail::lower_byte_mask( 32, lo * 8))),
+				_mm256_loadu_pd( reinterpret_cast< const double *>( detail::upper_byte_mask( 32, ( 4 - hi) * 8))));
+			return _mm256_maskload_pd( reinterpret_cast< const double *>( p), _mm256_castpd_si256( m));
+		}
+
+		static __m256d mask_lower( __m256d a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < 4);
+			return _mm256_and_pd( a, _mm256_loadu_pd( reinterpret_cast< const double *>( detail::lower_byte_mask( 32, lgap * 8))));
+		}
+		static __m256d mask_upper( __m256d a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > -4);
+			assert( ugap <= 0);
+			return _mm256_and_pd( a, _mm256_loadu_pd( reinterpret_cast< const double *>( detail::upper_byte_mask( 32, - ugap * 8))));
+		}
+		static __m256d mask_both( __m256d a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return mask_upper( mask_lower( a, lgap), ugap);
+		}
+	};
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+	template<>
+	struct simd< double, __m512d> {
+		static __m512d broadcast( double x)
+		{
+			return _mm512_set1_pd( x);
+		}
+		static __m512d zero()
+		{
+			return _mm512_setzero_pd();
+		}
+		static __m512d add( __m512d a, __m512d b)
+		{
+			return _mm512_add_pd( a, b);
+		}
+		static __m512d sub( __m512d a, __m512d b)
+		{
+			return _mm512_sub_pd( a, b);
+		}
+		static __m512d mul( __m512d a, __m512d b)
+		{
+			return _mm512_mul_pd( a, b);
+		}
+		static __m512d div( __m512d a, __m512d b)
+		{
+			return _mm512_div_pd( a, b);
+		}
+		static __m512d min( __m512d a, __m512d b)
+		{
+			return _mm512_min_pd( a, b);
+		}
+		static __m512d max( __m512d a, __m512d b)
+		{
+			return _mm512_max_pd( a, b);
+		}
+		static __m512d abs( __m512d a)
+		{
+			return _mm512_abs_pd( a);
+		}
+		static __m512d sqrt( __m512d a)
+		{
+			return _mm512_sqrt_pd( a);
+		}
+		// 1 / sqrt( a), two Newton steps of the 14-bit estimate would not be more accurate than the division
+		static __m512d rsqrt( __m512d a)
+		{
+			return _mm512_div_pd( _mm512_set1_pd( 1.0), _mm512_sqrt_pd( a));
+		}
+		// a * b + c, always fused (FMA is a part of AVX-512F)
+		static __m512d fmadd( __m512d a, __m512d b, __m512d c)
+		{
+			return _mm512_fmadd_pd( a, b, c);
+		}
+		static double sum( __m512d a)
+		{
+			__m256d b = _mm256_add_pd( _mm512_castpd512_pd256( a), _mm512_extractf64x4_pd( a, 1));
+			return simd< double, __m256d>::sum( b);
+		}
+		static double max_lane( __m512d a)
+		{
+			return _mm512_reduce_max_pd( a);
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b, false for NaN
+		static lane_mask cmp_lt( __m512d a, __m512d b)
+		{
+			return static_cast< lane_mask>( _mm512_cmp_pd_mask( a, b, _CMP_LT_OQ));
+		}
+		static lane_mask cmp_le( __m512d a, __m512d b)
+		{
+			return static_cast< lane_mask>( _mm512_cmp_pd_mask( a, b, _CMP_LE_OQ));
+		}
+		static lane_mask cmp_eq( __m512d a, __m512d b)
+		{
+			return static_cast< lane_mask>( _mm512_cmp_pd_mask( a, b, _CMP_EQ_OQ));
+		}
+		static void store( __m512d * p, __m512d a)
+		{
+			_mm512_store_pd( reinterpret_cast< double *>( p), a);
+		}
+		static void stream( __m512d * p, __m512d a)
+		{
+			_mm512_stream_pd( reinterpret_cast< double *>( p), a);
+		}
+		static void fence()
+		{
+			_mm_sfence();
+		}
+
+		static __m512d load_partial( const __m512d * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= 8);
+			__mmask8 m = static_cast< __mmask8>( ( 0xFFu << lo) & ( 0xFFu >> ( 8 - hi)));
+			return _mm512_maskz_loadu_pd( m, p);
+		}
+
+		static __m512d mask_lower( __m512d a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < 8);
+			return _mm512_maskz_mov_pd( static_cast< __mmask8>( 0xFFu << lgap), a);
+		}
+		static __m512d mask_upper( __m512d a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > -8);
+			assert( ugap <= 0);
+			return _mm512_maskz_mov_pd( static_cast< __mmask8>( 0xFFu >> - ugap), a);
+		}
+		static __m512d mask_both( __m512d a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return _mm512_maskz_mov_pd( static_cast< __mmask8>( ( 0xFFu << lgap) & ( 0xFFu >> - ugap)), a);
+		}
+	};
+#endif
+#endif // DU1SIMD_HAVE_SSE
+};
+
+#endif // DU1SIMD_OPS_HPP
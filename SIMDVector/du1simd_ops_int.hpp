@@ -0,0 +1,1512 @@
+// du1simd_ops_int.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Operation traits for the integer carriers
+//
+// du1simd::simd< T, S> for T in int8_t ... uint64_t and S in __m128i (SSE2), __m256i (AVX2) and __m512i
+// (AVX-512BW) provides the operations of du1simd_ops.hpp (except div) and
+//
+//	adds, subs		saturating add / subtract, 8 and 16 bit lanes only (the widths the hardware has)
+//	min, max		signed or unsigned according to T
+//	mul			low half of the product, 16 and 32 bit lanes only
+//	wide_add( acc, a)	adds the lanes of a to the 64-bit partial sums held in acc
+//	wide_sum( acc)		total of the partial sums as wide_type (int64_t or uint64_t)
+//	cmp_lt, cmp_le, cmp_eq	lane_mask of the comparison, cmp_le derived from min( a, b) == a, no lt / le
+//				for 8-bit lanes of __m512i (64 lanes do not fit a lane_mask)
+//
+// add, sub and sum wrap around like the arithmetic of T, wide_add / wide_sum never overflow for ranges
+// of 8, 16 and 32 bit elements (e.g. uint8_t lanes are summed by _mm_sad_epu8), see du1simd::widening_sum
+// in du1simd_reduce.hpp.
+//
+// The __m128i carriers use SSE4.1 / SSE4.2 instructions only if the translation unit enables them
+// (__SSE4_1__, __SSE4_2__ or AVX), otherwise they are emulated by SSE2. The __m256i carriers require
+// isa::avx2 and the __m512i carriers isa::avx512 at runtime (du1simd_dispatch.hpp).
+//
+// There are no integer carriers on ARM, the header is empty there.
+//
+
+#ifndef DU1SIMD_OPS_INT_HPP
+#define DU1SIMD_OPS_INT_HPP
+
+#include "du1simd_ops.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <type_traits>
+
+#if DU1SIMD_HAVE_SSE
+#include <emmintrin.h>
+
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define DU1SIMD_HAVE_SSE41 1
+#include <smmintrin.h>
+#else
+#define DU1SIMD_HAVE_SSE41 0
+#endif
+
+#if defined(__SSE4_2__) || defined(__AVX__)
+#define DU1SIMD_HAVE_SSE42 1
+#include <nmmintrin.h>
+#else
+#define DU1SIMD_HAVE_SSE42 0
+#endif
+
+#if DU1SIMD_HAVE_AVX2 || DU1SIMD_HAVE_AVX512BW
+#include <immintrin.h>
+#endif
+
+namespace du1simd {
+
+	namespace detail {
+
+		// Lane operations of the integer carriers, specialized by the element type
+		template< typename T>
+		struct sse2_lanes;
+
+		template< typename T>
+		struct avx2_lanes;
+
+		template< typename T>
+		struct avx512_lanes;
+
+		// Sign bit of every 64-bit lane
+		inline __m128i sse2_sign64()
+		{
+			return _mm_set_epi32( static_cast< int>( 0x80000000u), 0, static_cast< int>( 0x80000000u), 0);
+		}
+
+		// a where m is set, b elsewhere
+		inline __m128i sse2_select( __m128i m, __m128i a, __m128i b)
+		{
+			return _mm_or_si128( _mm_and_si128( m, a), _mm_andnot_si128( m, b));
+		}
+
+		// Sums of the pairs of signed / unsigned 32-bit lanes as two 64-bit lanes
+		inline __m128i sse2_widen_epi32( __m128i a)
+		{
+			__m128i s = _mm_srai_epi32( a, 31);
+			return _mm_add_epi64( _mm_unpacklo_epi32( a, s), _mm_unpackhi_epi32( a, s));
+		}
+
+		inline __m128i sse2_widen_epu32( __m128i a)
+		{
+			__m128i z = _mm_setzero_si128();
+			return _mm_add_epi64( _mm_unpacklo_epi32( a, z), _mm_unpackhi_epi32( a, z));
+		}
+
+		// Bit j set if the lanes j of a and b of n bytes are equal
+		template< std::size_t n>
+		lane_mask sse2_equal( __m128i a, __m128i b);
+
+		template<>
+		inline lane_mask sse2_equal< 1>( __m128i a, __m128i b)
+		{
+			return static_cast< lane_mask>( _mm_movemask_epi8( _mm_cmpeq_epi8( a, b)));
+		}
+
+		template<>
+		inline lane_mask sse2_equal< 2>( __m128i a, __m128i b)
+		{
+			return static_cast< lane_mask>( _mm_movemask_epi8( _mm_packs_epi16( _mm_cmpeq_epi16( a, b), _mm_setzero_si128())));
+		}
+
+		template<>
+		inline lane_mask sse2_equal< 4>( __m128i a, __m128i b)
+		{
+			return static_cast< lane_mask>( _mm_movemask_ps( _mm_castsi128_ps( _mm_cmpeq_epi32( a, b))));
+		}
+
+		template<>
+		inline lane_mask sse2_equal< 8>( __m128i a, __m128i b)
+		{
+			__m128i e = _mm_cmpeq_epi32( a, b);
+			e = _mm_and_si128( e, _mm_shuffle_epi32( e, 0xB1));
+			return static_cast< lane_mask>( _mm_movemask_pd( _mm_castsi128_pd( e)));
+		}
+
+		inline __m128i sse2_mullo_epi32( __m128i a, __m128i b)
+		{
+#if DU1SIMD_HAVE_SSE41
+			return _mm_mullo_epi32( a, b);
+#else
+			__m128i even = _mm_mul_epu32( a, b);
+			__m128i odd = _mm_mul_epu32( _mm_srli_epi64( a, 32), _mm_srli_epi64( b, 32));
+			return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, 0x08), _mm_shuffle_epi32( odd, 0x08));
+#endif
+		}
+
+		// Lane-wise min / max of 64-bit lanes, a > b given by the signed comparison of the biased values
+		template< typename T, bool maximum>
+		__m128i sse2_minmax64( __m128i a, __m128i b)
+		{
+#if DU1SIMD_HAVE_SSE42
+			__m128i bias = std::is_signed< T>::value ? _mm_setzero_si128() : sse2_sign64();
+			__m128i gt = _mm_cmpgt_epi64( _mm_xor_si128( a, bias), _mm_xor_si128( b, bias));
+			return maximum ? sse2_select( gt, a, b) : sse2_select( gt, b, a);
+#else
+			T x[ 2], y[ 2];
+			_mm_storeu_si128( reinterpret_cast< __m128i *>( x), a);
+			_mm_storeu_si128( reinterpret_cast< __m128i *>( y), b);
+			for ( int i = 0; i < 2; ++ i)
+			{
+				x[ i] = ( ( x[ i] < y[ i]) == maximum) ? y[ i] : x[ i];
+			}
+			return _mm_loadu_si128( reinterpret_cast< const __m128i *>( x));
+#endif
+		}
+
+		template<>
+		struct sse2_lanes< std::int8_t> {
+			typedef std::int64_t wide_type;
+
+			static __m128i broadcast( std::int8_t x)
+			{
+				return _mm_set1_epi8( static_cast< char>( x));
+			}
+			static __m128i add( __m128i a, __m128i b)
+			{
+				return _mm_add_epi8( a, b);
+			}
+			static __m128i sub( __m128i a, __m128i b)
+			{
+				return _mm_sub_epi8( a, b);
+			}
+			static __m128i adds( __m128i a, __m128i b)
+			{
+				return _mm_adds_epi8( a, b);
+			}
+			static __m128i subs( __m128i a, __m128i b)
+			{
+				return _mm_subs_epi8( a, b);
+			}
+			static __m128i min( __m128i a, __m128i b)
+			{
+#if DU1SIMD_HAVE_SSE41
+				return _mm_min_epi8( a, b);
+#else
+				return sse2_select( _mm_cmpgt_epi8( a, b), b, a);
+#endif
+			}
+			static __m128i max( __m128i a, __m128i b)
+			{
+#if DU1SIMD_HAVE_SSE41
+				return _mm_max_epi8( a, b);
+#else
+				return sse2_select( _mm_cmpgt_epi8( a, b), a, b);
+#endif
+			}
+			// Biased to unsigned, summed by groups of 8 and the bias of 8 * 128 removed
+			static __m128i widen( __m128i a)
+			{
+				__m128i s = _mm_sad_epu8( _mm_xor_si128( a, _mm_set1_epi8( static_cast< char>( 0x80))), _mm_setzero_si128());
+				return _mm_sub_epi64( s, _mm_set_epi32( 0, 1024, 0, 1024));
+			}
+		};
+
+		template<>
+		struct sse2_lanes< std::uint8_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m128i broadcast( std::uint8_t x)
+			{
+				return _mm_set1_epi8( static_cast< char>( x));
+			}
+			static __m128i add( __m128i a, __m128i b)
+			{
+				return _mm_add_epi8( a, b);
+			}
+			static __m128i sub( __m128i a, __m128i b)
+			{
+				return _mm_sub_epi8( a, b);
+			}
+			static __m128i adds( __m128i a, __m128i b)
+			{
+				return _mm_adds_epu8( a, b);
+			}
+			static __m128i subs( __m128i a, __m128i b)
+			{
+				return _mm_subs_epu8( a, b);
+			}
+			static __m128i min( __m128i a, __m128i b)
+			{
+				return _mm_min_epu8( a, b);
+			}
+			static __m128i max( __m128i a, __m128i b)
+			{
+				return _mm_max_epu8( a, b);
+			}
+			static __m128i widen( __m128i a)
+			{
+				return _mm_sad_epu8( a, _mm_setzero_si128());
+			}
+		};
+
+		template<>
+		struct sse2_lanes< std::int16_t> {
+			typedef std::int64_t wide_type;
+
+			static __m128i broadcast( std::int16_t x)
+			{
+				return _mm_set1_epi16( x);
+			}
+			static __m128i add( __m128i a, __m128i b)
+			{
+				return _mm_add_epi16( a, b);
+			}
+			static __m128i sub( __m128i a, __m128i b)
+			{
+				return _mm_sub_epi16( a, b);
+			}
+			static __m128i adds( __m128i a, __m128i b)
+			{
+				return _mm_adds_epi16( a, b);
+			}
+			static __m128i subs( __m128i a, __m128i b)
+			{
+				return _mm_subs_epi16( a, b);
+			}
+			static __m128i min( __m128i a, __m128i b)
+			{
+				return _mm_min_epi16( a, b);
+			}
+			static __m128i max( __m128i a, __m128i b)
+			{
+				return _mm_max_epi16( a, b);
+			}
+			static __m128i mul( __m128i a, __m128i b)
+			{
+				return _mm_mullo_epi16( a, b);
+			}
+			static __m128i widen( __m128i a)
+			{
+				return sse2_widen_epi32( _mm_madd_epi16( a, _mm_set1_epi16( 1)));
+			}
+		};
+
+		template<>
+		struct sse2_lanes< std::uint16_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m128i broadcast( std::uint16_t x)
+			{
+				return _mm_set1_epi16( static_cast< short>( x));
+			}
+			static __m128i add( __m128i a, __m128i b)
+			{
+				return _mm_add_epi16( a, b);
+			}
+			static __m128i sub( __m128i a, __m128i b)
+			{
+				return _mm_sub_epi16( a, b);
+			}
+			static __m128i adds( __m128i a, __m128i b)
+			{
+				return _mm_adds_epu16( a, b);
+			}
+			static __m128i subs( __m128i a, __m128i b)
+			{
+				return _mm_subs_epu16( a, b);
+			}
+			static __m128i min( __m128i a, __m128i b)
+			{
+#if DU1SIMD_HAVE_SSE41
+				return _mm_min_epu16( a, b);
+#else
+				__m128i bias = _mm_set1_epi16( static_cast< short>( 0x8000));
+				return _mm_xor_si128( _mm_min_epi16( _mm_xor_si128( a, bias), _mm_xor_si128( b, bias)), bias);
+#endif
+			}
+			static __m128i max( __m128i a, __m128i b)
+			{
+#if DU1SIMD_HAVE_SSE41
+				return _mm_max_epu16( a, b);
+#else
+				__m128i bias = _mm_set1_epi16( static_cast< short>( 0x8000));
+				return _mm_xor_si128( _mm_max_epi16( _mm_xor_si128( a, bias), _mm_xor_si128( b, bias)), bias);
+#endif
+			}
+			static __m128i mul( __m128i a, __m128i b)
+			{
+				return _mm_mullo_epi16( a, b);
+			}
+			// Biased to signed, pairs summed by madd and the bias of 2 * 32768 removed
+			static __m128i widen( __m128i a)
+			{
+				__m128i m = _mm_madd_epi16( _mm_xor_si128( a, _mm_set1_epi16( static_cast< short>( 0x8000))), _mm_set1_epi16( 1));
+				return sse2_widen_epu32( _mm_add_epi32( m, _mm_set1_epi32( 65536)));
+			}
+		};
+
+		template<>
+		struct sse2_lanes< std::int32_t> {
+			typedef std::int64_t wide_type;
+
+			static __m128i broadcast( std::int32_t x)
+			{
+				return _mm_set1_epi32( x);
+			}
+			static __m128i add( __m128i a, __m128i b)
+			{
+				return _mm_add_epi32( a, b);
+			}
+			static __m128i sub( __m128i a, __m128i b)
+			{
+				return _mm_sub_epi32( a, b);
+			}
+			static __m128i min( __m128i a, __m128i b)
+			{
+#if DU1SIMD_HAVE_SSE41
+				return _mm_min_epi32( a, b);
+#else
+				return sse2_select( _mm_cmpgt_epi32( a, b), b, a);
+#endif
+			}
+			static __m128i max( __m128i a, __m128i b)
+			{
+#if DU1SIMD_HAVE_SSE41
+				return _mm_max_epi32( a, b);
+#else
+				return sse2_select( _mm_cmpgt_epi32( a, b), a, b);
+#endif
+			}
+			static __m128i mul( __m128i a, __m128i b)
+			{
+				return sse2_mullo_epi32( a, b);
+			}
+			static __m128i widen( __m128i a)
+			{
+				return sse2_widen_epi32( a);
+			}
+		};
+
+		template<>
+		struct sse2_lanes< std::uint32_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m128i broadcast( std::uint32_t x)
+			{
+				return _mm_set1_epi32( static_cast< int>( x));
+			}
+			static __m128i add( __m128i a, __m128i b)
+			{
+				return _mm_add_epi32( a, b);
+			}
+			static __m128i sub( __m128i a, __m128i b)
+			{
+				return _mm_sub_epi32( a, b);
+			}
+			static __m128i min( __m128i a, __m128i b)
+			{
+#if DU1SIMD_HAVE_SSE41
+				return _mm_min_epu32( a, b);
+#else
+				__m128i bias = _mm_set1_epi32( static_cast< int>( 0x80000000u));
+				return sse2_select( _mm_cmpgt_epi32( _mm_xor_si128( a, bias), _mm_xor_si128( b, bias)), b, a);
+#endif
+			}
+			static __m128i max( __m128i a, __m128i b)
+			{
+#if DU1SIMD_HAVE_SSE41
+				return _mm_max_epu32( a, b);
+#else
+				__m128i bias = _mm_set1_epi32( static_cast< int>( 0x80000000u));
+				return sse2_select( _mm_cmpgt_epi32( _mm_xor_si128( a, bias), _mm_xor_si128( b, bias)), a, b);
+#endif
+			}
+			static __m128i mul( __m128i a, __m128i b)
+			{
+				return sse2_mullo_epi32( a, b);
+			}
+			static __m128i widen( __m128i a)
+			{
+				return sse2_widen_epu32( a);
+			}
+		};
+
+		template<>
+		struct sse2_lanes< std::int64_t> {
+			typedef std::int64_t wide_type;
+
+			static __m128i broadcast( std::int64_t x)
+			{
+				return _mm_set_epi32( static_cast< int>( x >> 32), static_cast< int>( x), static_cast< int>( x >> 32), static_cast< int>( x));
+			}
+			static __m128i add( __m128i a, __m128i b)
+			{
+				return _mm_add_epi64( a, b);
+			}
+			static __m128i sub( __m128i a, __m128i b)
+			{
+				return _mm_sub_epi64( a, b);
+			}
+			static __m128i min( __m128i a, __m128i b)
+			{
+				return sse2_minmax64< std::int64_t, false>( a, b);
+			}
+			static __m128i max( __m128i a, __m128i b)
+			{
+				return sse2_minmax64< std::int64_t, true>( a, b);
+			}
+			static __m128i widen( __m128i a)
+			{
+				return a;
+			}
+		};
+
+		template<>
+		struct sse2_lanes< std::uint64_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m128i broadcast( std::uint64_t x)
+			{
+				return _mm_set_epi32( static_cast< int>( x >> 32), static_cast< int>( x), static_cast< int>( x >> 32), static_cast< int>( x));
+			}
+			static __m128i add( __m128i a, __m128i b)
+			{
+				return _mm_add_epi64( a, b);
+			}
+			static __m128i sub( __m128i a, __m128i b)
+			{
+				return _mm_sub_epi64( a, b);
+			}
+			static __m128i min( __m128i a, __m128i b)
+			{
+				return sse2_minmax64< std::uint64_t, false>( a, b);
+			}
+			static __m128i max( __m128i a, __m128i b)
+			{
+				return sse2_minmax64< std::uint64_t, true>( a, b);
+			}
+			static __m128i widen( __m128i a)
+			{
+				return a;
+			}
+		};
+	}
+
+	template< typename T>
+	struct simd< T, __m128i> {
+		static_assert( std::is_integral< T>::value, "Integer element type required!");
+
+		typedef detail::sse2_lanes< T> lanes;
+		typedef typename lanes::wide_type wide_type;
+
+		static __m128i broadcast( T x)
+		{
+			return lanes::broadcast( x);
+		}
+		static __m128i zero()
+		{
+			return _mm_setzero_si128();
+		}
+		static __m128i add( __m128i a, __m128i b)
+		{
+			return lanes::add( a, b);
+		}
+		static __m128i sub( __m128i a, __m128i b)
+		{
+			return lanes::sub( a, b);
+		}
+		static __m128i adds( __m128i a, __m128i b)
+		{
+			return lanes::adds( a, b);
+		}
+		static __m128i subs( __m128i a, __m128i b)
+		{
+			return lanes::subs( a, b);
+		}
+		static __m128i mul( __m128i a, __m128i b)
+		{
+			return lanes::mul( a, b);
+		}
+		static __m128i min( __m128i a, __m128i b)
+		{
+			return lanes::min( a, b);
+		}
+		static __m128i max( __m128i a, __m128i b)
+		{
+			return lanes::max( a, b);
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b
+		static lane_mask cmp_lt( __m128i a, __m128i b)
+		{
+			return cmp_le( a, b) & ~ cmp_eq( a, b);
+		}
+		static lane_mask cmp_le( __m128i a, __m128i b)
+		{
+			return cmp_eq( lanes::min( a, b), a);
+		}
+		static lane_mask cmp_eq( __m128i a, __m128i b)
+		{
+			return detail::sse2_equal< sizeof(T)>( a, b);
+		}
+		static __m128i wide_add( __m128i acc, __m128i a)
+		{
+			return _mm_add_epi64( acc, lanes::widen( a));
+		}
+		static wide_type wide_sum( __m128i acc)
+		{
+			std::uint64_t x[ 2];
+			_mm_storeu_si128( reinterpret_cast< __m128i *>( x), acc);
+			return static_cast< wide_type>( x[ 0] + x[ 1]);
+		}
+		static T sum( __m128i a)
+		{
+			return static_cast< T>( wide_sum( wide_add( zero(), a)));
+		}
+		static void store( __m128i * p, __m128i a)
+		{
+			_mm_store_si128( p, a);
+		}
+		static void stream( __m128i * p, __m128i a)
+		{
+			_mm_stream_si128( p, a);
+		}
+		static void fence()
+		{
+			_mm_sfence();
+		}
+
+		static __m128i load_partial( const __m128i * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= static_cast< std::ptrdiff_t>( 16 / sizeof(T)));
+			return detail::load_lanes< T>( p, lo, hi, zero());
+		}
+
+		static __m128i mask_lower( __m128i a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < static_cast< std::ptrdiff_t>( 16 / sizeof(T)));
+			return _mm_and_si128( a, _mm_loadu_si128( reinterpret_cast< const __m128i *>( detail::lower_byte_mask( 16, lgap * sizeof(T)))));
+		}
+		static __m128i mask_upper( __m128i a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > - static_cast< std::ptrdiff_t>( 16 / sizeof(T)));
+			assert( ugap <= 0);
+			return _mm_and_si128( a, _mm_loadu_si128( reinterpret_cast< const __m128i *>( detail::upper_byte_mask( 16, - ugap * sizeof(T)))));
+		}
+		static __m128i mask_both( __m128i a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return mask_upper( mask_lower( a, lgap), ugap);
+		}
+	};
+
+#if DU1SIMD_HAVE_AVX2
+	namespace detail {
+
+		inline __m256i avx2_sign64()
+		{
+			return _mm256_set_epi32( static_cast< int>( 0x80000000u), 0, static_cast< int>( 0x80000000u), 0,
+				static_cast< int>( 0x80000000u), 0, static_cast< int>( 0x80000000u), 0);
+		}
+
+		inline __m256i avx2_widen_epi32( __m256i a)
+		{
+			__m256i s = _mm256_srai_epi32( a, 31);
+			return _mm256_add_epi64( _mm256_unpacklo_epi32( a, s), _mm256_unpackhi_epi32( a, s));
+		}
+
+		inline __m256i avx2_widen_epu32( __m256i a)
+		{
+			__m256i z = _mm256_setzero_si256();
+			return _mm256_add_epi64( _mm256_unpacklo_epi32( a, z), _mm256_unpackhi_epi32( a, z));
+		}
+
+		template< std::size_t n>
+		lane_mask avx2_equal( __m256i a, __m256i b);
+
+		template<>
+		inline lane_mask avx2_equal< 1>( __m256i a, __m256i b)
+		{
+			return static_cast< lane_mask>( _mm256_movemask_epi8( _mm256_cmpeq_epi8( a, b)));
+		}
+
+		// The words are packed to bytes within each 128-bit half, then the halves joined
+		template<>
+		inline lane_mask avx2_equal< 2>( __m256i a, __m256i b)
+		{
+			__m256i e = _mm256_packs_epi16( _mm256_cmpeq_epi16( a, b), _mm256_setzero_si256());
+			return static_cast< lane_mask>( _mm256_movemask_epi8( _mm256_permute4x64_epi64( e, 0x08))) & 0xFFFFu;
+		}
+
+		template<>
+		inline lane_mask avx2_equal< 4>( __m256i a, __m256i b)
+		{
+			return static_cast< lane_mask>( _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpeq_epi32( a, b))));
+		}
+
+		template<>
+		inline lane_mask avx2_equal< 8>( __m256i a, __m256i b)
+		{
+			return static_cast< lane_mask>( _mm256_movemask_pd( _mm256_castsi256_pd( _mm256_cmpeq_epi64( a, b))));
+		}
+
+		template< typename T, bool maximum>
+		__m256i avx2_minmax64( __m256i a, __m256i b)
+		{
+			__m256i bias = std::is_signed< T>::value ? _mm256_setzero_si256() : avx2_sign64();
+			__m256i gt = _mm256_cmpgt_epi64( _mm256_xor_si256( a, bias), _mm256_xor_si256( b, bias));
+			return maximum ? _mm256_blendv_epi8( b, a, gt) : _mm256_blendv_epi8( a, b, gt);
+		}
+
+		template<>
+		struct avx2_lanes< std::int8_t> {
+			typedef std::int64_t wide_type;
+
+			static __m256i broadcast( std::int8_t x)
+			{
+				return _mm256_set1_epi8( static_cast< char>( x));
+			}
+			static __m256i add( __m256i a, __m256i b)
+			{
+				return _mm256_add_epi8( a, b);
+			}
+			static __m256i sub( __m256i a, __m256i b)
+			{
+				return _mm256_sub_epi8( a, b);
+			}
+			static __m256i adds( __m256i a, __m256i b)
+			{
+				return _mm256_adds_epi8( a, b);
+			}
+			static __m256i subs( __m256i a, __m256i b)
+			{
+				return _mm256_subs_epi8( a, b);
+			}
+			static __m256i min( __m256i a, __m256i b)
+			{
+				return _mm256_min_epi8( a, b);
+			}
+			static __m256i max( __m256i a, __m256i b)
+			{
+				return _mm256_max_epi8( a, b);
+			}
+			static __m256i widen( __m256i a)
+			{
+				__m256i s = _mm256_sad_epu8( _mm256_xor_si256( a, _mm256_set1_epi8( static_cast< char>( 0x80))), _mm256_setzero_si256());
+				return _mm256_sub_epi64( s, _mm256_set_epi32( 0, 1024, 0, 1024, 0, 1024, 0, 1024));
+			}
+		};
+
+		template<>
+		struct avx2_lanes< std::uint8_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m256i broadcast( std::uint8_t x)
+			{
+				return _mm256_set1_epi8( static_cast< char>( x));
+			}
+			static __m256i add( __m256i a, __m256i b)
+			{
+				return _mm256_add_epi8( a, b);
+			}
+			static __m256i sub( __m256i a, __m256i b)
+			{
+				return _mm256_sub_epi8( a, b);
+			}
+			static __m256i adds( __m256i a, __m256i b)
+			{
+				return _mm256_adds_epu8( a, b);
+			}
+			static __m256i subs( __m256i a, __m256i b)
+			{
+				return _mm256_subs_epu8( a, b);
+			}
+			static __m256i min( __m256i a, __m256i b)
+			{
+				return _mm256_min_epu8( a, b);
+			}
+			static __m256i max( __m256i a, __m256i b)
+			{
+				return _mm256_max_epu8( a, b);
+			}
+			static __m256i widen( __m256i a)
+			{
+				return _mm256_sad_epu8( a, _mm256_setzero_si256());
+			}
+		};
+
+		template<>
+		struct avx2_lanes< std::int16_t> {
+			typedef std::int64_t wide_type;
+
+			static __m256i broadcast( std::int16_t x)
+			{
+				return _mm256_set1_epi16( x);
+			}
+			static __m256i add( __m256i a, __m256i b)
+			{
+				return _mm256_add_epi16( a, b);
+			}
+			static __m256i sub( __m256i a, __m256i b)
+			{
+				return _mm256_sub_epi16( a, b);
+			}
+			static __m256i adds( __m256i a, __m256i b)
+			{
+				return _mm256_adds_epi16( a, b);
+			}
+			static __m256i subs( __m256i a, __m256i b)
+			{
+				return _mm256_subs_epi16( a, b);
+			}
+			static __m256i min( __m256i a, __m256i b)
+			{
+				return _mm256_min_epi16( a, b);
+			}
+			static __m256i max( __m256i a, __m256i b)
+			{
+				return _mm256_max_epi16( a, b);
+			}
+			static __m256i mul( __m256i a, __m256i b)
+			{
+				return _mm256_mullo_epi16( a, b);
+			}
+			static __m256i widen( __m256i a)
+			{
+				return avx2_widen_epi32( _mm256_madd_epi16( a, _mm256_set1_epi16( 1)));
+			}
+		};
+
+		template<>
+		struct avx2_lanes< std::uint16_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m256i broadcast( std::uint16_t x)
+			{
+				return _mm256_set1_epi16( static_cast< short>( x));
+			}
+			static __m256i add( __m256i a, __m256i b)
+			{
+				return _mm256_add_epi16( a, b);
+			}
+			static __m256i sub( __m256i a, __m256i b)
+			{
+				return _mm256_sub_epi16( a, b);
+			}
+			static __m256i adds( __m256i a, __m256i b)
+			{
+				return _mm256_adds_epu16( a, b);
+			}
+			static __m256i subs( __m256i a, __m256i b)
+			{
+				return _mm256_subs_epu16( a, b);
+			}
+			static __m256i min( __m256i a, __m256i b)
+			{
+				return _mm256_min_epu16( a, b);
+			}
+			static __m256i max( __m256i a, __m256i b)
+			{
+				return _mm256_max_epu16( a, b);
+			}
+			static __m256i mul( __m256i a, __m256i b)
+			{
+				return _mm256_mullo_epi16( a, b);
+			}
+			static __m256i widen( __m256i a)
+			{
+				__m256i m = _mm256_madd_epi16( _mm256_xor_si256( a, _mm256_set1_epi16( static_cast< short>( 0x8000))), _mm256_set1_epi16( 1));
+				return avx2_widen_epu32( _mm256_add_epi32( m, _mm256_set1_epi32( 65536)));
+			}
+		};
+
+		template<>
+		struct avx2_lanes< std::int32_t> {
+			typedef std::int64_t wide_type;
+
+			static __m256i broadcast( std::int32_t x)
+			{
+				return _mm256_set1_epi32( x);
+			}
+			static __m256i add( __m256i a, __m256i b)
+			{
+				return _mm256_add_epi32( a, b);
+			}
+			static __m256i sub( __m256i a, __m256i b)
+			{
+				return _mm256_sub_epi32( a, b);
+			}
+			static __m256i min( __m256i a, __m256i b)
+			{
+				return _mm256_min_epi32( a, b);
+			}
+			static __m256i max( __m256i a, __m256i b)
+			{
+				return _mm256_max_epi32( a, b);
+			}
+			static __m256i mul( __m256i a, __m256i b)
+			{
+				return _mm256_mullo_epi32( a, b);
+			}
+			static __m256i widen( __m256i a)
+			{
+				return avx2_widen_epi32( a);
+			}
+		};
+
+		template<>
+		struct avx2_lanes< std::uint32_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m256i broadcast( std::uint32_t x)
+			{
+				return _mm256_set1_epi32( static_cast< int>( x));
+			}
+			static __m256i add( __m256i a, __m256i b)
+			{
+				return _mm256_add_epi32( a, b);
+			}
+			static __m256i sub( __m256i a, __m256i b)
+			{
+				return _mm256_sub_epi32( a, b);
+			}
+			static __m256i min( __m256i a, __m256i b)
+			{
+				return _mm256_min_epu32( a, b);
+			}
+			static __m256i max( __m256i a, __m256i b)
+			{
+				return _mm256_max_epu32( a, b);
+			}
+			static __m256i mul( __m256i a, __m256i b)
+			{
+				return _mm256_mullo_epi32( a, b);
+			}
+			static __m256i widen( __m256i a)
+			{
+				return avx2_widen_epu32( a);
+			}
+		};
+
+		template<>
+		struct avx2_lanes< std::int64_t> {
+			typedef std::int64_t wide_type;
+
+			static __m256i broadcast( std::int64_t x)
+			{
+				int hi = static_cast< int>( x >> 32), lo = static_cast< int>( x);
+				return _mm256_set_epi32( hi, lo, hi, lo, hi, lo, hi, lo);
+			}
+			static __m256i add( __m256i a, __m256i b)
+			{
+				return _mm256_add_epi64( a, b);
+			}
+			static __m256i sub( __m256i a, __m256i b)
+			{
+				return _mm256_sub_epi64( a, b);
+			}
+			static __m256i min( __m256i a, __m256i b)
+			{
+				return avx2_minmax64< std::int64_t, false>( a, b);
+			}
+			static __m256i max( __m256i a, __m256i b)
+			{
+				return avx2_minmax64< std::int64_t, true>( a, b);
+			}
+			static __m256i widen( __m256i a)
+			{
+				return a;
+			}
+		};
+
+		template<>
+		struct avx2_lanes< std::uint64_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m256i broadcast( std::uint64_t x)
+			{
+				int hi = static_cast< int>( x >> 32), lo = static_cast< int>( x);
+				return _mm256_set_epi32( hi, lo, hi, lo, hi, lo, hi, lo);
+			}
+			static __m256i add( __m256i a, __m256i b)
+			{
+				return _mm256_add_epi64( a, b);
+			}
+			static __m256i sub( __m256i a, __m256i b)
+			{
+				return _mm256_sub_epi64( a, b);
+			}
+			static __m256i min( __m256i a, __m256i b)
+			{
+				return avx2_minmax64< std::uint64_t, false>( a, b);
+			}
+			static __m256i max( __m256i a, __m256i b)
+			{
+				return avx2_minmax64< std::uint64_t, true>( a, b);
+			}
+			static __m256i widen( __m256i a)
+			{
+				return a;
+			}
+		};
+	}
+
+	template< typename T>
+	struct simd< T, __m256i> {
+		static_assert( std::is_integral< T>::value, "Integer element type required!");
+
+		typedef detail::avx2_lanes< T> lanes;
+		typedef typename lanes::wide_type wide_type;
+
+		static __m256i broadcast( T x)
+		{
+			return lanes::broadcast( x);
+		}
+		static __m256i zero()
+		{
+			return _mm256_setzero_si256();
+		}
+		static __m256i add( __m256i a, __m256i b)
+		{
+			return lanes::add( a, b);
+		}
+		static __m256i sub( __m256i a, __m256i b)
+		{
+			return lanes::sub( a, b);
+		}
+		static __m256i adds( __m256i a, __m256i b)
+		{
+			return lanes::adds( a, b);
+		}
+		static __m256i subs( __m256i a, __m256i b)
+		{
+			return lanes::subs( a, b);
+		}
+		static __m256i mul( __m256i a, __m256i b)
+		{
+			return lanes::mul( a, b);
+		}
+		static __m256i min( __m256i a, __m256i b)
+		{
+			return lanes::min( a, b);
+		}
+		static __m256i max( __m256i a, __m256i b)
+		{
+			return lanes::max( a, b);
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b
+		static lane_mask cmp_lt( __m256i a, __m256i b)
+		{
+			return cmp_le( a, b) & ~ cmp_eq( a, b);
+		}
+		static lane_mask cmp_le( __m256i a, __m256i b)
+		{
+			return cmp_eq( lanes::min( a, b), a);
+		}
+		static lane_mask cmp_eq( __m256i a, __m256i b)
+		{
+			return detail::avx2_equal< sizeof(T)>( a, b);
+		}
+		static __m256i wide_add( __m256i acc, __m256i a)
+		{
+			return _mm256_add_epi64( acc, lanes::widen( a));
+		}
+		static wide_type wide_sum( __m256i acc)
+		{
+			__m128i b = _mm_add_epi64( _mm256_castsi256_si128( acc), _mm256_extracti128_si256( acc, 1));
+			return simd< T, __m128i>::wide_sum( b);
+		}
+		static T sum( __m256i a)
+		{
+			return static_cast< T>( wide_sum( wide_add( zero(), a)));
+		}
+		static void store( __m256i * p, __m256i a)
+		{
+			_mm256_store_si256( p, a);
+		}
+		static void stream( __m256i * p, __m256i a)
+		{
+			_mm256_stream_si256( p, a);
+		}
+		static void fence()
+		{
+			_mm_sfence();
+		}
+
+		// Masked load of whole dwords for 32 and 64 bit lanes, a copy of the lanes for the narrower ones
+		static __m256i load_partial( const __m256i * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= static_cast< std::ptrdiff_t>( 32 / sizeof(T)));
+			if ( sizeof(T) < 4)
+			{
+				return detail::load_lanes< T>( p, lo, hi, zero());
+			}
+			__m256i m = _mm256_and_si256( _mm256_loadu_si256( reinterpret_cast< const __m256i *>( detail::lower_byte_mask( 32, lo * sizeof(T)))),
+				_mm256_loadu_si256( reinterpret_cast< const __m256i *>( detail::upper_byte_mask( 32, ( 32 / sizeof(T) - hi) * sizeof(T)))));
+			return _mm256_maskload_epi32( reinterpret_cast< const int *>( p), m);
+		}
+
+		static __m256i mask_lower( __m256i a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < static_cast< std::ptrdiff_t>( 32 / sizeof(T)));
+			return _mm256_and_si256( a, _mm256_loadu_si256( reinterpret_cast< const __m256i *>( detail::lower_byte_mask( 32, lgap * sizeof(T)))));
+		}
+		static __m256i mask_upper( __m256i a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > - static_cast< std::ptrdiff_t>( 32 / sizeof(T)));
+			assert( ugap <= 0);
+			return _mm256_and_si256( a, _mm256_loadu_si256( reinterpret_cast< const __m256i *>( detail::upper_byte_mask( 32, - ugap * sizeof(T)))));
+		}
+		static __m256i mask_both( __m256i a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return mask_upper( mask_lower( a, lgap), ugap);
+		}
+	};
+#endif
+
+#if DU1SIMD_HAVE_AVX512BW
+	namespace detail {
+
+		inline __m512i avx512_widen_epi32( __m512i a)
+		{
+			__m512i s = _mm512_srai_epi32( a, 31);
+			return _mm512_add_epi64( _mm512_unpacklo_epi32( a, s), _mm512_unpackhi_epi32( a, s));
+		}
+
+		inline __m512i avx512_widen_epu32( __m512i a)
+		{
+			__m512i z = _mm512_setzero_si512();
+			return _mm512_add_epi64( _mm512_unpacklo_epi32( a, z), _mm512_unpackhi_epi32( a, z));
+		}
+
+		template< std::size_t n>
+		lane_mask avx512_equal( __m512i, __m512i)
+		{
+			static_assert( n > 1, "The 64 lanes of bytes do not fit a lane_mask!");
+			return 0;
+		}
+
+		template<>
+		inline lane_mask avx512_equal< 2>( __m512i a, __m512i b)
+		{
+			return static_cast< lane_mask>( _mm512_cmpeq_epi16_mask( a, b));
+		}
+
+		template<>
+		inline lane_mask avx512_equal< 4>( __m512i a, __m512i b)
+		{
+			return static_cast< lane_mask>( _mm512_cmpeq_epi32_mask( a, b));
+		}
+
+		template<>
+		inline lane_mask avx512_equal< 8>( __m512i a, __m512i b)
+		{
+			return static_cast< lane_mask>( _mm512_cmpeq_epi64_mask( a, b));
+		}
+
+		template<>
+		struct avx512_lanes< std::int8_t> {
+			typedef std::int64_t wide_type;
+
+			static __m512i broadcast( std::int8_t x)
+			{
+				return _mm512_set1_epi8( static_cast< char>( x));
+			}
+			static __m512i add( __m512i a, __m512i b)
+			{
+				return _mm512_add_epi8( a, b);
+			}
+			static __m512i sub( __m512i a, __m512i b)
+			{
+				return _mm512_sub_epi8( a, b);
+			}
+			static __m512i adds( __m512i a, __m512i b)
+			{
+				return _mm512_adds_epi8( a, b);
+			}
+			static __m512i subs( __m512i a, __m512i b)
+			{
+				return _mm512_subs_epi8( a, b);
+			}
+			static __m512i min( __m512i a, __m512i b)
+			{
+				return _mm512_min_epi8( a, b);
+			}
+			static __m512i max( __m512i a, __m512i b)
+			{
+				return _mm512_max_epi8( a, b);
+			}
+			static __m512i widen( __m512i a)
+			{
+				__m512i s = _mm512_sad_epu8( _mm512_xor_si512( a, _mm512_set1_epi8( static_cast< char>( 0x80))), _mm512_setzero_si512());
+				return _mm512_sub_epi64( s, _mm512_set1_epi64( 1024));
+			}
+		};
+
+		template<>
+		struct avx512_lanes< std::uint8_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m512i broadcast( std::uint8_t x)
+			{
+				return _mm512_set1_epi8( static_cast< char>( x));
+			}
+			static __m512i add( __m512i a, __m512i b)
+			{
+				return _mm512_add_epi8( a, b);
+			}
+			static __m512i sub( __m512i a, __m512i b)
+			{
+				return _mm512_sub_epi8( a, b);
+			}
+			static __m512i adds( __m512i a, __m512i b)
+			{
+				return _mm512_adds_epu8( a, b);
+			}
+			static __m512i subs( __m512i a, __m512i b)
+			{
+				return _mm512_subs_epu8( a, b);
+			}
+			static __m512i min( __m512i a, __m512i b)
+			{
+				return _mm512_min_epu8( a, b);
+			}
+			static __m512i max( __m512i a, __m512i b)
+			{
+				return _mm512_max_epu8( a, b);
+			}
+			static __m512i widen( __m512i a)
+			{
+				return _mm512_sad_epu8( a, _mm512_setzero_si512());
+			}
+		};
+
+		template<>
+		struct avx512_lanes< std::int16_t> {
+			typedef std::int64_t wide_type;
+
+			static __m512i broadcast( std::int16_t x)
+			{
+				return _mm512_set1_epi16( x);
+			}
+			static __m512i add( __m512i a, __m512i b)
+			{
+				return _mm512_add_epi16( a, b);
+			}
+			static __m512i sub( __m512i a, __m512i b)
+			{
+				return _mm512_sub_epi16( a, b);
+			}
+			static __m512i adds( __m512i a, __m512i b)
+			{
+				return _mm512_adds_epi16( a, b);
+			}
+			static __m512i subs( __m512i a, __m512i b)
+			{
+				return _mm512_subs_epi16( a, b);
+			}
+			static __m512i min( __m512i a, __m512i b)
+			{
+				return _mm512_min_epi16( a, b);
+			}
+			static __m512i max( __m512i a, __m512i b)
+			{
+				return _mm512_max_epi16( a, b);
+			}
+			static __m512i mul( __m512i a, __m512i b)
+			{
+				return _mm512_mullo_epi16( a, b);
+			}
+			static __m512i widen( __m512i a)
+			{
+				return avx512_widen_epi32( _mm512_madd_epi16( a, _mm512_set1_epi16( 1)));
+			}
+		};
+
+		template<>
+		struct avx512_lanes< std::uint16_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m512i broadcast( std::uint16_t x)
+			{
+				return _mm512_set1_epi16( static_cast< short>( x));
+			}
+			static __m512i add( __m512i a, __m512i b)
+			{
+				return _mm512_add_epi16( a, b);
+			}
+			static __m512i sub( __m512i a, __m512i b)
+			{
+				return _mm512_sub_epi16( a, b);
+			}
+			static __m512i adds( __m512i a, __m512i b)
+			{
+				return _mm512_adds_epu16( a, b);
+			}
+			static __m512i subs( __m512i a, __m512i b)
+			{
+				return _mm512_subs_epu16( a, b);
+			}
+			static __m512i min( __m512i a, __m512i b)
+			{
+				return _mm512_min_epu16( a, b);
+			}
+			static __m512i max( __m512i a, __m512i b)
+			{
+				return _mm512_max_epu16( a, b);
+			}
+			static __m512i mul( __m512i a, __m512i b)
+			{
+				return _mm512_mullo_epi16( a, b);
+			}
+			static __m512i widen( __m512i a)
+			{
+				__m512i m = _mm512_madd_epi16( _mm512_xor_si512( a, _mm512_set1_epi16( static_cast< short>( 0x8000))), _mm512_set1_epi16( 1));
+				return avx512_widen_epu32( _mm512_add_epi32( m, _mm512_set1_epi32( 65536)));
+			}
+		};
+
+		template<>
+		struct avx512_lanes< std::int32_t> {
+			typedef std::int64_t wide_type;
+
+			static __m512i broadcast( std::int32_t x)
+			{
+				return _mm512_set1_epi32( x);
+			}
+			static __m512i add( __m512i a, __m512i b)
+			{
+				return _mm512_add_epi32( a, b);
+			}
+			static __m512i sub( __m512i a, __m512i b)
+			{
+				return _mm512_sub_epi32( a, b);
+			}
+			static __m512i min( __m512i a, __m512i b)
+			{
+				return _mm512_min_epi32( a, b);
+			}
+			static __m512i max( __m512i a, __m512i b)
+			{
+				return _mm512_max_epi32( a, b);
+			}
+			static __m512i mul( __m512i a, __m512i b)
+			{
+				return _mm512_mullo_epi32( a, b);
+			}
+			static __m512i widen( __m512i a)
+			{
+				return avx512_widen_epi32( a);
+			}
+		};
+
+		template<>
+		struct avx512_lanes< std::uint32_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m512i broadcast( std::uint32_t x)
+			{
+				return _mm512_set1_epi32( static_cast< int>( x));
+			}
+			static __m512i add( __m512i a, __m512i b)
+			{
+				return _mm512_add_epi32( a, b);
+			}
+			static __m512i sub( __m512i a, __m512i b)
+			{
+				return _mm512_sub_epi32( a, b);
+			}
+			static __m512i min( __m512i a, __m512i b)
+			{
+				return _mm512_min_epu32( a, b);
+			}
+			static __m512i max( __m512i a, __m512i b)
+			{
+				return _mm512_max_epu32( a, b);
+			}
+			static __m512i mul( __m512i a, __m512i b)
+			{
+				return _mm512_mullo_epi32( a, b);
+			}
+			static __m512i widen( __m512i a)
+			{
+				return avx512_widen_epu32( a);
+			}
+		};
+
+		template<>
+		struct avx512_lanes< std::int64_t> {
+			typedef std::int64_t wide_type;
+
+			static __m512i broadcast( std::int64_t x)
+			{
+				return _mm512_set1_epi64( x);
+			}
+			static __m512i add( __m512i a, __m512i b)
+			{
+				return _mm512_add_epi64( a, b);
+			}
+			static __m512i sub( __m512i a, __m512i b)
+			{
+				return _mm512_sub_epi64( a, b);
+			}
+			static __m512i min( __m512i a, __m512i b)
+			{
+				return _mm512_min_epi64( a, b);
+			}
+			static __m512i max( __m512i a, __m512i b)
+			{
+				return _mm512_max_epi64( a, b);
+			}
+			static __m512i widen( __m512i a)
+			{
+				return a;
+			}
+		};
+
+		template<>
+		struct avx512_lanes< std::uint64_t> {
+			typedef std::uint64_t wide_type;
+
+			static __m512i broadcast( std::uint64_t x)
+			{
+				return _mm512_set1_epi64( static_cast< long long>( x));
+			}
+			static __m512i add( __m512i a, __m512i b)
+			{
+				return _mm512_add_epi64( a, b);
+			}
+			static __m512i sub( __m512i a, __m512i b)
+			{
+				return _mm512_sub_epi64( a, b);
+			}
+			static __m512i min( __m512i a, __m512i b)
+			{
+				return _mm512_min_epu64( a, b);
+			}
+			static __m512i max( __m512i a, __m512i b)
+			{
+				return _mm512_max_epu64( a, b);
+			}
+			static __m512i widen( __m512i a)
+			{
+				return a;
+			}
+		};
+	}
+
+	template< typename T>
+	struct simd< T, __m512i> {
+		static_assert( std::is_integral< T>::value, "Integer element type required!");
+
+		typedef detail::avx512_lanes< T> lanes;
+		typedef typename lanes::wide_type wide_type;
+
+		static __m512i broadcast( T x)
+		{
+			return lanes::broadcast( x);
+		}
+		static __m512i zero()
+		{
+			return _mm512_setzero_si512();
+		}
+		static __m512i add( __m512i a, __m512i b)
+		{
+			return lanes::add( a, b);
+		}
+		static __m512i sub( __m512i a, __m512i b)
+		{
+			return lanes::sub( a, b);
+		}
+		static __m512i adds( __m512i a, __m512i b)
+		{
+			return lanes::adds( a, b);
+		}
+		static __m512i subs( __m512i a, __m512i b)
+		{
+			return lanes::subs( a, b);
+		}
+		static __m512i mul( __m512i a, __m512i b)
+		{
+			return lanes::mul( a, b);
+		}
+		static __m512i min( __m512i a, __m512i b)
+		{
+			return lanes::min( a, b);
+		}
+		static __m512i max( __m512i a, __m512i b)
+		{
+			return lanes::max( a, b);
+		}
+		// Bit j set if lane j of a is less than (less or equal, equal to) lane j of b
+		static lane_mask cmp_lt( __m512i a, __m512i b)
+		{
+			return cmp_le( a, b) & ~ cmp_eq( a, b);
+		}
+		static lane_mask cmp_le( __m512i a, __m512i b)
+		{
+			return cmp_eq( lanes::min( a, b), a);
+		}
+		static lane_mask cmp_eq( __m512i a, __m512i b)
+		{
+			return detail::avx512_equal< sizeof(T)>( a, b);
+		}
+		static __m512i wide_add( __m512i acc, __m512i a)
+		{
+			return _mm512_add_epi64( acc, lanes::widen( a));
+		}
+		static wide_type wide_sum( __m512i acc)
+		{
+			// Folded by vector adds, the partial sums of 64-bit elements may wrap around
+			__m256i h = _mm256_add_epi64( _mm512_castsi512_si256( acc), _mm512_extracti64x4_epi64( acc, 1));
+			__m128i q = _mm_add_epi64( _mm256_castsi256_si128( h), _mm256_extracti128_si256( h, 1));
+			return simd< T, __m128i>::wide_sum( q);
+		}
+		static T sum( __m512i a)
+		{
+			return static_cast< T>( wide_sum( wide_add( zero(), a)));
+		}
+		static void store( __m512i * p, __m512i a)
+		{
+			_mm512_store_si512( p, a);
+		}
+		static void stream( __m512i * p, __m512i a)
+		{
+			_mm512_stream_si512( p, a);
+		}
+		static void fence()
+		{
+			_mm_sfence();
+		}
+
+		// Masked load of the bytes of the lanes
+		static __m512i load_partial( const __m512i * p, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			assert( lo >= 0);
+			assert( lo < hi);
+			assert( hi <= static_cast< std::ptrdiff_t>( 64 / sizeof(T)));
+			std::uint64_t ones = ~ std::uint64_t( 0);
+			__mmask64 m = ( ones << ( lo * sizeof(T))) & ( ones >> ( 64 - hi * sizeof(T)));
+			return _mm512_maskz_loadu_epi8( m, p);
+		}
+
+		static __m512i mask_lower( __m512i a, std::ptrdiff_t lgap)
+		{
+			assert( lgap >= 0);
+			assert( lgap < static_cast< std::ptrdiff_t>( 64 / sizeof(T)));
+			return _mm512_and_si512( a, _mm512_loadu_si512( detail::lower_byte_mask( 64, lgap * sizeof(T))));
+		}
+		static __m512i mask_upper( __m512i a, std::ptrdiff_t ugap)
+		{
+			assert( ugap > - static_cast< std::ptrdiff_t>( 64 / sizeof(T)));
+			assert( ugap <= 0);
+			return _mm512_and_si512( a, _mm512_loadu_si512( detail::upper_byte_mask( 64, - ugap * sizeof(T))));
+		}
+		static __m512i mask_both( __m512i a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+		{
+			return mask_upper( mask_lower( a, lgap), ugap);
+		}
+	};
+#endif
+};
+#endif // DU1SIMD_HAVE_SSE
+
+#endif // DU1SIMD_OPS_INT_HPP
@@ -0,0 +1,578 @@
+// du1simd_packed.hpp
+// Petr Kubát NPRG051 2013/2014
+
+//
+// Compressed columns of 32-bit integers
+//
+// packed_simd_vector< T, S> stores int32_t or uint32_t elements bit-packed in frames of frame_size =
+// 32 * k elements, k = lanes_of< T, S>. A column of values which need only b bits takes about b / 32 of
+// the memory of a simd_vector, so the kernels over it read fewer bytes from DRAM:
+//
+//	packed_simd_vector< std::uint32_t, __m256i> p( v.begin(), v.end());
+//	std::uint64_t total = du1simd::widening_sum( p);
+//
+// The layout is vertical: element r * k + j of a frame is lane j of row r of the frame, so the rows are
+// the consecutive blocks of S of the column. Lane j of the b packed blocks of a frame holds the b-bit
+// codes of lane j of its 32 rows one after another, all the lanes of a row are decoded at once by the
+// same shifts and masks, straight into a register:
+//
+//	row r = ( ( word[ r * b / 32] >> s) | ( word[ r * b / 32 + 1] << ( 32 - s))) & mask, s = r * b % 32
+//
+// Every frame has its own encoding, the one of the fewer bits:
+//
+//	packing::frame_of_reference	element = base + code, base is the minimum of the frame
+//	packing::delta			element = element k positions before + base + code, the row before the
+//					first one is the first element of the frame broadcast, base is the minimum
+//					of the differences, so sorted or slowly changing columns take few bits
+//
+// The arithmetic wraps around in 32 bits, so any column round-trips, a frame of full-range values just
+// takes 32 bits. The last frame is padded by repeating the last element.
+//
+// The kernels decode the frames row by row and consume the rows in the registers: reduce_sum,
+// widening_sum and count_if (the predicates of du1simd_filter.hpp) as over a simd_vector range, unpack()
+// writes the elements to a simd_vector. visit_blocks( f) calls f( block, lanes) for the decoded blocks
+// in order, lanes is k except for the last block. v[ i] decodes a single element, a delta frame decodes
+// up to the row of the element then.
+//
+// The integer carriers exist on x86 only (du1simd_ops_int.hpp), the header is empty on ARM.
+//
+
+#ifndef DU1SIMD_PACKED_HPP
+#define DU1SIMD_PACKED_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_ops_int.hpp"
+#include "du1simd_filter.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#if DU1SIMD_HAVE_SSE
+
+namespace du1simd {
+
+	enum class packing {
+		frame_of_reference,
+		delta
+	};
+
+	// Encoding of one frame of a packed_simd_vector
+	struct packed_frame {
+		// Offset of the packed blocks of the frame
+		std::size_t offset;
+		// Minimum of the elements or of the differences
+		std::uint32_t base;
+		// First element, the row before the first one of a delta frame
+		std::uint32_t seed;
+		// Bits per element, the frame has bits packed blocks
+		unsigned char bits;
+		packing encoding;
+	};
+
+	namespace detail {
+
+		// Shifts and bit operations of the 32-bit lanes of the integer carriers
+		template< typename S>
+		struct bit_lanes;
+
+		template<>
+		struct bit_lanes< __m128i> {
+			static __m128i shift_right( __m128i a, int n)
+			{
+				return _mm_srli_epi32( a, n);
+			}
+			static __m128i shift_left( __m128i a, int n)
+			{
+				return _mm_slli_epi32( a, n);
+			}
+			static __m128i bit_or( __m128i a, __m128i b)
+			{
+				return _mm_or_si128( a, b);
+			}
+			static __m128i bit_and( __m128i a, __m128i b)
+			{
+				return _mm_and_si128( a, b);
+			}
+		};
+
+#if DU1SIMD_HAVE_AVX2
+		template<>
+		struct bit_lanes< __m256i> {
+			static __m256i shift_right( __m256i a, int n)
+			{
+				return _mm256_srli_epi32( a, n);
+			}
+			static __m256i shift_left( __m256i a, int n)
+			{
+				return _mm256_slli_epi32( a, n);
+			}
+			static __m256i bit_or( __m256i a, __m256i b)
+			{
+				return _mm256_or_si256( a, b);
+			}
+			static __m256i bit_and( __m256i a, __m256i b)
+			{
+				return _mm256_and_si256( a, b);
+			}
+		};
+#endif
+
+#if DU1SIMD_HAVE_AVX512BW
+		// The zero-masked shifts compile to the plain ones, the unmasked intrinsics of GCC merge into an
+		// undefined register and trip -Wmaybe-uninitialized
+		template<>
+		struct bit_lanes< __m512i> {
+			static __m512i shift_right( __m512i a, int n)
+			{
+				return _mm512_maskz_srli_epi32( 0xFFFF, a, static_cast< unsigned>( n));
+			}
+			static __m512i shift_left( __m512i a, int n)
+			{
+				return _mm512_maskz_slli_epi32( 0xFFFF, a, static_cast< unsigned>( n));
+			}
+			static __m512i bit_or( __m512i a, __m512i b)
+			{
+				return _mm512_or_si512( a, b);
+			}
+			static __m512i bit_and( __m512i a, __m512i b)
+			{
+				return _mm512_and_si512( a, b);
+			}
+		};
+#endif
+
+		// Rows of a frame
+		const std::size_t packed_rows = 32;
+
+		// Number of bits of the largest code x
+		inline unsigned bit_width( std::uint64_t x)
+		{
+			unsigned b = 0;
+			for ( ; x != 0 && b < 32; x >>= 1)
+			{
+				++ b;
+			}
+			return b;
+		}
+
+		inline std::uint32_t code_mask( unsigned bits)
+		{
+			return bits == 32 ? 0xFFFFFFFFu : ( std::uint32_t( 1) << bits) - 1;
+		}
+
+		// Packs the codes of the 32 rows of k lanes at u to bits * k words at w, lane j of row r is u[ r * k + j]
+		inline void pack_codes( const std::uint32_t * u, std::size_t k, unsigned bits, std::uint32_t * w)
+		{
+			if ( bits == 0)
+			{
+				return;
+			}
+			std::fill( w, w + bits * k, 0u);
+			for ( std::size_t r = 0; r < packed_rows; ++ r)
+			{
+				std::size_t bit = r * bits;
+				std::size_t word = bit / 32;
+				unsigned s = static_cast< unsigned>( bit % 32);
+				for ( std::size_t j = 0; j < k; ++ j)
+				{
+					std::uint32_t c = u[ r * k + j];
+					w[ word * k + j] |= c << s;
+					if ( s + bits > 32)
+					{
+						w[ ( word + 1) * k + j] |= c >> ( 32 - s);
+					}
+				}
+			}
+		}
+
+		// Encodes the frame of 32 rows of k lanes at x (the last frame padded) to the words appended to w
+		template< typename T>
+		packed_frame encode_frame( const T * x, std::size_t k, std::vector< std::uint32_t> & w)
+		{
+			typedef typename std::conditional< std::is_signed< T>::value, std::int64_t, std::uint64_t>::type order_type;
+
+			const std::size_t n = packed_rows * k;
+
+			// Frame of reference
+			order_type lo = static_cast< order_type>( x[ 0]);
+			order_type hi = lo;
+			// Differences to the element k positions before
+			std::int64_t dlo = 0;
+			std::int64_t dhi = 0;
+			for ( std::size_t i = 0; i < n; ++ i)
+			{
+				order_type v = static_cast< order_type>( x[ i]);
+				lo = std::min( lo, v);
+				hi = std::max( hi, v);
+				std::int64_t d = static_cast< std::int64_t>( v) - static_cast< std::int64_t>( static_cast< order_type>( i < k ? x[ 0] : x[ i - k]));
+				dlo = std::min( dlo, d);
+				dhi = std::max( dhi, d);
+			}
+
+			packed_frame f;
+			f.offset = 0;
+			f.seed = static_cast< std::uint32_t>( x[ 0]);
+			unsigned bits_reference = bit_width( static_cast< std::uint64_t>( hi - lo));
+			unsigned bits_delta = bit_width( static_cast< std::uint64_t>( dhi - dlo));
+
+			std::vector< std::uint32_t> u( n);
+			if ( bits_delta < bits_reference)
+			{
+				f.encoding = packing::delta;
+				f.bits = static_cast< unsigned char>( bits_delta);
+				f.base = static_cast< std::uint32_t>( dlo);
+				for ( std::size_t i = 0; i < n; ++ i)
+				{
+					std::uint32_t before = static_cast< std::uint32_t>( i < k ? x[ 0] : x[ i - k]);
+					u[ i] = static_cast< std::uint32_t>( x[ i]) - before - f.base;
+				}
+			}
+			else
+			{
+				f.encoding = packing::frame_of_reference;
+				f.bits = static_cast< unsigned char>( bits_reference);
+				f.base = static_cast< std::uint32_t>( lo);
+				for ( std::size_t i = 0; i < n; ++ i)
+				{
+					u[ i] = static_cast< std::uint32_t>( x[ i]) - f.base;
+				}
+			}
+
+			std::size_t end = w.size();
+			w.resize( end + f.bits * k);
+			pack_codes( u.data(), k, f.bits, w.data() + end);
+			return f;
+		}
+
+		// The rows of a whole frame of B-bit codes, the bit width is a constant, so the words and the
+		// shifts of the rows are constants once the compiler unrolls the loop
+		template< unsigned B, bool delta, typename S, typename G>
+		void unpack_rows( const S * p, const S & base, const S & mask, S before, G & g)
+		{
+			typedef simd< std::uint32_t, S> simd_op;
+			typedef bit_lanes< S> bits_op;
+
+			for ( unsigned r = 0; r < packed_rows; ++ r)
+			{
+				const unsigned word = r * B / 32;
+				const unsigned s = r * B % 32;
+
+				S c = bits_op::shift_right( p[ word], static_cast< int>( s));
+				if ( s + B > 32)
+				{
+					c = bits_op::bit_or( c, bits_op::shift_left( p[ word + 1], static_cast< int>( 32 - s)));
+				}
+				S a = simd_op::add( bits_op::bit_and( c, mask), base);
+				if ( delta)
+				{
+					a = simd_op::add( a, before);
+					before = a;
+				}
+				g( a);
+			}
+		}
+
+		// Dispatches a whole frame of f.bits >= B bits to its unpack_rows
+		template< unsigned B>
+		struct unpack_frame {
+			template< typename S, typename G>
+			static void run( const S * p, const packed_frame & f, G & g)
+			{
+				typedef simd< std::uint32_t, S> simd_op;
+
+				if ( f.bits != B)
+				{
+					unpack_frame< B + 1>::run( p, f, g);
+					return;
+				}
+				const S base = simd_op::broadcast( f.base);
+				const S mask = simd_op::broadcast( code_mask( B));
+				if ( f.encoding == packing::delta)
+				{
+					unpack_rows< B, true>( p, base, mask, simd_op::broadcast( f.seed), g);
+				}
+				else
+				{
+					unpack_rows< B, false>( p, base, mask, base, g);
+				}
+			}
+		};
+
+		template<>
+		struct unpack_frame< 33> {
+			template< typename S, typename G>
+			static void run( const S *, const packed_frame &, G &)
+			{
+			}
+		};
+
+		// Calls g( row) for the first rows of the frame of blocks p in order
+		// A whole frame is decoded by the row loop of its constant bit width, a partial one by a generic loop
+		template< typename S, typename G>
+		void decode_rows( const S * p, const packed_frame & f, std::size_t rows, G & g)
+		{
+			if ( rows == packed_rows && f.bits != 0)
+			{
+				unpack_frame< 1>::run( p, f, g);
+				return;
+			}
+
+			typedef simd< std::uint32_t, S> simd_op;
+			typedef bit_lanes< S> bits_op;
+
+			const unsigned b = f.bits;
+			const S base = simd_op::broadcast( f.base);
+			S before = simd_op::broadcast( f.seed);
+
+			if ( b == 0)
+			{
+				for ( std::size_t r = 0; r < rows; ++ r)
+				{
+					S a = f.encoding == packing::delta ? simd_op::add( before, base) : base;
+					before = a;
+					g( a);
+				}
+				return;
+			}
+
+			const S mask = simd_op::broadcast( code_mask( b));
+			for ( std::size_t r = 0; r < rows; ++ r)
+			{
+				std::size_t bit = r * b;
+				std::size_t word = bit / 32;
+				int s = static_cast< int>( bit % 32);
+				S c = bits_op::shift_right( p[ word], s);
+				if ( s + b > 32)
+				{
+					c = bits_op::bit_or( c, bits_op::shift_left( p[ word + 1], 32 - s));
+				}
+				S a = simd_op::add( bits_op::bit_and( c, mask), base);
+				if ( f.encoding == packing::delta)
+				{
+					a = simd_op::add( a, before);
+					before = a;
+				}
+				g( a);
+			}
+		}
+	}
+};
+
+// Compressed column of int32_t or uint32_t elements in frames of 32 blocks of S, read-only
+template< typename T, typename S>
+class packed_simd_vector {
+	// Static check of type parameters
+	static_assert(std::is_integral<T>::value && sizeof(T) == 4, "int32_t or uint32_t elements required!");
+
+public:
+	typedef packed_simd_vector<T, S> self;
+
+	typedef T value_type;
+
+	// Elements per block
+	static DU1SIMD_CONSTEXPR const std::size_t lanes = du1simd::lanes_of<T, S>::value;
+
+	// Elements per frame
+	static DU1SIMD_CONSTEXPR const std::size_t frame_size = du1simd::detail::packed_rows * lanes;
+
+private:
+	simd_vector<std::uint32_t, S> words;
+	std::vector<du1simd::packed_frame> headers;
+	std::size_t content_size;
+
+	const S * frame_blocks(std::size_t i) const
+	{
+		return du1simd::to_address(words.begin().lower_block()) + headers[i].offset;
+	}
+
+public:
+	// Empty vector
+	packed_simd_vector() : content_size(0)
+	{
+	}
+
+	// Compresses the elements of [b, e)
+	template< typename U>
+	packed_simd_vector(simd_vector_iterator<U, S> b, simd_vector_iterator<U, S> e) : content_size(0)
+	{
+		static_assert(std::is_same<typename std::remove_const<U>::type, T>::value, "Incompatible element type!");
+
+		if (!(b < e))
+		{
+			return;
+		}
+		content_size = static_cast<std::size_t>(e - b);
+		const T * x = du1simd::to_address(b);
+
+		std::size_t n = (content_size + frame_size - 1) / frame_size;
+		std::vector<std::uint32_t> w;
+		std::vector<T> last(frame_size);
+		headers.reserve(n);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			const T * p = x + i * frame_size;
+			std::size_t m = std::min(frame_size, content_size - i * frame_size);
+			if (m < frame_size)
+			{
+				std::copy(p, p + m, last.begin());
+				std::fill(last.begin() + m, last.end(), p[m - 1]);
+				p = last.data();
+			}
+			std::size_t offset = w.size() / lanes;
+			headers.push_back(du1simd::detail::encode_frame(p, lanes, w));
+			headers.back().offset = offset;
+		}
+
+		words.resize(w.size(), du1simd::uninitialized);
+		std::copy(w.begin(), w.end(), words.begin());
+	}
+
+	// Compresses the elements of v
+	template< typename A>
+	explicit packed_simd_vector(const simd_vector<T, S, A>& v) : packed_simd_vector(v.begin(), v.end())
+	{
+	}
+
+	std::size_t size() const
+	{
+		return content_size;
+	}
+
+	bool empty() const
+	{
+		return content_size == 0;
+	}
+
+	// Number of frames
+	std::size_t frames() const
+	{
+		return headers.size();
+	}
+
+	// Encoding of the frame i
+	const du1simd::packed_frame& frame(std::size_t i) const
+	{
+		return headers[i];
+	}
+
+	// Bytes of the packed blocks and the frame headers
+	std::size_t packed_bytes() const
+	{
+		return words.size() * sizeof(std::uint32_t) + headers.size() * sizeof(du1simd::packed_frame);
+	}
+
+	// Calls f( block, lanes) for the decoded blocks in order, the lanes [lanes, k) of the last block are
+	// padding
+	template< typename F>
+	void visit_blocks(F f) const
+	{
+		std::size_t n = headers.size();
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			std::size_t m = std::min(frame_size, content_size - i * frame_size);
+			if (m == frame_size)
+			{
+				auto g = [&f](S a){
+					f(a, lanes);
+				};
+				du1simd::detail::decode_rows(frame_blocks(i), headers[i], du1simd::detail::packed_rows, g);
+				continue;
+			}
+			std::size_t rows = (m + lanes - 1) / lanes;
+			std::size_t last = m - (rows - 1) * lanes;
+			std::size_t r = 0;
+			auto g = [&f, &r, rows, last](S a){
+				f(a, ++r == rows ? last : lanes);
+			};
+			du1simd::detail::decode_rows(frame_blocks(i), headers[i], rows, g);
+		}
+	}
+
+	// Element i, decodes the rows of a delta frame up to the row of i
+	T operator[](std::size_t i) const
+	{
+		std::size_t r = (i % frame_size) / lanes + 1;
+		S a = du1simd::simd<std::uint32_t, S>::zero();
+		auto g = [&a](S x){ a = x; };
+		du1simd::detail::decode_rows(frame_blocks(i / frame_size), headers[i / frame_size], r, g);
+		T x[lanes];
+		std::memcpy(x, &a, sizeof(S));
+		return x[i % lanes];
+	}
+
+	// The elements decoded to a simd_vector
+	simd_vector<T, S> unpack() const
+	{
+		simd_vector<T, S> v(content_size, du1simd::uninitialized);
+		S * p = du1simd::to_address(v.begin().lower_block());
+		std::size_t i = 0;
+		visit_blocks([p, &i](S a, std::size_t){
+			p[i++] = a;
+		});
+		return v;
+	}
+};
+
+template< typename T, typename S>
+DU1SIMD_CONSTEXPR const std::size_t packed_simd_vector<T, S>::lanes;
+
+template< typename T, typename S>
+DU1SIMD_CONSTEXPR const std::size_t packed_simd_vector<T, S>::frame_size;
+
+namespace du1simd {
+
+	// Sum of the elements, wraps around like the arithmetic of T (reduce_sum of du1simd_reduce.hpp)
+	template< typename T, typename S>
+	T reduce_sum( const packed_simd_vector< T, S> & v)
+	{
+		DU1SIMD_INSTRUMENT_BYTES( "packed::reduce_sum", v.packed_bytes());
+
+		typedef simd< T, S> simd_op;
+		const std::ptrdiff_t k = packed_simd_vector< T, S>::lanes;
+
+		S acc = simd_op::zero();
+		v.visit_blocks( [ & acc, k]( S a, std::size_t lanes){
+			acc = simd_op::add( acc, lanes == static_cast< std::size_t>( k) ? a : simd_op::mask_upper( a, static_cast< std::ptrdiff_t>( lanes) - k));
+		});
+		return simd_op::sum( acc);
+	}
+
+	// Sum of the elements in 64-bit partial sums (widening_sum of du1simd_reduce.hpp)
+	template< typename T, typename S>
+	typename simd< T, S>::wide_type widening_sum( const packed_simd_vector< T, S> & v)
+	{
+		DU1SIMD_INSTRUMENT_BYTES( "packed::widening_sum", v.packed_bytes());
+
+		typedef simd< T, S> simd_op;
+		const std::ptrdiff_t k = packed_simd_vector< T, S>::lanes;
+
+		S acc = simd_op::zero();
+		v.visit_blocks( [ & acc, k]( S a, std::size_t lanes){
+			acc = simd_op::wide_add( acc, lanes == static_cast< std::size_t>( k) ? a : simd_op::mask_upper( a, static_cast< std::ptrdiff_t>( lanes) - k));
+		});
+		return simd_op::wide_sum( acc);
+	}
+
+	// Number of the elements pred holds for (count_if of du1simd_filter.hpp)
+	template< typename T, typename S, typename P>
+	std::size_t count_if( const packed_simd_vector< T, S> & v, P pred)
+	{
+		DU1SIMD_INSTRUMENT_BYTES( "packed::count_if", v.packed_bytes());
+
+		std::size_t n = 0;
+		v.visit_blocks( [ & n, & pred]( S a, std::size_t lanes){
+			n += detail::popcount( pred( a) & detail::lane_range( 0, static_cast< std::ptrdiff_t>( lanes)));
+		});
+		return n;
+	}
+};
+
+#endif // DU1SIMD_HAVE_SSE
+
+#endif // DU1SIMD_PACKED_HPP
@@ -0,0 +1,344 @@
+// du1simd_parallel.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Multi-threaded kernels over simd_vector ranges
+//
+// du1simd::thread_pool is a fixed set of worker threads, each owning a task deque. A worker takes its
+// own tasks from the back and, when it runs out of them, steals from the front of the other deques.
+// The thread calling parallel_for() takes part in the work as well, so a pool of n threads starts
+// n - 1 workers.
+//
+// The parallel reductions split the range into chunks of a fixed number of elements, counted from the
+// simd block containing the first element. The inner chunk boundaries are therefore block boundaries
+// and only the first and the last chunk need masking. The chunk partials are combined pairwise in
+// chunk order, so the result depends on the range and the chunk size only, never on the number of
+// threads or on the order in which the chunks were finished. With compensated_summation
+// (du1simd_reduce.hpp) the chunk partials keep their rounding errors and are combined with them.
+//
+// parallel_copy copies a range (or a whole vector) chunk by chunk, a copy of a large vector is made by
+// all the threads of the pool and its pages are first touched by them.
+//
+// The reductions only read the range, several of them may run over the const_iterator range of one const
+// vector at the same time.
+//
+
+#ifndef DU1SIMD_PARALLEL_HPP
+#define DU1SIMD_PARALLEL_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_reduce.hpp"
+#include "du1simd_algorithm.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <type_traits>
+
+namespace du1simd {
+
+	class thread_pool {
+	public:
+		typedef std::function< void()> task;
+
+		// Number of threads including the calling one, 0 means std::thread::hardware_concurrency()
+		explicit thread_pool( std::size_t threads = 0);
+
+		~thread_pool();
+
+		std::size_t size() const
+		{
+			return workers_.size() + 1;
+		}
+
+		// Calls f( i) for every i in [0, count) and waits until all calls finished
+		// The first exception thrown by f is rethrown in the calling thread
+		template< typename F>
+		void parallel_for( std::size_t count, F f)
+		{
+			if ( count == 0)
+			{
+				return;
+			}
+			if ( workers_.empty() || count == 1)
+			{
+				for ( std::size_t i = 0; i < count; ++ i)
+				{
+					f( i);
+				}
+				return;
+			}
+
+			std::atomic< std::size_t> pending( count);
+			std::exception_ptr error;
+			std::mutex error_lock;
+
+			std::vector< task> tasks;
+			tasks.reserve( count);
+			for ( std::size_t i = 0; i < count; ++ i)
+			{
+				tasks.push_back( [ & f, & pending, & error, & error_lock, i](){
+					try
+					{
+						f( i);
+					}
+					catch ( ...)
+					{
+						std::lock_guard< std::mutex> lock( error_lock);
+						if ( ! error)
+						{
+							error = std::current_exception();
+						}
+					}
+					-- pending;
+				});
+			}
+
+			submit( tasks);
+			wait_for( pending);
+
+			if ( error)
+			{
+				std::rethrow_exception( error);
+			}
+		}
+
+	private:
+		struct task_queue {
+			std::mutex lock;
+			std::deque< task> tasks;
+		};
+
+		// Distributes the tasks over the worker queues in contiguous groups
+		void submit( std::vector< task> & tasks);
+
+		// Runs queued tasks until the counter drops to zero
+		void wait_for( const std::atomic< std::size_t> & pending);
+
+		// Runs one task, taken from the back of the home queue or stolen from the front of another one
+		bool try_run_one( std::size_t home);
+
+		void worker_loop( std::size_t index);
+
+		std::vector< std::unique_ptr< task_queue>> queues_;
+		std::vector< std::thread> workers_;
+		std::atomic< std::size_t> queued_;
+		std::mutex sleep_lock_;
+		std::condition_variable wake_;
+		bool stop_;
+
+		thread_pool( const thread_pool &);
+		thread_pool & operator=( const thread_pool &);
+	};
+
+	// Process-wide pool with one thread per hardware thread
+	thread_pool & default_pool();
+
+	// Elements per chunk of the parallel kernels (rounded up to a multiple of the block size)
+	const std::size_t default_chunk_size = 1 << 20;
+
+	namespace detail {
+
+		// Pairwise combination of partials[ 0, n) in index order
+		template< typename R, typename C>
+		R combine_pairwise( std::vector< R> & partials, C combine)
+		{
+			std::size_t n = partials.size();
+			for ( std::size_t w = 1; w < n; w *= 2)
+			{
+				for ( std::size_t i = 0; i + w < n; i += 2 * w)
+				{
+					partials[ i] = combine( partials[ i], partials[ i + w]);
+				}
+			}
+			return partials[ 0];
+		}
+	}
+
+	namespace detail {
+
+		// Split of [b, e) into chunks of chunk_size elements counted from the block containing b
+		template< typename T, typename S>
+		struct chunking {
+			typedef simd_vector_iterator< T, S> iterator;
+
+			chunking( iterator b, iterator e, std::size_t chunk_size) : b_( b), e_( e), count_( 0)
+			{
+				const std::size_t lanes = lanes_of< T, S>::value;
+
+				chunk_ = static_cast< std::ptrdiff_t>( round_up< lanes>( chunk_size));
+				if ( chunk_ == 0)
+				{
+					chunk_ = static_cast< std::ptrdiff_t>( lanes);
+				}
+				if ( b < e)
+				{
+					std::ptrdiff_t lead = b.lower_offset();
+					origin_ = b - lead;
+					count_ = static_cast< std::size_t>( ( ( e - b) + lead + chunk_ - 1) / chunk_);
+				}
+			}
+
+			std::size_t count() const
+			{
+				return count_;
+			}
+			iterator begin( std::size_t i) const
+			{
+				return ( i == 0) ? b_ : origin_ + static_cast< std::ptrdiff_t>( i) * chunk_;
+			}
+			iterator end( std::size_t i) const
+			{
+				return ( i + 1 == count_) ? e_ : origin_ + static_cast< std::ptrdiff_t>( i + 1) * chunk_;
+			}
+		private:
+			iterator b_, e_, origin_;
+			std::ptrdiff_t chunk_;
+			std::size_t count_;
+		};
+	}
+
+	// Calls f( chunk_begin, chunk_end) for the block-aligned chunks of [b, e) on the pool
+	// The chunks are split exactly as by parallel_reduce and the pool hands out the chunk indices in the
+	// same way for equal ranges, so a chunk is usually processed by the thread which first touched it
+	template< typename T, typename S, typename F>
+	void parallel_for_chunks( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, F f,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		detail::chunking< T, S> chunks( b, e, chunk_size);
+		pool.parallel_for( chunks.count(), [ & chunks, & f]( std::size_t i){
+			f( chunks.begin( i), chunks.end( i));
+		});
+	}
+
+	// Splits [b, e) into block-aligned chunks, computes kernel( chunk_begin, chunk_end) for each chunk
+	// on the pool and combines the results pairwise in chunk order with combine( R, R)
+	template< typename R, typename T, typename S, typename K, typename C>
+	R parallel_reduce( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, R identity, K kernel, C combine,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		detail::chunking< T, S> chunks( b, e, chunk_size);
+		if ( chunks.count() == 0)
+		{
+			return identity;
+		}
+
+		std::vector< R> partials( chunks.count(), identity);
+		pool.parallel_for( chunks.count(), [ & partials, & kernel, & chunks]( std::size_t i){
+			partials[ i] = kernel( chunks.begin( i), chunks.end( i));
+		});
+
+		return detail::combine_pairwise( partials, combine);
+	}
+
+	// Assigns value to the elements in [b, e) chunk by chunk on the pool
+	// Used as the parallel first touch of vectors allocated uninitialized (page_allocator), so that
+	// the pages are placed close to the threads which process them later
+	template< typename T, typename S>
+	void parallel_fill( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, const T & value,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "parallel_fill", S, b, e, 1);
+
+		parallel_for_chunks( b, e, [ & value]( simd_vector_iterator< T, S> cb, simd_vector_iterator< T, S> ce){
+			std::fill( cb, ce, value);
+		}, pool, chunk_size);
+	}
+
+	// Parallel sum of the elements in [b, e) with N accumulators of the summation policy Q per chunk, visited
+	// by the policy P
+	template< std::size_t N, typename P = sequential_traversal, typename Q = plain_summation, typename T, typename S>
+	typename std::remove_const< T>::type parallel_reduce_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "parallel_reduce_sum", S, b, e, 1);
+
+		typedef typename Q::template accumulator< typename std::remove_const< T>::type, S> policy;
+		typedef typename policy::partial partial;
+
+		return policy::value( parallel_reduce( b, e, policy::reduce( policy::zero()),
+			[]( simd_vector_iterator< T, S> cb, simd_vector_iterator< T, S> ce){
+				DU1SIMD_INSTRUMENT_RANGE( "reduce_sum", S, cb, ce, 1);
+				detail::identity< S> f;
+				return detail::reduce_range< N, P, Q>( cb, ce, f);
+			},
+			[]( partial x, partial y){ return policy::merge( x, y); },
+			pool, chunk_size));
+	}
+
+	template< typename T, typename S>
+	typename std::remove_const< T>::type parallel_reduce_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		return parallel_reduce_sum< default_accumulators>( b, e, pool, chunk_size);
+	}
+
+	// Parallel sum of f applied block-wise to the elements in [b, e), see transform_reduce_sum
+	template< std::size_t N, typename P = sequential_traversal, typename Q = plain_summation, typename T, typename S, typename F>
+	typename std::remove_const< T>::type parallel_transform_reduce_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, F f,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "parallel_transform_reduce_sum", S, b, e, 1);
+
+		typedef typename Q::template accumulator< typename std::remove_const< T>::type, S> policy;
+		typedef typename policy::partial partial;
+
+		return policy::value( parallel_reduce( b, e, policy::reduce( policy::zero()),
+			[ & f]( simd_vector_iterator< T, S> cb, simd_vector_iterator< T, S> ce){
+				DU1SIMD_INSTRUMENT_RANGE( "transform_reduce_sum", S, cb, ce, 1);
+				return detail::reduce_range< N, P, Q>( cb, ce, f);
+			},
+			[]( partial x, partial y){ return policy::merge( x, y); },
+			pool, chunk_size));
+	}
+
+	template< typename T, typename S, typename F>
+	typename std::remove_const< T>::type parallel_transform_reduce_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, F f,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		return parallel_transform_reduce_sum< default_accumulators>( b, e, f, pool, chunk_size);
+	}
+
+	// Copies [b, e) to the range starting at d chunk by chunk on the pool and returns the end of the output
+	// The chunks are copied by du1simd::copy, all of them by non-temporal stores if the whole output takes
+	// at least threshold bytes
+	template< typename U, typename T, typename S>
+	simd_vector_iterator< T, S> parallel_copy( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e, simd_vector_iterator< T, S> d,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size, std::size_t threshold = default_streaming_threshold)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "parallel_copy", S, b, e, 2);
+
+		if ( ! ( b < e))
+		{
+			return d;
+		}
+		std::size_t chunk_threshold = ( static_cast< std::size_t>( e - b) * sizeof(T) >= threshold) ? 0 : SIZE_MAX;
+		parallel_for_chunks( b, e, [ b, d, chunk_threshold]( simd_vector_iterator< U, S> cb, simd_vector_iterator< U, S> ce){
+			du1simd::copy( cb, ce, d + ( cb - b), chunk_threshold);
+		}, pool, chunk_size);
+		return d + ( e - b);
+	}
+
+	// Copy of v made by parallel_copy, the pages of the copy are first touched by the threads of the pool
+	template< typename T, typename S, typename A>
+	simd_vector< T, S, A> parallel_copy( const simd_vector< T, S, A> & v,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		simd_vector< T, S, A> r( v.size(), uninitialized, std::allocator_traits< A>::select_on_container_copy_construction( v.get_allocator()));
+		parallel_copy( v.begin(), v.end(), r.begin(), pool, chunk_size);
+		return r;
+	}
+};
+
+#endif // DU1SIMD_PARALLEL_HPP
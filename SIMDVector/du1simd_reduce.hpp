@@ -0,0 +1,436 @@
+// du1simd_reduce.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Reduction kernels over simd_vector ranges
+//
+// du1simd::reduce_sum< N>( b, e) sums the elements in [b, e) using N independent accumulators, so that
+// N additions are in flight and the loop is bound by the throughput of the adder instead of its latency.
+// The accumulators are combined pairwise at the end (acc[0] += acc[1], acc[2] += acc[3], ... then
+// acc[0] += acc[2], ...), so the order of the additions depends only on the range, never on the machine.
+//
+// du1simd::transform_reduce_sum< N>( b, e, f) sums f( block) instead, f maps a carrier to a carrier
+// (e.g. squares the lanes for a sum of squares).
+//
+// du1simd::widening_sum< N>( b, e) sums integer elements into 64-bit lanes (simd::wide_add), so the sum
+// of e.g. uint8_t elements does not wrap around at 256.
+//
+// The range boundaries need not be aligned to the simd blocks. The range is divided by du1simd::split
+// (du1simd_split.hpp), the whole blocks are summed by an unmasked loop and the partial first and last
+// blocks are read by load_partial, so no element outside of the range is read.
+//
+// reduce_sum< N, P> and transform_reduce_sum< N, P> visit the full blocks by the traversal policy P
+// (du1simd_traversal.hpp), e.g. prefetch_traversal for ranges much larger than the last level cache. The
+// policy does not change the result.
+//
+// The summation policy Q of reduce_sum< N, P, Q> and transform_reduce_sum< N, P, Q> decides what an
+// accumulator keeps. du1simd::plain_summation (the default) keeps the sum of its lanes only, the rounding
+// error of a float lane then grows with the number of the blocks it summed, i.e. with the length of the
+// range. du1simd::compensated_summation keeps the rounding error of every addition in a second carrier
+// (Kahan-Babuska summation computed by the branch-free two-sum of Knuth), the lanes and the accumulators
+// are combined with their errors as well. After every addition the error is folded back into the sum (fast
+// two-sum), so it stays below an ulp of the sum and the pair keeps about twice the bits of T even after the
+// elements fell below half an ulp of the sum; the error of the result is a few ulp regardless of the length
+// of the range. It takes nine additions instead of one, the kernel stays bound by the memory bandwidth for
+// ranges outside of the caches. The compensation is removed by value-unsafe optimizations (-ffast-math,
+// /fp:fast), compile the callers without them.
+//
+//	float s = du1simd::reduce_sum< 8, du1simd::sequential_traversal, du1simd::compensated_summation>( b, e);
+//
+// The kernels only read the range, so they accept the const_iterator of a const vector as well, the
+// result type is the element type without const.
+//
+
+#ifndef DU1SIMD_REDUCE_HPP
+#define DU1SIMD_REDUCE_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_split.hpp"
+#include "du1simd_traversal.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace du1simd {
+
+	// Default number of accumulators, enough to cover the add latency on current x86 cores
+	const std::size_t default_accumulators = 8;
+
+	// Sum of floating-point values kept with the rounding error of its additions, sum + error is the value
+	template< typename T>
+	struct compensated {
+		T sum;
+		T error;
+
+		T value() const
+		{
+			return sum + error;
+		}
+	};
+
+	namespace detail {
+
+		// s + x as s, the rounding error of the addition is added to e (two-sum of Knuth, no comparison
+		// of the magnitudes, exact unless the addition overflows), S is a carrier or T itself
+		template< typename T, typename S>
+		void two_sum( S & s, S & e, S x)
+		{
+			typedef simd< T, S> simd_op;
+
+			S t = simd_op::add( s, x);
+			S z = simd_op::sub( t, s);
+			S d = simd_op::add( simd_op::sub( s, simd_op::sub( t, z)), simd_op::sub( x, z));
+			s = t;
+			e = simd_op::add( e, d);
+		}
+
+		// s + e as s and the part of it which does not fit into s as e (fast two-sum of Dekker, exact while s
+		// is not smaller than e in magnitude, which fails only right after a cancellation of s)
+		// Keeps e within an ulp of s, otherwise e would be a plain sum of the errors and stall as well once
+		// the elements are below half an ulp of s
+		template< typename T, typename S>
+		void renormalize( S & s, S & e)
+		{
+			typedef simd< T, S> simd_op;
+
+			S t = simd_op::add( s, e);
+			e = simd_op::sub( e, simd_op::sub( t, s));
+			s = t;
+		}
+	}
+
+	// Summation policy keeping the sum only, an accumulator is one carrier
+	struct plain_summation {
+		template< typename T, typename S>
+		struct accumulator {
+			typedef simd< T, S> simd_op;
+
+			// Lanes of an accumulator and the result of a range
+			typedef S state;
+			typedef T partial;
+
+			static state zero()
+			{
+				return simd_op::zero();
+			}
+			static void add( state & a, S x)
+			{
+				a = simd_op::add( a, x);
+			}
+			static void combine( state & a, const state & b)
+			{
+				a = simd_op::add( a, b);
+			}
+			static partial reduce( const state & a)
+			{
+				return simd_op::sum( a);
+			}
+			static partial merge( partial x, partial y)
+			{
+				return x + y;
+			}
+			static T value( partial x)
+			{
+				return x;
+			}
+		};
+	};
+
+	// Kahan-Babuska summation policy, an accumulator is a carrier of sums and a carrier of their errors
+	struct compensated_summation {
+		template< typename T, typename S>
+		struct accumulator {
+			static_assert( std::is_floating_point< T>::value, "Compensated summation of floating-point elements only!");
+
+			typedef simd< T, S> simd_op;
+
+			struct state {
+				S sum;
+				S error;
+			};
+			typedef compensated< T> partial;
+
+			static state zero()
+			{
+				state a = { simd_op::zero(), simd_op::zero() };
+				return a;
+			}
+			static void add( state & a, S x)
+			{
+				detail::two_sum< T>( a.sum, a.error, x);
+				detail::renormalize< T>( a.sum, a.error);
+			}
+			static void combine( state & a, const state & b)
+			{
+				detail::two_sum< T>( a.sum, a.error, b.sum);
+				a.error = simd_op::add( a.error, b.error);
+				detail::renormalize< T>( a.sum, a.error);
+			}
+			// The lanes are combined in lane order
+			static partial reduce( const state & a)
+			{
+				const std::size_t k = lanes_of< T, S>::value;
+
+				T s[ k], e[ k];
+				std::memcpy( s, & a.sum, sizeof( s));
+				std::memcpy( e, & a.error, sizeof( e));
+
+				partial r = { s[ 0], e[ 0] };
+				for ( std::size_t j = 1; j < k; ++ j)
+				{
+					partial x = { s[ j], e[ j] };
+					r = merge( r, x);
+				}
+				return r;
+			}
+			static partial merge( partial x, partial y)
+			{
+				detail::two_sum< T, T>( x.sum, x.error, y.sum);
+				x.error = x.error + y.error;
+				detail::renormalize< T, T>( x.sum, x.error);
+				return x;
+			}
+			static T value( partial x)
+			{
+				return x.value();
+			}
+		};
+	};
+
+	namespace detail {
+
+		// Compile-time unrolled operations on an array of N accumulators of the summation policy Q
+		template< typename T, typename S, std::size_t N, typename Q = plain_summation>
+		struct accumulators {
+			typedef typename Q::template accumulator< T, S> policy;
+			typedef typename policy::state state;
+
+			static void zero( state * acc)
+			{
+				accumulators< T, S, N - 1, Q>::zero( acc);
+				acc[ N - 1] = policy::zero();
+			}
+
+			// acc[ i] += f( p[ i]) for i in [0, N)
+			template< typename F>
+			static void add( state * acc, const S * p, F & f)
+			{
+				accumulators< T, S, N - 1, Q>::add( acc, p, f);
+				policy::add( acc[ N - 1], f( p[ N - 1]));
+			}
+
+			// Pairwise combination of the accumulators into acc[ 0]
+			static state combine( state * acc)
+			{
+				for ( std::size_t w = 1; w < N; w *= 2)
+				{
+					for ( std::size_t i = 0; i + w < N; i += 2 * w)
+					{
+						policy::combine( acc[ i], acc[ i + w]);
+					}
+				}
+				return acc[ 0];
+			}
+		};
+
+		template< typename T, typename S, typename Q>
+		struct accumulators< T, S, 0, Q> {
+			template< typename U>
+			static void zero( U *) { }
+			template< typename U, typename F>
+			static void add( U *, const S *, F &) { }
+		};
+
+		// Identity block transformation
+		template< typename S>
+		struct identity {
+			S operator()( S a) const
+			{
+				return a;
+			}
+		};
+
+		// f( a) with the lanes outside of [lo, hi) cleared, a is a partial block loaded by load_partial
+		template< typename T, typename S, typename F>
+		S edge_block( F & f, S a, std::ptrdiff_t lo, std::ptrdiff_t hi)
+		{
+			const std::ptrdiff_t k = lanes_of< T, S>::value;
+			return simd< T, S>::mask_both( f( a), lo, hi - k);
+		}
+
+		// The lanes outside of the range are already zero
+		template< typename T, typename S>
+		S edge_block( identity< S> &, S a, std::ptrdiff_t, std::ptrdiff_t)
+		{
+			return a;
+		}
+
+		// Sum of f applied to the full blocks [p, p + n) visited by the traversal policy P, returned as an
+		// accumulator of the summation policy Q
+		template< std::size_t N, typename P, typename Q, typename T, typename S, typename F>
+		typename Q::template accumulator< T, S>::state sum_blocks( const S * p, std::ptrdiff_t n, F & f)
+		{
+			static_assert( N > 0, "At least one accumulator is required!");
+
+			typedef accumulators< T, S, N, Q> acc_type;
+
+			typename acc_type::state acc[ N];
+			acc_type::zero( acc);
+
+			const std::ptrdiff_t full = n - n % static_cast< std::ptrdiff_t>( N);
+			auto run = [ & acc, & f]( const S * q, std::ptrdiff_t m) {
+				for ( std::ptrdiff_t i = 0; i < m; i += N)
+				{
+					acc_type::add( acc, q + i, f);
+				}
+			};
+			P::visit( p, full, static_cast< std::ptrdiff_t>( N), run);
+
+			std::ptrdiff_t i = full;
+			for ( std::size_t j = 0; i < n; ++ i, ++ j)
+			{
+				acc_type::policy::add( acc[ j], f( p[ i]));
+			}
+
+			return acc_type::combine( acc);
+		}
+
+		// Sum of f( block) over the blocks of the split range as a partial of the summation policy Q
+		template< std::size_t N, typename P, typename Q, typename T, typename S, typename F>
+		typename Q::template accumulator< typename std::remove_const< T>::type, S>::partial reduce_split(
+			const block_split< T, S> & s, F & f)
+		{
+			typedef typename std::remove_const< T>::type value_type;
+			typedef simd< value_type, S> simd_op;
+			typedef typename Q::template accumulator< value_type, S> policy;
+
+			S first = s.has_head() ? edge_block< value_type>( f, load_head( s), s.head_lo, s.head_hi) : simd_op::zero();
+			typename policy::state body = sum_blocks< N, P, Q, value_type>( s.body_begin, s.blocks(), f);
+			S last = s.has_tail() ? edge_block< value_type>( f, load_tail( s), 0, s.tail_hi) : simd_op::zero();
+
+			policy::add( body, first);
+			policy::add( body, last);
+			return policy::reduce( body);
+		}
+
+		// Sum of f( block) over the blocks covering [b, e) as a partial of the summation policy Q, see
+		// transform_reduce_sum
+		template< std::size_t N, typename P, typename Q, typename T, typename S, typename F>
+		typename Q::template accumulator< typename std::remove_const< T>::type, S>::partial reduce_range(
+			simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, F & f)
+		{
+			return reduce_split< N, P, Q>( split( b, e), f);
+		}
+	}
+
+	// Sum of f( block) over the blocks covering [b, e) computed with N independent accumulators
+	// f maps a carrier to a carrier, the elements outside of the range are masked after f was applied
+	// The full blocks are visited by the traversal policy P (du1simd_traversal.hpp), the accumulators
+	// are kept by the summation policy Q
+	template< std::size_t N, typename P = sequential_traversal, typename Q = plain_summation, typename T, typename S, typename F>
+	typename std::remove_const< T>::type transform_reduce_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, F f)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "transform_reduce_sum", S, b, e, 1);
+		return Q::template accumulator< typename std::remove_const< T>::type, S>::value( detail::reduce_range< N, P, Q>( b, e, f));
+	}
+
+	template< typename T, typename S, typename F>
+	typename std::remove_const< T>::type transform_reduce_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e, F f)
+	{
+		return transform_reduce_sum< default_accumulators>( b, e, f);
+	}
+
+	// Sum of the elements in [b, e) computed with N independent accumulators of the summation policy Q,
+	// visited by the policy P
+	template< std::size_t N, typename P = sequential_traversal, typename Q = plain_summation, typename T, typename S>
+	typename std::remove_const< T>::type reduce_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "reduce_sum", S, b, e, 1);
+		detail::identity< S> f;
+		return Q::template accumulator< typename std::remove_const< T>::type, S>::value( detail::reduce_range< N, P, Q>( b, e, f));
+	}
+
+	// Sum of the elements in [b, e) with the default number of accumulators
+	template< typename T, typename S>
+	typename std::remove_const< T>::type reduce_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e)
+	{
+		return reduce_sum< default_accumulators>( b, e);
+	}
+
+	// Sum of the integer elements in [b, e) in 64-bit partial sums computed with N independent accumulators
+	// Unlike reduce_sum the result does not wrap around in T (integer carriers of du1simd_ops_int.hpp)
+	template< std::size_t N, typename T, typename S>
+	typename simd< typename std::remove_const< T>::type, S>::wide_type widening_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e)
+	{
+		static_assert( N > 0, "At least one accumulator is required!");
+
+		DU1SIMD_INSTRUMENT_RANGE( "widening_sum", S, b, e, 1);
+
+		typedef simd< typename std::remove_const< T>::type, S> simd_op;
+		typedef typename simd_op::wide_type wide_type;
+
+		block_split< T, S> s = split( b, e);
+
+		S acc[ N];
+		for ( std::size_t j = 0; j < N; ++ j)
+		{
+			acc[ j] = simd_op::zero();
+		}
+		if ( s.has_head())
+		{
+			acc[ 0] = simd_op::wide_add( acc[ 0], load_head( s));
+		}
+
+		const S * p = s.body_begin;
+		std::ptrdiff_t n = s.blocks();
+
+		std::ptrdiff_t i = 0;
+		for ( ; i + static_cast< std::ptrdiff_t>( N) <= n; i += N)
+		{
+			for ( std::size_t j = 0; j < N; ++ j)
+			{
+				acc[ j] = simd_op::wide_add( acc[ j], p[ i + j]);
+			}
+		}
+		for ( std::size_t j = 0; i < n; ++ i, ++ j)
+		{
+			acc[ j] = simd_op::wide_add( acc[ j], p[ i]);
+		}
+
+		if ( s.has_tail())
+		{
+			acc[ N - 1] = simd_op::wide_add( acc[ N - 1], load_tail( s));
+		}
+
+		wide_type r = 0;
+		for ( std::size_t j = 0; j < N; ++ j)
+		{
+			r += simd_op::wide_sum( acc[ j]);
+		}
+		return r;
+	}
+
+	// Widening sum of the elements in [b, e) with the default number of accumulators
+	template< typename T, typename S>
+	typename simd< typename std::remove_const< T>::type, S>::wide_type widening_sum( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e)
+	{
+		return widening_sum< default_accumulators>( b, e);
+	}
+
+	// Kernel of du1simd::dispatch summing the floats in [b, e) of a buffer of any alignment, no element
+	// outside of the range is read; compiled for the wider levels by their units (du1simd_dispatch.hpp)
+	template< typename simd_carrier_type>
+	struct reduce_sum_kernel {
+		static float run( const float * b, const float * e)
+		{
+			detail::identity< simd_carrier_type> f;
+			return plain_summation::accumulator< float, simd_carrier_type>::value(
+				detail::reduce_split< default_accumulators, sequential_traversal, plain_summation>( split< simd_carrier_type>( b, e), f));
+		}
+	};
+};
+
+#endif // DU1SIMD_REDUCE_HPP
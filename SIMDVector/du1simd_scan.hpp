@@ -0,0 +1,355 @@
+// du1simd_scan.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Prefix sum (scan) kernels over simd_vector ranges
+//
+//	inclusive_scan( b, e, d, init)		d[ i] = init + b[ 0] + ... + b[ i]
+//	exclusive_scan( b, e, d, init)		d[ i] = init + b[ 0] + ... + b[ i - 1]
+//	parallel_inclusive_scan( b, e, d, init, pool, chunk_size)
+//	parallel_exclusive_scan( b, e, d, init, pool, chunk_size)
+//
+// The output range starts at d, which may be b itself (in-place scan), the kernels return its end.
+//
+// The blocks are written by du1simd::transform (du1simd_algorithm.hpp), a block is scanned in the
+// registers by log2( k) steps a = a + ( a shifted up by 1, 2, 4 ... lanes) and the carry, the running
+// total broadcast to all lanes, is added to it. The carry chain is a single add per block, the total of
+// the block is broadcast from its last lane off the chain. The lane shifts are byte shifts on SSE2,
+// alignr across the 128-bit halves on AVX2, valignd on AVX-512 and ext on NEON and SVE. The carriers
+// without them (the __m256 carriers in a translation unit without AVX2, the 8 and 16-bit lanes of
+// __m512i) scan the lanes of a block one by one.
+//
+// The parallel scans are two-pass: the chunks of [b, e) are summed on the pool, the offsets of the
+// chunks are the exclusive scan of these sums and then every chunk is scanned from its offset on the
+// pool. The input is read twice, the output written once. The chunks are split as by parallel_reduce
+// (du1simd_parallel.hpp), so the result depends on the chunk size but never on the number of threads.
+//
+// The integer scans wrap around like the arithmetic of T. The float scans add in a different order than
+// a scalar loop, within a block as a tree and across the chunks of the parallel scans by the offsets.
+//
+
+#ifndef DU1SIMD_SCAN_HPP
+#define DU1SIMD_SCAN_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_reduce.hpp"
+#include "du1simd_algorithm.hpp"
+#include "du1simd_parallel.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <type_traits>
+
+namespace du1simd {
+
+	namespace detail {
+
+		// a shifted up by B bytes (towards the higher lanes), zeros shifted in
+#if DU1SIMD_HAVE_SSE
+		template< int B>
+		__m128i shift_up_bytes( __m128i a)
+		{
+			return _mm_slli_si128( a, B);
+		}
+
+		template< int B>
+		__m128 shift_up_bytes( __m128 a)
+		{
+			return _mm_castsi128_ps( _mm_slli_si128( _mm_castps_si128( a), B));
+		}
+
+		template< int B>
+		__m128d shift_up_bytes( __m128d a)
+		{
+			return _mm_castsi128_pd( _mm_slli_si128( _mm_castpd_si128( a), B));
+		}
+#endif
+
+#if DU1SIMD_HAVE_AVX2
+		// The high half receives the top bytes of the low half, B is at most 16
+		template< int B>
+		__m256i shift_up_bytes( __m256i a)
+		{
+			return _mm256_alignr_epi8( a, _mm256_permute2x128_si256( a, a, 0x08), 16 - B);
+		}
+#endif
+
+#if defined(__AVX2__)
+		template< int B>
+		__m256 shift_up_bytes( __m256 a)
+		{
+			return _mm256_castsi256_ps( shift_up_bytes< B>( _mm256_castps_si256( a)));
+		}
+
+		template< int B>
+		__m256d shift_up_bytes( __m256d a)
+		{
+			return _mm256_castsi256_pd( shift_up_bytes< B>( _mm256_castpd_si256( a)));
+		}
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+		// Whole 32-bit lanes only
+		template< int B>
+		__m512i shift_up_bytes( __m512i a)
+		{
+			static_assert( B % 4 == 0, "The lanes of __m512i are shifted by 32-bit lanes!");
+			return _mm512_alignr_epi32( a, _mm512_setzero_si512(), 16 - B / 4);
+		}
+
+		template< int B>
+		__m512 shift_up_bytes( __m512 a)
+		{
+			return _mm512_castsi512_ps( shift_up_bytes< B>( _mm512_castps_si512( a)));
+		}
+
+		template< int B>
+		__m512d shift_up_bytes( __m512d a)
+		{
+			return _mm512_castsi512_pd( shift_up_bytes< B>( _mm512_castpd_si512( a)));
+		}
+#endif
+
+#if DU1SIMD_HAVE_NEON
+		// Whole lanes only, ext takes the top lanes of zero followed by the low lanes of a
+		template< int B>
+		float32x4_t shift_up_bytes( float32x4_t a)
+		{
+			static_assert( B % 4 == 0, "The lanes of float32x4_t are shifted by whole lanes!");
+			return vextq_f32( vdupq_n_f32( 0.0F), a, 4 - B / 4);
+		}
+#endif
+
+#if DU1SIMD_HAVE_SVE
+		template< int B>
+		sve_float32_t shift_up_bytes( sve_float32_t a)
+		{
+			static_assert( B % 4 == 0, "The lanes of sve_float32_t are shifted by whole lanes!");
+			return svext_f32( svdup_n_f32( 0.0F), a, simd< float, sve_float32_t>::k - B / 4);
+		}
+#endif
+
+		// Carriers with the lane shifts of shift_up_bytes
+		template< typename T, typename S>
+		struct has_lane_shift : std::false_type { };
+
+#if DU1SIMD_HAVE_SSE
+		template< typename T>
+		struct has_lane_shift< T, __m128i> : std::true_type { };
+
+		template<>
+		struct has_lane_shift< float, __m128> : std::true_type { };
+
+		template<>
+		struct has_lane_shift< double, __m128d> : std::true_type { };
+#endif
+
+#if DU1SIMD_HAVE_AVX2
+		template< typename T>
+		struct has_lane_shift< T, __m256i> : std::true_type { };
+#endif
+
+#if defined(__AVX2__)
+		template<>
+		struct has_lane_shift< float, __m256> : std::true_type { };
+
+		template<>
+		struct has_lane_shift< double, __m256d> : std::true_type { };
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+		template< typename T>
+		struct has_lane_shift< T, __m512i> : std::integral_constant< bool, sizeof(T) >= 4> { };
+
+		template<>
+		struct has_lane_shift< float, __m512> : std::true_type { };
+
+		template<>
+		struct has_lane_shift< double, __m512d> : std::true_type { };
+#endif
+
+#if DU1SIMD_HAVE_NEON
+		template<>
+		struct has_lane_shift< float, float32x4_t> : std::true_type { };
+#endif
+
+#if DU1SIMD_HAVE_SVE
+		template<>
+		struct has_lane_shift< float, sve_float32_t> : std::true_type { };
+#endif
+
+		// The steps of the in-register scan shifting by n, 2 n, 4 n ... lanes
+		template< typename T, typename S, std::size_t n, bool more = ( n < lanes_of< T, S>::value)>
+		struct scan_steps {
+			static S apply( S a)
+			{
+				return scan_steps< T, S, 2 * n>::apply( simd< T, S>::add( a, shift_up_bytes< static_cast< int>( n * sizeof(T))>( a)));
+			}
+		};
+
+		template< typename T, typename S, std::size_t n>
+		struct scan_steps< T, S, n, false> {
+			static S apply( S a)
+			{
+				return a;
+			}
+		};
+
+		// Inclusive scan of the lanes of a block
+		template< typename T, typename S>
+		S scan_lanes( S a, std::true_type)
+		{
+			return scan_steps< T, S, 1>::apply( a);
+		}
+
+		template< typename T, typename S>
+		S scan_lanes( S a, std::false_type)
+		{
+			const std::size_t k = lanes_of< T, S>::value;
+			T lanes[ k];
+			std::memcpy( lanes, & a, sizeof(S));
+			for ( std::size_t j = 1; j < k; ++ j)
+			{
+				lanes[ j] = static_cast< T>( lanes[ j - 1] + lanes[ j]);
+			}
+			std::memcpy( & a, lanes, sizeof(S));
+			return a;
+		}
+
+		template< typename T, typename S>
+		S scan_lanes( S a)
+		{
+			return scan_lanes< T>( a, has_lane_shift< T, S>());
+		}
+
+		// a shifted up by one lane, zero in lane 0
+		template< typename T, typename S>
+		S shift_up_lane( S a, std::true_type)
+		{
+			return shift_up_bytes< static_cast< int>( sizeof(T))>( a);
+		}
+
+		template< typename T, typename S>
+		S shift_up_lane( S a, std::false_type)
+		{
+			const std::size_t k = lanes_of< T, S>::value;
+			T lanes[ k + 1];
+			lanes[ 0] = T( 0);
+			std::memcpy( lanes + 1, & a, sizeof(S));
+			std::memcpy( & a, lanes, sizeof(S));
+			return a;
+		}
+
+		template< typename T, typename S>
+		S shift_up_lane( S a)
+		{
+			return shift_up_lane< T>( a, has_lane_shift< T, S>());
+		}
+
+		template< typename T, typename S>
+		S broadcast_last_lane( S a)
+		{
+			const std::size_t k = lanes_of< T, S>::value;
+			T lanes[ k];
+			std::memcpy( lanes, & a, sizeof(S));
+			return simd< T, S>::broadcast( lanes[ k - 1]);
+		}
+
+		// Block function of transform carrying the running total of the blocks in carry
+		template< typename T, typename S, bool inclusive>
+		struct scan_block {
+			S * carry;
+
+			S operator()( S a) const
+			{
+				typedef simd< T, S> simd_op;
+
+				S s = scan_lanes< T>( inclusive ? a : shift_up_lane< T>( a));
+				S r = simd_op::add( s, * carry);
+				* carry = simd_op::add( * carry, broadcast_last_lane< T>( inclusive ? s : simd_op::add( s, a)));
+				return r;
+			}
+		};
+
+		template< bool inclusive, typename U, typename T, typename S>
+		simd_vector_iterator< T, S> scan( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e, simd_vector_iterator< T, S> d, T init,
+			std::size_t threshold)
+		{
+			static_assert( std::is_arithmetic< T>::value, "Arithmetic element type required!");
+
+			S carry = simd< T, S>::broadcast( init);
+			scan_block< T, S, inclusive> f = { & carry };
+			return du1simd::transform( b, e, d, f, threshold);
+		}
+
+		template< bool inclusive, typename U, typename T, typename S>
+		simd_vector_iterator< T, S> parallel_scan( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e, simd_vector_iterator< T, S> d, T init,
+			thread_pool & pool, std::size_t chunk_size)
+		{
+			chunking< U, S> chunks( b, e, chunk_size);
+			std::size_t n = chunks.count();
+			if ( n <= 1)
+			{
+				return scan< inclusive>( b, e, d, init, default_streaming_threshold);
+			}
+
+			std::vector< T> offsets( n);
+			pool.parallel_for( n, [ & offsets, & chunks]( std::size_t i){
+				offsets[ i] = du1simd::reduce_sum( chunks.begin( i), chunks.end( i));
+			});
+			T total = init;
+			for ( std::size_t i = 0; i < n; ++ i)
+			{
+				T sum = offsets[ i];
+				offsets[ i] = total;
+				total = static_cast< T>( total + sum);
+			}
+
+			pool.parallel_for( n, [ & offsets, & chunks, b, d]( std::size_t i){
+				scan< inclusive>( chunks.begin( i), chunks.end( i), d + ( chunks.begin( i) - b), offsets[ i], default_streaming_threshold);
+			});
+			return d + ( e - b);
+		}
+	}
+
+	template< typename U, typename T, typename S>
+	simd_vector_iterator< T, S> inclusive_scan( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e, simd_vector_iterator< T, S> d,
+		T init = T( 0), std::size_t threshold = default_streaming_threshold)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "inclusive_scan", S, b, e, 2);
+
+		return detail::scan< true>( b, e, d, init, threshold);
+	}
+
+	template< typename U, typename T, typename S>
+	simd_vector_iterator< T, S> exclusive_scan( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e, simd_vector_iterator< T, S> d,
+		T init = T( 0), std::size_t threshold = default_streaming_threshold)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "exclusive_scan", S, b, e, 2);
+
+		return detail::scan< false>( b, e, d, init, threshold);
+	}
+
+	template< typename U, typename T, typename S>
+	simd_vector_iterator< T, S> parallel_inclusive_scan( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e, simd_vector_iterator< T, S> d,
+		T init = T( 0), thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "parallel_inclusive_scan", S, b, e, 2);
+
+		return detail::parallel_scan< true>( b, e, d, init, pool, chunk_size);
+	}
+
+	template< typename U, typename T, typename S>
+	simd_vector_iterator< T, S> parallel_exclusive_scan( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e, simd_vector_iterator< T, S> d,
+		T init = T( 0), thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "parallel_exclusive_scan", S, b, e, 2);
+
+		return detail::parallel_scan< false>( b, e, d, init, pool, chunk_size);
+	}
+};
+
+#endif // DU1SIMD_SCAN_HPP
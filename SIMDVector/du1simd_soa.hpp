@@ -0,0 +1,517 @@
+// du1simd_soa.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Structure of arrays built on simd_vector
+//
+// soa_simd_vector< S, Fields ...> stores records of the field types Fields ... as one simd_vector< Field, S>
+// per field (a column), all columns share the size. A kernel over one field reads only the memory of
+// that field, whole blocks of S at a time, instead of striding over an array of structures:
+//
+//	soa_simd_vector< __m128, float, std::uint32_t> v( n);
+//	float total = du1simd::reduce_sum( v.begin< 0>(), v.end< 0>());
+//
+// begin< I>() / end< I>() are the element iterators of the column I, their lower_block() / upper_block()
+// are its simd_iterators, so all the kernels apply to a column. column< I>() gives read access to the
+// simd_vector of the column, its size can only be changed through the soa_simd_vector.
+//
+// The rows are reached through a proxy: begin() / end() iterate over soa_row_reference objects, get< I>()
+// of a row is a reference to its field I and a row converts to and is assignable from
+// std::tuple< Fields ...>. As with std::vector< bool> the row iterator is a random access iterator whose
+// reference type is not a real reference.
+//
+// S gives the width of the blocks, each column uses the carrier of that width for its field type
+// (du1simd::detail::column_carrier): with S = __m128 a float column is a simd_vector< float, __m128>,
+// a double column uses __m128d and an integer column __m128i, so the float, double and integer kernels
+// apply to the respective columns. A scalar S is used for all columns as it is.
+//
+// Every field must fit its carrier (sizeof(carrier) % sizeof(Field) == 0) and be trivially copyable, so
+// e.g. a record of three uint32_t (s2 in du1test.cpp) is stored as three uint32_t columns.
+//
+
+#ifndef DU1SIMD_SOA_HPP
+#define DU1SIMD_SOA_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#include <utility>
+#include <initializer_list>
+#include <type_traits>
+
+namespace du1simd {
+
+	namespace detail {
+
+		// std::index_sequence is C++14
+		template< std::size_t ... I>
+		struct index_sequence { };
+
+		template< std::size_t N, std::size_t ... I>
+		struct make_index_sequence : make_index_sequence< N - 1, N - 1, I ...> { };
+
+		template< std::size_t ... I>
+		struct make_index_sequence< 0, I ...> {
+			typedef index_sequence< I ...> type;
+		};
+
+		// Evaluates the expansion of a parameter pack in order
+		inline void expand( std::initializer_list< int>) { }
+
+		template< typename U>
+		struct void_type {
+			typedef void type;
+		};
+
+		// Vector carriers of one width for float, double and other (integer) elements
+		template< typename S>
+		struct carrier_family;
+
+		template< typename F, typename D, typename I>
+		struct carrier_types {
+			typedef F float_type;
+			typedef D double_type;
+			typedef I integer_type;
+		};
+
+#if DU1SIMD_HAVE_SSE
+		template<> struct carrier_family< __m128> : carrier_types< __m128, __m128d, __m128i> { };
+		template<> struct carrier_family< __m128d> : carrier_types< __m128, __m128d, __m128i> { };
+		template<> struct carrier_family< __m128i> : carrier_types< __m128, __m128d, __m128i> { };
+#endif
+#if DU1SIMD_HAVE_AVX
+		template<> struct carrier_family< __m256> : carrier_types< __m256, __m256d, __m256i> { };
+		template<> struct carrier_family< __m256d> : carrier_types< __m256, __m256d, __m256i> { };
+		template<> struct carrier_family< __m256i> : carrier_types< __m256, __m256d, __m256i> { };
+#endif
+#if DU1SIMD_HAVE_AVX512
+		template<> struct carrier_family< __m512> : carrier_types< __m512, __m512d, __m512i> { };
+		template<> struct carrier_family< __m512d> : carrier_types< __m512, __m512d, __m512i> { };
+		template<> struct carrier_family< __m512i> : carrier_types< __m512, __m512d, __m512i> { };
+#endif
+
+		// Carrier of a column of T in a structure of arrays of the width of S, S itself if it is scalar
+		template< typename T, typename S, typename = void>
+		struct column_carrier {
+			typedef S type;
+		};
+
+		template< typename T, typename S>
+		struct column_carrier< T, S, typename void_type< typename carrier_family< S>::float_type>::type> {
+			typedef carrier_family< S> family;
+			typedef typename std::conditional< std::is_same< T, float>::value, typename family::float_type,
+				typename std::conditional< std::is_same< T, double>::value, typename family::double_type, typename family::integer_type>::type>::type type;
+		};
+
+		// The fields fit their carriers and may be moved as raw memory
+		template< typename S, typename ... F>
+		struct soa_fields_valid : std::true_type { };
+
+		template< typename S, typename F, typename ... R>
+		struct soa_fields_valid< S, F, R ...> : std::integral_constant< bool,
+			sizeof(typename column_carrier< F, S>::type) % sizeof(F) == 0 && std::is_trivially_copyable< F>::value && soa_fields_valid< S, R ...>::value> { };
+	}
+};
+
+template< typename S, typename ... Fields>
+class soa_simd_vector;
+
+// Proxy of a row, V is soa_simd_vector or const soa_simd_vector
+template< typename V>
+class soa_row_reference {
+public:
+	typedef typename V::value_type value_type;
+
+	// Reference to the field I of the row, const if the vector is const
+	template< std::size_t I>
+	typename std::conditional<std::is_const<V>::value, const typename V::template field_type<I>, typename V::template field_type<I>>::type& get() const
+	{
+		return v->template begin<I>()[i];
+	}
+
+	operator value_type() const
+	{
+		return load(typename du1simd::detail::make_index_sequence<V::fields>::type());
+	}
+
+	// Assignment copies the fields into the row, not the proxy
+	const soa_row_reference& operator=(const value_type& r) const
+	{
+		store(r, typename du1simd::detail::make_index_sequence<V::fields>::type());
+		return (*this);
+	}
+
+	const soa_row_reference& operator=(const soa_row_reference& r) const
+	{
+		return (*this) = static_cast<value_type>(r);
+	}
+
+	soa_row_reference(const soa_row_reference& r) : v(r.v), i(r.i) { }
+
+private:
+	V* v;
+	std::size_t i;
+
+	soa_row_reference(V* vec, std::size_t index) : v(vec), i(index) { }
+
+	template< std::size_t ... I>
+	value_type load(du1simd::detail::index_sequence<I ...>) const
+	{
+		return value_type(get<I>() ...);
+	}
+
+	template< std::size_t ... I>
+	void store(const value_type& r, du1simd::detail::index_sequence<I ...>) const
+	{
+		du1simd::detail::expand({ (get<I>() = std::get<I>(r), 0) ... });
+	}
+
+	template<typename U> friend class soa_row_iterator;
+};
+
+// Random access iterator over the rows, V is soa_simd_vector or const soa_simd_vector
+template< typename V>
+class soa_row_iterator {
+public:
+	typedef soa_row_iterator<V> self;
+
+	// Random access iterator category
+	typedef std::random_access_iterator_tag iterator_category;
+
+	// Iterator types
+	typedef typename V::value_type value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef void pointer;
+	typedef soa_row_reference<V> reference;
+
+private:
+	// Vector and row index
+	V* v;
+	difference_type i;
+
+	soa_row_iterator(V* vec, difference_type index) : v(vec), i(index) { }
+
+	template<typename K, typename ... F> friend class soa_simd_vector;
+	template<typename U> friend class soa_row_iterator;
+
+public:
+	// Operator overloads
+	reference operator*() const { return reference(v, static_cast<std::size_t>(i)); }
+	reference operator[](const difference_type& n) const { return reference(v, static_cast<std::size_t>(i + n)); }
+	bool operator==(const self& a) const { return i == a.i; }
+	bool operator!=(const self& a) const { return i != a.i; }
+	bool operator<(const self& a) const { return i < a.i; }
+	bool operator>(const self& a) const { return i > a.i; }
+	bool operator<=(const self& a) const { return i <= a.i; }
+	bool operator>=(const self& a) const { return i >= a.i; }
+	self& operator++()
+	{
+		++i;
+		return (*this);
+	}
+	self operator++(int)
+	{
+		self tmp = (*this);
+		++i;
+		return tmp;
+	}
+	self& operator--()
+	{
+		--i;
+		return (*this);
+	}
+	self operator--(int)
+	{
+		self tmp = (*this);
+		--i;
+		return tmp;
+	}
+	self& operator+=(const difference_type& n)
+	{
+		i += n;
+		return (*this);
+	}
+	self& operator-=(const difference_type& n)
+	{
+		i -= n;
+		return (*this);
+	}
+	difference_type operator-(const self& a) const
+	{
+		return (i - a.i);
+	}
+	self operator+(const difference_type& n) const
+	{
+		return self(v, i + n);
+	}
+	self operator-(const difference_type& n) const
+	{
+		return self(v, i - n);
+	}
+
+	// Default constructor
+	soa_row_iterator() : v(nullptr), i(0) { }
+
+	// Conversion of an iterator to a const iterator
+	template< typename U, typename = typename std::enable_if<std::is_same<const U, V>::value>::type>
+	soa_row_iterator(const soa_row_iterator<U>& a) : v(a.v), i(a.i) { }
+};
+
+template< typename V>
+soa_row_iterator<V> operator+(std::ptrdiff_t n, const soa_row_iterator<V>& a)
+{
+	return a + n;
+}
+
+template< typename S, typename ... Fields>
+class soa_simd_vector {
+	// Static check of type parameters
+	static_assert(sizeof...(Fields) > 0, "At least one field is required!");
+	static_assert(du1simd::detail::soa_fields_valid<S, Fields ...>::value, "Fields must fit their carriers and be trivially copyable!");
+
+public:
+	typedef soa_simd_vector<S, Fields ...> self;
+
+	// Row of the vector
+	typedef std::tuple<Fields ...> value_type;
+
+	// Number of fields
+	static DU1SIMD_CONSTEXPR const std::size_t fields = sizeof...(Fields);
+
+	template< std::size_t I>
+	using field_type = typename std::tuple_element<I, value_type>::type;
+
+	// Column of the field I
+	template< std::size_t I>
+	using column_type = simd_vector<field_type<I>, typename du1simd::detail::column_carrier<field_type<I>, S>::type>;
+
+	// Element and block iterators of the column I
+	template< std::size_t I>
+	using column_iterator = typename column_type<I>::iterator;
+
+	template< std::size_t I>
+	using const_column_iterator = typename column_type<I>::const_iterator;
+
+	template< std::size_t I>
+	using column_simd_iterator = typename column_type<I>::simd_iterator;
+
+	template< std::size_t I>
+	using const_column_simd_iterator = typename column_type<I>::const_simd_iterator;
+
+	typedef soa_row_iterator<self> iterator;
+
+	typedef soa_row_iterator<const self> const_iterator;
+
+	typedef soa_row_reference<self> reference;
+
+	typedef soa_row_reference<const self> const_reference;
+
+private:
+	typedef typename du1simd::detail::make_index_sequence<sizeof...(Fields)>::type indices;
+
+	template< typename F>
+	using column_of = simd_vector<F, typename du1simd::detail::column_carrier<F, S>::type>;
+
+	std::tuple<column_of<Fields> ...> columns;
+	std::size_t content_size;
+
+	template< std::size_t ... I>
+	void resize_columns(std::size_t n, du1simd::detail::index_sequence<I ...>)
+	{
+		du1simd::detail::expand({ (std::get<I>(columns).resize(n), 0) ... });
+	}
+
+	template< std::size_t ... I>
+	void reserve_columns(std::size_t n, du1simd::detail::index_sequence<I ...>)
+	{
+		du1simd::detail::expand({ (std::get<I>(columns).reserve(n), 0) ... });
+	}
+
+	template< std::size_t ... I>
+	void push_back_columns(const Fields& ... values, du1simd::detail::index_sequence<I ...>)
+	{
+		du1simd::detail::expand({ (std::get<I>(columns).push_back(values), 0) ... });
+	}
+
+	template< std::size_t ... I>
+	void push_back_row(const value_type& r, du1simd::detail::index_sequence<I ...>)
+	{
+		push_back(std::get<I>(r) ...);
+	}
+
+	template< std::size_t ... I>
+	void swap_columns(self& other, du1simd::detail::index_sequence<I ...>)
+	{
+		du1simd::detail::expand({ (std::swap(std::get<I>(columns), std::get<I>(other.columns)), 0) ... });
+	}
+
+public:
+	// Empty vector
+	soa_simd_vector() : content_size(0)
+	{
+	}
+
+	// Vector of s value-initialized rows
+	explicit soa_simd_vector(std::size_t s) : columns(column_of<Fields>(s) ...), content_size(s)
+	{
+	}
+
+	// Vector of s uninitialized rows, for columns about to be overwritten
+	soa_simd_vector(std::size_t s, du1simd::uninitialized_t) : columns(column_of<Fields>(s, du1simd::uninitialized) ...), content_size(s)
+	{
+	}
+
+	// Move constructor
+	soa_simd_vector(self&& v) : columns(std::move(v.columns)), content_size(v.content_size)
+	{
+		v.content_size = 0;
+	}
+
+	// Move assignment operator
+	self& operator=(self&& v)
+	{
+		swap_columns(v, indices());
+		std::swap(content_size, v.content_size);
+		return (*this);
+	}
+
+	// Rows
+	iterator begin()
+	{
+		return iterator(this, 0);
+	}
+
+	iterator end()
+	{
+		return iterator(this, static_cast<std::ptrdiff_t>(content_size));
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, 0);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, static_cast<std::ptrdiff_t>(content_size));
+	}
+
+	const_iterator cbegin() const
+	{
+		return begin();
+	}
+
+	const_iterator cend() const
+	{
+		return end();
+	}
+
+	reference operator[](std::size_t i)
+	{
+		return begin()[static_cast<std::ptrdiff_t>(i)];
+	}
+
+	const_reference operator[](std::size_t i) const
+	{
+		return begin()[static_cast<std::ptrdiff_t>(i)];
+	}
+
+	// Columns
+	template< std::size_t I>
+	column_iterator<I> begin()
+	{
+		return std::get<I>(columns).begin();
+	}
+
+	template< std::size_t I>
+	column_iterator<I> end()
+	{
+		return std::get<I>(columns).end();
+	}
+
+	template< std::size_t I>
+	const_column_iterator<I> begin() const
+	{
+		return std::get<I>(columns).begin();
+	}
+
+	template< std::size_t I>
+	const_column_iterator<I> end() const
+	{
+		return std::get<I>(columns).end();
+	}
+
+	template< std::size_t I>
+	const column_type<I>& column() const
+	{
+		return std::get<I>(columns);
+	}
+
+	std::size_t size() const
+	{
+		return content_size;
+	}
+
+	bool empty() const
+	{
+		return content_size == 0;
+	}
+
+	// Makes room for at least n rows in every column
+	void reserve(std::size_t n)
+	{
+		reserve_columns(n, indices());
+	}
+
+	// Changes the number of rows to n, the new rows are value-initialized
+	void resize(std::size_t n)
+	{
+		try
+		{
+			resize_columns(n, indices());
+		}
+		catch (...)
+		{
+			// The columns already resized are restored, shrinking does not throw
+			if (n > content_size)
+			{
+				resize_columns(content_size, indices());
+			}
+			throw;
+		}
+		content_size = n;
+	}
+
+	void push_back(const Fields& ... values)
+	{
+		try
+		{
+			push_back_columns(values ..., indices());
+		}
+		catch (...)
+		{
+			resize_columns(content_size, indices());
+			throw;
+		}
+		++content_size;
+	}
+
+	void push_back(const value_type& r)
+	{
+		push_back_row(r, indices());
+	}
+
+	void clear()
+	{
+		resize_columns(0, indices());
+		content_size = 0;
+	}
+};
+
+template< typename S, typename ... Fields>
+DU1SIMD_CONSTEXPR const std::size_t soa_simd_vector<S, Fields ...>::fields;
+
+#endif // DU1SIMD_SOA_HPP
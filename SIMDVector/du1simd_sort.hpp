@@ -0,0 +1,424 @@
+// du1simd_sort.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Sorting kernels over simd_vector ranges
+//
+//	sort( b, e)				ascending sort of [b, e)
+//	partial_sort( b, m, e)			the m - b smallest elements sorted to [b, m), the rest in [m, e)
+//						in unspecified order (top-k)
+//	nth_element( b, nth, e)			the element which would be at nth after sorting placed there,
+//						no greater elements before it and no smaller ones after it
+//	parallel_sort( b, e, pool, chunk_size)	sort with the subranges above chunk_size elements sorted
+//						on the thread pool
+//
+// The kernels are a quicksort whose partitioning is done a block at a time in place: the block is
+// compared with the broadcast pivot (du1simd::simd::cmp_lt / cmp_le) and its lanes are packed by
+// detail::compress to the front part and by detail::compress_to_end to the back part of the range. The
+// two blocks at the ends of the range are saved in registers first, so the writes never overtake the
+// reads. Subranges of up to sort_threshold blocks, the subranges with too many unbalanced partitions
+// and the ranges of the scalar carriers are left to std::sort.
+//
+// The subranges are not aligned to the blocks, the blocks are read by unaligned loads, which cost the
+// same as the aligned ones within a cache line.
+//
+// Supported are the element types with the comparison traits and operator < (float, double and the
+// integers), the ranges must not contain NaN. parallel_sort partitions the ranges above chunk_size
+// serially before sorting the parts in parallel, so its speedup is bounded by the logarithm of the
+// number of chunks; the result does not depend on the number of threads.
+//
+
+#ifndef DU1SIMD_SORT_HPP
+#define DU1SIMD_SORT_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_filter.hpp"
+#include "du1simd_parallel.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+namespace du1simd {
+
+	// Blocks per subrange left to std::sort
+	const std::size_t sort_threshold = 16;
+
+	namespace detail {
+
+		template< typename S, typename T>
+		S load_unaligned( const T * p)
+		{
+			S a;
+			std::memcpy( & a, p, sizeof(S));
+			return a;
+		}
+
+		// Writes the lanes of a selected by m to consecutive elements ending at end and returns their
+		// number, all the k elements before end may be overwritten
+		template< typename T, typename S>
+		std::size_t compress_to_end( T * end, const S & a, lane_mask m)
+		{
+			const std::size_t k = lanes_of< T, S>::value;
+			T lanes[ k];
+			std::memcpy( lanes, & a, sizeof(S));
+			std::size_t n = 0;
+			for ( std::size_t j = k; j-- > 0; )
+			{
+				end[ -1 - static_cast< std::ptrdiff_t>( n)] = lanes[ j];
+				n += ( m >> j) & 1;
+			}
+			return n;
+		}
+
+#if defined(__AVX__)
+		inline std::size_t compress_to_end( float * end, __m128 a, lane_mask m)
+		{
+			std::size_t n = popcount( m);
+			__m128i first = _mm_cmpgt_epi32( _mm_set1_epi32( static_cast< int>( n)), _mm_setr_epi32( 0, 1, 2, 3));
+			_mm_maskstore_ps( end - n, first, compressed( a, m));
+			return n;
+		}
+
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 4>::value, std::size_t>::type compress_to_end( T * end, __m128i a, lane_mask m)
+		{
+			return compress_to_end( reinterpret_cast< float *>( end), _mm_castsi128_ps( a), m);
+		}
+#endif
+
+#if defined(__AVX2__)
+		inline std::size_t compress_to_end( float * end, __m256 a, lane_mask m)
+		{
+			std::size_t n = popcount( m);
+			__m256i first = _mm256_cmpgt_epi32( _mm256_set1_epi32( static_cast< int>( n)), _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7));
+			_mm256_maskstore_ps( end - n, first, compressed( a, m));
+			return n;
+		}
+
+		inline std::size_t compress_to_end( double * end, __m256d a, lane_mask m)
+		{
+			std::size_t n = popcount( m);
+			__m256i first = _mm256_cmpgt_epi64( _mm256_set1_epi64x( static_cast< long long>( n)), _mm256_setr_epi64x( 0, 1, 2, 3));
+			_mm256_maskstore_pd( end - n, first, compressed( a, m));
+			return n;
+		}
+
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 4>::value, std::size_t>::type compress_to_end( T * end, __m256i a, lane_mask m)
+		{
+			return compress_to_end( reinterpret_cast< float *>( end), _mm256_castsi256_ps( a), m);
+		}
+
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 8>::value, std::size_t>::type compress_to_end( T * end, __m256i a, lane_mask m)
+		{
+			return compress_to_end( reinterpret_cast< double *>( end), _mm256_castsi256_pd( a), m);
+		}
+#endif
+
+#if DU1SIMD_HAVE_AVX512
+		inline std::size_t compress_to_end( float * end, __m512 a, lane_mask m)
+		{
+			std::size_t n = popcount( m);
+			_mm512_mask_compressstoreu_ps( end - n, static_cast< __mmask16>( m), a);
+			return n;
+		}
+
+		inline std::size_t compress_to_end( double * end, __m512d a, lane_mask m)
+		{
+			std::size_t n = popcount( m);
+			_mm512_mask_compressstoreu_pd( end - n, static_cast< __mmask8>( m), a);
+			return n;
+		}
+
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 4>::value, std::size_t>::type compress_to_end( T * end, __m512i a, lane_mask m)
+		{
+			return compress_to_end( reinterpret_cast< float *>( end), _mm512_castsi512_ps( a), m);
+		}
+
+		template< typename T>
+		typename std::enable_if< is_integer_of_size< T, 8>::value, std::size_t>::type compress_to_end( T * end, __m512i a, lane_mask m)
+		{
+			return compress_to_end( reinterpret_cast< double *>( end), _mm512_castsi512_pd( a), m);
+		}
+#endif
+
+#if DU1SIMD_HAVE_SVE
+		inline std::size_t compress_to_end( float * end, sve_float32_t a, lane_mask m)
+		{
+			typedef simd< float, sve_float32_t> simd_op;
+
+			std::size_t n = popcount( m);
+			svst1_f32( simd_op::lanes( 0, static_cast< std::ptrdiff_t>( n)), end - n, svcompact_f32( simd_op::from_mask( m), a));
+			return n;
+		}
+#endif
+
+		// Moves the elements of [lo, hi) the block predicate pred holds for before the other ones and
+		// returns the end of them, hi - lo must be at least two blocks
+		template< typename S, typename T, typename P>
+		T * partition_blocks( T * lo, T * hi, const P & pred)
+		{
+			const std::ptrdiff_t k = lanes_of< T, S>::value;
+			const lane_mask all = lane_range( 0, k);
+
+			assert( hi - lo >= 2 * k);
+
+			// The space taken by the saved blocks is free for writing, reading from the side with less
+			// free space keeps at least a block of it on both sides before the writes
+			S first = load_unaligned< S>( lo);
+			S last = load_unaligned< S>( hi - k);
+			T * read_lo = lo + k;
+			T * read_hi = hi - k;
+			T * write_lo = lo;
+			T * write_hi = hi;
+			while ( read_hi - read_lo >= k)
+			{
+				S a;
+				if ( read_lo - write_lo <= write_hi - read_hi)
+				{
+					a = load_unaligned< S>( read_lo);
+					read_lo += k;
+				}
+				else
+				{
+					read_hi -= k;
+					a = load_unaligned< S>( read_hi);
+				}
+				lane_mask m = pred( a) & all;
+				write_lo += compress( write_lo, a, m);
+				write_hi -= compress_to_end( write_hi, a, all & ~ m);
+			}
+
+			// The last unread elements and the saved blocks fill the remaining gap exactly
+			T rest[ 2 * k] = { };
+			std::ptrdiff_t r = read_hi - read_lo;
+			std::copy( read_lo, read_hi, rest);
+			std::memcpy( rest + r, & last, sizeof(S));
+
+			lane_mask m = pred( first) & all;
+			write_lo += compress( write_lo, first, m);
+			write_hi -= compress_to_end( write_hi, first, all & ~ m);
+
+			for ( std::ptrdiff_t i = 0; i < r + k; i += k)
+			{
+				m = pred( load_unaligned< S>( rest + i));
+				for ( std::ptrdiff_t j = i; j < std::min( i + k, r + k); ++ j)
+				{
+					if ( ( m >> ( j - i)) & 1)
+					{
+						* write_lo ++ = rest[ j];
+					}
+					else
+					{
+						* -- write_hi = rest[ j];
+					}
+				}
+			}
+
+			assert( write_lo == write_hi);
+			return write_lo;
+		}
+
+		template< typename T>
+		const T & median_of_three( const T & a, const T & b, const T & c)
+		{
+			return ( a < b) ? ( ( b < c) ? b : ( ( a < c) ? c : a)) : ( ( a < c) ? a : ( ( b < c) ? c : b));
+		}
+
+		// Splits [lo, hi) into [lo, mid) and [mid, hi) with no element of the first part greater than an
+		// element of the second one, mid == lo means that [lo, hi) is sorted already
+		template< typename S, typename T>
+		T * partition_by_pivot( T * lo, T * hi)
+		{
+			std::ptrdiff_t n = hi - lo;
+			std::ptrdiff_t h = n / 2;
+			std::ptrdiff_t q = n / 8;
+			T pivot = median_of_three( median_of_three( lo[ 0], lo[ q], lo[ 2 * q]),
+				median_of_three( lo[ h - q], lo[ h], lo[ h + q]),
+				median_of_three( hi[ -1 - 2 * q], hi[ -1 - q], hi[ -1]));
+
+			T * mid = partition_blocks< S>( lo, hi, compare_predicate< T, S, compare_op::less>( pivot));
+			if ( mid == lo)
+			{
+				// The pivot is the minimum, its copies are placed at the front and not sorted any more
+				mid = partition_blocks< S>( lo, hi, compare_predicate< T, S, compare_op::less_equal>( pivot));
+				if ( mid == hi)
+				{
+					return lo;
+				}
+			}
+			return mid;
+		}
+
+		template< typename S, typename T>
+		void quicksort( T * lo, T * hi, int depth)
+		{
+			const std::ptrdiff_t small = static_cast< std::ptrdiff_t>( sort_threshold * lanes_of< T, S>::value);
+
+			// Partitioning one-element blocks gains nothing over std::sort
+			if ( lanes_of< T, S>::value == 1)
+			{
+				std::sort( lo, hi);
+				return;
+			}
+
+			while ( hi - lo > small)
+			{
+				if ( depth == 0)
+				{
+					std::sort( lo, hi);
+					return;
+				}
+				-- depth;
+
+				T * mid = partition_by_pivot< S>( lo, hi);
+				if ( mid == lo)
+				{
+					return;
+				}
+
+				// Recursion to the smaller part bounds the stack depth
+				if ( mid - lo < hi - mid)
+				{
+					quicksort< S>( lo, mid, depth);
+					lo = mid;
+				}
+				else
+				{
+					quicksort< S>( mid, hi, depth);
+					hi = mid;
+				}
+			}
+			std::sort( lo, hi);
+		}
+
+		template< typename S, typename T>
+		void parallel_quicksort( T * lo, T * hi, int depth, thread_pool & pool, std::ptrdiff_t chunk_size)
+		{
+			if ( hi - lo <= chunk_size || depth == 0)
+			{
+				quicksort< S>( lo, hi, depth);
+				return;
+			}
+
+			T * mid = partition_by_pivot< S>( lo, hi);
+			if ( mid == lo)
+			{
+				return;
+			}
+			pool.parallel_for( 2, [ lo, mid, hi, depth, & pool, chunk_size]( std::size_t i){
+				if ( i == 0)
+				{
+					parallel_quicksort< S>( lo, mid, depth - 1, pool, chunk_size);
+				}
+				else
+				{
+					parallel_quicksort< S>( mid, hi, depth - 1, pool, chunk_size);
+				}
+			});
+		}
+
+		template< typename S, typename T>
+		void select( T * lo, T * nth, T * hi)
+		{
+			const std::ptrdiff_t small = static_cast< std::ptrdiff_t>( sort_threshold * lanes_of< T, S>::value);
+
+			if ( lanes_of< T, S>::value == 1)
+			{
+				std::nth_element( lo, nth, hi);
+				return;
+			}
+
+			while ( hi - lo > small)
+			{
+				T * mid = partition_by_pivot< S>( lo, hi);
+				if ( mid == lo)
+				{
+					return;
+				}
+				if ( nth < mid)
+				{
+					hi = mid;
+				}
+				else
+				{
+					lo = mid;
+				}
+			}
+			std::nth_element( lo, nth, hi);
+		}
+
+		// Twice the binary logarithm of the unbalanced partitions allowed before falling back to std::sort
+		inline int sort_depth( std::ptrdiff_t n)
+		{
+			int depth = 0;
+			for ( ; n > 1; n >>= 1)
+			{
+				depth += 2;
+			}
+			return depth;
+		}
+
+		template< typename T, typename S>
+		T * sort_begin( simd_vector_iterator< T, S> b)
+		{
+			static_assert( ! std::is_const< T>::value, "The range to sort must be mutable!");
+			return to_address( b);
+		}
+	}
+
+	template< typename T, typename S>
+	void sort( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "sort", S, b, e, 1);
+
+		T * lo = detail::sort_begin( b);
+		detail::quicksort< S>( lo, lo + ( e - b), detail::sort_depth( e - b));
+	}
+
+	template< typename T, typename S>
+	void nth_element( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> nth, simd_vector_iterator< T, S> e)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "nth_element", S, b, e, 1);
+
+		if ( nth == e)
+		{
+			return;
+		}
+		T * lo = detail::sort_begin( b);
+		detail::select< S>( lo, lo + ( nth - b), lo + ( e - b));
+	}
+
+	template< typename T, typename S>
+	void partial_sort( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> m, simd_vector_iterator< T, S> e)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "partial_sort", S, b, e, 1);
+
+		if ( m == b)
+		{
+			return;
+		}
+		nth_element( b, m - 1, e);
+		sort( b, m - 1);
+	}
+
+	template< typename T, typename S>
+	void parallel_sort( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e,
+		thread_pool & pool = default_pool(), std::size_t chunk_size = default_chunk_size)
+	{
+		DU1SIMD_INSTRUMENT_RANGE( "parallel_sort", S, b, e, 1);
+
+		T * lo = detail::sort_begin( b);
+		std::ptrdiff_t chunk = std::max( static_cast< std::ptrdiff_t>( chunk_size), static_cast< std::ptrdiff_t>( 2 * lanes_of< T, S>::value));
+		detail::parallel_quicksort< S>( lo, lo + ( e - b), detail::sort_depth( e - b), pool, chunk);
+	}
+};
+
+#endif // DU1SIMD_SORT_HPP
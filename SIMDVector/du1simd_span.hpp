@@ -0,0 +1,208 @@
+// du1simd_span.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Non-owning view of a range of simd_vector elements
+//
+// simd_span< T, S> is the pair of element iterators [begin(), end()) into the aligned data of a
+// simd_vector, a mapped_simd_vector or a soa_simd_vector column. Making and copying a span copies the two
+// iterators only, a sub-range is passed to the kernels as a span instead of as a copy of its elements:
+//
+//	simd_span< const float, __m128> s = du1simd::make_span( v).subspan( 1, n);
+//	float total = du1simd::reduce_sum( s.begin(), s.end());
+//
+// The span keeps the guarantee of the vector it views: the blocks of the data are aligned to sizeof(S)
+// (simd_span::alignment), lower_block() / upper_block() are the simd_iterators of the blocks covering the
+// span and lower_offset() / upper_offset() the ragged edges, the lanes of the first and the last block
+// outside of the span, exactly as of begin().lower_offset() and end().upper_offset(). aligned() tells
+// whether the span consists of whole blocks only, such spans need no masking at all.
+//
+// T may be const, the span is read-only then, a span converts to its read-only span. As the iterators,
+// the span is invalidated by a reallocation of the vector it views.
+//
+
+#ifndef DU1SIMD_SPAN_HPP
+#define DU1SIMD_SPAN_HPP
+
+#include "du1simd.hpp"
+
+#include <cstddef>
+#include <cassert>
+#include <utility>
+#include <type_traits>
+
+template< typename T, typename S>
+class simd_span {
+	// Static check of type parameters
+	static_assert(sizeof(S) % sizeof(T) == 0, "Incompatible type parameters!");
+
+public:
+	typedef simd_span<T, S> self;
+
+	typedef T element_type;
+	typedef typename std::remove_const<T>::type value_type;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef T* pointer;
+	typedef T& reference;
+
+	typedef simd_vector_iterator<T, S> iterator;
+	typedef simd_vector_simd_iterator<T, S> simd_iterator;
+
+	// Elements per block (k)
+	static DU1SIMD_CONSTEXPR const std::size_t lanes = du1simd::lanes_of<T, S>::value;
+
+	// Alignment of the blocks in bytes
+	static DU1SIMD_CONSTEXPR const std::size_t alignment = sizeof(S);
+
+private:
+	iterator b;
+	iterator e;
+
+public:
+	// Empty span
+	simd_span() : b(), e() { }
+
+	simd_span(iterator first, iterator last) : b(first), e(last)
+	{
+		assert(!(e < b));
+	}
+
+	simd_span(iterator first, std::size_t count) : b(first), e(first + static_cast<difference_type>(count)) { }
+
+	// Span of a whole vector, any container with begin() and end() convertible to iterator
+	template< typename C, typename = typename std::enable_if<std::is_convertible<decltype(std::declval<C&>().begin()), iterator>::value>::type>
+	simd_span(C& c) : b(c.begin()), e(c.end()) { }
+
+	// Conversion of a span to a read-only span
+	template< typename U, typename = typename std::enable_if<std::is_same<const U, T>::value && !std::is_const<U>::value>::type>
+	simd_span(const simd_span<U, S>& s) : b(s.begin()), e(s.end()) { }
+
+	iterator begin() const
+	{
+		return b;
+	}
+
+	iterator end() const
+	{
+		return e;
+	}
+
+	// simd_iterators of the blocks covering the span
+	simd_iterator lower_block() const
+	{
+		return b.lower_block();
+	}
+
+	simd_iterator upper_block() const
+	{
+		return e.upper_block();
+	}
+
+	// Lanes of the first block preceding the span
+	difference_type lower_offset() const
+	{
+		return b.lower_offset();
+	}
+
+	// Lanes of the last block following the span, negative or zero as of simd_vector_iterator
+	difference_type upper_offset() const
+	{
+		return e.upper_offset();
+	}
+
+	// Whether the span starts and ends at a block boundary
+	bool aligned() const
+	{
+		return lower_offset() == 0 && upper_offset() == 0;
+	}
+
+	// Number of blocks covering the span
+	std::size_t blocks() const
+	{
+		return empty() ? 0 : static_cast<std::size_t>(upper_block() - lower_block());
+	}
+
+	std::size_t size() const
+	{
+		return static_cast<std::size_t>(e - b);
+	}
+
+	bool empty() const
+	{
+		return !(b < e);
+	}
+
+	T* data() const
+	{
+		return du1simd::to_address(b);
+	}
+
+	T& operator[](std::size_t i) const
+	{
+		assert(i < size());
+		return b[static_cast<difference_type>(i)];
+	}
+
+	T& front() const
+	{
+		assert(!empty());
+		return *b;
+	}
+
+	T& back() const
+	{
+		assert(!empty());
+		return e[-1];
+	}
+
+	// count elements starting at the element offset
+	self subspan(std::size_t offset, std::size_t count) const
+	{
+		assert(offset <= size() && count <= size() - offset);
+		return self(b + static_cast<difference_type>(offset), count);
+	}
+
+	// Elements from offset to the end
+	self subspan(std::size_t offset) const
+	{
+		assert(offset <= size());
+		return self(b + static_cast<difference_type>(offset), e);
+	}
+
+	self first(std::size_t count) const
+	{
+		return subspan(0, count);
+	}
+
+	self last(std::size_t count) const
+	{
+		assert(count <= size());
+		return subspan(size() - count, count);
+	}
+};
+
+template< typename T, typename S>
+DU1SIMD_CONSTEXPR const std::size_t simd_span<T, S>::lanes;
+
+template< typename T, typename S>
+DU1SIMD_CONSTEXPR const std::size_t simd_span<T, S>::alignment;
+
+namespace du1simd {
+
+	// Span of [b, e), the element type is the one of the iterators
+	template< typename T, typename S>
+	simd_span< T, S> make_span( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e)
+	{
+		return simd_span< T, S>( b, e);
+	}
+
+	// Span of a whole container, read-only for a const container
+	template< typename C>
+	auto make_span( C & c) -> decltype( make_span( c.begin(), c.end()))
+	{
+		return make_span( c.begin(), c.end());
+	}
+};
+
+#endif // DU1SIMD_SPAN_HPP
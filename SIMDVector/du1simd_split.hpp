@@ -0,0 +1,145 @@
+// du1simd_split.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Head / body / tail decomposition of a range
+//
+// du1simd::split( b, e) divides the elements in [b, e) into
+//
+//	head	the lanes [head_lo, head_hi) of the block containing the first element, present if the range
+//		does not start at a block boundary or is shorter than a block,
+//	body	the whole blocks [body_begin, body_end), processed by an unmasked loop of aligned blocks,
+//	tail	the lanes [0, tail_hi) of the block following the body, present if the range does not end
+//		at a block boundary.
+//
+// load_head and load_tail read the partial blocks by du1simd::simd::load_partial, which accesses only
+// the lanes inside of the range (masked loads on AVX and AVX-512, a copy of the lanes otherwise) and
+// zeroes the others. Unlike mask_lower / mask_upper applied to a whole block they never read memory
+// outside of the range, so they are safe on sub-ranges of buffers that are not padded to whole blocks,
+// see split< S>( p, q) for a range of plain pointers.
+//
+// The range may be read-only (const T elements, e.g. the const_iterator of a const vector), the block
+// pointers are const S then.
+//
+
+#ifndef DU1SIMD_SPLIT_HPP
+#define DU1SIMD_SPLIT_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+namespace du1simd {
+
+	template< typename T, typename S>
+	struct block_split {
+		// S or const S
+		typedef typename std::conditional< std::is_const< T>::value, const S, S>::type block_type;
+
+		// Block containing the first element, lanes [head_lo, head_hi) belong to the range
+		block_type * head;
+		std::ptrdiff_t head_lo;
+		std::ptrdiff_t head_hi;
+		// Whole blocks of the range
+		block_type * body_begin;
+		block_type * body_end;
+		// Block following the body, lanes [0, tail_hi) belong to the range
+		block_type * tail;
+		std::ptrdiff_t tail_hi;
+
+		bool has_head() const
+		{
+			return head_lo != head_hi;
+		}
+		bool has_tail() const
+		{
+			return tail_hi != 0;
+		}
+		std::ptrdiff_t blocks() const
+		{
+			return body_end - body_begin;
+		}
+	};
+
+	// Splits [b, e) of elements of T into blocks of S, b need not be aligned to sizeof(S)
+	// Only b must be aligned to sizeof(T), the head and tail pointers may point before b or after e
+	template< typename S, typename T>
+	block_split< T, S> split( T * b, T * e)
+	{
+		static_assert( sizeof(S) % sizeof(T) == 0, "Incompatible type parameters!");
+		const std::size_t lanes = lanes_of< T, S>::value;
+		const std::ptrdiff_t k = lanes;
+
+		typedef typename block_split< T, S>::block_type block_type;
+
+		block_split< T, S> r;
+		r.head = r.body_begin = r.body_end = r.tail = nullptr;
+		r.head_lo = r.head_hi = r.tail_hi = 0;
+
+		if ( ! ( b < e))
+		{
+			return r;
+		}
+
+		std::uintptr_t address = reinterpret_cast< std::uintptr_t>( b);
+		assert( address % sizeof(T) == 0);
+		std::ptrdiff_t lo = static_cast< std::ptrdiff_t>( ( address % sizeof(S)) / sizeof(T));
+		block_type * p = reinterpret_cast< block_type *>( address - lo * sizeof(T));
+		std::ptrdiff_t n = e - b;
+
+		if ( lo != 0 || n < k)
+		{
+			r.head = p;
+			r.head_lo = lo;
+			r.head_hi = std::min( k, lo + n);
+			n -= r.head_hi - lo;
+			++ p;
+		}
+
+		// n >= 0 here, the unsigned division by the constant lane count is a shift
+		std::size_t m = static_cast< std::size_t>( n);
+		r.body_begin = p;
+		r.body_end = p + m / lanes;
+		r.tail_hi = static_cast< std::ptrdiff_t>( m % lanes);
+		if ( r.tail_hi != 0)
+		{
+			r.tail = r.body_end;
+		}
+		return r;
+	}
+
+	// Splits [b, e) of a simd_vector or mapped_simd_vector into blocks of the container
+	template< typename T, typename S>
+	block_split< T, S> split( simd_vector_iterator< T, S> b, simd_vector_iterator< T, S> e)
+	{
+		if ( ! ( b < e))
+		{
+			return split< S>( static_cast< T *>( nullptr), static_cast< T *>( nullptr));
+		}
+		T * p = du1simd::to_address( b);
+		return split< S>( p, p + ( e - b));
+	}
+
+	// The partial first block, the lanes outside of the range are zero
+	template< typename T, typename S>
+	S load_head( const block_split< T, S> & s)
+	{
+		assert( s.has_head());
+		return simd< typename std::remove_const< T>::type, S>::load_partial( s.head, s.head_lo, s.head_hi);
+	}
+
+	// The partial last block, the lanes outside of the range are zero
+	template< typename T, typename S>
+	S load_tail( const block_split< T, S> & s)
+	{
+		assert( s.has_tail());
+		return simd< typename std::remove_const< T>::type, S>::load_partial( s.tail, 0, s.tail_hi);
+	}
+};
+
+#endif // DU1SIMD_SPLIT_HPP
@@ -0,0 +1,504 @@
+// du1simd_stream.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Streaming of unbounded input through recycled simd_vector chunks
+//
+// du1simd::chunk_pool< T, S, A> owns a fixed number of simd_vector chunks of the same capacity, allocated
+// once by the constructor. acquire() moves a free chunk out of the pool (and waits for one if there is
+// none), release() moves it back, so a loop over batches reuses the same aligned blocks instead of
+// allocating a new vector for every batch. allocations() counts the blocks the pool allocated, it only
+// grows if a released chunk was replaced by a smaller one.
+//
+// du1simd::stream_pipeline< T, S, A> reads a source chunk by chunk and calls f( b, e) for every chunk in
+// order. The source is a function std::size_t source( T * p, std::size_t n) which writes at most n
+// elements to p and returns their number, 0 at the end of the input (du1simd::istream_source reads the
+// binary elements of a std::istream). The pipeline calls it until a chunk is full, so all the chunks but
+// the last one hold chunk_size() elements and the stream stays aligned to the blocks of S.
+//
+// The chunks are double-buffered: a reader thread fills the next chunk while f processes the current
+// one, with more than two buffers the reader may run further ahead. The reads overlap the processing, the
+// run takes about the longer of the two instead of their sum:
+//
+//	typedef du1simd::stream_pipeline< float, __m256> pipeline;
+//	pipeline p( 1 << 20);
+//	du1simd::running_sum< float, __m256> s;
+//	p.run( du1simd::istream_source< float>( file), [ & s]( pipeline::iterator b, pipeline::iterator e){ s.add( b, e); });
+//	float total = s.value();
+//
+// In steady state neither the pool nor the pipeline allocates, run() only starts the reader thread. An
+// exception thrown by the source or by f stops the reader and is rethrown by run() after all the chunks
+// were returned to the pool.
+//
+// du1simd::running_sum< T, S, N> carries the N accumulators of reduce_sum (du1simd_reduce.hpp) across
+// chunk boundaries and combines them only in value(), so a stream is summed as one range, not as a sum
+// of the rounded sums of its chunks. running_widening_sum< T, S, N> does the same for widening_sum. The
+// result depends on the input and on the chunk boundaries only, never on the timing of the reader.
+//
+
+#ifndef DU1SIMD_STREAM_HPP
+#define DU1SIMD_STREAM_HPP
+
+#include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_split.hpp"
+#include "du1simd_reduce.hpp"
+#include "du1simd_instrument.hpp"
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <istream>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+namespace du1simd {
+
+	// Elements per chunk of stream_pipeline, 4 MB of floats
+	const std::size_t default_stream_chunk_size = 1 << 20;
+
+	// Fixed set of simd_vector chunks of chunk_size elements, recycled by acquire() and release()
+	// acquire() and release() may be called from different threads
+	template< typename T, typename S, typename A = simd_allocator< T, S> >
+	class chunk_pool {
+	public:
+		typedef simd_vector< T, S, A> chunk_type;
+
+		// count chunks of chunk_size elements rounded up to a multiple of the block size, all allocated here
+		explicit chunk_pool( std::size_t chunk_size = default_stream_chunk_size, std::size_t count = 2, const A & a = A())
+			: chunk_size_( round_up( chunk_size)), count_( count), allocations_( 0)
+		{
+			free_.reserve( count_);
+			for ( std::size_t i = 0; i < count_; ++ i)
+			{
+				chunk_type c( a);
+				c.reserve( chunk_size_);
+				++ allocations_;
+				free_.push_back( std::move( c));
+			}
+		}
+
+		std::size_t chunk_size() const
+		{
+			return chunk_size_;
+		}
+
+		// Number of chunks owned by the pool, free or acquired
+		std::size_t size() const
+		{
+			return count_;
+		}
+
+		// Number of the blocks allocated by the pool since its construction
+		std::size_t allocations() const
+		{
+			std::lock_guard< std::mutex> lock( lock_);
+			return allocations_;
+		}
+
+		// An empty chunk of capacity chunk_size(), waits until one is released if all are acquired
+		chunk_type acquire()
+		{
+			std::unique_lock< std::mutex> lock( lock_);
+			available_.wait( lock, [ this](){ return ! free_.empty(); });
+			chunk_type c( std::move( free_.back()));
+			free_.pop_back();
+			return c;
+		}
+
+		// Returns a chunk acquired from this pool, its elements are destroyed
+		void release( chunk_type && c)
+		{
+			c.clear();
+			bool allocated = c.capacity() < chunk_size_;
+			if ( allocated)
+			{
+				c.reserve( chunk_size_);
+			}
+			{
+				std::lock_guard< std::mutex> lock( lock_);
+				if ( allocated)
+				{
+					++ allocations_;
+				}
+				free_.push_back( std::move( c));
+			}
+			available_.notify_one();
+		}
+
+	private:
+		static std::size_t round_up( std::size_t n)
+		{
+			const std::size_t k = chunk_type::lanes;
+			return std::max( k, ( n + k - 1) / k * k);
+		}
+
+		std::size_t chunk_size_;
+		std::size_t count_;
+		std::size_t allocations_;
+		std::vector< chunk_type> free_;
+		mutable std::mutex lock_;
+		std::condition_variable available_;
+
+		chunk_pool( const chunk_pool &);
+		chunk_pool & operator=( const chunk_pool &);
+	};
+
+	// Source of stream_pipeline reading the binary elements of a stream, a partial last element is dropped
+	template< typename T>
+	class istream_source {
+	public:
+		explicit istream_source( std::istream & is) : is_( & is)
+		{
+		}
+
+		std::size_t operator()( T * p, std::size_t n)
+		{
+			static_assert( std::is_trivially_copyable< T>::value, "Trivially copyable elements required!");
+
+			is_->read( reinterpret_cast< char *>( p), static_cast< std::streamsize>( n * sizeof(T)));
+			return static_cast< std::size_t>( is_->gcount()) / sizeof(T);
+		}
+
+	private:
+		std::istream * is_;
+	};
+
+	// Reads a source in chunks of a chunk_pool and processes each chunk while the reader fills the next one
+	template< typename T, typename S, typename A = simd_allocator< T, S> >
+	class stream_pipeline {
+	public:
+		typedef chunk_pool< T, S, A> pool_type;
+		typedef typename pool_type::chunk_type chunk_type;
+		typedef simd_vector_iterator< T, S> iterator;
+
+		// buffers chunks of chunk_size elements, at least two so that the reads overlap the processing
+		explicit stream_pipeline( std::size_t chunk_size = default_stream_chunk_size, std::size_t buffers = 2, const A & a = A())
+			: pool_( chunk_size, std::max< std::size_t>( buffers, 2), a), ready_( pool_.size()), head_( 0), queued_( 0), done_( false), stop_( false)
+		{
+		}
+
+		pool_type & pool()
+		{
+			return pool_;
+		}
+
+		std::size_t chunk_size() const
+		{
+			return pool_.chunk_size();
+		}
+
+		// Calls f( b, e) for the chunks of the source in order, returns the number of elements processed
+		// The iterators are valid during the call only
+		template< typename R, typename F>
+		std::size_t run( R source, F f)
+		{
+			head_ = 0;
+			queued_ = 0;
+			done_ = false;
+			stop_ = false;
+			error_ = nullptr;
+
+			std::thread reader( [ this, & source](){ read_all( source); });
+
+			std::size_t total = 0;
+			std::exception_ptr error;
+			chunk_type c;
+			bool held = false;
+			try
+			{
+				while ( pop( c))
+				{
+					held = true;
+					{
+						DU1SIMD_INSTRUMENT_BYTES( "stream_pipeline::process", c.size() * sizeof(T));
+						f( c.begin(), c.end());
+					}
+					total += c.size();
+					held = false;
+					pool_.release( std::move( c));
+				}
+			}
+			catch ( ...)
+			{
+				error = std::current_exception();
+				{
+					std::lock_guard< std::mutex> lock( lock_);
+					stop_ = true;
+				}
+				if ( held)
+				{
+					pool_.release( std::move( c));
+				}
+			}
+
+			// The chunk released above is free, so the reader cannot block in acquire() and sees stop_
+			drain();
+			reader.join();
+			drain();
+
+			if ( ! error)
+			{
+				error = error_;
+			}
+			if ( error)
+			{
+				std::rethrow_exception( error);
+			}
+			return total;
+		}
+
+	private:
+		// Reader thread, fills the chunks until the source ends, the pipeline stops or the source throws
+		template< typename R>
+		void read_all( R & source)
+		{
+			chunk_type c;
+			bool held = false;
+			try
+			{
+				for ( ;;)
+				{
+					c = pool_.acquire();
+					held = true;
+					if ( stopped())
+					{
+						break;
+					}
+
+					std::size_t n = 0;
+					{
+						DU1SIMD_INSTRUMENT_BYTES( "stream_pipeline::read", pool_.chunk_size() * sizeof(T));
+
+						c.resize( pool_.chunk_size(), uninitialized);
+						T * p = to_address( c.begin());
+						for ( std::size_t m = 0; n < c.size(); n += m)
+						{
+							m = source( p + n, c.size() - n);
+							if ( m == 0)
+							{
+								break;
+							}
+						}
+						c.resize( n, uninitialized);
+					}
+
+					if ( n == 0)
+					{
+						break;
+					}
+					bool last = n < pool_.chunk_size();
+					held = false;
+					push( std::move( c));
+					if ( last)
+					{
+						break;
+					}
+				}
+			}
+			catch ( ...)
+			{
+				std::lock_guard< std::mutex> lock( lock_);
+				error_ = std::current_exception();
+			}
+			if ( held)
+			{
+				pool_.release( std::move( c));
+			}
+
+			{
+				std::lock_guard< std::mutex> lock( lock_);
+				done_ = true;
+			}
+			ready_signal_.notify_one();
+		}
+
+		bool stopped()
+		{
+			std::lock_guard< std::mutex> lock( lock_);
+			return stop_;
+		}
+
+		// Queues a filled chunk, the queue holds all the chunks of the pool, so it is never full
+		void push( chunk_type && c)
+		{
+			{
+				std::lock_guard< std::mutex> lock( lock_);
+				ready_[ ( head_ + queued_) % ready_.size()] = std::move( c);
+				++ queued_;
+			}
+			ready_signal_.notify_one();
+		}
+
+		// Takes the oldest filled chunk, false once the reader finished and the queue is empty
+		bool pop( chunk_type & c)
+		{
+			std::unique_lock< std::mutex> lock( lock_);
+			ready_signal_.wait( lock, [ this](){ return queued_ != 0 || done_; });
+			if ( queued_ == 0)
+			{
+				return false;
+			}
+			c = std::move( ready_[ head_]);
+			head_ = ( head_ + 1) % ready_.size();
+			-- queued_;
+			return true;
+		}
+
+		// Returns the queued chunks to the pool
+		void drain()
+		{
+			std::unique_lock< std::mutex> lock( lock_);
+			while ( queued_ != 0)
+			{
+				chunk_type c( std::move( ready_[ head_]));
+				head_ = ( head_ + 1) % ready_.size();
+				-- queued_;
+				lock.unlock();
+				pool_.release( std::move( c));
+				lock.lock();
+			}
+		}
+
+		pool_type pool_;
+		// Ring of the filled chunks, queued_ chunks starting at head_
+		std::vector< chunk_type> ready_;
+		std::size_t head_;
+		std::size_t queued_;
+		bool done_;
+		bool stop_;
+		std::exception_ptr error_;
+		std::mutex lock_;
+		std::condition_variable ready_signal_;
+
+		stream_pipeline( const stream_pipeline &);
+		stream_pipeline & operator=( const stream_pipeline &);
+	};
+
+	// Sum of the elements of consecutive ranges in the N accumulators of reduce_sum, kept across the ranges
+	template< typename T, typename S, std::size_t N = default_accumulators>
+	class running_sum {
+		static_assert( N > 0, "At least one accumulator is required!");
+
+		typedef simd< T, S> simd_op;
+		typedef detail::accumulators< T, S, N> acc_type;
+
+	public:
+		running_sum()
+		{
+			acc_type::zero( acc_);
+		}
+
+		// Adds the elements of [b, e), the whole blocks go to the accumulators in turn
+		template< typename U>
+		void add( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e)
+		{
+			static_assert( std::is_same< typename std::remove_const< U>::type, T>::value, "Incompatible element type!");
+
+			block_split< U, S> s = split( b, e);
+			if ( s.has_head())
+			{
+				acc_[ 0] = simd_op::add( acc_[ 0], load_head( s));
+			}
+
+			const S * p = s.body_begin;
+			const std::ptrdiff_t n = s.blocks();
+			const std::ptrdiff_t full = n - n % static_cast< std::ptrdiff_t>( N);
+			detail::identity< S> f;
+			for ( std::ptrdiff_t i = 0; i < full; i += N)
+			{
+				acc_type::add( acc_, p + i, f);
+			}
+			for ( std::ptrdiff_t i = full, j = 0; i < n; ++ i, ++ j)
+			{
+				acc_[ j] = simd_op::add( acc_[ j], p[ i]);
+			}
+
+			if ( s.has_tail())
+			{
+				acc_[ N - 1] = simd_op::add( acc_[ N - 1], load_tail( s));
+			}
+		}
+
+		// Sum of all the elements added so far
+		T value() const
+		{
+			S acc[ N];
+			std::copy( acc_, acc_ + N, acc);
+			return simd_op::sum( acc_type::combine( acc));
+		}
+
+	private:
+		S acc_[ N];
+	};
+
+	// Widening sum of the integer elements of consecutive ranges (widening_sum of du1simd_reduce.hpp)
+	template< typename T, typename S, std::size_t N = default_accumulators>
+	class running_widening_sum {
+		static_assert( N > 0, "At least one accumulator is required!");
+
+		typedef simd< T, S> simd_op;
+
+	public:
+		typedef typename simd_op::wide_type wide_type;
+
+		running_widening_sum()
+		{
+			for ( std::size_t j = 0; j < N; ++ j)
+			{
+				acc_[ j] = simd_op::zero();
+			}
+		}
+
+		template< typename U>
+		void add( simd_vector_iterator< U, S> b, simd_vector_iterator< U, S> e)
+		{
+			static_assert( std::is_same< typename std::remove_const< U>::type, T>::value, "Incompatible element type!");
+
+			block_split< U, S> s = split( b, e);
+			if ( s.has_head())
+			{
+				acc_[ 0] = simd_op::wide_add( acc_[ 0], load_head( s));
+			}
+
+			const S * p = s.body_begin;
+			const std::ptrdiff_t n = s.blocks();
+			std::ptrdiff_t i = 0;
+			for ( ; i + static_cast< std::ptrdiff_t>( N) <= n; i += N)
+			{
+				for ( std::size_t j = 0; j < N; ++ j)
+				{
+					acc_[ j] = simd_op::wide_add( acc_[ j], p[ i + j]);
+				}
+			}
+			for ( std::size_t j = 0; i < n; ++ i, ++ j)
+			{
+				acc_[ j] = simd_op::wide_add( acc_[ j], p[ i]);
+			}
+
+			if ( s.has_tail())
+			{
+				acc_[ N - 1] = simd_op::wide_add( acc_[ N - 1], load_tail( s));
+			}
+		}
+
+		wide_type value() const
+		{
+			wide_type r = 0;
+			for ( std::size_t j = 0; j < N; ++ j)
+			{
+				r += simd_op::wide_sum( acc_[ j]);
+			}
+			return r;
+		}
+
+	private:
+		S acc_[ N];
+	};
+};
+
+#endif // DU1SIMD_STREAM_HPP
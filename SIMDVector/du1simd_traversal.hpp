@@ -0,0 +1,105 @@
+// du1simd_traversal.hpp
+// Petr Kubt NPRG051 2013/2014
+
+//
+// Traversal policies of the block loops of the reduction kernels
+//
+// A policy decides the order in which a kernel visits the full blocks [p, p + n) and which memory hints
+// it issues on the way. The kernels take it as a template parameter:
+//
+//	float s = du1simd::reduce_sum< 8, du1simd::prefetch_traversal< 1024>>( v.begin(), v.end());
+//
+// du1simd::sequential_traversal visits the range in one run and issues no hints, it is the default of all
+// kernels and compiles to the plain loop.
+//
+// du1simd::prefetch_traversal< distance, tile> visits the range in runs and, before each run, prefetches
+// the blocks of the run distance bytes ahead. The run is one cache line if tile is 0, the prefetches are
+// then interleaved with the loads. Otherwise the run is a tile of tile bytes and its prefetches are issued
+// in a burst, distance == tile fetches the next tile while the current one is processed. The hardware
+// prefetchers do not cross page boundaries, the software prefetch keeps the loads of a range much larger
+// than the last level cache in flight at the start of every page. Within the caches the prefetches only
+// cost issue slots, so the policy pays off for ranges in DRAM only.
+//
+// The runs are multiples of the granule requested by the kernel (e.g. the number of its accumulators),
+// so the policy never changes the order of the operations and the result of the kernel.
+//
+
+#ifndef DU1SIMD_TRAVERSAL_HPP
+#define DU1SIMD_TRAVERSAL_HPP
+
+#include "du1simd_ops.hpp"
+
+#include <cstddef>
+#include <algorithm>
+
+namespace du1simd {
+
+	// Size of the cache line of current x86 and ARM cores in bytes
+	const std::size_t cache_line_size = 64;
+
+	// Prefetch distance of one page, the lines of the next page are requested before its first load
+	const std::size_t default_prefetch_distance = 4096;
+
+	// Fetches the cache line of p into all levels of the cache, never faults
+	inline void prefetch( const void * p)
+	{
+#if DU1SIMD_HAVE_SSE
+		_mm_prefetch( static_cast< const char *>( p), _MM_HINT_T0);
+#elif defined(__GNUC__)
+		__builtin_prefetch( p, 0, 3);
+#else
+		( void) p;
+#endif
+	}
+
+	// Prefetches the cache lines of [b, e)
+	inline void prefetch_range( const char * b, const char * e)
+	{
+		for ( ; b < e; b += cache_line_size)
+		{
+			prefetch( b);
+		}
+	}
+
+	// The whole range in one run
+	struct sequential_traversal {
+		// Calls f( q, m) for consecutive runs [q, q + m) covering [p, p + n), m is a multiple of granule
+		// except for the last run
+		template< typename S, typename F>
+		static void visit( const S * p, std::ptrdiff_t n, std::ptrdiff_t, F & f)
+		{
+			if ( n > 0)
+			{
+				f( p, n);
+			}
+		}
+	};
+
+	// Runs of one cache line or of one tile, each prefetching the run distance bytes ahead
+	template< std::size_t distance = default_prefetch_distance, std::size_t tile = 0>
+	struct prefetch_traversal {
+		template< typename S, typename F>
+		static void visit( const S * p, std::ptrdiff_t n, std::ptrdiff_t granule, F & f)
+		{
+			const std::ptrdiff_t run_bytes = static_cast< std::ptrdiff_t>( tile != 0 ? tile : cache_line_size);
+			const std::ptrdiff_t ahead = static_cast< std::ptrdiff_t>( distance / sizeof(S));
+
+			std::ptrdiff_t run = std::max< std::ptrdiff_t>( 1, run_bytes / static_cast< std::ptrdiff_t>( sizeof(S)));
+			run = ( run + granule - 1) / granule * granule;
+
+			for ( std::ptrdiff_t i = 0; i < n; i += run)
+			{
+				std::ptrdiff_t m = std::min( run, n - i);
+				// The blocks past the end of the range are not prefetched
+				if ( i + ahead < n)
+				{
+					std::ptrdiff_t hi = std::min( n, i + ahead + m);
+					prefetch_range( reinterpret_cast< const char *>( p + i + ahead), reinterpret_cast< const char *>( p + hi));
+				}
+				f( p + i, m);
+			}
+		}
+	};
+};
+
+#endif // DU1SIMD_TRAVERSAL_HPP
@@ -1,244 +1,1763 @@
 #include "du1simd.hpp"
+#include "du1simd_ops.hpp"
+#include "du1simd_ops_int.hpp"
+#include "du1simd_dispatch.hpp"
+#include "du1simd_reduce.hpp"
+#include "du1simd_parallel.hpp"
+#include "du1simd_algorithm.hpp"
+#include "du1simd_mmap.hpp"
+#include "du1simd_blas.hpp"
+#include "du1simd_soa.hpp"
+#include "du1simd_filter.hpp"
+#include "du1simd_sort.hpp"
+#include "du1simd_scan.hpp"
+#include "du1simd_span.hpp"
+#include "du1simd_instrument.hpp"
+#include "du1simd_histogram.hpp"
+#include "du1simd_gather.hpp"
+#include "du1simd_packed.hpp"
+#include "du1simd_stream.hpp"
+#include "du1simd_math.hpp"
+#include "du1bench.hpp"
 
 #include <memory>
 #include <algorithm>
-#include <xmmintrin.h>
-#include <pmmintrin.h>
 #include <cassert>
 #include <string>
 #include <iostream>
-#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <tuple>
+#include <iterator>
+#include <limits>
+#include <cmath>
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <cstdlib>
 
 #include <cstdint>
 
 
-namespace du1simd {
+namespace du1example {
+
+	// Single run for the quick report of the tests, use --benchmark (du1bench.hpp) for measurements
+	template< typename F>
+	double measure_time( F f)
+	{
+		return du1bench::time_once( f);
+	}
+
+	// Release size of a tester keeping bytes_per_element in all its vectors together, so that no tester takes
+	// more memory than the 729M floats (2.9 GB) of tester itself
+	std::size_t release_size( std::size_t bytes_per_element)
+	{
+		return 729000000 * sizeof( float) / bytes_per_element;
+	}
+
+	template< typename simd_carrier_type>
+	struct tester
+	{
+		typedef simd_vector< float, simd_carrier_type> vector_type;
+
+		typedef typename vector_type::iterator simd_iterator;
+
+		typedef du1simd::simd< float, simd_carrier_type> simd_op;
+
+		static float sum( simd_iterator b, simd_iterator e)
+		{
+			float acc = 0;
+
+			for (; b != e; ++ b)
+			{
+				acc = acc + * b;
+			}
+
+			return acc;
+		}
+
+		static float simd_sum( simd_iterator b, simd_iterator e)
+		{
+			auto bb = b.lower_block();
+			auto ee = e.upper_block();
+
+			if ( bb == ee )
+			{
+				return 0;
+			}
+
+			-- ee;
+
+			if ( bb == ee )
+			{
+				return simd_op::sum( simd_op::mask_both( * bb, b.lower_offset(), e.upper_offset()));
+			}
+
+			simd_carrier_type acc = simd_op::mask_lower( * bb, b.lower_offset());
+
+			for ( ++ bb; bb != ee; ++ bb)
+			{
+				acc = simd_op::add( acc, * bb);
+			}
+
+			return simd_op::sum( simd_op::add( acc, simd_op::mask_upper( * bb, e.upper_offset())));
+		}
+
+		static void test( const std::string & name)
+		{
+#ifdef _DEBUG
+			std::size_t K1 = 111, K2 = 700666, K3 = 729000;
+#else
+			std::size_t K1 = 111, K2 = 700000666, K3 = 729000000;
+#endif
+			float X1 = 0.0F, X2 = 1.00F;
+
+			vector_type vec( K3, du1simd::uninitialized);
+
+			float gen = X1;
+			/*
+			long long i = 0;
+			for (auto it = vec.begin(); it != vec.end(); it++) {
+				i++;
+				if (i % 1000 == 0) std::cout << i << std::endl;
+				(*it) = 15;
+			}
+			*/
+			// gen + X2, gen + 2 * X2, ... written a whole block at a time
+			const std::size_t k = sizeof(simd_carrier_type) / sizeof(float);
+			float lanes[ k];
+			for ( std::size_t j = 0; j < k; ++ j)
+			{
+				lanes[ j] = gen + (j + 1) * X2;
+			}
+			simd_carrier_type block;
+			std::memcpy( & block, lanes, sizeof(block));
+			simd_carrier_type step = simd_op::broadcast( k * X2);
+			double t0 = measure_time( [ & vec, & block, step](){
+				du1simd::generate_blocks( vec.begin(), vec.end(), [ & block, step](){
+					simd_carrier_type r = block;
+					block = simd_op::add( block, step);
+					return r;
+				});
+			});
+
+			auto b = vec.begin() + K1;
+			auto e = vec.begin() + K2;
+
+			float s1; 
+			double t1 = measure_time( [ & s1, b, e](){
+				s1 = sum( b, e);
+			});
+			float s2;
+			double t2 = measure_time( [ & s2, b, e](){
+				s2 = simd_sum( b, e);
+			});
+
+			float s3;
+			double t3 = measure_time( [ & s3, b, e](){
+				s3 = du1simd::reduce_sum( b, e);
+			});
+			float s4;
+			double t4 = measure_time( [ & s4, b, e](){
+				s4 = du1simd::parallel_reduce_sum( b, e);
+			});
+			float s5;
+			double t5 = measure_time( [ & s5, b, e](){
+				s5 = du1simd::reduce_sum< du1simd::default_accumulators, du1simd::prefetch_traversal<>>( b, e);
+			});
+			float s6;
+			double t6 = measure_time( [ & s6, b, e](){
+				s6 = du1simd::reduce_sum< du1simd::default_accumulators, du1simd::prefetch_traversal< 4096, 4096>>( b, e);
+			});
+			float s7;
+			double t7 = measure_time( [ & s7, b, e](){
+				s7 = du1simd::reduce_sum< du1simd::default_accumulators, du1simd::sequential_traversal, du1simd::compensated_summation>( b, e);
+			});
+			float s8;
+			double t8 = measure_time( [ & s8, b, e](){
+				s8 = du1simd::parallel_reduce_sum< du1simd::default_accumulators, du1simd::sequential_traversal, du1simd::compensated_summation>( b, e);
+			});
+			du1simd::thread_pool single( 1), triple( 3);
+			float s9 = du1simd::parallel_reduce_sum< du1simd::default_accumulators, du1simd::sequential_traversal, du1simd::compensated_summation>( b, e, single);
+			float s10 = du1simd::parallel_reduce_sum< du1simd::default_accumulators, du1simd::sequential_traversal, du1simd::compensated_summation>( b, e, triple);
+
+			// Sum of the stored elements in double, exact up to a few ulp of the float result
+			double ref = 0;
+			for ( auto it = b; it != e; ++ it)
+			{
+				ref += * it;
+			}
+
+#ifdef _DEBUG
+			// The plain float sums are within 0.1% at the debug size only, at the release size the additions of
+			// the elements round away once an accumulator exceeds 2^25 times their value
+			assert( std::abs(s1 - s2) / std::abs(s1 + s2) < 0.001);
+			assert( std::abs( s1 - ref) / ref < 0.001);
+			assert( std::abs( s3 - ref) / ref < 0.001);
+			assert( std::abs( s4 - ref) / ref < 0.001);
+#endif
+			// The traversal policy does not change the order of the additions
+			assert( s5 == s3 && s6 == s3);
+			// The accuracy of the tester at every size: the compensated sums are the float nearest to the sum of
+			// the stored elements up to an ulp, independently of the threads
+			assert( std::abs( s7 - ref) / ref < 2e-7);
+			assert( std::abs( s8 - ref) / ref < 2e-7);
+			assert( s9 == s8 && s10 == s8);
+
+			std::cout << name << "/generate_blocks: " << (1000000000.0 * t0 / K3) << " ns" << std::endl;
+			std::cout << name << "/sum: " << (1000000000.0 * t1 / (K2-K1)) << " ns" << std::endl;
+			std::cout << name << "/simd_sum: " << (1000000000.0 * t2 / (K2-K1)) << " ns" << std::endl;
+			std::cout << name << "/reduce_sum: " << (1000000000.0 * t3 / (K2-K1)) << " ns" << std::endl;
+			std::cout << name << "/parallel_reduce_sum: " << (1000000000.0 * t4 / (K2-K1)) << " ns" << std::endl;
+			std::cout << name << "/reduce_sum/prefetch: " << (1000000000.0 * t5 / (K2-K1)) << " ns" << std::endl;
+			std::cout << name << "/reduce_sum/prefetch_tiled: " << (1000000000.0 * t6 / (K2-K1)) << " ns" << std::endl;
+			std::cout << name << "/reduce_sum/compensated: " << (1000000000.0 * t7 / (K2-K1)) << " ns" << std::endl;
+			std::cout << name << "/parallel_reduce_sum/compensated: " << (1000000000.0 * t8 / (K2-K1)) << " ns" << std::endl;
+			std::cout << name << "/relative_error: sum " << std::abs( s1 - ref) / ref << ", simd_sum " << std::abs( s2 - ref) / ref
+				<< ", reduce_sum " << std::abs( s3 - ref) / ref << ", compensated " << std::abs( s7 - ref) / ref << std::endl;
+		}
+	};
+
+	// Runs the tester with the carrier selected by du1simd::dispatch, named by the width of the carrier
+	// The tester is not registered by the units of the wider levels, it runs the compiled-in carriers only
+	template< typename simd_carrier_type>
+	struct dispatched_tester
+	{
+		static void run()
+		{
+			tester< simd_carrier_type>::test( "dispatch/" + std::to_string( 8 * sizeof( simd_carrier_type)));
+		}
+	};
+
+	// The kernels registered by the units run the widest carrier of the host even in a baseline build
+	void dispatch_test()
+	{
+		du1simd::isa level = du1simd::best_isa();
+		std::size_t bytes = du1simd::dispatch< du1simd::carrier_size_kernel>();
+
+#if DU1SIMD_HAVE_SSE
+		// isa::avx without AVX2 has no unit, __m256 runs there only if it is compiled in
+		du1simd::isa host = du1simd::detect_isa();
+		if ( host == du1simd::isa::avx && du1simd::compiled_isa() < du1simd::isa::avx)
+		{
+			host = du1simd::isa::sse3;
+		}
+		const std::size_t sizes[] = { sizeof( float), 16, 32, 32, 64 };
+		assert( level == host);
+		assert( bytes == sizes[ static_cast< std::size_t>( level)]);
+#endif
+
+		// Sub-ranges of every alignment of a buffer which is not padded to whole blocks, the sums are exact
+		std::vector< float> x( 1021);
+		for ( std::size_t i = 0; i < x.size(); ++ i)
+		{
+			x[ i] = static_cast< float>( i % 7);
+		}
+		for ( std::size_t o = 0; o < 17; ++ o)
+		{
+			for ( std::size_t n : { std::size_t( 0), std::size_t( 1), std::size_t( 15), std::size_t( 16), std::size_t( 17), std::size_t( 1000)})
+			{
+				const float * p = x.data() + o;
+				float ref = 0;
+				for ( std::size_t i = 0; i < n; ++ i)
+				{
+					ref += p[ i];
+				}
+				assert( du1simd::dispatch< du1simd::reduce_sum_kernel>( p, p + n) == ref);
+			}
+		}
+
+		std::cout << "dispatch/" << du1simd::isa_name( level) << "/carrier_size: " << bytes << std::endl;
+	}
+
+	void test()
+	{
+		tester< float>::test( "float");
+#if DU1SIMD_HAVE_SSE
+		tester< __m128>::test( "__m128");
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
+		{
+			tester< __m256>::test( "__m256");
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			tester< __m512>::test( "__m512");
+		}
+#endif
+#if DU1SIMD_HAVE_NEON
+		tester< float32x4_t>::test( "float32x4_t");
+#endif
+#if DU1SIMD_HAVE_SVE
+		if ( du1simd::supports( du1simd::isa::sve))
+		{
+			tester< du1simd::sve_float32_t>::test( "sve_float32_t");
+		}
+#endif
+		du1simd::dispatch< dispatched_tester>();
+		dispatch_test();
+	}
+
+	// Compares the allocation policies on the parallel first touch and on a parallel reduction
+	template< typename simd_carrier_type>
+	struct allocation_tester
+	{
+		template< typename allocator_type>
+		static void test_policy( const std::string & name, const allocator_type & alloc)
+		{
+#ifdef _DEBUG
+			std::size_t K3 = 729000;
+#else
+			std::size_t K3 = 729000000;
+#endif
+			typedef simd_vector< float, simd_carrier_type, allocator_type> vector_type;
+
+			vector_type vec;
+			double t1 = measure_time( [ & vec, & alloc, K3](){
+				vec = vector_type( K3, du1simd::uninitialized, alloc);
+				du1simd::parallel_fill( vec.begin(), vec.end(), 1.0F);
+			});
+			float s;
+			double t2 = measure_time( [ & vec, & s](){
+				s = du1simd::parallel_reduce_sum( vec.begin(), vec.end());
+			});
+
+			assert( std::abs(s - K3) / (s + K3) < 0.001);
+
+			std::cout << "alloc/" << name << "/touch: " << (1000000000.0 * t1 / K3) << " ns" << std::endl;
+			std::cout << "alloc/" << name << "/parallel_reduce_sum: " << (1000000000.0 * t2 / K3) << " ns" << std::endl;
+		}
+
+		static void test()
+		{
+			using du1simd::page_allocator;
+			using du1simd::page_options;
+			using du1simd::page_size;
+			using du1simd::numa_policy;
+
+			test_policy( "aligned_alloc", du1simd::simd_allocator< float, simd_carrier_type>());
+			test_policy( "pages", page_allocator< float>());
+			test_policy( "thp", page_allocator< float>( page_options( page_size::transparent_huge)));
+			test_policy( "huge_2mb", page_allocator< float>( page_options( page_size::huge_2mb)));
+			test_policy( "huge_1gb", page_allocator< float>( page_options( page_size::huge_1gb)));
+			test_policy( "interleave", page_allocator< float>( page_options( page_size::normal, numa_policy::interleave)));
+			test_policy( "thp_interleave", page_allocator< float>( page_options( page_size::transparent_huge, numa_policy::interleave)));
+			test_policy( "bind", page_allocator< float>( page_options( page_size::normal, numa_policy::bind, 0)));
+
+			// A bind to a node which does not exist is rejected, a refused policy is reported
+			const int nodes[] = { -1, du1simd::max_numa_nodes, 1000 };
+			for ( int node : nodes)
+			{
+				bool rejected = false;
+				try
+				{
+					du1simd::page_allocate( 4096, page_options( page_size::normal, numa_policy::bind, node));
+				}
+				catch ( const std::invalid_argument &)
+				{
+					rejected = true;
+				}
+				assert( rejected);
+			}
+			void * p = du1simd::page_allocate( 4096, page_options( page_size::normal, numa_policy::bind, 0));
+			int error = du1simd::last_numa_error();
+			du1simd::page_deallocate( p, 4096, page_options( page_size::normal, numa_policy::bind, 0));
+			p = du1simd::page_allocate( 4096, page_options());
+			assert( du1simd::last_numa_error() == 0);
+			du1simd::page_deallocate( p, 4096, page_options());
+
+			std::cout << "alloc/bind/numa_error: " << error << std::endl;
+		}
+	};
+
+	void allocation_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		allocation_tester< __m128>::test();
+#elif DU1SIMD_HAVE_NEON
+		allocation_tester< float32x4_t>::test();
+#endif
+	}
+
+	template< typename simd_carrier_type>
+	struct mapping_tester
+	{
+		typedef mapped_simd_vector< float, simd_carrier_type> vector_type;
+
+		// Path in the temporary directory, the file is removed when the guard goes out of scope
+		struct temporary_file {
+			std::string path;
+
+			explicit temporary_file( const std::string & name)
+			{
+				const char * dir = std::getenv( "TMPDIR");
+				if ( ! dir)
+				{
+					dir = std::getenv( "TEMP");
+				}
+#if defined(_WIN32)
+				path = std::string( dir ? dir : ".") + "\\" + name;
+#else
+				path = std::string( dir ? dir : "/tmp") + "/" + name;
+#endif
+			}
+			~temporary_file()
+			{
+				std::remove( path.c_str());
+			}
+		};
+
+		// Writes a vector file of the header h followed by n zero bytes
+		static void write_file( const std::string & path, const du1simd::mapped_header & h, std::size_t n)
+		{
+			std::ofstream f( path, std::ios::binary | std::ios::trunc);
+			f.write( reinterpret_cast< const char *>( & h), sizeof( h));
+			std::vector< char> zeros( n);
+			f.write( zeros.data(), zeros.size());
+			assert( f);
+		}
+
+		static bool rejected( const std::string & path)
+		{
+			try
+			{
+				vector_type vec( path);
+			}
+			catch ( const mapping_exception &)
+			{
+				return true;
+			}
+			return false;
+		}
+
+		// Files whose header does not match the payload are rejected before the payload is trusted
+		static void test_corrupt( const std::string & path)
+		{
+			const std::uint64_t k = sizeof( simd_carrier_type) / sizeof( float);
+			const std::uint64_t offset = ( ( sizeof( du1simd::mapped_header) + sizeof( simd_carrier_type) - 1) / sizeof( simd_carrier_type)) * sizeof( simd_carrier_type);
+
+			du1simd::mapped_header h;
+			std::memset( & h, 0, sizeof( h));
+			std::memcpy( h.magic, du1simd::mapped_magic, sizeof( h.magic));
+			h.version = du1simd::mapped_version;
+			h.element_size = sizeof( float);
+			h.block_size = sizeof( simd_carrier_type);
+			h.size = 1000;
+			h.payload_offset = offset;
+
+			const std::size_t payload = 1000 * sizeof( float);
+			write_file( path, h, offset - sizeof( h) + payload);
+			assert( vector_type( path).size() == 1000);
+
+			// Payload truncated by one block
+			write_file( path, h, offset - sizeof( h) + payload - sizeof( simd_carrier_type));
+			assert( rejected( path));
+
+			// Sizes whose byte counts wrap around
+			h.size = UINT64_MAX;
+			write_file( path, h, offset - sizeof( h) + payload);
+			assert( rejected( path));
+			h.size = UINT64_MAX / sizeof( float) + 1 - k;
+			write_file( path, h, offset - sizeof( h) + payload);
+			assert( rejected( path));
+
+			// Payload overlapping the header or starting past the end of the file
+			h.size = 0;
+			h.payload_offset = 0;
+			write_file( path, h, offset - sizeof( h) + payload);
+			assert( rejected( path));
+			h.payload_offset = UINT64_MAX - sizeof( simd_carrier_type) + 1;
+			write_file( path, h, offset - sizeof( h) + payload);
+			assert( rejected( path));
+
+			// Header cut short
+			std::ofstream( path, std::ios::binary | std::ios::trunc).write( "DU1SIMD", 8);
+			assert( rejected( path));
+		}
+
+		static void test()
+		{
+#ifdef _DEBUG
+			std::size_t K3 = 729001;
+#else
+			std::size_t K3 = 7290001;
+#endif
+			temporary_file file( "du1simd_mapping_test.bin");
+			const std::string & path = file.path;
+
+			test_corrupt( path);
+
+			float s1, s2;
+			double t1 = measure_time( [ & path, & s1, K3](){
+				vector_type vec( path, K3);
+				du1simd::parallel_fill( vec.begin(), vec.end(), 1.0F);
+				s1 = du1simd::parallel_reduce_sum( vec.begin(), vec.end());
+				vec.flush();
+			});
+			double t2 = measure_time( [ & path, & s2](){
+				const vector_type vec( path);
+				vec.advise( du1simd::access_advice::sequential);
+				s2 = du1simd::parallel_reduce_sum( vec.begin(), vec.end());
+			});
+
+			assert( s1 == s2);
+			assert( std::abs(s2 - K3) / (s2 + K3) < 0.001);
+
+			std::cout << "mapping/create: " << (1000000000.0 * t1 / K3) << " ns" << std::endl;
+			std::cout << "mapping/read_only: " << (1000000000.0 * t2 / K3) << " ns" << std::endl;
+		}
+	};
+
+	void mapping_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		mapping_tester< __m128>::test();
+#elif DU1SIMD_HAVE_NEON
+		mapping_tester< float32x4_t>::test();
+#endif
+	}
+
+	// Widening sum of bytes and saturating arithmetic of the integer carriers
+	template< typename simd_carrier_type>
+	struct integer_tester
+	{
+		static void test( const std::string & name)
+		{
+#ifdef _DEBUG
+			std::size_t K3 = 729001;
+#else
+			std::size_t K3 = 729000001;
+#endif
+			typedef simd_vector< std::uint8_t, simd_carrier_type> vector_type;
+			typedef du1simd::simd< std::uint8_t, simd_carrier_type> simd_op;
+
+			vector_type vec( K3, du1simd::uninitialized);
+			du1simd::fill( vec.begin(), vec.end(), std::uint8_t( 255));
+
+			std::uint64_t s;
+			double t = measure_time( [ & vec, & s](){
+				s = du1simd::widening_sum( vec.begin() + 1, vec.end() - 1);
+			});
+
+			assert( s == 255 * std::uint64_t( K3 - 2));
+
+			simd_carrier_type a = simd_op::adds( simd_op::broadcast( 200), simd_op::broadcast( 100));
+			simd_carrier_type d = simd_op::subs( simd_op::broadcast( 100), simd_op::broadcast( 200));
+			assert( simd_op::wide_sum( simd_op::wide_add( simd_op::zero(), a)) == 255 * ( sizeof( simd_carrier_type)));
+			assert( simd_op::wide_sum( simd_op::wide_add( simd_op::zero(), d)) == 0);
+
+			std::cout << name << "/widening_sum: " << (1000000000.0 * t / K3) << " ns" << std::endl;
+		}
+	};
+
+	void integer_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		integer_tester< __m128i>::test( "__m128i");
+#endif
+#if DU1SIMD_HAVE_AVX2
+		if ( du1simd::supports( du1simd::isa::avx2))
+		{
+			integer_tester< __m256i>::test( "__m256i");
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512BW
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			integer_tester< __m512i>::test( "__m512i");
+		}
+#endif
+	}
+
+	// BLAS level 1 kernels on ranges not aligned to the blocks
+	template< typename simd_carrier_type>
+	struct blas_tester
+	{
+		static void test( const std::string & name)
+		{
+#ifdef _DEBUG
+			std::size_t K1 = 111, K3 = 729000;
+#else
+			// x and y
+			std::size_t K1 = 111, K3 = release_size( 2 * sizeof( float));
+#endif
+			typedef simd_vector< float, simd_carrier_type> vector_type;
+
+			vector_type x( K3, du1simd::uninitialized), y( K3, du1simd::uninitialized);
+			du1simd::fill( x.begin(), x.end(), -1.0F);
+			du1simd::fill( y.begin(), y.end(), 2.0F);
+			x.begin()[ K3 / 2] = 3.0F;
+
+			auto b = x.begin() + K1;
+			auto e = x.end() - 1;
+			auto d = y.begin() + K1;
+			float n = static_cast< float>( e - b);
+
+			float s1;
+			double t1 = measure_time( [ & s1, b, e, d](){
+				s1 = du1simd::dot( b, e, d);
+			});
+			double t2 = measure_time( [ b, e, d](){
+				du1simd::axpy( 0.5F, b, e, d);
+			});
+			float s3 = du1simd::nrm2( b, e);
+			float s4 = du1simd::asum( b, e);
+			auto m = du1simd::iamax( b, e);
+
+			// The same kernels through the read-only view of x
+			const vector_type & cx = x;
+			typename vector_type::const_iterator cb = cx.cbegin() + K1;
+			typename vector_type::const_iterator ce = cx.cend() - 1;
+			float s5 = du1simd::asum( cb, ce);
+			float s6 = du1simd::dot( cb, ce, cb);
+			auto cm = du1simd::iamax( cb, ce);
+
+			assert( std::abs(s1 - 2 * ( 4 - n)) / ( 2 * n) < 0.001);
+			assert( y.begin()[ K1 - 1] == 2.0F && y.begin()[ K1] == 1.5F && * ( y.end() - 1) == 2.0F);
+			assert( std::abs(s3 * s3 - ( n + 8)) / n < 0.001);
+			assert( std::abs(s4 - ( n + 2)) / n < 0.001);
+			assert( m - x.begin() == static_cast< std::ptrdiff_t>( K3 / 2));
+			assert( s5 == s4 && std::abs(s6 - ( n + 8)) / n < 0.001);
+			assert( cm == m && b == cb);
+
+			std::cout << name << "/dot: " << (1000000000.0 * t1 / n) << " ns" << std::endl;
+			std::cout << name << "/axpy: " << (1000000000.0 * t2 / n) << " ns" << std::endl;
+		}
+	};
+
+	void blas_test()
+	{
+		blas_tester< float>::test( "float");
+#if DU1SIMD_HAVE_SSE
+		blas_tester< __m128>::test( "__m128");
+#endif
+#if DU1SIMD_HAVE_NEON
+		blas_tester< float32x4_t>::test( "float32x4_t");
+#endif
+#if DU1SIMD_HAVE_SVE
+		if ( du1simd::supports( du1simd::isa::sve))
+		{
+			blas_tester< du1simd::sve_float32_t>::test( "sve_float32_t");
+		}
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
+		{
+			blas_tester< __m256>::test( "__m256");
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			blas_tester< __m512>::test( "__m512");
+		}
+#endif
+	}
+
+	// Structure of arrays against the array of structures of the same records
+	template< typename simd_carrier_type>
+	struct soa_tester
+	{
+		struct record
+		{
+			float first;
+			std::uint32_t second;
+			std::uint32_t third;
+		};
+
+		static void test( const std::string & name)
+		{
+#ifdef _DEBUG
+			std::size_t K3 = 729001;
+#else
+			std::size_t K3 = 72900001;
+#endif
+			typedef soa_simd_vector< simd_carrier_type, float, std::uint32_t, std::uint32_t> vector_type;
+
+			vector_type soa( K3, du1simd::uninitialized);
+			du1simd::fill( soa.template begin< 0>(), soa.template end< 0>(), 1.0F);
+			du1simd::fill( soa.template begin< 1>(), soa.template end< 1>(), std::uint32_t( 2));
+			du1simd::fill( soa.template begin< 2>(), soa.template end< 2>(), std::uint32_t( 3));
+			soa[ K3 / 2] = std::make_tuple( 5.0F, std::uint32_t( 7), std::uint32_t( 9));
+
+			record r = { 1.0F, 2, 3 };
+			std::vector< record> aos( K3, r);
+			aos[ K3 / 2].first = 5.0F;
+
+			float s1;
+			double t1 = measure_time( [ & s1, & aos](){
+				float acc = 0;
+				for ( auto it = aos.begin(); it != aos.end(); ++ it)
+				{
+					acc += it->first;
+				}
+				s1 = acc;
+			});
+			float s2;
+			double t2 = measure_time( [ & s2, & soa](){
+				s2 = du1simd::reduce_sum( soa.template begin< 0>(), soa.template end< 0>());
+			});
+			std::uint64_t s3 = du1simd::widening_sum( soa.template begin< 1>(), soa.template end< 1>());
+
+			const vector_type & csoa = soa;
+			std::tuple< float, std::uint32_t, std::uint32_t> row = csoa[ K3 / 2];
+
+			assert( std::abs(s1 - s2) / (s1 + s2) < 0.001);
+			assert( std::abs(s2 - ( K3 + 4)) / K3 < 0.001);
+			assert( s3 == 2 * K3 + 5);
+			assert( std::get< 2>( row) == 9 && soa[ K3 / 2 + 1].template get< 2>() == 3);
+
+			std::cout << name << "/aos: " << (1000000000.0 * t1 / K3) << " ns" << std::endl;
+			std::cout << name << "/soa: " << (1000000000.0 * t2 / K3) << " ns" << std::endl;
+		}
+	};
 
-	template< typename value_type, typename simd_carrier_type> 
-	struct simd;
+	void soa_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		soa_tester< __m128>::test( "__m128");
+#endif
+#if DU1SIMD_HAVE_AVX2
+		if ( du1simd::supports( du1simd::isa::avx2))
+		{
+			soa_tester< __m256>::test( "__m256");
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			soa_tester< __m512>::test( "__m512");
+		}
+#endif
+	}
+
+	// Filtering kernels on ranges not aligned to the blocks against the scalar algorithms
+	template< typename T, typename simd_carrier_type>
+	struct filter_tester
+	{
+		static void test( const std::string & name)
+		{
+#ifdef _DEBUG
+			std::size_t K1 = 111, K3 = 729000;
+#else
+			std::size_t K1 = 111, K3 = 72900000;
+#endif
+			typedef simd_vector< T, simd_carrier_type> vector_type;
 
-	template<>
-	struct simd< float, float> {
-		static float broadcast( float x)
+			vector_type x( K3, du1simd::uninitialized);
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ i)
+			{
+				* it = static_cast< T>( ( i * 7919) % 100);
+			}
+
+			auto b = x.begin() + K1;
+			auto e = x.end() - 1;
+			auto pred = du1simd::less< simd_carrier_type>( T( 30));
+			auto scalar_pred = []( T v){ return v < T( 30); };
+
+			std::size_t n1;
+			double t1 = measure_time( [ & n1, b, e, pred](){
+				n1 = du1simd::count_if( b, e, pred);
+			});
+			vector_type y;
+			std::size_t n2;
+			double t2 = measure_time( [ & n2, & y, b, e, pred](){
+				y.clear();
+				n2 = du1simd::copy_if( b, e, y, pred);
+			});
+			vector_type yt, yf;
+			auto n3 = du1simd::partition_copy( b, e, yt, yf, du1simd::between< simd_carrier_type>( T( 10), T( 19)));
+
+			std::vector< T> r;
+			std::copy_if( b, e, std::back_inserter( r), scalar_pred);
+			std::size_t m = static_cast< std::size_t>( e - b);
+
+			assert( n1 == r.size() && n2 == r.size() && y.size() == r.size());
+			assert( std::equal( r.begin(), r.end(), y.begin()));
+			assert( n3.first + n3.second == m && yt.size() == n3.first && yf.size() == n3.second);
+			assert( std::count_if( yt.begin(), yt.end(), []( T v){ return v < T( 10) || v > T( 19); }) == 0);
+			assert( std::count_if( yf.begin(), yf.end(), []( T v){ return v >= T( 10) && v <= T( 19); }) == 0);
+			assert( du1simd::count_if( b, b, pred) == 0 && du1simd::count_if( b, b + 1, du1simd::equal_to< simd_carrier_type>( * b)) == 1);
+
+			std::cout << name << "/count_if: " << (1000000000.0 * t1 / m) << " ns" << std::endl;
+			std::cout << name << "/copy_if: " << (1000000000.0 * t2 / m) << " ns" << std::endl;
+		}
+	};
+
+	void filter_test()
+	{
+		filter_tester< float, float>::test( "float");
+#if DU1SIMD_HAVE_SSE
+		filter_tester< float, __m128>::test( "__m128");
+		filter_tester< double, __m128d>::test( "__m128d");
+#endif
+#if DU1SIMD_HAVE_NEON
+		filter_tester< float, float32x4_t>::test( "float32x4_t");
+#endif
+#if DU1SIMD_HAVE_SVE
+		if ( du1simd::supports( du1simd::isa::sve))
 		{
-			return x;
+			filter_tester< float, du1simd::sve_float32_t>::test( "sve_float32_t");
 		}
-		static float zero()
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
 		{
-			return 0.0F;
+			filter_tester< float, __m256>::test( "__m256");
+			filter_tester< double, __m256d>::test( "__m256d");
 		}
-		static float add( float a, float b)
+#endif
+#if DU1SIMD_HAVE_AVX512
+		if ( du1simd::supports( du1simd::isa::avx512))
 		{
-			return a + b;
+			filter_tester< float, __m512>::test( "__m512");
+			filter_tester< double, __m512d>::test( "__m512d");
 		}
-		static float sub( float a, float b)
+#endif
+	}
+
+	// Sorting kernels on ranges not aligned to the blocks against std::sort
+	template< typename T, typename simd_carrier_type>
+	struct sort_tester
+	{
+		static void test( const std::string & name)
 		{
-			return a - b;
+#ifdef _DEBUG
+			std::size_t K1 = 111, K3 = 729000;
+#else
+			std::size_t K1 = 111, K3 = 72900000;
+#endif
+			typedef simd_vector< T, simd_carrier_type> vector_type;
+
+			vector_type x( K3, du1simd::uninitialized);
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ i)
+			{
+				* it = static_cast< T>( ( i * 7919) % 1000003);
+			}
+
+			auto b = x.begin() + K1;
+			auto e = x.end() - 1;
+			std::vector< T> r( b, e);
+			std::vector< T> s( r);
+
+			double t1 = measure_time( [ & s](){
+				std::sort( s.begin(), s.end());
+			});
+			double t2 = measure_time( [ b, e](){
+				du1simd::sort( b, e);
+			});
+			assert( std::equal( s.begin(), s.end(), b));
+			assert( x.begin()[ K1 - 1] == static_cast< T>( ( ( K1 - 1) * 7919) % 1000003));
+
+			std::size_t k = 100;
+			std::copy( r.begin(), r.end(), b);
+			du1simd::partial_sort( b, b + k, e);
+			assert( std::equal( s.begin(), s.begin() + k, b));
+
+			std::copy( r.begin(), r.end(), b);
+			double t3 = measure_time( [ b, e](){
+				du1simd::parallel_sort( b, e);
+			});
+			assert( std::equal( s.begin(), s.end(), b));
+
+			std::size_t m = static_cast< std::size_t>( e - b);
+			std::cout << name << "/std::sort: " << (1000000000.0 * t1 / m) << " ns" << std::endl;
+			std::cout << name << "/sort: " << (1000000000.0 * t2 / m) << " ns" << std::endl;
+			std::cout << name << "/parallel_sort: " << (1000000000.0 * t3 / m) << " ns" << std::endl;
 		}
-		static float mul( float a, float b)
+	};
+
+	void sort_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		sort_tester< float, __m128>::test( "__m128");
+		sort_tester< std::int32_t, __m128i>::test( "__m128i");
+#endif
+#if DU1SIMD_HAVE_NEON
+		sort_tester< float, float32x4_t>::test( "float32x4_t");
+#endif
+#if DU1SIMD_HAVE_SVE
+		if ( du1simd::supports( du1simd::isa::sve))
 		{
-			return a * b;
+			sort_tester< float, du1simd::sve_float32_t>::test( "sve_float32_t");
 		}
-		static float sum( float a)
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
 		{
-			return a;
+			sort_tester< float, __m256>::test( "__m256");
 		}
-		static float mask_lower( float a, std::ptrdiff_t lgap)
+#endif
+#if DU1SIMD_HAVE_AVX2
+		if ( du1simd::supports( du1simd::isa::avx2))
 		{
-			assert( lgap == 0);
-			return a;
+			sort_tester< std::uint32_t, __m256i>::test( "__m256i");
 		}
-		static float mask_upper( float a, std::ptrdiff_t ugap)
+#endif
+#if DU1SIMD_HAVE_AVX512
+		if ( du1simd::supports( du1simd::isa::avx512))
 		{
-			assert( ugap == 0);
-			return a;
+			sort_tester< float, __m512>::test( "__m512");
+			sort_tester< double, __m512d>::test( "__m512d");
 		}
-		static float mask_both( float a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+#endif
+	}
+
+	// Running totals of an integer column, serial and two-pass parallel, against a scalar loop
+	template< typename simd_carrier_type>
+	struct scan_tester
+	{
+		static void test( const std::string & name)
 		{
-			assert( lgap == 0);
-			assert( ugap == 0);
-			return a;
+#ifdef _DEBUG
+			std::size_t K1 = 111, K3 = 729000;
+#else
+			std::size_t K1 = 111, K3 = 729000000 / 4;
+#endif
+			typedef simd_vector< std::uint32_t, simd_carrier_type> vector_type;
+
+			// One output buffer for both scans
+			vector_type x( K3, du1simd::uninitialized), y( K3, du1simd::uninitialized);
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ i)
+			{
+				* it = static_cast< std::uint32_t>( i % 7);
+			}
+
+			auto b = x.begin() + K1;
+			auto e = x.end() - 1;
+			std::uint32_t init = 1000;
+
+			double t1 = measure_time( [ b, e, & y, init](){
+				du1simd::inclusive_scan( b, e, y.begin(), init);
+			});
+			std::uint32_t s = init;
+			bool ok = true;
+			auto d = y.begin();
+			for ( auto it = b; it != e; ++ it, ++ d)
+			{
+				s += * it;
+				ok = ok && * d == s;
+			}
+			assert( ok);
+
+			double t2 = measure_time( [ b, e, & y, init](){
+				du1simd::parallel_exclusive_scan( b, e, y.begin() + 1, init);
+			});
+			s = init;
+			d = y.begin() + 1;
+			for ( auto it = b; it != e; ++ it, ++ d)
+			{
+				ok = ok && * d == s;
+				s += * it;
+			}
+			assert( ok);
+
+			std::size_t m = static_cast< std::size_t>( e - b);
+			std::cout << name << "/inclusive_scan: " << (1000000000.0 * t1 / m) << " ns" << std::endl;
+			std::cout << name << "/parallel_exclusive_scan: " << (1000000000.0 * t2 / m) << " ns" << std::endl;
 		}
 	};
 
-	template<>
-	struct simd< float, __m128> {
-		static __m128 broadcast( float x)
+	void scan_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		scan_tester< __m128i>::test( "__m128i");
+#endif
+#if DU1SIMD_HAVE_AVX2
+		if ( du1simd::supports( du1simd::isa::avx2))
+		{
+			scan_tester< __m256i>::test( "__m256i");
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512BW
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			scan_tester< __m512i>::test( "__m512i");
+		}
+#endif
+	}
+
+	// Copies of a vector and spans of its sub-ranges
+	template< typename simd_carrier_type>
+	struct copy_tester
+	{
+		static void test( const std::string & name)
 		{
-			__m128 a = _mm_load_ss( & x);
-			return _mm_shuffle_ps( a, a, 0x00);
+#ifdef _DEBUG
+			std::size_t K1 = 111, K3 = 729000;
+#else
+			// x, its copy y and the parallel copy z
+			std::size_t K1 = 111, K3 = release_size( 3 * sizeof( float));
+#endif
+			typedef simd_vector< float, simd_carrier_type> vector_type;
+			typedef simd_span< const float, simd_carrier_type> span_type;
+
+			vector_type x( K3, du1simd::uninitialized);
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ i)
+			{
+				* it = static_cast< float>( i % 1000);
+			}
+
+			vector_type y, z;
+			double t1 = measure_time( [ & x, & y](){
+				y = x;
+			});
+			double t2 = measure_time( [ & x, & z](){
+				z = du1simd::parallel_copy( x);
+			});
+			assert( y.size() == K3 && std::equal( x.begin(), x.end(), y.begin()));
+			assert( z.size() == K3 && std::equal( x.begin(), x.end(), z.begin()));
+
+			// The block of y is reused by the copy of a shorter vector
+			const vector_type w( K1);
+			y = w;
+			assert( y.size() == K1 && y.capacity() >= K3 && std::equal( w.begin(), w.end(), y.begin()));
+			vector_type v( w);
+			assert( v.size() == K1 && std::equal( w.begin(), w.end(), v.begin()));
+
+			span_type s = du1simd::make_span( x).subspan( K1, K3 - 2 * K1);
+			assert( s.size() == K3 - 2 * K1 && s.front() == x.begin()[ K1]);
+			assert( s.lower_offset() == ( x.begin() + K1).lower_offset() && s.upper_offset() == ( x.end() - K1).upper_offset());
+			assert( s.aligned() == ( K1 % vector_type::lanes == 0));
+			assert( du1simd::make_span( x).first( 10 * vector_type::lanes).aligned());
+			assert( s.blocks() == static_cast< std::size_t>( s.upper_block() - s.lower_block()));
+			assert( du1simd::reduce_sum( s.begin(), s.end()) == du1simd::reduce_sum( x.begin() + K1, x.end() - K1));
+
+			double t3 = measure_time( [ & s, & z](){
+				du1simd::copy( s.begin(), s.end(), z.begin() + 1);
+			});
+			assert( std::equal( s.begin(), s.end(), z.begin() + 1) && z.begin()[ 0] == x.begin()[ 0]);
+
+			std::cout << name << "/copy: " << (1000000000.0 * t1 / K3) << " ns" << std::endl;
+			std::cout << name << "/parallel_copy: " << (1000000000.0 * t2 / K3) << " ns" << std::endl;
+			std::cout << name << "/copy_span: " << (1000000000.0 * t3 / s.size()) << " ns" << std::endl;
 		}
-		static __m128 zero()
+	};
+
+	void copy_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		copy_tester< __m128>::test( "__m128");
+#endif
+#if DU1SIMD_HAVE_NEON
+		copy_tester< float32x4_t>::test( "float32x4_t");
+#endif
+#if DU1SIMD_HAVE_SVE
+		if ( du1simd::supports( du1simd::isa::sve))
 		{
-			return _mm_setzero_ps();
+			copy_tester< du1simd::sve_float32_t>::test( "sve_float32_t");
 		}
-		static __m128 add( __m128 a, __m128 b)
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
 		{
-			return _mm_add_ps( a, b);
+			copy_tester< __m256>::test( "__m256");
 		}
-		static __m128 sub( __m128 a, __m128 b)
+#endif
+	}
+
+	// Histograms and grouped aggregates of skewed keys, serial and parallel, against a scalar loop
+	template< typename key_type, typename key_carrier_type, typename value_carrier_type>
+	struct histogram_tester
+	{
+		static void test( const std::string & name)
 		{
-			return _mm_sub_ps( a, b);
+#ifdef _DEBUG
+			std::size_t K1 = 111, K3 = 729000;
+#else
+			// A key and a value per element, the histograms and the group tables are of key_range elements only
+			std::size_t K1 = 111, K3 = release_size( sizeof( key_type) + sizeof( float));
+#endif
+			typedef simd_vector< key_type, key_carrier_type> key_vector_type;
+			typedef simd_vector< float, value_carrier_type> value_vector_type;
+			const std::size_t m = du1simd::key_range< key_type>::value;
+
+			// Every other key is the same, the values are small integers, so the sums are exact
+			key_vector_type k( K3, du1simd::uninitialized);
+			value_vector_type v( K3, du1simd::uninitialized);
+			auto d = v.begin();
+			std::size_t i = 0;
+			for ( auto it = k.begin(); it != k.end(); ++ it, ++ d, ++ i)
+			{
+				* it = static_cast< key_type>( i % 2 == 0 ? 3 : ( i * 7919) % m);
+				* d = static_cast< float>( ( i * 13) % 17) - 8.0F;
+			}
+
+			auto b = k.begin() + K1;
+			auto e = k.end() - 1;
+			auto vb = v.begin() + K1 + 1;
+
+			// Several chunks even in a debug build
+			std::size_t chunk = K3 / 7;
+			std::vector< std::uint64_t> h1, h2;
+			du1simd::group_table< float, value_carrier_type> g1, g2, g3;
+			double t1 = measure_time( [ b, e, & h1](){
+				h1 = du1simd::histogram( b, e);
+			});
+			double t2 = measure_time( [ b, e, chunk, & h2](){
+				h2 = du1simd::parallel_histogram( b, e, du1simd::default_pool(), chunk);
+			});
+			double t3 = measure_time( [ b, e, vb, & g1](){
+				g1 = du1simd::group_by< du1simd::aggregate::sum>( b, e, vb);
+			});
+			double t4 = measure_time( [ b, e, vb, chunk, & g2](){
+				g2 = du1simd::parallel_group_by< du1simd::aggregate::min>( b, e, vb, du1simd::default_pool(), chunk);
+			});
+			g3 = du1simd::parallel_group_by< du1simd::aggregate::max>( b, e, vb, du1simd::default_pool(), chunk);
+			du1simd::group_table< float, value_carrier_type> g4 = du1simd::group_by< du1simd::aggregate::count>( b, e, vb);
+
+			std::vector< std::uint64_t> h( m);
+			std::vector< float> sum( m), lo( m, std::numeric_limits< float>::infinity()), hi( m, - std::numeric_limits< float>::infinity());
+			d = vb;
+			for ( auto it = b; it != e; ++ it, ++ d)
+			{
+				++ h[ * it];
+				sum[ * it] += * d;
+				lo[ * it] = std::min( lo[ * it], * d);
+				hi[ * it] = std::max( hi[ * it], * d);
+			}
+			assert( h1 == h && h2 == h);
+			assert( g1.counts == h && g2.counts == h && g3.counts == h && g4.counts == h && g4.values.empty());
+			assert( std::equal( sum.begin(), sum.end(), g1.values.begin()));
+			assert( std::equal( lo.begin(), lo.end(), g2.values.begin()));
+			assert( std::equal( hi.begin(), hi.end(), g3.values.begin()));
+
+			std::size_t n = static_cast< std::size_t>( e - b);
+			std::cout << name << "/histogram: " << (1000000000.0 * t1 / n) << " ns" << std::endl;
+			std::cout << name << "/parallel_histogram: " << (1000000000.0 * t2 / n) << " ns" << std::endl;
+			std::cout << name << "/group_by_sum: " << (1000000000.0 * t3 / n) << " ns" << std::endl;
+			std::cout << name << "/parallel_group_by_min: " << (1000000000.0 * t4 / n) << " ns" << std::endl;
 		}
-		static __m128 mul( __m128 a, __m128 b)
+	};
+
+	void histogram_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		histogram_tester< std::uint8_t, __m128i, __m128>::test( "uint8_t/__m128i");
+		histogram_tester< std::uint16_t, __m128i, __m128>::test( "uint16_t/__m128i");
+#endif
+#if DU1SIMD_HAVE_AVX2
+		if ( du1simd::supports( du1simd::isa::avx2))
 		{
-			return _mm_mul_ps( a, b);
+			histogram_tester< std::uint16_t, __m256i, __m256>::test( "uint16_t/__m256i");
 		}
-		static float sum( __m128 a)
+#endif
+	}
+
+	// Gathers and scatters through random indices, with and without the prefetches, against a scalar loop
+	template< typename T, typename simd_carrier_type>
+	struct gather_tester
+	{
+		static void test( const std::string & name)
 		{
-			float x;
-			__m128 b = _mm_hadd_ps( a, a);
-			__m128 c = _mm_hadd_ps( b, b);
-			_mm_store_ss( & x, c);
-			return x;
+			// Four vectors of K3 elements are alive at a time
+#ifdef _DEBUG
+			std::size_t K1 = 111, K3 = 729000;
+#else
+			std::size_t K1 = 111, K3 = 729000000 / 8;
+#endif
+			typedef simd_vector< T, simd_carrier_type> vector_type;
+			typedef simd_vector< std::uint32_t, typename du1simd::index_carrier< simd_carrier_type>::type> index_vector_type;
+
+			vector_type x( K3, du1simd::uninitialized);
+			index_vector_type r( K3, du1simd::uninitialized);
+			auto d = r.begin();
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ d, ++ i)
+			{
+				* it = static_cast< T>( i % 1000);
+				* d = static_cast< std::uint32_t>( ( i * 7919) % K3);
+			}
+
+			// Indices and output at different positions within their blocks
+			auto b = r.begin() + K1;
+			auto e = r.end() - 1;
+			vector_type y( K3);
+			double t1 = measure_time( [ & x, b, e, & y](){
+				du1simd::gather( x.begin(), x.end(), b, e, y.begin() + 1);
+			});
+			auto g = y.begin() + 1;
+			for ( auto it = b; it != e; ++ it, ++ g)
+			{
+				assert( * g == x.begin()[ * it]);
+			}
+			double t2;
+			{
+				vector_type z;
+				t2 = measure_time( [ & x, & r, & z](){
+					z = du1simd::gather( x, r, du1simd::gather_prefetch_distance);
+				});
+				assert( z.size() == K3);
+				for ( i = 0; i < K3; ++ i)
+				{
+					assert( z.begin()[ i] == x.begin()[ r.begin()[ i]]);
+				}
+			}
+
+			// Every other index is the same, the last of the equal ones wins
+			for ( d = r.begin(), i = 0; d != r.end(); ++ d, ++ i)
+			{
+				* d = static_cast< std::uint32_t>( i % 2 == 0 ? 5 : ( i * 7919) % K3);
+			}
+			vector_type w( x);
+			double t3 = measure_time( [ & y, & r, & x, K1](){
+				du1simd::scatter( y.begin() + K1, y.end(), r.begin() + K1, x.begin(), x.end());
+			});
+			for ( i = K1; i < K3; ++ i)
+			{
+				w.begin()[ r.begin()[ i]] = y.begin()[ i];
+			}
+			assert( std::equal( w.begin(), w.end(), x.begin()));
+
+			du1simd::scatter( y, r, x, du1simd::gather_prefetch_distance);
+			for ( i = 0; i < K3; ++ i)
+			{
+				w.begin()[ r.begin()[ i]] = y.begin()[ i];
+			}
+			assert( std::equal( w.begin(), w.end(), x.begin()));
+			assert( x.begin()[ 5] == y.begin()[ ( K3 - 1) / 2 * 2]);
+
+			std::size_t m = static_cast< std::size_t>( e - b);
+			std::cout << name << "/gather: " << (1000000000.0 * t1 / m) << " ns" << std::endl;
+			std::cout << name << "/gather_prefetch: " << (1000000000.0 * t2 / K3) << " ns" << std::endl;
+			std::cout << name << "/scatter: " << (1000000000.0 * t3 / ( K3 - K1)) << " ns" << std::endl;
 		}
+	};
 
-		static __m128 mask_lower( __m128 a, std::ptrdiff_t lgap)
+	void gather_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		gather_tester< float, __m128>::test( "__m128");
+#endif
+#if DU1SIMD_HAVE_NEON
+		gather_tester< float, float32x4_t>::test( "float32x4_t");
+#endif
+#if DU1SIMD_HAVE_AVX2
+		if ( du1simd::supports( du1simd::isa::avx2))
+		{
+			gather_tester< float, __m256>::test( "__m256");
+			gather_tester< double, __m256d>::test( "__m256d");
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512
+		if ( du1simd::supports( du1simd::isa::avx512))
 		{
-			assert( lgap >= 0);
-			assert( lgap < 4);
-			return _mm_and_ps( a, mask_data_.lmask_[ lgap]);
+			gather_tester< float, __m512>::test( "__m512");
+			gather_tester< double, __m512d>::test( "__m512d");
 		}
-		static __m128 mask_upper( __m128 a, std::ptrdiff_t ugap)
+#endif
+	}
+
+	// Counters of the registry, the library kernels are counted only in a DU1SIMD_INSTRUMENT build
+	template< typename simd_carrier_type>
+	struct instrument_tester
+	{
+		static void test( const std::string & name)
 		{
-			assert( ugap > -4);
-			assert( ugap <= 0);
-			return _mm_and_ps( a, mask_data_.umask_[ ugap + 3]);
+#ifdef _DEBUG
+			std::size_t K3 = 729000;
+#else
+			std::size_t K3 = 729000000;
+#endif
+			typedef simd_vector< float, simd_carrier_type> vector_type;
+			const std::size_t k = vector_type::lanes;
+
+			vector_type x( K3);
+			du1simd::fill( x.begin(), x.end(), 1.0F);
+
+			// A range of two streams starting after the first lane and ending before the last one
+			du1simd::instrument::counters & c = du1simd::instrument::kernel( ( "test/" + name).c_str());
+			assert( & c == & du1simd::instrument::kernel( ( "test/" + name).c_str()));
+			{
+				du1simd::instrument::scope s( c, du1simd::to_address( x.begin() + 1), K3 - 2, sizeof(float), sizeof(simd_carrier_type), 2);
+			}
+			assert( c.calls == 1 && c.bytes == 2 * ( K3 - 2) * sizeof(float));
+			assert( c.edge_blocks == 2 && c.blocks == K3 / k - 2);
+
+			bool hardware = du1simd::instrument::enable_hardware_counters( true);
+			const std::size_t scopes = 1000;
+			double t1 = measure_time( [ & c, & x, scopes](){
+				for ( std::size_t i = 0; i < scopes; ++ i)
+				{
+					du1simd::instrument::scope s( c, du1simd::to_address( x.begin()), x.size(), sizeof(float), sizeof(simd_carrier_type), 1);
+				}
+			});
+			assert( c.calls == 1 + scopes);
+			assert( hardware || c.cycles == 0);
+			du1simd::instrument::enable_hardware_counters( false);
+
+#if DU1SIMD_INSTRUMENT
+			const std::size_t K1 = 111;
+			du1simd::instrument::reset();
+			float r = du1simd::reduce_sum( x.begin() + K1, x.end());
+			assert( r == static_cast< float>( K3 - K1));
+			bool found = false;
+			for ( const du1simd::instrument::kernel_stats & st : du1simd::instrument::snapshot())
+			{
+				if ( st.name == "reduce_sum")
+				{
+					found = true;
+					assert( st.calls == 1 && st.bytes == ( K3 - K1) * sizeof(float));
+					assert( st.blocks * k + st.edge_blocks * k >= K3 - K1);
+				}
+			}
+			assert( found);
+			du1simd::instrument::report( std::cout);
+#endif
+
+			std::cout << name << "/instrument/scope" << ( hardware ? "/hardware" : "") << ": " << (1000000000.0 * t1 / scopes) << " ns" << std::endl;
 		}
-		static __m128 mask_both( __m128 a, std::ptrdiff_t lgap, std::ptrdiff_t ugap)
+	};
+
+	void instrument_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		instrument_tester< __m128>::test( "__m128");
+#endif
+#if DU1SIMD_HAVE_NEON
+		instrument_tester< float32x4_t>::test( "float32x4_t");
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
 		{
-			return mask_upper( mask_lower( a, lgap), ugap);
+			instrument_tester< __m256>::test( "__m256");
 		}
-	private:
-		struct mask_data {
-			__m128 lmask_[ 4];
-			__m128 umask_[ 4];
-			mask_data()
+#endif
+	}
+
+#if DU1SIMD_HAVE_SSE
+	// Packed columns of 10-bit values, of sorted values and of full-range values against the plain column
+	template< typename simd_carrier_type>
+	struct packed_tester
+	{
+		static void test( const std::string & name)
+		{
+			// Two vectors of K3 elements and the packed copies are alive at a time
+#ifdef _DEBUG
+			std::size_t K3 = 729000;
+#else
+			std::size_t K3 = 729000000 / 8;
+#endif
+			typedef simd_vector< std::uint32_t, simd_carrier_type> vector_type;
+			typedef packed_simd_vector< std::uint32_t, simd_carrier_type> packed_type;
+
+			vector_type x( K3, du1simd::uninitialized);
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ i)
+			{
+				* it = static_cast< std::uint32_t>( ( i * 7919) % 1000);
+			}
+
+			// Not a whole number of frames, so the last one is partial
+			packed_type p( x.begin(), x.end() - 3);
+			assert( p.size() == K3 - 3);
+			assert( p.packed_bytes() < ( K3 - 3) * sizeof(std::uint32_t) / 3 + p.frames() * sizeof(du1simd::packed_frame));
+			for ( std::size_t f = 0; f < p.frames(); ++ f)
+			{
+				assert( p.frame( f).bits <= 10);
+			}
+
+			std::uint64_t s1 = 0, s2 = 0;
+			double t1 = measure_time( [ & x, & s1](){
+				s1 = du1simd::widening_sum( x.begin(), x.end() - 3);
+			});
+			double t2 = measure_time( [ & p, & s2](){
+				s2 = du1simd::widening_sum( p);
+			});
+			assert( s1 == s2);
+			assert( du1simd::reduce_sum( p) == static_cast< std::uint32_t>( s1));
+
+			std::size_t c1 = du1simd::count_if( x.begin(), x.end() - 3, du1simd::less< simd_carrier_type>( 500u));
+			std::size_t c2 = 0;
+			double t3 = measure_time( [ & p, & c2](){
+				c2 = du1simd::count_if( p, du1simd::less< simd_carrier_type>( 500u));
+			});
+			assert( c1 == c2);
+
+			{
+				vector_type u = p.unpack();
+				assert( u.size() == K3 - 3);
+				assert( std::equal( u.begin(), u.end(), x.begin()));
+			}
+			for ( i = 0; i < K3 - 3; i += 997)
+			{
+				assert( p[ i] == x.begin()[ i]);
+			}
+
+			// Sorted values take a few bits of delta, full-range values take 32 bits and still round-trip
+			vector_type y( x);
+			std::sort( y.begin(), y.end());
+			packed_type q( y);
+			for ( std::size_t f = 0; f < q.frames(); ++ f)
 			{
-				lmask_[ 0] = _mm_castsi128_ps( _mm_set_epi32( -1, -1, -1, -1));
-				lmask_[ 1] = _mm_castsi128_ps( _mm_set_epi32( -1, -1, -1,  0));
-				lmask_[ 2] = _mm_castsi128_ps( _mm_set_epi32( -1, -1,  0,  0));
-				lmask_[ 3] = _mm_castsi128_ps( _mm_set_epi32( -1,  0,  0,  0));
-				umask_[ 0] = _mm_castsi128_ps( _mm_set_epi32(  0,  0,  0, -1));
-				umask_[ 1] = _mm_castsi128_ps( _mm_set_epi32(  0,  0, -1, -1));
-				umask_[ 2] = _mm_castsi128_ps( _mm_set_epi32(  0, -1, -1, -1));
-				umask_[ 3] = _mm_castsi128_ps( _mm_set_epi32( -1, -1, -1, -1));
+				assert( q.frame( f).bits <= 1);
 			}
-		};
-		static const mask_data mask_data_;
-	};
+			assert( du1simd::widening_sum( q) == s1 + du1simd::widening_sum( x.end() - 3, x.end()));
+			assert( std::equal( y.begin(), y.end(), q.unpack().begin()));
 
-	const simd< float, __m128>::mask_data simd< float, __m128>::mask_data_;
-};
+			i = 0;
+			for ( auto it = y.begin(); it != y.end(); ++ it, ++ i)
+			{
+				* it = static_cast< std::uint32_t>( i * 2654435761u);
+			}
+			packed_type r( y.begin() + 1, y.end());
+			assert( std::equal( y.begin() + 1, y.end(), r.unpack().begin()));
+			assert( r[ K3 - 2] == y.begin()[ K3 - 1]);
 
-namespace du1example {
+			std::cout << name << "/widening_sum: " << (1000000000.0 * t1 / K3) << " ns" << std::endl;
+			std::cout << name << "/packed/widening_sum: " << (1000000000.0 * t2 / K3) << " ns" << std::endl;
+			std::cout << name << "/packed/count_if: " << (1000000000.0 * t3 / K3) << " ns" << std::endl;
+			std::cout << name << "/packed/ratio: " << (static_cast< double>( p.packed_bytes()) / ( ( K3 - 3) * sizeof(std::uint32_t))) << std::endl;
+		}
+	};
+#endif
 
-	template< typename F>
-	double measure_time( F f)
+	void packed_test()
 	{
-		auto tb = std::chrono::steady_clock::now();
-		f();
-		auto te = std::chrono::steady_clock::now();
-		return std::chrono::duration_cast<std::chrono::microseconds>( te - tb).count() / 1000000.0;
+#if DU1SIMD_HAVE_SSE
+		packed_tester< __m128i>::test( "__m128i");
+#endif
+#if DU1SIMD_HAVE_AVX2
+		if ( du1simd::supports( du1simd::isa::avx2))
+		{
+			packed_tester< __m256i>::test( "__m256i");
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512BW
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			packed_tester< __m512i>::test( "__m512i");
+		}
+#endif
 	}
 
+	// Streams a generated input through the pipeline in chunks, against the sum of the whole vector
 	template< typename simd_carrier_type>
-	struct tester
+	struct stream_tester
 	{
-		typedef simd_vector< float, simd_carrier_type> vector_type;
+		static void test( const std::string & name)
+		{
+#ifdef _DEBUG
+			std::size_t K2 = 10000, K3 = 729000;
+#else
+			std::size_t K2 = 1000000, K3 = 729000000;
+#endif
+			typedef simd_vector< float, simd_carrier_type> vector_type;
+			typedef du1simd::stream_pipeline< float, simd_carrier_type> pipeline_type;
+			typedef typename pipeline_type::iterator iterator;
 
-		typedef typename vector_type::iterator simd_iterator;
+			vector_type x( K3, du1simd::uninitialized);
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ i)
+			{
+				* it = static_cast< float>( i % 1000) * 0.001F;
+			}
 
-		typedef du1simd::simd< float, simd_carrier_type> simd_op;
+			// The source delivers odd pieces, the pipeline fills whole chunks from them
+			std::size_t position = 0;
+			auto source = [ & x, & position]( float * p, std::size_t n){
+				n = std::min( std::min( n, x.size() - position), std::size_t( 7777));
+				std::copy( x.begin() + position, x.begin() + position + n, p);
+				position += n;
+				return n;
+			};
 
-		static float sum( simd_iterator b, simd_iterator e)
-		{
-			float acc = 0;
+			pipeline_type pipeline( K2 + 1, 3);
+			assert( pipeline.chunk_size() % vector_type::lanes == 0);
+			du1simd::running_sum< float, simd_carrier_type> s;
+			std::size_t chunks = 0;
+			std::size_t m = 0;
+			double t1 = measure_time( [ & pipeline, & source, & s, & chunks, & m](){
+				m = pipeline.run( source, [ & s, & chunks]( iterator b, iterator e){
+					s.add( b, e);
+					++ chunks;
+				});
+			});
+			assert( m == K3);
+			assert( chunks == ( K3 + pipeline.chunk_size() - 1) / pipeline.chunk_size());
+			assert( pipeline.pool().allocations() == 3);
 
-			for (; b != e; ++ b)
+			float r = du1simd::reduce_sum( x.begin(), x.end());
+			assert( std::abs( s.value() - r) <= 1e-5F * std::abs( r));
+
+			// The pipeline is reused without new allocations, the exceptions of f and of the source propagate
+			position = 0;
+			bool thrown = false;
+			try
 			{
-				acc = acc + * b;
+				pipeline.run( source, [ & chunks]( iterator, iterator){
+					if ( -- chunks == 1)
+					{
+						throw std::runtime_error( "stop");
+					}
+				});
+			}
+			catch ( const std::runtime_error &)
+			{
+				thrown = true;
 			}
+			assert( thrown);
+			thrown = false;
+			try
+			{
+				pipeline.run( []( float *, std::size_t) -> std::size_t { throw std::runtime_error( "read"); }, []( iterator, iterator){ });
+			}
+			catch ( const std::runtime_error &)
+			{
+				thrown = true;
+			}
+			assert( thrown);
+			assert( pipeline.pool().allocations() == 3);
 
-			return acc;
+			// Binary elements of a stream, the partial last element is dropped
+			std::string bytes( reinterpret_cast< const char *>( du1simd::to_address( x.begin())), K2 * sizeof(float) + 1);
+			std::istringstream is( bytes);
+			du1simd::running_sum< float, simd_carrier_type> t;
+			m = pipeline.run( du1simd::istream_source< float>( is), [ & t]( iterator b, iterator e){ t.add( b, e); });
+			assert( m == K2);
+			float u = du1simd::reduce_sum( x.begin(), x.begin() + K2);
+			assert( std::abs( t.value() - u) <= 1e-5F * std::abs( u));
+
+			std::cout << name << "/stream/running_sum: " << (1000000000.0 * t1 / K3) << " ns" << std::endl;
 		}
+	};
 
-		static float simd_sum( simd_iterator b, simd_iterator e)
+	void stream_test()
+	{
+#if DU1SIMD_HAVE_SSE
+		stream_tester< __m128>::test( "__m128");
+
+		// Integer sums carried across the chunks are exact
+		typedef du1simd::stream_pipeline< std::uint8_t, __m128i> pipeline_type;
+		pipeline_type pipeline( 1000);
+		std::size_t left = 100000;
+		du1simd::running_widening_sum< std::uint8_t, __m128i> s;
+		pipeline.run( [ & left]( std::uint8_t * p, std::size_t n){
+			n = std::min( n, left);
+			std::fill( p, p + n, std::uint8_t( 255));
+			left -= n;
+			return n;
+		}, [ & s]( pipeline_type::iterator b, pipeline_type::iterator e){
+			s.add( b + 1, e);
+			s.add( b, b + 1);
+		});
+		assert( s.value() == 255u * 100000u);
+#endif
+#if DU1SIMD_HAVE_NEON
+		stream_tester< float32x4_t>::test( "float32x4_t");
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
 		{
-			auto bb = b.lower_block();
-			auto ee = e.upper_block();
+			stream_tester< __m256>::test( "__m256");
+		}
+#endif
+	}
 
-			if ( bb == ee )
-			{
-				return 0;
-			}
+	// Distance of x from the exact value y in units of the last place of T at y
+	template< typename T>
+	long double ulp_error( T x, long double y)
+	{
+		if ( std::isnan( y) || std::isinf( y))
+		{
+			return ( x == y || ( std::isnan( x) && std::isnan( y))) ? 0 : std::numeric_limits< long double>::infinity();
+		}
+		T r = std::abs( static_cast< T>( y));
+		long double u = r < std::numeric_limits< T>::min() ? std::numeric_limits< T>::denorm_min() : std::nextafter( r, std::numeric_limits< T>::infinity()) - r;
+		return std::abs( x - y) / u;
+	}
 
-			-- ee;
+	// Lazy functions of a vector against the long double functions of the C library
+	template< typename T, typename simd_carrier_type>
+	struct math_tester
+	{
+		typedef simd_vector< T, simd_carrier_type> vector_type;
 
-			if ( bb == ee )
+		// Largest error of z = e( x) over n points of [lo, hi), of a log-uniform spread if logarithmic
+		template< typename E, typename F>
+		static long double max_error( std::size_t n, T lo, T hi, bool logarithmic, E e, F f)
+		{
+			vector_type x( n), z( n);
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ i)
 			{
-				return simd_op::sum( simd_op::mask_both( * bb, b.lower_offset(), e.upper_offset()));
+				long double t = static_cast< long double>( ( i * 7919) % n) / n;
+				* it = logarithmic ? static_cast< T>( lo * std::pow( static_cast< long double>( hi) / lo, t)) : static_cast< T>( lo + ( hi - lo) * t);
 			}
-
-			simd_carrier_type acc = simd_op::mask_lower( * bb, b.lower_offset());
-
-			for ( ++ bb; bb != ee; ++ bb)
+			z = e( x);
+			long double m = 0;
+			for ( i = 0; i < n; ++ i)
 			{
-				acc = simd_op::add( acc, * bb);
+				m = std::max( m, ulp_error( z.begin()[ i], f( static_cast< long double>( x.begin()[ i]))));
 			}
-
-			return simd_op::sum( simd_op::add( acc, simd_op::mask_upper( * bb, e.upper_offset())));
+			return m;
 		}
 
 		static void test( const std::string & name)
 		{
 #ifdef _DEBUG
-			std::size_t K1 = 111, K2 = 700666, K3 = 729000;
+			std::size_t K2 = 100001;
 #else
-			std::size_t K1 = 111, K2 = 700000666, K3 = 729000000;
+			std::size_t K2 = 10000001;
 #endif
-			float X1 = 0.0F, X2 = 1.00F;
+			typedef du1simd::math< T, simd_carrier_type> math_type;
+			const bool single = sizeof(T) == sizeof(float);
+			const T exp_lo = single ? -87 : -708, exp_hi = single ? 88 : 709;
 
-			vector_type vec( K3);
+			long double e1 = max_error( K2, exp_lo, exp_hi, false, []( const vector_type & x){ return du1simd::exp( x); }, []( long double x){ return std::exp( x); });
+			long double e2 = max_error( K2, std::numeric_limits< T>::denorm_min(), std::numeric_limits< T>::max(), true, []( const vector_type & x){ return du1simd::log( x); }, []( long double x){ return std::log( x); });
+			long double e3 = max_error( K2, static_cast< T>( 0.5), static_cast< T>( 2), false, []( const vector_type & x){ return du1simd::log( x); }, []( long double x){ return std::log( x); });
+			long double e4 = max_error( K2, -25, 25, false, []( const vector_type & x){ return du1simd::tanh( x); }, []( long double x){ return std::tanh( x); });
+			long double e5 = max_error( K2, std::numeric_limits< T>::min(), 1, true, []( const vector_type & x){ return du1simd::tanh( x); }, []( long double x){ return std::tanh( x); });
+			long double e6 = max_error( K2, exp_lo, - exp_lo, false, []( const vector_type & x){ return du1simd::sigmoid( x); }, []( long double x){ return 1 / ( 1 + std::exp( - x)); });
+			long double e7 = max_error( K2, 0, 1000, false, []( const vector_type & x){ return du1simd::sqrt( du1simd::abs( 0 - x)); }, []( long double x){ return std::sqrt( x); });
+			assert( e1 <= 1.5 && e2 <= 2 && e3 <= 2 && e4 <= 3 && e5 <= 3 && e6 <= 3 && e7 <= 0.5);
 
-			float gen = X1;
-			/*
-			long long i = 0;
-			for (auto it = vec.begin(); it != vec.end(); it++) {
-				i++;
-				if (i % 1000 == 0) std::cout << i << std::endl;
-				(*it) = 15;
+			// Special values, the padding of the lanes is not used by the scalar carriers
+			const T inf = std::numeric_limits< T>::infinity();
+			simd_carrier_type a = du1simd::simd< T, simd_carrier_type>::broadcast( inf);
+			assert( reinterpret_cast< const T *>( & a)[ 0] == inf);
+			simd_carrier_type b = math_type::exp( a);
+			assert( reinterpret_cast< const T *>( & b)[ 0] == inf);
+			b = math_type::exp( du1simd::simd< T, simd_carrier_type>::broadcast( - inf));
+			assert( reinterpret_cast< const T *>( & b)[ 0] == 0);
+			b = math_type::log( du1simd::simd< T, simd_carrier_type>::zero());
+			assert( reinterpret_cast< const T *>( & b)[ 0] == - inf);
+			b = math_type::log( du1simd::simd< T, simd_carrier_type>::broadcast( -1));
+			assert( std::isnan( reinterpret_cast< const T *>( & b)[ 0]));
+			b = math_type::tanh( du1simd::simd< T, simd_carrier_type>::broadcast( std::numeric_limits< T>::quiet_NaN()));
+			assert( std::isnan( reinterpret_cast< const T *>( & b)[ 0]));
+
+			// Functions and arithmetic fused into one pass, the same as the element-wise calls
+			vector_type x( K2), y( K2), z( K2);
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ i)
+			{
+				* it = static_cast< T>( i % 1000) / 100 - 5;
 			}
-			*/
-			std::generate( vec.begin(), vec.end(), [ & gen, X2](){
-				return gen += X2;
+			double t1 = measure_time( [ & x, & y](){
+				y = du1simd::max( du1simd::exp( -0.5F * x * x), 0.125F) / 2.5066283F;
 			});
+			double t2 = measure_time( [ & x, & z](){
+				for ( std::size_t j = 0; j < z.size(); ++ j)
+				{
+					z.begin()[ j] = std::max( static_cast< T>( std::exp( static_cast< T>( -0.5F) * x.begin()[ j] * x.begin()[ j])), static_cast< T>( 0.125F)) / static_cast< T>( 2.5066283F);
+				}
+			});
+			for ( i = 0; i < K2; ++ i)
+			{
+				assert( ulp_error( y.begin()[ i], static_cast< long double>( z.begin()[ i])) <= 4);
+			}
 
-			auto b = vec.begin() + K1;
-			auto e = vec.begin() + K2;
+			std::cout << name << "/math/ulp: exp " << e1 << ", log " << std::max( e2, e3) << ", tanh " << std::max( e4, e5) << ", sigmoid " << e6 << std::endl;
+			std::cout << name << "/math/expression: " << (1000000000.0 * t1 / K2) << " ns" << std::endl;
+			std::cout << name << "/math/std: " << (1000000000.0 * t2 / K2) << " ns" << std::endl;
+		}
+	};
 
-			float exp = (K2 - K1) * (X1 + (K2 + K1 + 1) * X2 / 2);
-			float s1; 
-			double t1 = measure_time( [ & s1, b, e](){
-				s1 = sum( b, e);
-			});
-			float s2;
-			double t2 = measure_time( [ & s2, b, e](){
-				s2 = simd_sum( b, e);
-			});
+	// Evaluation of expressions and the rejection of operands of different sizes
+	template< typename simd_carrier_type>
+	struct expression_tester
+	{
+		typedef simd_vector< float, simd_carrier_type> vector_type;
 
-			assert( std::abs(s1 - s2) / std::abs(s1 + s2) < 0.001);
-			assert( std::abs(s1 - exp) / std::abs(s1 + exp) < 0.001);
+		template< typename F>
+		static bool throws_length_error( F f)
+		{
+			try
+			{
+				f();
+			}
+			catch ( const std::length_error &)
+			{
+				return true;
+			}
+			return false;
+		}
 
-			std::cout << name << "/sum: " << (1000000000.0 * t1 / (K2-K1)) << " ns" << std::endl;
-			std::cout << name << "/simd_sum: " << (1000000000.0 * t2 / (K2-K1)) << " ns" << std::endl;
+		static void test()
+		{
+			const std::size_t n = 1001;
+			vector_type x( n), y( n), z( n), w( n + 1), e;
+			std::size_t i = 0;
+			for ( auto it = x.begin(); it != x.end(); ++ it, ++ i)
+			{
+				* it = static_cast< float>( i);
+			}
+			std::fill( y.begin(), y.end(), 1.0F);
+			std::fill( w.begin(), w.end(), 3.0F);
+
+			z = 2.0F * x + y;
+			for ( i = 0; i < n; ++ i)
+			{
+				assert( z.begin()[ i] == 2.0F * i + 1);
+			}
+
+			// Operands of different sizes, an empty vector is not a scalar
+			assert( throws_length_error( [ & x, & w, & z](){ z = x + w; }));
+			assert( throws_length_error( [ & x, & e, & z](){ z = 2.0F * x - e; }));
+			assert( throws_length_error( [ & x, & y, & w](){ w = x * y; }));
+			assert( throws_length_error( [ & x, & y, & e](){ e = du1simd::sqrt( x + y); }));
+			assert( std::count( w.begin(), w.end(), 3.0F) == static_cast< std::ptrdiff_t>( n + 1));
 		}
 	};
 
-	void test()
+	void expression_test()
 	{
-		tester< float>::test( "float");
-		tester< __m128>::test( "__m128");
+		expression_tester< float>::test();
+#if DU1SIMD_HAVE_SSE
+		expression_tester< __m128>::test();
+#endif
+#if DU1SIMD_HAVE_NEON
+		expression_tester< float32x4_t>::test();
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
+		{
+			expression_tester< __m256>::test();
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			expression_tester< __m512>::test();
+		}
+#endif
+	}
+
+	void math_test()
+	{
+		math_tester< float, float>::test( "float");
+		math_tester< double, double>::test( "double");
+#if DU1SIMD_HAVE_SSE
+		math_tester< float, __m128>::test( "__m128");
+		math_tester< double, __m128d>::test( "__m128d");
+#endif
+#if DU1SIMD_HAVE_NEON
+		math_tester< float, float32x4_t>::test( "float32x4_t");
+#endif
+#if DU1SIMD_HAVE_AVX
+		if ( du1simd::supports( du1simd::isa::avx))
+		{
+			math_tester< float, __m256>::test( "__m256");
+			math_tester< double, __m256d>::test( "__m256d");
+		}
+#endif
+#if DU1SIMD_HAVE_AVX512
+		if ( du1simd::supports( du1simd::isa::avx512))
+		{
+			math_tester< float, __m512>::test( "__m512");
+			math_tester< double, __m512d>::test( "__m512d");
+		}
+#endif
 	}
 };
 
@@ -248,6 +1767,8 @@ simd_vector<uint8_t, uint32_t> make_vector(std::size_t size)
 }
 
 void iterator_test() {
+	static_assert(simd_vector<uint8_t, uint32_t>::lanes == 4, "Lane count must be a compile-time constant!");
+
 	simd_vector<uint8_t, uint32_t> my_vector(20);
 	simd_vector<uint8_t, uint32_t> my_new_vector = make_vector(20);
 
@@ -295,6 +1816,311 @@ void iterator_test() {
 	std::cout << (uint32_t)my_it[5] << std::endl;
 }
 
+// 4B element counting its live instances, the construction number throw_at throws
+struct counted
+{
+	static int live;
+	static int throw_at;
+
+	std::uint32_t value;
+
+	counted() : value(0) { enter(); }
+	counted(const counted& c) : value(c.value) { enter(); }
+	~counted() { --live; }
+
+	static void enter()
+	{
+		if (throw_at == 0)
+		{
+			throw std::runtime_error("counted");
+		}
+		--throw_at;
+		++live;
+	}
+};
+
+int counted::live = 0;
+int counted::throw_at = -1;
+
+// A constructor throwing in the middle of the size constructor or of resize leaves no element behind
+void exception_safety_test()
+{
+	typedef simd_vector<counted, std::uint64_t> vector_type;
+	{
+		vector_type v(10);
+		assert(counted::live == 10);
+		v.reserve(30);
+
+		bool thrown = false;
+		counted::throw_at = 5;
+		try
+		{
+			v.resize(30);
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		assert(thrown && v.size() == 10 && counted::live == 10);
+
+		thrown = false;
+		counted::throw_at = 3;
+		try
+		{
+			v.resize(30, counted());
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		assert(thrown && v.size() == 10 && counted::live == 10);
+
+		// A copy of the relocation throws, the old block is kept
+		thrown = false;
+		counted::throw_at = 4;
+		try
+		{
+			v.resize(300);
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		assert(thrown && v.size() == 10 && counted::live == 10);
+
+		thrown = false;
+		counted::throw_at = 7;
+		try
+		{
+			vector_type w(20);
+		}
+		catch (const std::runtime_error&)
+		{
+			thrown = true;
+		}
+		assert(thrown && counted::live == 10);
+
+		counted::throw_at = -1;
+		v.resize(4);
+		assert(v.size() == 4 && counted::live == 4);
+	}
+	assert(counted::live == 0);
+
+	// Shrinking an uninitialized resize destroys the elements past the new size as well
+	simd_vector<float, std::uint64_t> u(10);
+	u.resize(3, du1simd::uninitialized);
+	assert(u.size() == 3);
+	u.resize(12, du1simd::uninitialized);
+	assert(u.size() == 12 && u.capacity() >= 12);
+}
+
+// Allocator of simd_allocator blocks counting the allocations and the reallocations
+template< typename T, typename S>
+struct counting_allocator
+{
+	typedef T value_type;
+
+	static const std::size_t alignment = du1simd::allocator_alignment<du1simd::simd_allocator<T, S> >::value;
+
+	static int allocations;
+	static int reallocations;
+
+	counting_allocator() { }
+	template< typename U>
+	counting_allocator(const counting_allocator<U, S>&) { }
+
+	T* allocate(std::size_t n)
+	{
+		++allocations;
+		return du1simd::simd_allocator<T, S>().allocate(n);
+	}
+
+	void deallocate(T* p, std::size_t n)
+	{
+		du1simd::simd_allocator<T, S>().deallocate(p, n);
+	}
+
+	T* reallocate(T* p, std::size_t old_count, std::size_t new_count)
+	{
+		++reallocations;
+		T* r = du1simd::simd_allocator<T, S>().allocate(new_count);
+		std::memcpy(static_cast<void*>(r), static_cast<const void*>(p), (old_count < new_count ? old_count : new_count) * sizeof(T));
+		deallocate(p, old_count);
+		return r;
+	}
+
+	bool operator==(const counting_allocator&) const { return true; }
+	bool operator!=(const counting_allocator&) const { return false; }
+};
+
+template< typename T, typename S>
+int counting_allocator<T, S>::allocations = 0;
+template< typename T, typename S>
+int counting_allocator<T, S>::reallocations = 0;
+
+// 4B element which is not trivially copyable, counting its moves and copies
+template< bool nothrow_move>
+struct relocated
+{
+	static int moves;
+	static int copies;
+
+	std::uint32_t value;
+
+	relocated(std::uint32_t v) : value(v) { }
+	relocated(const relocated& r) : value(r.value) { ++copies; }
+	relocated(relocated&& r) noexcept(nothrow_move) : value(r.value) { ++moves; }
+	~relocated() { }
+};
+
+template< bool nothrow_move>
+int relocated<nothrow_move>::moves = 0;
+template< bool nothrow_move>
+int relocated<nothrow_move>::copies = 0;
+
+// Whether the data of v starts at a block boundary
+template< typename V>
+bool block_aligned(const V& v, std::size_t block)
+{
+	return reinterpret_cast<std::uintptr_t>(du1simd::to_address(v.begin())) % block == 0;
+}
+
+// Whether v holds first, first + 1, ... converted to its value type
+template< typename V>
+bool holds_sequence(const V& v, std::uint32_t first = 0)
+{
+	std::uint32_t j = first;
+	for (auto it = v.begin(); it != v.end(); ++it, ++j)
+	{
+		if (static_cast<std::uint32_t>(*it) != j)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Relocation of the growth of trivially copyable and of non-trivial elements
+template< bool nothrow_move>
+void relocation_test()
+{
+	typedef relocated<nothrow_move> element_type;
+	typedef simd_vector<element_type, std::uint64_t> vector_type;
+
+	vector_type v;
+	for (std::uint32_t i = 0; i < 1000; ++i)
+	{
+		v.push_back(element_type(i));
+		assert(block_aligned(v, sizeof(std::uint64_t)));
+	}
+	for (std::uint32_t i = 0; i < 1000; ++i)
+	{
+		assert(v.begin()[i].value == i);
+	}
+
+	// The move constructor relocates if it cannot throw, the copy constructor otherwise
+	element_type::moves = element_type::copies = 0;
+	v.reserve(5000);
+	assert(v.capacity() == 5000);
+	assert(nothrow_move ? (element_type::moves == 1000 && element_type::copies == 0) : (element_type::moves == 0 && element_type::copies == 1000));
+	for (std::uint32_t i = 0; i < 1000; ++i)
+	{
+		assert(v.begin()[i].value == i);
+	}
+
+	// The argument refers to an element of the block being relocated
+	v.resize(v.capacity(), element_type(0));
+	v.begin()[4999].value = 77;
+	v.emplace_back(v.begin()[4999]);
+	assert(v.size() == 5001 && v.begin()[5000].value == 77 && v.begin()[4999].value == 77 && v.begin()[999].value == 999);
+}
+
+// 32B block, over the malloc alignment
+struct block32
+{
+	std::uint64_t q[4];
+};
+
+// Growth of the capacity by push_back, reserve and shrink_to_fit with blocks of S
+template< typename S>
+void growth_test()
+{
+	typedef counting_allocator<float, S> allocator_type;
+	typedef simd_vector<float, S, allocator_type> vector_type;
+	const std::size_t lanes = vector_type::lanes;
+
+	allocator_type::allocations = allocator_type::reallocations = 0;
+
+	// A vector of no elements allocates nothing
+	{
+		vector_type z;
+		vector_type e(0);
+		z.reserve(0);
+		z.shrink_to_fit();
+		e.resize(0);
+		vector_type c(e);
+		assert(z.capacity() == 0 && e.capacity() == 0 && c.capacity() == 0 && z.begin() == z.end());
+	}
+	assert(allocator_type::allocations == 0);
+
+	// The capacity at least doubles and stays a multiple of k, every new block is aligned and keeps the elements
+	vector_type v;
+	std::size_t capacity = 0;
+	int growths = 0;
+	for (std::uint32_t i = 0; i < 100000; ++i)
+	{
+		v.push_back(static_cast<float>(i));
+		if (v.capacity() != capacity)
+		{
+			assert(v.capacity() >= 2 * capacity && v.capacity() % lanes == 0);
+			assert(block_aligned(v, sizeof(S)) && holds_sequence(v));
+			capacity = v.capacity();
+			++growths;
+		}
+	}
+	assert(v.size() == 100000 && holds_sequence(v));
+	assert(allocator_type::allocations == growths && growths <= 20);
+
+	// reserve uses the reallocate method of an allocator which aligns the blocks itself
+	std::size_t n = 3 * v.capacity() + 1;
+	v.reserve(n);
+	assert(v.capacity() == (n + lanes - 1) / lanes * lanes);
+	assert(allocator_type::reallocations == (allocator_type::alignment % sizeof(S) == 0 ? 1 : 0));
+	assert(block_aligned(v, sizeof(S)) && holds_sequence(v));
+
+	// The argument of push_back refers to an element of the block being relocated
+	while (v.size() != v.capacity())
+	{
+		v.push_back(static_cast<float>(v.size()));
+	}
+	capacity = v.capacity();
+	v.push_back(v.begin()[v.size() - 1]);
+	assert(v.capacity() > capacity && v.begin()[v.size() - 1] == v.begin()[v.size() - 2]);
+	v.pop_back();
+	assert(holds_sequence(v));
+
+	// shrink_to_fit keeps the size rounded up to a multiple of k
+	v.resize(13);
+	v.shrink_to_fit();
+	assert(v.capacity() == (13 + lanes - 1) / lanes * lanes);
+	assert(block_aligned(v, sizeof(S)) && holds_sequence(v));
+	v.clear();
+	v.shrink_to_fit();
+	assert(v.capacity() == 0 && v.begin() == v.end());
+
+	// The default allocator reallocates by realloc where the malloc alignment suffices
+	simd_vector<float, S> w;
+	for (std::uint32_t i = 0; i < 1000; ++i)
+	{
+		w.push_back(static_cast<float>(i));
+	}
+	w.reserve(100000);
+	assert(w.capacity() == (100000 + lanes - 1) / lanes * lanes);
+	assert(block_aligned(w, sizeof(S)) && holds_sequence(w));
+	w.shrink_to_fit();
+	assert(w.capacity() == 1000 && block_aligned(w, sizeof(S)) && holds_sequence(w));
+}
+
 // 8B structure
 struct s1 
 {
@@ -321,8 +2147,34 @@ void static_assert_test()
 
 int main(int argc, char* *argv)
 {
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		return du1bench::main(argc - 2, argv + 2);
+	}
+
 	iterator_test();
+	exception_safety_test();
+	growth_test<std::uint64_t>();
+	growth_test<block32>();
+	relocation_test<true>();
+	relocation_test<false>();
 	du1example::test();
+	du1example::allocation_test();
+	du1example::mapping_test();
+	du1example::integer_test();
+	du1example::blas_test();
+	du1example::soa_test();
+	du1example::filter_test();
+	du1example::sort_test();
+	du1example::scan_test();
+	du1example::copy_test();
+	du1example::instrument_test();
+	du1example::histogram_test();
+	du1example::gather_test();
+	du1example::packed_test();
+	du1example::stream_test();
+	du1example::math_test();
+	du1example::expression_test();
 	return 0;
 }
 